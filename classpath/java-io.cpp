@@ -35,6 +35,7 @@
 #  define CHMOD(path, mode) _wchmod(path, mode)
 #  define UNLINK _wunlink
 #  define RENAME _wrename
+#  define LSEEK _lseeki64
 #  define OPEN_MASK O_BINARY
 
 #  define CHECK_X_OK R_OK
@@ -60,6 +61,10 @@ typedef wchar_t char_t;
 #  include <dirent.h>
 #  include <unistd.h>
 #  include "sys/mman.h"
+#  ifdef __linux__
+#    include <sys/sendfile.h>
+#    include <sys/syscall.h>
+#  endif
 
 #  define ACCESS access
 #  define OPEN open
@@ -72,6 +77,7 @@ typedef wchar_t char_t;
 #  define CHMOD chmod
 #  define UNLINK unlink
 #  define RENAME rename
+#  define LSEEK lseek
 #  define OPEN_MASK 0
 
 #  define CHECK_X_OK X_OK
@@ -295,6 +301,152 @@ unmap(JNIEnv*, Mapping* mapping)
 
 #endif // not PLATFORM_WINDOWS
 
+inline int
+doRead(JNIEnv* e, jint fd, void* data, jint length, jlong position)
+{
+  int r;
+  if (position < 0) {
+    r = READ(fd, data, length);
+  } else {
+#ifdef PLATFORM_WINDOWS
+    jlong old = LSEEK(fd, 0, SEEK_CUR);
+    if (old < 0 or LSEEK(fd, position, SEEK_SET) < 0) {
+      r = -1;
+    } else {
+      r = READ(fd, data, length);
+      LSEEK(fd, old, SEEK_SET);
+    }
+#else
+    r = pread(fd, data, length, position);
+#endif
+  }
+
+  if (r > 0) {
+    return r;
+  } else if (r == 0) {
+    return -1;
+  } else {
+    throwNewErrno(e, "java/io/IOException");
+    return 0;
+  }
+}
+
+inline int
+doWrite(JNIEnv* e, jint fd, const void* data, jint length, jlong position)
+{
+  int r;
+  if (position < 0) {
+    r = WRITE(fd, data, length);
+  } else {
+#ifdef PLATFORM_WINDOWS
+    jlong old = LSEEK(fd, 0, SEEK_CUR);
+    if (old < 0 or LSEEK(fd, position, SEEK_SET) < 0) {
+      r = -1;
+    } else {
+      r = WRITE(fd, data, length);
+      LSEEK(fd, old, SEEK_SET);
+    }
+#else
+    r = pwrite(fd, data, length, position);
+#endif
+  }
+
+  if (r < 0) {
+    throwNewErrno(e, "java/io/IOException");
+    return 0;
+  }
+  return r;
+}
+
+#ifdef __linux__
+
+inline ssize_t
+copyFileRange(int src, off_t* srcOffset, int dst, off_t* dstOffset,
+              size_t length)
+{
+#  ifdef SYS_copy_file_range
+  return syscall
+    (SYS_copy_file_range, src, srcOffset, dst, dstOffset, length, 0);
+#  else
+  errno = ENOSYS;
+  return -1;
+#  endif
+}
+
+// returns true if the specified error from copy_file_range or
+// sendfile just means that the kernel can't do this particular
+// transfer, in which case the caller should fall back to copying
+// through a buffer:
+inline bool
+transferUnsupported(int error)
+{
+  return error == ENOSYS
+    or error == EXDEV
+    or error == EINVAL
+    or error == EBADF
+    or error == EOPNOTSUPP;
+}
+
+#endif // __linux__
+
+// copies count bytes starting at srcPosition in src to dst at
+// dstPosition (or at dst's current position if dstPosition is
+// negative, advancing it) without copying through user space.
+// Returns -1 if the kernel can't do this transfer.
+jlong
+transfer(JNIEnv* e, int src, jlong srcPosition, jlong count, int dst,
+         jlong dstPosition)
+{
+#ifdef __linux__
+  const jlong MaxChunk = 1 << 30;
+
+  off_t in = srcPosition;
+  off_t out = dstPosition;
+  bool useCopyFileRange = true;
+  jlong total = 0;
+  while (total < count) {
+    size_t length = (count - total < MaxChunk ? count - total : MaxChunk);
+    ssize_t r;
+    if (useCopyFileRange) {
+      r = copyFileRange(src, &in, dst, dstPosition < 0 ? 0 : &out, length);
+      if (r < 0 and total == 0 and transferUnsupported(errno)) {
+        // sendfile can only write at the current position of dst
+        if (dstPosition < 0) {
+          useCopyFileRange = false;
+          continue;
+        } else {
+          return -1;
+        }
+      }
+    } else {
+      r = sendfile(dst, src, &in, length);
+      if (r < 0 and total == 0 and transferUnsupported(errno)) {
+        return -1;
+      }
+    }
+
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      throwNewErrno(e, "java/io/IOException");
+      return total;
+    } else if (r == 0) {
+      break;
+    }
+
+    total += r;
+  }
+  return total;
+#else
+  (void) e;
+  (void) src;
+  (void) srcPosition;
+  (void) count;
+  (void) dst;
+  (void) dstPosition;
+  return -1;
+#endif
+}
+
 } // namespace
 
 inline string_t getChars(JNIEnv* e, jstring path) {
@@ -817,3 +969,286 @@ Java_java_io_RandomAccessFile_close(JNIEnv* e, jclass, jlong peer)
 {
   unmap(e, reinterpret_cast<Mapping*>(peer));
 }
+
+#define sun_nio_ch_FileChannelImpl_MapReadOnly 0L
+#define sun_nio_ch_FileChannelImpl_MapReadWrite 1L
+#define sun_nio_ch_FileChannelImpl_MapPrivate 2L
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_sun_nio_ch_FileChannelImpl_natPosition(JNIEnv* e, jclass, jint fd)
+{
+  jlong r = LSEEK(fd, 0, SEEK_CUR);
+  if (r < 0) {
+    throwNewErrno(e, "java/io/IOException");
+  }
+  return r;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_sun_nio_ch_FileChannelImpl_natSetPosition(JNIEnv* e, jclass, jint fd,
+                                               jlong position)
+{
+  if (LSEEK(fd, position, SEEK_SET) < 0) {
+    throwNewErrno(e, "java/io/IOException");
+  }
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_sun_nio_ch_FileChannelImpl_natSize(JNIEnv* e, jclass, jint fd)
+{
+#ifdef PLATFORM_WINDOWS
+  struct _stati64 s;
+  int r = _fstati64(fd, &s);
+#else
+  struct stat s;
+  int r = fstat(fd, &s);
+#endif
+  if (r != 0) {
+    throwNewErrno(e, "java/io/IOException");
+    return 0;
+  }
+  return s.st_size;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_sun_nio_ch_FileChannelImpl_natTruncate(JNIEnv* e, jclass, jint fd,
+                                            jlong size)
+{
+#ifdef PLATFORM_WINDOWS
+  int r = _chsize_s(fd, size);
+#else
+  int r = ftruncate(fd, size);
+#endif
+  if (r != 0) {
+    throwNewErrno(e, "java/io/IOException");
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_sun_nio_ch_FileChannelImpl_natForce(JNIEnv* e, jclass, jint fd,
+                                         jboolean metaData)
+{
+#ifdef PLATFORM_WINDOWS
+  (void) metaData;
+  int r = _commit(fd);
+#elif (defined __linux__)
+  int r = metaData ? fsync(fd) : fdatasync(fd);
+#else
+  (void) metaData;
+  int r = fsync(fd);
+#endif
+  if (r != 0) {
+    throwNewErrno(e, "java/io/IOException");
+  }
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_sun_nio_ch_FileChannelImpl_natRead(JNIEnv* e, jclass, jint fd,
+                                        jbyteArray b, jint offset,
+                                        jint length, jlong position)
+{
+  jbyte* data = static_cast<jbyte*>(allocate(e, length));
+  if (data == 0) {
+    return 0;
+  }
+
+  int r = doRead(e, fd, data, length, position);
+  if (r > 0) {
+    e->SetByteArrayRegion(b, offset, r, data);
+  }
+
+  free(data);
+
+  return r;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_sun_nio_ch_FileChannelImpl_natReadDirect(JNIEnv* e, jclass, jint fd,
+                                              jobject b, jint offset,
+                                              jint length, jlong position)
+{
+  uint8_t* data = static_cast<uint8_t*>(e->GetDirectBufferAddress(b));
+  if (e->ExceptionCheck()) {
+    return 0;
+  }
+
+  return doRead(e, fd, data + offset, length, position);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_sun_nio_ch_FileChannelImpl_natWrite(JNIEnv* e, jclass, jint fd,
+                                         jbyteArray b, jint offset,
+                                         jint length, jlong position)
+{
+  jbyte* data = static_cast<jbyte*>(allocate(e, length));
+  if (data == 0) {
+    return 0;
+  }
+
+  e->GetByteArrayRegion(b, offset, length, data);
+
+  int r = 0;
+  if (not e->ExceptionCheck()) {
+    r = doWrite(e, fd, data, length, position);
+  }
+
+  free(data);
+
+  return r;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_sun_nio_ch_FileChannelImpl_natWriteDirect(JNIEnv* e, jclass, jint fd,
+                                               jobject b, jint offset,
+                                               jint length, jlong position)
+{
+  uint8_t* data = static_cast<uint8_t*>(e->GetDirectBufferAddress(b));
+  if (e->ExceptionCheck()) {
+    return 0;
+  }
+
+  return doWrite(e, fd, data + offset, length, position);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_sun_nio_ch_FileChannelImpl_natTransfer(JNIEnv* e, jclass, jint srcFd,
+                                            jlong srcPosition, jlong count,
+                                            jint dstFd, jlong dstPosition)
+{
+  return transfer(e, srcFd, srcPosition, count, dstFd, dstPosition);
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_sun_nio_ch_FileChannelImpl_natMap(JNIEnv* e, jclass, jint fd,
+                                       jint mode, jlong position, jint size)
+{
+#ifdef PLATFORM_WINDOWS
+  (void) fd;
+  (void) mode;
+  (void) position;
+  (void) size;
+  throwNew(e, "java/lang/UnsupportedOperationException", 0);
+  return 0;
+#else
+  if (mode == sun_nio_ch_FileChannelImpl_MapReadWrite) {
+    // like the JDK, grow the file to cover a writable mapping
+    struct stat s;
+    if (fstat(fd, &s) != 0
+        or (s.st_size < position + size
+            and ftruncate(fd, position + size) != 0))
+    {
+      throwNewErrno(e, "java/io/IOException");
+      return 0;
+    }
+  }
+
+  void* mapping = 0;
+  jlong mappingLength = 0;
+  jint offset = 0;
+  if (size) {
+    // mmap requires a page-aligned file offset, so map from the start
+    // of the page containing the requested position:
+    offset = position % sysconf(_SC_PAGESIZE);
+    mappingLength = size + offset;
+
+    mapping = mmap
+      (0, mappingLength,
+       mode == sun_nio_ch_FileChannelImpl_MapReadOnly
+       ? PROT_READ : (PROT_READ | PROT_WRITE),
+       mode == sun_nio_ch_FileChannelImpl_MapPrivate
+       ? MAP_PRIVATE : MAP_SHARED,
+       fd, position - offset);
+
+    if (mapping == MAP_FAILED) {
+      throwNewErrno(e, "java/io/IOException");
+      return 0;
+    }
+  }
+
+  jclass c = e->FindClass("java/nio/MappedByteBuffer");
+  if (c) {
+    jmethodID init = e->GetMethodID(c, "<init>", "(JJIIZ)V");
+    if (init) {
+      jobject b = e->NewObject
+        (c, init, reinterpret_cast<jlong>(mapping), mappingLength, offset,
+         size, mode == sun_nio_ch_FileChannelImpl_MapReadOnly);
+      if (b) {
+        return b;
+      }
+    }
+  }
+
+  if (mapping) {
+    munmap(mapping, mappingLength);
+  }
+  return 0;
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_MappedByteBuffer_load(JNIEnv*, jclass, jlong address,
+                                    jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  (void) address;
+  (void) length;
+#else
+  madvise(reinterpret_cast<void*>(address), length, MADV_WILLNEED);
+#endif
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_java_nio_MappedByteBuffer_isLoaded(JNIEnv* e, jclass, jlong address,
+                                        jlong length)
+{
+#ifdef __linux__
+  long pageSize = sysconf(_SC_PAGESIZE);
+  unsigned pageCount = (length + pageSize - 1) / pageSize;
+  unsigned char* pages = static_cast<unsigned char*>
+    (allocate(e, pageCount));
+  if (pages == 0) {
+    return false;
+  }
+
+  bool loaded = mincore(reinterpret_cast<void*>(address), length, pages) == 0;
+  for (unsigned i = 0; loaded and i < pageCount; ++i) {
+    loaded = (pages[i] & 1) != 0;
+  }
+
+  free(pages);
+
+  return loaded;
+#else
+  (void) e;
+  (void) address;
+  (void) length;
+  return false;
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_MappedByteBuffer_force(JNIEnv* e, jclass, jlong address,
+                                     jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  if (not FlushViewOfFile(reinterpret_cast<void*>(address), length)) {
+    throwNew(e, "java/io/IOException", "%d", GetLastError());
+  }
+#else
+  if (msync(reinterpret_cast<void*>(address), length, MS_SYNC) != 0) {
+    throwNewErrno(e, "java/io/IOException");
+  }
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_MappedByteBuffer_unmap(JNIEnv*, jclass, jlong address,
+                                     jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  (void) length;
+  UnmapViewOfFile(reinterpret_cast<void*>(address));
+#else
+  munmap(reinterpret_cast<void*>(address), length);
+#endif
+}
@@ -12,6 +12,7 @@
 #include <sys/stat.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #include "jni.h"
 #include "jni-util.h"
@@ -36,6 +37,10 @@
 #  include <netinet/ip.h>
 #  include <netinet/tcp.h>
 #  include <sys/socket.h>
+#  ifdef __linux__
+#    define USE_EPOLL
+#    include <sys/epoll.h>
+#  endif
 #endif
 
 #define java_nio_channels_SelectionKey_OP_READ 1L
@@ -797,6 +802,70 @@ class Pipe {
 #endif
 };
 
+#ifdef USE_EPOLL
+
+// On Linux, we use epoll so that interest sets are kept in the kernel
+// rather than rebuilt for every select, and so that neither the
+// number of sockets nor their descriptor values are limited by
+// FD_SETSIZE.  Registrations are level-triggered, matching select's
+// semantics.
+struct SelectorState {
+  int epoll;
+  Pipe control;
+  // events registered for each descriptor, indexed by descriptor
+  uint32_t* interest;
+  // events reported by the most recent epoll_wait, indexed by descriptor
+  uint32_t* ready;
+  unsigned capacity;
+  unsigned registeredCount;
+  epoll_event* events;
+  unsigned eventCapacity;
+  int eventCount;
+  SelectorState(JNIEnv* e):
+    epoll(-1), control(e), interest(0), ready(0), capacity(0),
+    registeredCount(0), events(0), eventCapacity(0), eventCount(0)
+  { }
+};
+
+bool
+ensureCapacity(SelectorState* s, int socket)
+{
+  if (static_cast<unsigned>(socket) >= s->capacity) {
+    unsigned capacity = s->capacity ? s->capacity : 64;
+    while (capacity <= static_cast<unsigned>(socket)) capacity *= 2;
+
+    uint32_t* interest = static_cast<uint32_t*>
+      (realloc(s->interest, capacity * sizeof(uint32_t)));
+    if (interest == 0) return false;
+    s->interest = interest;
+
+    uint32_t* ready = static_cast<uint32_t*>
+      (realloc(s->ready, capacity * sizeof(uint32_t)));
+    if (ready == 0) return false;
+    s->ready = ready;
+
+    memset(s->interest + s->capacity, 0,
+           (capacity - s->capacity) * sizeof(uint32_t));
+    memset(s->ready + s->capacity, 0,
+           (capacity - s->capacity) * sizeof(uint32_t));
+
+    s->capacity = capacity;
+  }
+  return true;
+}
+
+int
+epollControl(SelectorState* s, int op, int socket, uint32_t events)
+{
+  epoll_event event;
+  memset(&event, 0, sizeof(epoll_event));
+  event.events = events;
+  event.data.fd = socket;
+  return epoll_ctl(s->epoll, op, socket, &event);
+}
+
+#else // not USE_EPOLL
+
 struct SelectorState {
   fd_set read;
   fd_set write;
@@ -805,8 +874,25 @@ struct SelectorState {
   SelectorState(JNIEnv* e) : control(e) { }
 };
 
+#endif // not USE_EPOLL
+
 } // namespace
 
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketSelector_natWakeup(JNIEnv *e, jclass, jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  if (s->control.connected()) {
+    const char c = 1;
+    int r = ::doWrite(s->control.writer(), &c, 1);
+    if (r != 1) {
+      throwIOException(e);
+    }
+  }
+}
+
+#ifdef USE_EPOLL
+
 extern "C" JNIEXPORT jlong JNICALL
 Java_java_nio_channels_SocketSelector_natInit(JNIEnv* e, jclass)
 {
@@ -815,28 +901,242 @@ Java_java_nio_channels_SocketSelector_natInit(JNIEnv* e, jclass)
     SelectorState *s = new (mem) SelectorState(e);
     if (e->ExceptionCheck()) return 0;
 
-    if (s) {
-      FD_ZERO(&(s->read));
-      FD_ZERO(&(s->write));
-      FD_ZERO(&(s->except));
-      return reinterpret_cast<jlong>(s);
+    s->epoll = epoll_create(64);
+    if (s->epoll < 0
+        or epollControl(s, EPOLL_CTL_ADD, s->control.reader(), EPOLLIN) < 0)
+    {
+      throwIOException(e);
+      return 0;
     }
+    fcntl(s->epoll, F_SETFD, FD_CLOEXEC);
+
+    return reinterpret_cast<jlong>(s);
   }
   throwNew(e, "java/lang/OutOfMemoryError", 0);
   return 0;
 }
 
 extern "C" JNIEXPORT void JNICALL
-Java_java_nio_channels_SocketSelector_natWakeup(JNIEnv *e, jclass, jlong state)
+Java_java_nio_channels_SocketSelector_natClose(JNIEnv *, jclass, jlong state)
 {
   SelectorState* s = reinterpret_cast<SelectorState*>(state);
-  if (s->control.connected()) {
-    const char c = 1;
-    int r = ::doWrite(s->control.writer(), &c, 1);
-    if (r != 1) {
+  s->control.dispose();
+  if (s->epoll >= 0) ::close(s->epoll);
+  free(s->interest);
+  free(s->ready);
+  free(s->events);
+  free(s);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketSelector_natSelectClearAll(JNIEnv *, jclass,
+							jint socket,
+							jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  if (static_cast<unsigned>(socket) < s->capacity) {
+    if (s->interest[socket]) {
+      // this fails harmlessly if the socket has already been closed,
+      // since closing a descriptor removes it from the epoll set
+      epollControl(s, EPOLL_CTL_DEL, socket, 0);
+      s->interest[socket] = 0;
+      -- s->registeredCount;
+    }
+    s->ready[socket] = 0;
+  }
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_SocketSelector_natSelectUpdateInterestSet(JNIEnv *e,
+								 jclass,
+								 jint socket,
+								 jint interest,
+								 jlong state,
+								 jint max)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  if (socket < 0) {
+    return max;
+  }
+
+  if (not ensureCapacity(s, socket)) {
+    throwNew(e, "java/lang/OutOfMemoryError", 0);
+    return max;
+  }
+
+  uint32_t events = 0;
+  if (interest & (java_nio_channels_SelectionKey_OP_READ |
+		  java_nio_channels_SelectionKey_OP_ACCEPT)) {
+    events |= EPOLLIN;
+  }
+  
+  if (interest & (java_nio_channels_SelectionKey_OP_WRITE |
+		  java_nio_channels_SelectionKey_OP_CONNECT)) {
+    events |= EPOLLOUT;
+  }
+
+  if (events != s->interest[socket]) {
+    int r;
+    if (events == 0) {
+      // epoll always reports errors and hangups, so we deregister
+      // entirely rather than registering an empty interest set
+      r = epollControl(s, EPOLL_CTL_DEL, socket, 0);
+      if (r < 0 and (errno == ENOENT or errno == EBADF)) {
+        // closing the descriptor already removed it from the epoll set
+        r = 0;
+      }
+      if (r == 0) {
+        -- s->registeredCount;
+      }
+    } else if (s->interest[socket]) {
+      r = epollControl(s, EPOLL_CTL_MOD, socket, events);
+      if (r < 0 and errno == ENOENT) {
+        // the descriptor was closed and reused since we registered it
+        r = epollControl(s, EPOLL_CTL_ADD, socket, events);
+      }
+    } else {
+      r = epollControl(s, EPOLL_CTL_ADD, socket, events);
+      if (r < 0 and errno == EEXIST) {
+        r = epollControl(s, EPOLL_CTL_MOD, socket, events);
+      }
+      if (r == 0) {
+        ++ s->registeredCount;
+      }
+    }
+
+    if (r < 0) {
+      throwIOException(e);
+    }
+
+    s->interest[socket] = events;
+  }
+
+  return max;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_SocketSelector_natDoSocketSelect(JNIEnv *e, jclass,
+							jlong state,
+							jint,
+							jlong interval)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+
+  for (int i = 0; i < s->eventCount; ++i) {
+    int socket = s->events[i].data.fd;
+    if (static_cast<unsigned>(socket) < s->capacity) {
+      s->ready[socket] = 0;
+    }
+  }
+  s->eventCount = 0;
+
+  if (s->eventCapacity < s->registeredCount + 1) {
+    unsigned capacity = s->eventCapacity ? s->eventCapacity : 64;
+    while (capacity < s->registeredCount + 1) capacity *= 2;
+
+    epoll_event* events = static_cast<epoll_event*>
+      (realloc(s->events, capacity * sizeof(epoll_event)));
+    if (events == 0) {
+      throwNew(e, "java/lang/OutOfMemoryError", 0);
+      return 0;
+    }
+    s->events = events;
+    s->eventCapacity = capacity;
+  }
+
+  int timeout;
+  if (interval > 0) {
+    timeout = interval > INT_MAX ? INT_MAX : static_cast<int>(interval);
+  } else if (interval < 0) {
+    timeout = 0;
+  } else {
+    timeout = -1;
+  }
+
+  int r = epoll_wait(s->epoll, s->events, s->eventCapacity, timeout);
+
+  if (r < 0) {
+    if (errno != EINTR) {
       throwIOException(e);
     }
+    return 0;
+  }
+
+  s->eventCount = r;
+
+  for (int i = 0; i < r; ++i) {
+    int socket = s->events[i].data.fd;
+    if (socket == s->control.reader()) {
+      char c;
+      int r = 1;
+      while (r == 1) {
+        r = ::doRead(s->control.reader(), &c, 1);
+      }
+      if (r < 0 and not eagain()) {
+        throwIOException(e);
+      }
+    } else if (static_cast<unsigned>(socket) < s->capacity) {
+      s->ready[socket] = s->events[i].events;
+    }
   }
+
+  return r;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_SocketSelector_natUpdateReadySet(JNIEnv *, jclass,
+							jint socket,
+							jint interest,
+							jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  jint ready = 0;
+
+  uint32_t events = static_cast<unsigned>(socket) < s->capacity
+    ? s->ready[socket] : 0;
+
+  if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+    if (interest & java_nio_channels_SelectionKey_OP_READ) {
+      ready |= java_nio_channels_SelectionKey_OP_READ;
+    }
+    
+    if (interest & java_nio_channels_SelectionKey_OP_ACCEPT) {
+      ready |= java_nio_channels_SelectionKey_OP_ACCEPT;
+    }
+  }
+  
+  if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+    if (interest & java_nio_channels_SelectionKey_OP_WRITE) {
+      ready |= java_nio_channels_SelectionKey_OP_WRITE;
+    }
+
+    if (interest & java_nio_channels_SelectionKey_OP_CONNECT) {
+      ready |= java_nio_channels_SelectionKey_OP_CONNECT;
+    }    
+  }
+
+  return ready;
+}
+
+#else // not USE_EPOLL
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_SocketSelector_natInit(JNIEnv* e, jclass)
+{
+  void *mem = malloc(sizeof(SelectorState));
+  if (mem) {
+    SelectorState *s = new (mem) SelectorState(e);
+    if (e->ExceptionCheck()) return 0;
+
+    if (s) {
+      FD_ZERO(&(s->read));
+      FD_ZERO(&(s->write));
+      FD_ZERO(&(s->except));
+      return reinterpret_cast<jlong>(s);
+    }
+  }
+  throwNew(e, "java/lang/OutOfMemoryError", 0);
+  return 0;
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -1014,6 +1314,7 @@ Java_java_nio_channels_SocketSelector_natUpdateReadySet(JNIEnv *, jclass,
   return ready;
 }
 
+#endif // not USE_EPOLL
 
 extern "C" JNIEXPORT jboolean JNICALL
 Java_java_nio_ByteOrder_isNativeBigEndian(JNIEnv *, jclass)
@@ -10,12 +10,16 @@
 
 package java.io;
 
+import java.nio.channels.FileChannel;
+import sun.nio.ch.FileChannelImpl;
+
 public class FileInputStream extends InputStream {
   //   static {
   //     System.loadLibrary("natives");
   //   }
 
   private int fd;
+  private FileChannel channel;
   private int remaining;
 
   public FileInputStream(FileDescriptor fd) {
@@ -68,6 +72,13 @@ public class FileInputStream extends InputStream {
     return c;
   }
 
+  public FileChannel getChannel() {
+    if (channel == null) {
+      channel = FileChannelImpl.open(fd, true, false, this);
+    }
+    return channel;
+  }
+
   public void close() throws IOException {
     if (fd != -1) {
       close(fd);
@@ -10,12 +10,16 @@
 
 package java.io;
 
+import java.nio.channels.FileChannel;
+import sun.nio.ch.FileChannelImpl;
+
 public class FileOutputStream extends OutputStream {
   //   static {
   //     System.loadLibrary("natives");
   //   }
 
   private int fd;
+  private FileChannel channel;
 
   public FileOutputStream(FileDescriptor fd) {
     this.fd = fd.value;
@@ -59,6 +63,13 @@ public class FileOutputStream extends OutputStream {
     write(fd, b, offset, length);
   }
 
+  public FileChannel getChannel() {
+    if (channel == null) {
+      channel = FileChannelImpl.open(fd, false, true, this);
+    }
+    return channel;
+  }
+
   public void close() throws IOException {
     if (fd != -1) {
       close(fd);
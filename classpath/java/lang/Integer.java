@@ -70,6 +70,38 @@ public final class Integer extends Number implements Comparable<Integer> {
     return Long.toString(((long) v) & 0xFFFFFFFFL, 2);
   }
 
+  public static int bitCount(int v) {
+    v = v - ((v >>> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >>> 2) & 0x33333333);
+    v = (v + (v >>> 4)) & 0x0F0F0F0F;
+    return (v * 0x01010101) >>> 24;
+  }
+
+  public static int numberOfLeadingZeros(int v) {
+    if (v == 0) return 32;
+
+    int n = 0;
+    if ((v & 0xFFFF0000) == 0) { n += 16; v <<= 16; }
+    if ((v & 0xFF000000) == 0) { n +=  8; v <<=  8; }
+    if ((v & 0xF0000000) == 0) { n +=  4; v <<=  4; }
+    if ((v & 0xC0000000) == 0) { n +=  2; v <<=  2; }
+    if ((v & 0x80000000) == 0) { n +=  1; }
+    return n;
+  }
+
+  public static int numberOfTrailingZeros(int v) {
+    if (v == 0) return 32;
+
+    return 31 - numberOfLeadingZeros(v & -v);
+  }
+
+  public static int reverseBytes(int v) {
+    return (v << 24)
+      | ((v & 0xFF00) << 8)
+      | ((v >>> 8) & 0xFF00)
+      | (v >>> 24);
+  }
+
   public byte byteValue() {
     return (byte) value;
   }
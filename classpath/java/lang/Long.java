@@ -102,6 +102,29 @@ public final class Long extends Number implements Comparable<Long> {
     return toString(v, 2);
   }
 
+  public static int bitCount(long v) {
+    return Integer.bitCount((int) v) + Integer.bitCount((int) (v >>> 32));
+  }
+
+  public static int numberOfLeadingZeros(long v) {
+    int high = (int) (v >>> 32);
+    return high == 0
+      ? 32 + Integer.numberOfLeadingZeros((int) v)
+      : Integer.numberOfLeadingZeros(high);
+  }
+
+  public static int numberOfTrailingZeros(long v) {
+    int low = (int) v;
+    return low == 0
+      ? 32 + Integer.numberOfTrailingZeros((int) (v >>> 32))
+      : Integer.numberOfTrailingZeros(low);
+  }
+
+  public static long reverseBytes(long v) {
+    return (((long) Integer.reverseBytes((int) v)) << 32)
+      | (((long) Integer.reverseBytes((int) (v >>> 32))) & 0xFFFFFFFFL);
+  }
+
   public byte byteValue() {
     return (byte) value;
   }
@@ -147,25 +147,9 @@ public final class String
     return length;
   }
 
-  public int hashCode() {
-    if (hashCode == 0) {
-      int h = 0;
-      for (int i = 0; i < length; ++i) h = (h * 31) + charAt(i);
-      hashCode = h;
-    }
-    return hashCode;
-  }
+  public native int hashCode();
 
-  public boolean equals(Object o) {
-    if (this == o) {
-      return true;
-    } else if (o instanceof String) {
-      String s = (String) o;
-      return s.length == length && compareTo(s) == 0;
-    } else {
-      return false;
-    }
-  }
+  public native boolean equals(Object o);
 
   public boolean equalsIgnoreCase(String o) {
     if (this == o) {
@@ -272,15 +256,7 @@ public final class String
     return indexOf(c, 0);
   }
 
-  public int indexOf(int c, int start) {
-    for (int i = start; i < length; ++i) {
-      if (charAt(i) == c) {
-        return i;
-      }
-    }
-
-    return -1;
-  }
+  public native int indexOf(int c, int start);
 
   public int lastIndexOf(int ch) {
     return lastIndexOf(ch, length-1);
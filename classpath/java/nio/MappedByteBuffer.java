@@ -0,0 +1,100 @@
+/* Copyright (c) 2008-2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio;
+
+public class MappedByteBuffer extends DirectByteBuffer {
+  // the buffer which owns the mapping, or null if this buffer does.
+  // Views keep a reference to the owner so the mapping is not
+  // released while they are still reachable.
+  private final MappedByteBuffer owner;
+  private final long mapping;
+  private final long mappingLength;
+  private final boolean readOnly;
+
+  // called from native code (see java-io.cpp), which has already
+  // established the mapping:
+  MappedByteBuffer(long mapping, long mappingLength, int offset,
+                   int capacity, boolean readOnly)
+  {
+    super(mapping + offset, capacity, readOnly);
+
+    this.owner = null;
+    this.mapping = mapping;
+    this.mappingLength = mappingLength;
+    this.readOnly = readOnly;
+  }
+
+  private MappedByteBuffer(MappedByteBuffer owner, long address, int capacity,
+                           boolean readOnly)
+  {
+    super(address, capacity, readOnly);
+
+    this.owner = owner;
+    this.mapping = owner.mapping;
+    this.mappingLength = owner.mappingLength;
+    this.readOnly = readOnly;
+  }
+
+  private MappedByteBuffer owner() {
+    return owner == null ? this : owner;
+  }
+
+  private static native void load(long address, long length);
+
+  private static native boolean isLoaded(long address, long length);
+
+  private static native void force(long address, long length);
+
+  private static native void unmap(long address, long length);
+
+  public ByteBuffer asReadOnlyBuffer() {
+    ByteBuffer b = new MappedByteBuffer(owner(), address, capacity, true);
+    b.position(position());
+    b.limit(limit());
+    return b;
+  }
+
+  public ByteBuffer slice() {
+    return new MappedByteBuffer
+      (owner(), address + position, remaining(), readOnly);
+  }
+
+  public final MappedByteBuffer load() {
+    if (mappingLength != 0) {
+      load(mapping, mappingLength);
+    }
+    return this;
+  }
+
+  public final boolean isLoaded() {
+    return mappingLength == 0 || isLoaded(mapping, mappingLength);
+  }
+
+  public final MappedByteBuffer force() {
+    if (mappingLength != 0 && ! readOnly) {
+      force(mapping, mappingLength);
+    }
+    return this;
+  }
+
+  protected void finalize() {
+    if (owner == null && mappingLength != 0) {
+      unmap(mapping, mappingLength);
+    }
+  }
+
+  public String toString() {
+    return "(MappedByteBuffer with address: " + address
+      + " position: " + position
+      + " limit: " + limit
+      + " capacity: " + capacity + ")";
+  }
+}
@@ -0,0 +1,62 @@
+/* Copyright (c) 2008-2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio.channels;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+
+public abstract class FileChannel
+  implements ReadableByteChannel, WritableByteChannel
+{
+  protected FileChannel() { }
+
+  public abstract long position() throws IOException;
+
+  public abstract FileChannel position(long position) throws IOException;
+
+  public abstract long size() throws IOException;
+
+  public abstract FileChannel truncate(long size) throws IOException;
+
+  public abstract void force(boolean metaData) throws IOException;
+
+  public abstract int read(ByteBuffer b, long position) throws IOException;
+
+  public abstract int write(ByteBuffer b, long position) throws IOException;
+
+  public abstract long transferTo(long position, long count,
+                                  WritableByteChannel target)
+    throws IOException;
+
+  public abstract long transferFrom(ReadableByteChannel src, long position,
+                                    long count)
+    throws IOException;
+
+  public abstract MappedByteBuffer map(MapMode mode, long position, long size)
+    throws IOException;
+
+  public static class MapMode {
+    public static final MapMode READ_ONLY = new MapMode("READ_ONLY");
+    public static final MapMode READ_WRITE = new MapMode("READ_WRITE");
+    public static final MapMode PRIVATE = new MapMode("PRIVATE");
+
+    private final String name;
+
+    private MapMode(String name) {
+      this.name = name;
+    }
+
+    public String toString() {
+      return name;
+    }
+  }
+}
@@ -74,23 +74,28 @@ class SocketSelector extends Selector {
 
     if (clearWoken()) interval = -1;
 
-    int max=0;
+    // Interest is tracked per descriptor, and a closed channel's
+    // descriptor may already have been reused by a channel registered
+    // since, so clear out closed channels before registering interest
+    // for open ones.
     for (Iterator<SelectionKey> it = keys.iterator();
          it.hasNext();)
     {
       SelectionKey key = it.next();
       SelectableChannel c = key.channel();
-      int socket = c.socketFD();
-      if (c.isOpen()) {
-        key.readyOps(0);
-        max = natSelectUpdateInterestSet
-          (socket, key.interestOps(), state, max);
-      } else {
-        natSelectClearAll(socket, state);
+      if (! c.isOpen()) {
+        natSelectClearAll(c.socketFD(), state);
         it.remove();
       }
     }
 
+    int max=0;
+    for (SelectionKey key : keys) {
+      key.readyOps(0);
+      max = natSelectUpdateInterestSet
+        (key.channel().socketFD(), key.interestOps(), state, max);
+    }
+
     int r = natDoSocketSelect(state, max, interval);
 
     if (r > 0) {
@@ -185,17 +185,21 @@ public class Arrays {
     };
   }
 
-  public static void fill(int[] array, int value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
-  }
+  public static native void fill(boolean[] array, boolean value);
 
-  public static void fill(char[] array, char value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
-  }
+  public static native void fill(byte[] array, byte value);
+
+  public static native void fill(short[] array, short value);
+
+  public static native void fill(char[] array, char value);
+
+  public static native void fill(int[] array, int value);
+
+  public static native void fill(long[] array, long value);
+
+  public static native void fill(float[] array, float value);
+
+  public static native void fill(double[] array, double value);
   
   public static <T> void fill(T[] array, T value) {
     for (int i=0;i<array.length;i++) {
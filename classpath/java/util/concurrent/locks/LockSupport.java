@@ -0,0 +1,39 @@
+/* Copyright (c) 2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent.locks;
+
+import sun.misc.Unsafe;
+
+public class LockSupport {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+
+  private LockSupport() { }
+
+  public static void unpark(Thread thread) {
+    if (thread != null) {
+      unsafe.unpark(thread);
+    }
+  }
+
+  public static void park() {
+    unsafe.park(false, 0L);
+  }
+
+  public static void parkNanos(long nanoseconds) {
+    if (nanoseconds > 0) {
+      unsafe.park(false, nanoseconds);
+    }
+  }
+
+  public static void parkUntil(long deadline) {
+    unsafe.park(true, deadline);
+  }
+}
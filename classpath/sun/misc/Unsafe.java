@@ -57,4 +57,8 @@ public final class Unsafe {
   public void copyMemory(long src, long dst, long count) {
     copyMemory(null, src, null, dst, count);
   }
+
+  public native void unpark(Object thread);
+
+  public native void park(boolean absolute, long time);
 }
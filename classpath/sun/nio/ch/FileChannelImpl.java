@@ -0,0 +1,321 @@
+/* Copyright (c) 2008-2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package sun.nio.ch;
+
+import java.io.Closeable;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.ClosedChannelException;
+import java.nio.channels.FileChannel;
+import java.nio.channels.NonReadableChannelException;
+import java.nio.channels.NonWritableChannelException;
+import java.nio.channels.ReadableByteChannel;
+import java.nio.channels.WritableByteChannel;
+
+public class FileChannelImpl extends FileChannel {
+  private static final int TransferBufferSize = 64 * 1024;
+
+  private static final int MapReadOnly = 0;
+  private static final int MapReadWrite = 1;
+  private static final int MapPrivate = 2;
+
+  private final int fd;
+  private final boolean readable;
+  private final boolean writable;
+  private final Closeable parent;
+  private boolean open = true;
+
+  private FileChannelImpl(int fd, boolean readable, boolean writable,
+                          Closeable parent)
+  {
+    this.fd = fd;
+    this.readable = readable;
+    this.writable = writable;
+    this.parent = parent;
+  }
+
+  public static FileChannel open(int fd, boolean readable, boolean writable,
+                                 Closeable parent)
+  {
+    return new FileChannelImpl(fd, readable, writable, parent);
+  }
+
+  private static native long natPosition(int fd) throws IOException;
+
+  private static native void natSetPosition(int fd, long position)
+    throws IOException;
+
+  private static native long natSize(int fd) throws IOException;
+
+  private static native void natTruncate(int fd, long size)
+    throws IOException;
+
+  private static native void natForce(int fd, boolean metaData)
+    throws IOException;
+
+  private static native int natRead(int fd, byte[] array, int offset,
+                                    int length, long position)
+    throws IOException;
+
+  private static native int natReadDirect(int fd, ByteBuffer buffer,
+                                          int offset, int length,
+                                          long position)
+    throws IOException;
+
+  private static native int natWrite(int fd, byte[] array, int offset,
+                                     int length, long position)
+    throws IOException;
+
+  private static native int natWriteDirect(int fd, ByteBuffer buffer,
+                                           int offset, int length,
+                                           long position)
+    throws IOException;
+
+  private static native long natTransfer(int srcFd, long srcPosition,
+                                         long count, int dstFd,
+                                         long dstPosition)
+    throws IOException;
+
+  private static native MappedByteBuffer natMap(int fd, int mode,
+                                                long position, int size)
+    throws IOException;
+
+  private void checkOpen() throws IOException {
+    if (! open) throw new ClosedChannelException();
+  }
+
+  private void checkReadable() throws IOException {
+    checkOpen();
+    if (! readable) throw new NonReadableChannelException();
+  }
+
+  private void checkWritable() throws IOException {
+    checkOpen();
+    if (! writable) throw new NonWritableChannelException();
+  }
+
+  public boolean isOpen() {
+    return open;
+  }
+
+  public void close() throws IOException {
+    if (open) {
+      open = false;
+      parent.close();
+    }
+  }
+
+  public long position() throws IOException {
+    checkOpen();
+    return natPosition(fd);
+  }
+
+  public FileChannel position(long position) throws IOException {
+    if (position < 0) throw new IllegalArgumentException();
+    checkOpen();
+    natSetPosition(fd, position);
+    return this;
+  }
+
+  public long size() throws IOException {
+    checkOpen();
+    return natSize(fd);
+  }
+
+  public FileChannel truncate(long size) throws IOException {
+    if (size < 0) throw new IllegalArgumentException();
+    checkWritable();
+    if (size < natSize(fd)) {
+      natTruncate(fd, size);
+    }
+    if (natPosition(fd) > size) {
+      natSetPosition(fd, size);
+    }
+    return this;
+  }
+
+  public void force(boolean metaData) throws IOException {
+    checkOpen();
+    natForce(fd, metaData);
+  }
+
+  private int doRead(ByteBuffer b, long position) throws IOException {
+    checkReadable();
+    if (b.remaining() == 0) return 0;
+
+    int r;
+    if (b.hasArray()) {
+      r = natRead(fd, b.array(), b.arrayOffset() + b.position(),
+                  b.remaining(), position);
+    } else {
+      r = natReadDirect(fd, b, b.position(), b.remaining(), position);
+    }
+
+    if (r > 0) {
+      b.position(b.position() + r);
+    }
+    return r;
+  }
+
+  private int doWrite(ByteBuffer b, long position) throws IOException {
+    checkWritable();
+    if (b.remaining() == 0) return 0;
+
+    int w;
+    if (b.hasArray()) {
+      w = natWrite(fd, b.array(), b.arrayOffset() + b.position(),
+                   b.remaining(), position);
+    } else {
+      w = natWriteDirect(fd, b, b.position(), b.remaining(), position);
+    }
+
+    if (w > 0) {
+      b.position(b.position() + w);
+    }
+    return w;
+  }
+
+  public int read(ByteBuffer b) throws IOException {
+    return doRead(b, -1);
+  }
+
+  public int read(ByteBuffer b, long position) throws IOException {
+    if (position < 0) throw new IllegalArgumentException();
+    return doRead(b, position);
+  }
+
+  public int write(ByteBuffer b) throws IOException {
+    return doWrite(b, -1);
+  }
+
+  public int write(ByteBuffer b, long position) throws IOException {
+    if (position < 0) throw new IllegalArgumentException();
+    return doWrite(b, position);
+  }
+
+  public long transferTo(long position, long count,
+                         WritableByteChannel target)
+    throws IOException
+  {
+    if (position < 0 || count < 0) throw new IllegalArgumentException();
+    checkReadable();
+
+    long size = natSize(fd);
+    if (position >= size) return 0;
+    if (count > size - position) count = size - position;
+
+    if (target instanceof FileChannelImpl) {
+      FileChannelImpl t = (FileChannelImpl) target;
+      t.checkWritable();
+
+      // let the kernel move the bytes without copying them through
+      // user space:
+      long n = natTransfer(fd, position, count, t.fd, -1);
+      if (n >= 0) {
+        return n;
+      }
+    }
+
+    ByteBuffer buffer = ByteBuffer.allocate
+      ((int) Math.min(count, TransferBufferSize));
+    long total = 0;
+    while (total < count) {
+      buffer.clear();
+      if (count - total < buffer.capacity()) {
+        buffer.limit((int) (count - total));
+      }
+
+      int r = doRead(buffer, position + total);
+      if (r <= 0) break;
+
+      buffer.flip();
+      while (buffer.hasRemaining()) {
+        if (target.write(buffer) <= 0) {
+          return total + r - buffer.remaining();
+        }
+      }
+      total += r;
+    }
+    return total;
+  }
+
+  public long transferFrom(ReadableByteChannel src, long position,
+                           long count)
+    throws IOException
+  {
+    if (position < 0 || count < 0) throw new IllegalArgumentException();
+    checkWritable();
+
+    if (position > natSize(fd)) return 0;
+
+    if (src instanceof FileChannelImpl) {
+      FileChannelImpl s = (FileChannelImpl) src;
+      s.checkReadable();
+
+      long srcPosition = natPosition(s.fd);
+      long available = natSize(s.fd) - srcPosition;
+      if (available <= 0) return 0;
+      if (count > available) count = available;
+
+      long n = natTransfer(s.fd, srcPosition, count, fd, position);
+      if (n >= 0) {
+        natSetPosition(s.fd, srcPosition + n);
+        return n;
+      }
+    }
+
+    ByteBuffer buffer = ByteBuffer.allocate
+      ((int) Math.min(count, TransferBufferSize));
+    long total = 0;
+    while (total < count) {
+      buffer.clear();
+      if (count - total < buffer.capacity()) {
+        buffer.limit((int) (count - total));
+      }
+
+      int r = src.read(buffer);
+      if (r <= 0) break;
+
+      buffer.flip();
+      while (buffer.hasRemaining()) {
+        doWrite(buffer, position + total + r - buffer.remaining());
+      }
+      total += r;
+    }
+    return total;
+  }
+
+  public MappedByteBuffer map(MapMode mode, long position, long size)
+    throws IOException
+  {
+    if (position < 0 || size < 0 || size > Integer.MAX_VALUE) {
+      throw new IllegalArgumentException();
+    }
+
+    int m;
+    if (mode == MapMode.READ_ONLY) {
+      checkReadable();
+      m = MapReadOnly;
+    } else if (mode == MapMode.READ_WRITE) {
+      checkReadable();
+      checkWritable();
+      m = MapReadWrite;
+    } else if (mode == MapMode.PRIVATE) {
+      checkReadable();
+      m = MapPrivate;
+    } else {
+      throw new IllegalArgumentException();
+    }
+
+    return natMap(fd, m, position, (int) size);
+  }
+}
@@ -2309,6 +2309,12 @@ class MyArchitecture: public Assembler::Architecture {
       break;
 
     case Absolute:
+    case Float2Bits:
+    case Bits2Float:
+    case ReverseBytes:
+    case BitCount:
+    case LeadingZeros:
+    case TrailingZeros:
       *thunk = true;
       break;
 
@@ -2500,6 +2506,14 @@ class MyArchitecture: public Assembler::Architecture {
     }
   }
 
+  virtual void plan
+  (AtomicOperation, unsigned, uint64_t* addressRegisterMask,
+   uint64_t* valueRegisterMask, uint64_t* expectRegisterMask, bool* thunk)
+  {
+    *addressRegisterMask = *valueRegisterMask = *expectRegisterMask = 0;
+    *thunk = true;
+  }
+
   virtual void acquire() {
     ++ referenceCount;
   }
@@ -2749,6 +2763,12 @@ class MyAssembler: public Assembler {
     }
   }
 
+  virtual void apply(AtomicOperation, unsigned, Memory*, Register*,
+                     Register*)
+  {
+    abort(&con);
+  }
+
   virtual void setDestination(uint8_t* dst) {
     con.result = dst;
   }
@@ -66,11 +66,17 @@ enum BinaryOperation {
   FloatSquareRoot,
   FloatAbsolute,
   Absolute,
+  Float2Bits,
+  Bits2Float,
+  ReverseBytes,
+  BitCount,
+  LeadingZeros,
+  TrailingZeros,
   
   NoBinaryOperation = -1
 };
 
-const unsigned BinaryOperationCount = Absolute + 1;
+const unsigned BinaryOperationCount = TrailingZeros + 1;
 
 enum TernaryOperation {
   Add,
@@ -118,6 +124,18 @@ const unsigned NonBranchTernaryOperationCount = FloatMin + 1;
 const unsigned BranchOperationCount
 = JumpIfFloatGreaterOrEqualOrUnordered - FloatMin;
 
+// Atomic read-modify-write operations on a memory location.
+// AtomicAdd and AtomicExchange leave the previous contents of the
+// location in the value register.  AtomicCompareAndSwap stores the
+// value register only if the location holds the contents of the
+// expect register, and then leaves 1 in the expect register if it did
+// so or 0 if not.
+enum AtomicOperation {
+  AtomicAdd,
+  AtomicExchange,
+  AtomicCompareAndSwap
+};
+
 enum OperandType {
   ConstantOperand,
   AddressOperand,
@@ -410,6 +428,11 @@ class Assembler {
      unsigned bSize, uint8_t bTypeMask, uint64_t bRegisterMask,
      unsigned cSize, uint8_t* cTypeMask, uint64_t* cRegisterMask) = 0; 
 
+    virtual void plan
+    (AtomicOperation op, unsigned size, uint64_t* addressRegisterMask,
+     uint64_t* valueRegisterMask, uint64_t* expectRegisterMask,
+     bool* thunk) = 0;
+
     virtual void acquire() = 0;
     virtual void release() = 0;
   };
@@ -449,6 +472,9 @@ class Assembler {
                      unsigned bSize, OperandType bType, Operand* bOperand,
                      unsigned cSize, OperandType cType, Operand* cOperand) = 0;
 
+  virtual void apply(AtomicOperation op, unsigned size, Memory* location,
+                     Register* value, Register* expect) = 0;
+
   virtual void setDestination(uint8_t* dst) = 0;
 
   virtual void write() = 0;
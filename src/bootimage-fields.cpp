@@ -18,8 +18,7 @@ FIELD(callCount)
 FIELD(bootLoader)
 FIELD(appLoader)
 FIELD(types)
-FIELD(methodTree)
-FIELD(methodTreeSentinal)
+FIELD(compiledMethods)
 FIELD(virtualThunks)
 
 #ifdef FIELD_DEFINED
@@ -34,10 +33,14 @@ FIELD(virtualThunks)
 
 THUNK_FIELD(default_);
 THUNK_FIELD(defaultVirtual);
+THUNK_FIELD(defaultInterface);
 THUNK_FIELD(native);
 THUNK_FIELD(aioob);
 THUNK_FIELD(stackOverflow);
+THUNK_FIELD(safepoint);
 THUNK_FIELD(table);
+THUNK_FIELD(allocate);
+THUNK_FIELD(allocateArray);
 
 #ifdef THUNK_FIELD_DEFINED
 #  undef THUNK_FIELD
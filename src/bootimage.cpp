@@ -1131,7 +1131,8 @@ makeHeapImage(Thread* t, BootImage* image, target_uintptr_t* heap,
              (t, typeMaps, currentObject, currentOffset * BytesPerWord)
              / TargetBytesPerWord);
 
-        unsigned mark = heap[offset] & (~TargetPointerMask);
+        // keep only the low mark bits, not the lock word, if any:
+        unsigned mark = heap[offset] & (TargetBytesPerWord - 1);
         unsigned value = number | (mark << TargetBootShift);
 
         if (value) targetMarkBit(map, offset);
@@ -1981,7 +1982,7 @@ main(int ac, const char** av)
   // args.dump();
 
   System* s = makeSystem(0);
-  Heap* h = makeHeap(s, HeapCapacity * 2);
+  Heap* h = makeHeap(s, HeapCapacity * 2, 1);
   Classpath* c = makeClasspath(s, h, AVIAN_JAVA_HOME, AVIAN_EMBED_PREFIX);
   Finder* f = makeFinder(s, h, args.classpath, 0);
   Processor* p = makeProcessor(s, h, false);
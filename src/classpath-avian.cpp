@@ -50,7 +50,7 @@ class MyClasspath : public Classpath {
     const unsigned NormalPriority = 5;
 
     return vm::makeThread
-      (t, 0, 0, 0, 0, NewState, NormalPriority, 0, 0, 0,
+      (t, 0, 0, 0, NewState, NormalPriority, 0, 0, 0,
        root(t, Machine::BootLoader), 0, 0, group, 0);
   }
 
@@ -407,6 +407,38 @@ Avian_java_lang_String_intern
   return reinterpret_cast<int64_t>(intern(t, this_));
 }
 
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_lang_String_hashCode
+(Thread* t, object, uintptr_t* arguments)
+{
+  object this_ = reinterpret_cast<object>(arguments[0]);
+
+  return stringHash(t, this_);
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_lang_String_equals
+(Thread* t, object, uintptr_t* arguments)
+{
+  object this_ = reinterpret_cast<object>(arguments[0]);
+  object o = reinterpret_cast<object>(arguments[1]);
+
+  return o
+    and objectClass(t, o) == type(t, Machine::StringType)
+    and stringEqual(t, this_, o);
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_lang_String_indexOf__II
+(Thread* t, object, uintptr_t* arguments)
+{
+  object this_ = reinterpret_cast<object>(arguments[0]);
+  int32_t c = arguments[1];
+  int32_t start = arguments[2];
+
+  return stringIndexOf(t, this_, c, start);
+}
+
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_System_getVMProperty
 (Thread* t, object, uintptr_t* arguments)
@@ -427,6 +459,26 @@ Avian_java_lang_System_getVMProperty
     r = reinterpret_cast<int64_t>(makeString(t, AVIAN_VERSION));
   } else if (::strcmp(RUNTIME_ARRAY_BODY(n), "file.encoding") == 0) {
     r = reinterpret_cast<int64_t>(makeString(t, "ASCII"));
+  } else if (::strcmp(RUNTIME_ARRAY_BODY(n), "avian.heap.young") == 0) {
+    r = reinterpret_cast<int64_t>(makeString(t, "%d", t->m->heapPoolLimit));
+  } else if (::strcmp(RUNTIME_ARRAY_BODY(n), "avian.heap.thread") == 0) {
+    r = reinterpret_cast<int64_t>
+      (makeString(t, "%d", t->heapSizeInWords * BytesPerWord));
+  } else if (::strcmp(RUNTIME_ARRAY_BODY(n), "avian.heap.thread.max") == 0) {
+    r = reinterpret_cast<int64_t>
+      (makeString(t, "%d", t->m->maxThreadHeapSize));
+  } else if (::strcmp(RUNTIME_ARRAY_BODY(n), "avian.gc.minor") == 0) {
+    r = reinterpret_cast<int64_t>
+      (makeString(t, "%d", t->m->minorCollectionCount));
+  } else if (::strcmp(RUNTIME_ARRAY_BODY(n), "avian.gc.major") == 0) {
+    r = reinterpret_cast<int64_t>
+      (makeString(t, "%d", t->m->majorCollectionCount));
+  } else if (::strcmp(RUNTIME_ARRAY_BODY(n), "avian.safepoint.count") == 0) {
+    r = reinterpret_cast<int64_t>
+      (makeString(t, "%d", t->m->safepointCount));
+  } else if (::strcmp(RUNTIME_ARRAY_BODY(n), "avian.safepoint.max") == 0) {
+    r = reinterpret_cast<int64_t>
+      (makeString(t, "%"LLD, t->m->maxSafepointTime));
   } else {
     const char* v = findProperty(t, RUNTIME_ARRAY_BODY(n));
     if (v) {
@@ -452,6 +504,66 @@ Avian_java_lang_System_arraycopy
             arguments[4]);
 }
 
+extern "C" JNIEXPORT void JNICALL
+Avian_java_util_Arrays_fill___3ZZ
+(Thread* t, object, uintptr_t* arguments)
+{
+  arrayFill(t, reinterpret_cast<object>(arguments[0]), arguments[1]);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_java_util_Arrays_fill___3BB
+(Thread* t, object, uintptr_t* arguments)
+{
+  arrayFill(t, reinterpret_cast<object>(arguments[0]), arguments[1]);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_java_util_Arrays_fill___3SS
+(Thread* t, object, uintptr_t* arguments)
+{
+  arrayFill(t, reinterpret_cast<object>(arguments[0]), arguments[1]);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_java_util_Arrays_fill___3CC
+(Thread* t, object, uintptr_t* arguments)
+{
+  arrayFill(t, reinterpret_cast<object>(arguments[0]), arguments[1]);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_java_util_Arrays_fill___3II
+(Thread* t, object, uintptr_t* arguments)
+{
+  arrayFill(t, reinterpret_cast<object>(arguments[0]), arguments[1]);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_java_util_Arrays_fill___3JJ
+(Thread* t, object, uintptr_t* arguments)
+{
+  uint64_t value; memcpy(&value, arguments + 1, 8);
+
+  arrayFill(t, reinterpret_cast<object>(arguments[0]), value);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_java_util_Arrays_fill___3FF
+(Thread* t, object, uintptr_t* arguments)
+{
+  arrayFill(t, reinterpret_cast<object>(arguments[0]), arguments[1]);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_java_util_Arrays_fill___3DD
+(Thread* t, object, uintptr_t* arguments)
+{
+  uint64_t value; memcpy(&value, arguments + 1, 8);
+
+  arrayFill(t, reinterpret_cast<object>(arguments[0]), value);
+}
+
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_System_identityHashCode
 (Thread* t, object, uintptr_t* arguments)
@@ -529,13 +641,13 @@ Avian_java_lang_Throwable_resolveTrace
   object trace = reinterpret_cast<object>(*arguments);
   PROTECT(t, trace);
 
-  unsigned length = objectArrayLength(t, trace);
+  unsigned length = traceLength(t, trace);
   object elementType = type(t, Machine::StackTraceElementType);
   object array = makeObjectArray(t, elementType, length);
   PROTECT(t, array);
 
   for (unsigned i = 0; i < length; ++i) {
-    object ste = makeStackTraceElement(t, objectArrayBody(t, trace, i));
+    object ste = makeStackTraceElement(t, trace, i);
     set(t, array, ArrayBody + (i * BytesPerWord), ste);
   }
 
@@ -617,6 +729,23 @@ Avian_java_lang_Thread_yield
   t->m->system->yield();
 }
 
+extern "C" JNIEXPORT void JNICALL
+Avian_sun_misc_Unsafe_unpark
+(Thread* t, object, uintptr_t* arguments)
+{
+  unpark(t, reinterpret_cast<object>(arguments[1]));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_sun_misc_Unsafe_park
+(Thread* t, object, uintptr_t* arguments)
+{
+  bool absolute = arguments[1];
+  int64_t time; memcpy(&time, arguments + 2, 8);
+
+  park(t, absolute, time);
+}
+
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_avian_Atomic_getOffset
 (Thread* t, object, uintptr_t* arguments)
@@ -51,71 +51,11 @@ getTrace(Thread* t, unsigned skipCount)
 
   t->m->processor->walkStack(t, &v);
 
-  if (v.trace == 0) v.trace = makeObjectArray(t, 0);
+  if (v.trace == 0) v.trace = makeEmptyTrace(t);
 
   return v.trace;
 }
 
-bool
-compatibleArrayTypes(Thread* t, object a, object b)
-{
-  return classArrayElementSize(t, a)
-    and classArrayElementSize(t, b)
-    and (a == b
-         or (not ((classVmFlags(t, a) & PrimitiveFlag)
-                  or (classVmFlags(t, b) & PrimitiveFlag))));
-}
-
-void
-arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
-          int32_t dstOffset, int32_t length)
-{
-  if (LIKELY(src and dst)) {
-    if (LIKELY(compatibleArrayTypes
-               (t, objectClass(t, src), objectClass(t, dst))))
-    {
-      unsigned elementSize = classArrayElementSize(t, objectClass(t, src));
-
-      if (LIKELY(elementSize)) {
-        intptr_t sl = cast<uintptr_t>(src, BytesPerWord);
-        intptr_t dl = cast<uintptr_t>(dst, BytesPerWord);
-        if (LIKELY(length > 0)) {
-          if (LIKELY(srcOffset >= 0 and srcOffset + length <= sl and
-                     dstOffset >= 0 and dstOffset + length <= dl))
-          {
-            uint8_t* sbody = &cast<uint8_t>(src, ArrayBody);
-            uint8_t* dbody = &cast<uint8_t>(dst, ArrayBody);
-            if (src == dst) {
-              memmove(dbody + (dstOffset * elementSize),
-                      sbody + (srcOffset * elementSize),
-                      length * elementSize);
-            } else {
-              memcpy(dbody + (dstOffset * elementSize),
-                     sbody + (srcOffset * elementSize),
-                     length * elementSize);
-            }
-
-            if (classObjectMask(t, objectClass(t, dst))) {
-              mark(t, dst, ArrayBody + (dstOffset * BytesPerWord), length);
-            }
-
-            return;
-          } else {
-            throwNew(t, Machine::IndexOutOfBoundsExceptionType);
-          }
-        } else {
-          return;
-        }
-      }
-    }
-  } else {
-    throwNew(t, Machine::NullPointerExceptionType);
-    return;
-  }
-
-  throwNew(t, Machine::ArrayStoreExceptionType);
-}
-
 void
 runOnLoadIfFound(Thread* t, System::Library* library)
 {
@@ -254,9 +194,12 @@ clone(Thread* t, object o)
 
   if (classArrayElementSize(t, class_)) {
     clone = static_cast<object>(allocate(t, size, classObjectMask(t, class_)));
-    memcpy(clone, o, size);
-    // clear any object header flags:
-    setObjectClass(t, o, objectClass(t, o));
+    // copy everything but the header, which holds the original's
+    // flags and lock word:
+    memcpy(reinterpret_cast<void**>(clone) + 1,
+           reinterpret_cast<void**>(o) + 1,
+           size - BytesPerWord);
+    setObjectClass(t, clone, class_);
   } else {
     clone = make(t, class_);
     memcpy(reinterpret_cast<void**>(clone) + 1,
@@ -268,11 +211,11 @@ clone(Thread* t, object o)
 }
 
 object
-makeStackTraceElement(Thread* t, object e)
+makeStackTraceElement(Thread* t, object trace, unsigned index)
 {
-  PROTECT(t, e);
+  PROTECT(t, trace);
 
-  object class_ = className(t, methodClass(t, traceElementMethod(t, e)));
+  object class_ = className(t, methodClass(t, traceMethod(t, trace, index)));
   PROTECT(t, class_);
 
   THREAD_RUNTIME_ARRAY(t, char, s, byteArrayLength(t, class_));
@@ -280,16 +223,17 @@ makeStackTraceElement(Thread* t, object e)
           reinterpret_cast<char*>(&byteArrayBody(t, class_, 0)));
   class_ = makeString(t, "%s", RUNTIME_ARRAY_BODY(s));
 
-  object method = methodName(t, traceElementMethod(t, e));
+  object method = methodName(t, traceMethod(t, trace, index));
   PROTECT(t, method);
 
   method = t->m->classpath->makeString
     (t, method, 0, byteArrayLength(t, method) - 1);
 
   unsigned line = t->m->processor->lineNumber
-    (t, traceElementMethod(t, e), traceElementIp(t, e));
+    (t, traceMethod(t, trace, index), traceIp(t, trace, index));
 
-  object file = classSourceFile(t, methodClass(t, traceElementMethod(t, e)));
+  object file = classSourceFile
+    (t, methodClass(t, traceMethod(t, trace, index)));
   file = file ? t->m->classpath->makeString
     (t, file, 0, byteArrayLength(t, file) - 1) : 0;
 
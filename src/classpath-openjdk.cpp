@@ -2834,12 +2834,7 @@ extern "C" JNIEXPORT void JNICALL
 Avian_sun_misc_Unsafe_unpark
 (Thread* t, object, uintptr_t* arguments)
 {
-  object thread = reinterpret_cast<object>(arguments[1]);
-  
-  monitorAcquire(t, local::interruptLock(t, thread));
-  threadUnparked(t, thread) = true;
-  monitorNotify(t, local::interruptLock(t, thread));
-  monitorRelease(t, local::interruptLock(t, thread));
+  unpark(t, reinterpret_cast<object>(arguments[1]));
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -2848,37 +2843,8 @@ Avian_sun_misc_Unsafe_park
 {
   bool absolute = arguments[1];
   int64_t time; memcpy(&time, arguments + 2, 8);
-  
-  int64_t then = t->m->system->now();
 
-  if (absolute) {
-    time -= then;
-    if (time <= 0) {
-      return;
-    }
-  } else if (time) {
-    // if not absolute, interpret time as nanoseconds, but make sure
-    // it doesn't become zero when we convert to milliseconds, since
-    // zero is interpreted as infinity below
-    time = (time / (1000 * 1000)) + 1;
-  }
-
-  monitorAcquire(t, local::interruptLock(t, t->javaThread));
-  while (time >= 0
-         and (not (threadUnparked(t, t->javaThread)
-                   or monitorWait
-                   (t, local::interruptLock(t, t->javaThread), time))))
-  {
-    int64_t now = t->m->system->now();
-    time -= now - then;
-    then = now;
-    
-    if (time == 0) {
-      break;
-    }
-  }
-  threadUnparked(t, t->javaThread) = false;
-  monitorRelease(t, local::interruptLock(t, t->javaThread));
+  park(t, absolute, time);
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -3303,7 +3269,7 @@ EXPORT(JVM_GetStackTraceDepth)(Thread* t, jobject throwable)
 {
   ENTER(t, Thread::ActiveState);
 
-  return objectArrayLength(t, throwableTrace(t, *throwable));
+  return traceLength(t, throwableTrace(t, *throwable));
 }
 
 uint64_t
@@ -3314,8 +3280,7 @@ jvmGetStackTraceElement(Thread* t, uintptr_t* arguments)
 
   return reinterpret_cast<uint64_t>
     (makeLocalReference
-     (t, makeStackTraceElement
-      (t, objectArrayBody(t, throwableTrace(t, *throwable), index))));
+     (t, makeStackTraceElement(t, throwableTrace(t, *throwable), index)));
 }
 
 extern "C" JNIEXPORT jobject JNICALL
@@ -3498,9 +3463,7 @@ EXPORT(JVM_IsInterrupted)(Thread* t, jobject thread, jboolean clear)
 uint64_t
 jvmHoldsLock(Thread* t, uintptr_t* arguments)
 {
-  object m = objectMonitor(t, *reinterpret_cast<jobject>(arguments[0]), false);
-
-  return m and monitorOwner(t, m) == t;
+  return holdsLock(t, *reinterpret_cast<jobject>(arguments[0]));
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
@@ -3539,14 +3502,13 @@ jvmDumpThreads(Thread* t, uintptr_t* arguments)
       object trace = t->m->processor->getStackTrace(t, peer);
       PROTECT(t, trace);
 
-      unsigned traceLength = objectArrayLength(t, trace);
+      unsigned length = traceLength(t, trace);
       object array = makeObjectArray
-        (t, type(t, Machine::StackTraceElementType), traceLength);
+        (t, type(t, Machine::StackTraceElementType), length);
       PROTECT(t, array);
 
-      for (unsigned traceIndex = 0; traceIndex < traceLength; ++ traceIndex) {
-        object ste = makeStackTraceElement
-          (t, objectArrayBody(t, trace, traceIndex));
+      for (unsigned traceIndex = 0; traceIndex < length; ++ traceIndex) {
+        object ste = makeStackTraceElement(t, trace, traceIndex);
         set(t, array, ArrayBody + (traceIndex * BytesPerWord), ste);
       }
 
@@ -3578,12 +3540,11 @@ jvmGetClassContext(Thread* t, uintptr_t*)
   PROTECT(t, trace);
 
   object context = makeObjectArray
-    (t, type(t, Machine::JclassType), objectArrayLength(t, trace));
+    (t, type(t, Machine::JclassType), traceLength(t, trace));
   PROTECT(t, context);
 
-  for (unsigned i = 0; i < objectArrayLength(t, trace); ++i) {
-    object c = getJClass
-      (t, methodClass(t, traceElementMethod(t, objectArrayBody(t, trace, i))));
+  for (unsigned i = 0; i < traceLength(t, trace); ++i) {
+    object c = getJClass(t, methodClass(t, traceMethod(t, trace, i)));
 
     set(t, context, ArrayBody + (i * BytesPerWord), c);
   }
@@ -302,8 +302,12 @@ fopen(const char* name, const char* mode)
 const unsigned BytesPerWord = sizeof(uintptr_t);
 const unsigned BitsPerWord = BytesPerWord * 8;
 
+// masks off the low bits, which may hold flags, and, on 64-bit
+// machines, the top 16 bits, which are never part of a user-space
+// address and hold an object's thin lock word (see machine.h):
 const uintptr_t PointerMask
-= ((~static_cast<uintptr_t>(0)) / BytesPerWord) * BytesPerWord;
+= (((~static_cast<uintptr_t>(0)) >> (BytesPerWord == 8 ? 16 : 0))
+   / BytesPerWord) * BytesPerWord;
 
 const unsigned LikelyPageSizeInBytes = 4 * 1024;
 
@@ -501,8 +505,19 @@ hash(const char* s)
 inline uint32_t
 hash(const uint8_t* s, unsigned length)
 {
+  // Hash four elements per iteration so consecutive multiplies don't
+  // depend on each other; the result is the same as hashing one
+  // element at a time (923521 == 31^4, 29791 == 31^3, 961 == 31^2).
   uint32_t h = 0;
-  for (unsigned i = 0; i < length; ++i) {
+  unsigned i = 0;
+  for (; i + 4 <= length; i += 4) {
+    h = (h * 923521)
+      + (static_cast<uint32_t>(s[i]) * 29791)
+      + (static_cast<uint32_t>(s[i + 1]) * 961)
+      + (static_cast<uint32_t>(s[i + 2]) * 31)
+      + s[i + 3];
+  }
+  for (; i < length; ++i) {
     h = (h * 31) + s[i];
   }
   return h;
@@ -517,8 +532,17 @@ hash(const int8_t* s, unsigned length)
 inline uint32_t
 hash(const uint16_t* s, unsigned length)
 {
+  // see hash(const uint8_t*, unsigned)
   uint32_t h = 0;
-  for (unsigned i = 0; i < length; ++i) {
+  unsigned i = 0;
+  for (; i + 4 <= length; i += 4) {
+    h = (h * 923521)
+      + (static_cast<uint32_t>(s[i]) * 29791)
+      + (static_cast<uint32_t>(s[i + 1]) * 961)
+      + (static_cast<uint32_t>(s[i + 2]) * 31)
+      + s[i + 3];
+  }
+  for (; i < length; ++i) {
     h = (h * 31) + s[i];
   }
   return h;
@@ -16,6 +16,7 @@
 #include "target.h"
 #include "compiler.h"
 #include "arch.h"
+#include "interpreter.h"
 
 using namespace vm;
 
@@ -41,7 +42,7 @@ namespace local {
 const bool DebugCompile = false;
 const bool DebugNatives = false;
 const bool DebugCallTable = false;
-const bool DebugMethodTree = false;
+const bool DebugCodeIndex = false;
 const bool DebugFrameMaps = false;
 const bool DebugIntrinsics = false;
 
@@ -59,24 +60,40 @@ const unsigned InitialZoneCapacityInBytes = 64 * 1024;
 
 const unsigned ExecutableAreaSizeInBytes = 30 * 1024 * 1024;
 
+// size of the chunks of executable memory which each thread claims
+// from the executable area to hold the methods it compiles:
+const unsigned CodeChunkSizeInBytes = 32 * 1024;
+
+// maximum number of receiver classes cached by an invokeinterface
+// call site stub before the site is considered megamorphic:
+const unsigned InterfaceCacheSize = 4;
+
+const unsigned InterfaceMethodCacheSize = 1024;
+
 enum Root {
   CallTable,
-  MethodTree,
-  MethodTreeSentinal,
+  CompiledMethods,
+  BootCompiledMethods,
   ObjectPools,
   StaticTableArray,
   VirtualThunks,
   ReceiveMethod,
   WindMethod,
-  RewindMethod
+  RewindMethod,
+  InterfaceCaches,
+  InterfaceStubs,
+  InterfaceMethodCache,
+  CodeChunkMethods
 };
 
 enum ThunkIndex {
   compileMethodIndex,
   compileVirtualMethodIndex,
+  compileInterfaceMethodIndex,
   invokeNativeIndex,
   throwArrayIndexOutOfBoundsIndex,
   throwStackOverflowIndex,
+  safepointIndex,
 
 #define THUNK(s) s##Index,
 #include "thunks.cpp"
@@ -85,7 +102,7 @@ enum ThunkIndex {
   dummyIndex
 };
 
-const unsigned RootCount = RewindMethod + 1;
+const unsigned RootCount = CodeChunkMethods + 1;
 
 inline bool
 isVmInvokeUnsafeStack(void* ip)
@@ -97,6 +114,7 @@ isVmInvokeUnsafeStack(void* ip)
 }
 
 class MyThread;
+class CodeChunk;
 
 void*
 getIp(MyThread*);
@@ -213,6 +231,21 @@ class MyThread: public Thread {
     Reference* reference;
   };
 
+  // remembers, for a given return address and exception class, which
+  // method the address belongs to and where (if anywhere) that method
+  // handles the exception, so that repeated throws need not query the
+  // method tree or scan handler tables.  Entries refer to objects by
+  // address, so the cache is cleared whenever the heap is collected.
+  class HandlerCacheEntry {
+   public:
+    void* ip;
+    object exceptionClass;
+    object method;
+    void* handler;
+  };
+
+  static const unsigned HandlerCacheSize = 64;
+
   static void doTransition(MyThread* t, void* ip, void* stack,
                            object continuation, MyThread::CallTrace* trace)
   {
@@ -266,10 +299,15 @@ class MyThread: public Thread {
     transition(0),
     traceContext(0),
     stackLimit(0),
+    pollPage(0),
     referenceFrame(0),
-    methodLockIsClean(true)
+    methodLockIsClean(true),
+    interpreter(0),
+    codeChunk(0)
   {
     arch->acquire();
+
+    memset(handlerCache, 0, sizeof(handlerCache));
   }
 
   void* ip;
@@ -292,8 +330,13 @@ class MyThread: public Thread {
   Context* transition;
   TraceContext* traceContext;
   uintptr_t stackLimit;
+  uint8_t* cardTable;
+  uint8_t* pollPage;
   ReferenceFrame* referenceFrame;
+  HandlerCacheEntry handlerCache[HandlerCacheSize];
   bool methodLockIsClean;
+  Interpreter* interpreter;
+  CodeChunk* codeChunk;
 };
 
 void
@@ -360,6 +403,9 @@ root(Thread* t, Root root);
 void
 setRoot(Thread* t, Root root, object value);
 
+bool
+compareAndSwapRoot(Thread* t, Root root, object old, object new_);
+
 intptr_t
 methodCompiled(Thread* t, object method)
 {
@@ -372,44 +418,201 @@ methodCompiledSize(Thread* t, object method)
   return codeCompiledSize(t, methodCode(t, method));
 }
 
-intptr_t
-compareIpToMethodBounds(Thread* t, intptr_t ip, object method)
-{
-  intptr_t start = methodCompiled(t, method);
+class CodeIndex {
+ public:
+  // An index mapping addresses in a region of executable memory to the
+  // methods compiled there.  Since the code for each method is
+  // allocated from the region in increasing address order, the index
+  // is an append-only array of code bounds sorted by start address,
+  // plus a per-page table giving the first entry starting in each page,
+  // which narrows a lookup to a binary search over the few methods
+  // near the address.  The methods themselves are kept at matching
+  // positions in a heap array so that the collector can find them.
+  //
+  // Entries are added by one thread at a time (e.g. the owner of a
+  // CodeChunk), but readers take no lock: an entry is completely written (and the entry array replaced, if
+  // it had to grow) before the count is increased, and arrays which
+  // have been replaced are not freed until the index is disposed, so a
+  // reader sees a consistent prefix of the index.
+
+  static const unsigned PageBits = 12;
+
+  class Entry {
+   public:
+    uint32_t start;
+    uint32_t end;
+  };
 
-  if (DebugMethodTree) {
-    fprintf(stderr, "find %p in (%p,%p)\n",
-            reinterpret_cast<void*>(ip),
-            reinterpret_cast<void*>(start),
-            reinterpret_cast<void*>(start + methodCompiledSize(t, method)));
+  class Retired {
+   public:
+    Retired(Retired* next, Entry* entries, unsigned capacity):
+      next(next), entries(entries), capacity(capacity)
+    { }
+
+    Retired* next;
+    Entry* entries;
+    unsigned capacity;
+  };
+
+  CodeIndex():
+    base(0), size(0), entries(0), capacity(0), count(0), pages(0),
+    pageCount(0), retired(0)
+  { }
+
+  void init(Allocator* allocator, uint8_t* base, unsigned size) {
+    this->base = base;
+    this->size = size;
+    pageCount = (size >> PageBits) + 1;
+    pages = static_cast<uint32_t*>
+      (allocator->allocate(pageCount * sizeof(uint32_t)));
   }
 
-  if (ip < start) {
-    return -1;
-  } else if (ip < start + static_cast<intptr_t>
-             (methodCompiledSize(t, method)))
+  void dispose(Allocator* allocator) {
+    while (retired) {
+      Retired* r = retired;
+      retired = r->next;
+      allocator->free(r->entries, r->capacity * sizeof(Entry));
+      allocator->free(r, sizeof(Retired));
+    }
+
+    if (entries) {
+      allocator->free(entries, capacity * sizeof(Entry));
+    }
+
+    if (pages) {
+      allocator->free(pages, pageCount * sizeof(uint32_t));
+    }
+  }
+
+  bool contains(void* ip) {
+    return static_cast<uint8_t*>(ip) >= base
+      and static_cast<uint8_t*>(ip) < base + size;
+  }
+
+  // returns the index of the method containing ip, or -1 if none does
+  int find(void* ip) {
+    unsigned n = count;
+
+    loadMemoryBarrier();
+
+    if (n == 0 or not contains(ip)) {
+      return -1;
+    }
+
+    Entry* e = entries;
+    uint32_t offset = static_cast<uint8_t*>(ip) - base;
+
+    unsigned page = offset >> PageBits;
+    unsigned filled = (e[n - 1].start >> PageBits) + 1;
+
+    unsigned bottom;
+    unsigned top;
+    if (page < filled) {
+      bottom = pages[page] ? pages[page] - 1 : 0;
+      top = page + 1 < filled ? pages[page + 1] : n;
+    } else {
+      bottom = n - 1;
+      top = n;
+    }
+
+    if (e[bottom].start > offset) {
+      return -1;
+    }
+
+    // find the last entry in [bottom, top) which starts at or before
+    // offset
+    while (top - bottom > 1) {
+      unsigned middle = bottom + ((top - bottom) / 2);
+      if (e[middle].start <= offset) {
+        bottom = middle;
+      } else {
+        top = middle;
+      }
+    }
+
+    return offset < e[bottom].end ? static_cast<int>(bottom) : -1;
+  }
+
+  // appends an entry for the specified code bounds, which must lie
+  // above those of every existing entry, and returns its index.  The
+  // entry is not visible to readers until publish is called.
+  unsigned add(Thread* t, Allocator* allocator, void* start,
+               unsigned length)
   {
-    return 0;
-  } else {
-    return 1;
+    expect(t, contains(start));
+
+    if (count == capacity) {
+      unsigned newCapacity = capacity ? capacity * 2 : 256;
+      Entry* newEntries = static_cast<Entry*>
+        (allocator->allocate(newCapacity * sizeof(Entry)));
+
+      if (entries) {
+        memcpy(newEntries, entries, count * sizeof(Entry));
+        retired = new (allocator->allocate(sizeof(Retired)))
+          Retired(retired, entries, capacity);
+      }
+
+      storeStoreMemoryBarrier();
+
+      entries = newEntries;
+      capacity = newCapacity;
+    }
+
+    Entry* e = entries + count;
+    e->start = static_cast<uint8_t*>(start) - base;
+    e->end = e->start + length;
+
+    expect(t, count == 0 or entries[count - 1].end <= e->start);
+
+    unsigned filled = count ? (entries[count - 1].start >> PageBits) + 1 : 0;
+    for (unsigned page = filled; page <= (e->start >> PageBits); ++page) {
+      pages[page] = count;
+    }
+
+    return count;
   }
-}
 
-object
-methodForIp(MyThread* t, void* ip)
-{
-  if (DebugMethodTree) {
-    fprintf(stderr, "query for method containing %p\n", ip);
+  void publish() {
+    storeStoreMemoryBarrier();
+
+    ++ count;
   }
 
-  // we must use a version of the method tree at least as recent as the
-  // compiled form of the method containing the specified address (see
-  // compile(MyThread*, FixedAllocator*, BootContext*, object)):
-  loadMemoryBarrier();
+  uint8_t* base;
+  unsigned size;
+  Entry* entries;
+  unsigned capacity;
+  unsigned count;
+  uint32_t* pages;
+  unsigned pageCount;
+  Retired* retired;
+};
 
-  return treeQuery(t, root(t, MethodTree), reinterpret_cast<intptr_t>(ip),
-                   root(t, MethodTreeSentinal), compareIpToMethodBounds);
-}
+class CodeChunk {
+ public:
+  // A region of the executable area claimed by a single thread, which
+  // places the code for the methods it compiles there and indexes them
+  // in its own CodeIndex, so that compiling threads need not contend
+  // for a global allocator or index.  The methods themselves are kept
+  // in the CodeChunkMethods root at position "number".
+  //
+  // Chunks are claimed under the class lock in increasing address
+  // order and indexed by MyProcessor::codeChunkIndex, so a lookup by
+  // address first finds the chunk and then the method within it,
+  // although the chunks of different threads fill up in no particular
+  // order.
+
+  CodeChunk(System* s, uint8_t* base, unsigned capacity, unsigned number):
+    allocator(s, base, capacity), number(number)
+  { }
+
+  FixedAllocator allocator;
+  CodeIndex index;
+  unsigned number;
+};
+
+object
+methodForIp(MyThread* t, void* ip);
 
 unsigned
 localSize(MyThread* t, object method)
@@ -1082,6 +1285,27 @@ class Context {
             assert(t, resultSize == 4);
             return local::getThunk(t, longToFloatThunk);
           }
+
+        case Float2Bits:
+        case Bits2Float:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, moveLongBitsThunk);
+
+        case ReverseBytes:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, reverseBytesLongThunk);
+
+        case BitCount:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, bitCountLongThunk);
+
+        case LeadingZeros:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, leadingZerosLongThunk);
+
+        case TrailingZeros:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, trailingZerosLongThunk);
           
         default: abort(t);
         }
@@ -1120,6 +1344,27 @@ class Context {
             assert(t, resultSize == 8);
             return local::getThunk(t, intToDoubleThunk);
           }
+
+        case Float2Bits:
+        case Bits2Float:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, moveIntBitsThunk);
+
+        case ReverseBytes:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, reverseBytesIntThunk);
+
+        case BitCount:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, bitCountIntThunk);
+
+        case LeadingZeros:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, leadingZerosIntThunk);
+
+        case TrailingZeros:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, trailingZerosIntThunk);
           
         default: abort(t);
         }
@@ -1217,6 +1462,41 @@ class Context {
       }
     }
 
+    virtual intptr_t getThunk(AtomicOperation op, unsigned size,
+                              bool* threadParameter)
+    {
+      if (size == 8) {
+        *threadParameter = true;
+        switch (op) {
+        case AtomicAdd:
+          return local::getThunk(t, getAndAddLongThunk);
+
+        case AtomicExchange:
+          return local::getThunk(t, getAndSetLongThunk);
+
+        case AtomicCompareAndSwap:
+          return local::getThunk(t, compareAndSwapLongThunk);
+
+        default: abort(t);
+        }
+      } else {
+        assert(t, size == 4);
+        *threadParameter = false;
+        switch (op) {
+        case AtomicAdd:
+          return local::getThunk(t, getAndAddIntThunk);
+
+        case AtomicExchange:
+          return local::getThunk(t, getAndSetIntThunk);
+
+        case AtomicCompareAndSwap:
+          return local::getThunk(t, compareAndSwapIntThunk);
+
+        default: abort(t);
+        }
+      }
+    }
+
     MyThread* t;
   };
 
@@ -1233,6 +1513,7 @@ class Context {
     traceLog(0),
     visitTable(makeVisitTable(t, &zone, method)),
     rootTable(makeRootTable(t, &zone, method)),
+    boundsTable(0),
     subroutineTable(0),
     executableAllocator(0),
     executableStart(0),
@@ -1259,6 +1540,7 @@ class Context {
     traceLog(0),
     visitTable(0),
     rootTable(0),
+    boundsTable(0),
     subroutineTable(0),
     executableAllocator(0),
     executableStart(0),
@@ -1304,6 +1586,9 @@ class Context {
   TraceElement* traceLog;
   uint16_t* visitTable;
   uintptr_t* rootTable;
+  // array accesses which need no bounds check, indexed by bytecode
+  // offset (see findRedundantBoundsChecks)
+  uintptr_t* boundsTable;
   Subroutine** subroutineTable;
   Allocator* executableAllocator;
   void* executableStart;
@@ -1348,6 +1633,9 @@ storeLocal(Context* context, unsigned footprint, Compiler::Operand* value,
 FixedAllocator*
 codeAllocator(MyThread* t);
 
+FixedAllocator*
+reserveCode(MyThread* t, Context* context, unsigned* codeSize);
+
 class Frame {
  public:
   enum StackType {
@@ -2006,6 +2294,9 @@ findCallNode(MyThread* t, void* address);
 void
 insertCallNode(MyThread* t, object node);
 
+object
+insertCallNode(MyThread* t, object table, unsigned* size, object node);
+
 void*
 findExceptionHandler(Thread* t, object method, void* ip)
 {
@@ -2036,6 +2327,49 @@ findExceptionHandler(Thread* t, object method, void* ip)
   return 0;
 }
 
+MyThread::HandlerCacheEntry*
+handlerCacheEntry(MyThread* t, void* ip, object exceptionClass)
+{
+  uintptr_t hash = (reinterpret_cast<uintptr_t>(ip) >> 2)
+    ^ (reinterpret_cast<uintptr_t>(exceptionClass) >> 3);
+
+  return t->handlerCache + (hash & (MyThread::HandlerCacheSize - 1));
+}
+
+object
+findCompiledHandler(MyThread* t, void* ip, void** handler)
+{
+  // the shutdown exception bypasses every handler but finally blocks
+  // (see exceptionMatch), so we neither consult nor populate the
+  // cache for it, nor when unwinding without an exception
+  if (t->exception == 0 or t->exception == root(t, Machine::Shutdown)) {
+    object method = methodForIp(t, ip);
+    *handler = method ? findExceptionHandler(t, method, ip) : 0;
+    return method;
+  }
+
+  object exceptionClass = objectClass(t, t->exception);
+  MyThread::HandlerCacheEntry* e = handlerCacheEntry(t, ip, exceptionClass);
+  if (e->ip == ip and e->exceptionClass == exceptionClass) {
+    *handler = e->handler;
+    return e->method;
+  }
+
+  object method = methodForIp(t, ip);
+  if (method) {
+    *handler = findExceptionHandler(t, method, ip);
+
+    e->ip = ip;
+    e->exceptionClass = exceptionClass;
+    e->method = method;
+    e->handler = *handler;
+  } else {
+    *handler = 0;
+  }
+
+  return method;
+}
+
 void
 releaseLock(MyThread* t, object method, void* stack)
 {
@@ -2083,10 +2417,9 @@ findUnwindTarget(MyThread* t, void** targetIp, void** targetFrame,
 
   *targetIp = 0;
   while (*targetIp == 0) {
-    object method = methodForIp(t, ip);
+    void* handler;
+    object method = findCompiledHandler(t, ip, &handler);
     if (method) {
-      void* handler = findExceptionHandler(t, method, ip);
-
       if (handler) {
         *targetIp = handler;
 
@@ -2285,9 +2618,21 @@ aioobThunk(MyThread* t);
 uintptr_t
 stackOverflowThunk(MyThread* t);
 
+uintptr_t
+safepointThunk(MyThread* t);
+
+uintptr_t
+allocateThunk(MyThread* t);
+
+uintptr_t
+allocateArrayThunk(MyThread* t);
+
 uintptr_t
 virtualThunk(MyThread* t, unsigned index);
 
+uintptr_t
+defaultInterfaceThunk(MyThread* t);
+
 bool
 unresolved(MyThread* t, uintptr_t methodAddress);
 
@@ -2311,9 +2656,60 @@ void
 compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
         object method);
 
+bool
+shouldInterpret(MyThread* t, object method);
+
+object
+resolvedReference(Thread* t, object pair, Machine::Type resolvedType)
+{
+  // Each (method, reference) pair belongs to a single call site in
+  // compiled code, so once the reference has been resolved we store
+  // the result in place of the reference and later executions of that
+  // site skip the class and member lookups entirely.
+
+  object o = pairSecond(t, pair);
+
+  loadMemoryBarrier();
+
+  return objectClass(t, o) == type(t, resolvedType) ? o : 0;
+}
+
+object
+resolved(Thread* t, object pair, object o)
+{
+  storeStoreMemoryBarrier();
+
+  set(t, pair, PairSecond, o);
+
+  return o;
+}
+
+object
+resolveReferencedClass(Thread* t, object pair)
+{
+  object class_ = resolvedReference(t, pair, Machine::ClassType);
+  if (class_) {
+    return class_;
+  }
+
+  PROTECT(t, pair);
+
+  return resolved
+    (t, pair, resolveClass
+     (t, classLoader(t, methodClass(t, pairFirst(t, pair))),
+      referenceName(t, pairSecond(t, pair))));
+}
+
 object
 resolveMethod(Thread* t, object pair)
 {
+  object method = resolvedReference(t, pair, Machine::MethodType);
+  if (method) {
+    return method;
+  }
+
+  PROTECT(t, pair);
+
   object reference = pairSecond(t, pair);
   PROTECT(t, reference);
 
@@ -2321,9 +2717,10 @@ resolveMethod(Thread* t, object pair)
     (t, classLoader(t, methodClass(t, pairFirst(t, pair))), reference,
      ReferenceClass);
 
-  return findInHierarchy
-    (t, class_, referenceName(t, reference), referenceSpec(t, reference),
-     findMethodInClass, Machine::NoSuchMethodErrorType);
+  return resolved
+    (t, pair, findInHierarchy
+     (t, class_, referenceName(t, reference), referenceSpec(t, reference),
+      findMethodInClass, Machine::NoSuchMethodErrorType));
 }
 
 bool
@@ -2344,7 +2741,12 @@ prepareMethodForCall(MyThread* t, object target)
   } else { 
     if (unresolved(t, methodAddress(t, target))) {
       PROTECT(t, target);
-      
+
+      if (shouldInterpret(t, target)) {
+        t->trace->nativeMethod = target;
+        return bootNativeThunk(t);
+      }
+
       compile(t, codeAllocator(t), 0, target);
     }
 
@@ -2356,12 +2758,63 @@ prepareMethodForCall(MyThread* t, object target)
   }
 }
 
+unsigned
+interfaceMethodCacheIndex(object method, object class_)
+{
+  return ((reinterpret_cast<uintptr_t>(method) >> 3)
+          ^ (reinterpret_cast<uintptr_t>(class_) >> 4))
+    & (InterfaceMethodCacheSize - 1);
+}
+
+object
+findCachedInterfaceMethod(MyThread* t, object method, object class_)
+{
+  // The interface method cache is a direct-mapped table of (class,
+  // interface method, target) triples used in place of a linear scan
+  // of the class's interface table.  Entries are keyed by address, so
+  // they simply miss after their keys are moved by the collector.
+  // Each entry is immutable and published with a single store, so
+  // readers need no lock.
+
+  object cache = root(t, InterfaceMethodCache);
+  if (cache) {
+    object entry = arrayBody
+      (t, cache, interfaceMethodCacheIndex(method, class_));
+
+    if (entry
+        and tripleFirst(t, entry) == class_
+        and tripleSecond(t, entry) == method)
+    {
+      return tripleThird(t, entry);
+    }
+  }
+
+  PROTECT(t, method);
+  PROTECT(t, class_);
+
+  object target = findInterfaceMethod(t, method, class_);
+  PROTECT(t, target);
+
+  if (cache == 0) {
+    setRoot(t, InterfaceMethodCache, makeArray(t, InterfaceMethodCacheSize));
+  }
+
+  object entry = makeTriple(t, class_, method, target);
+
+  storeStoreMemoryBarrier();
+
+  set(t, root(t, InterfaceMethodCache), ArrayBody
+      + (interfaceMethodCacheIndex(method, class_) * BytesPerWord), entry);
+
+  return target;
+}
+
 int64_t
 findInterfaceMethodFromInstance(MyThread* t, object method, object instance)
 {
   if (instance) {
     return prepareMethodForCall
-      (t, findInterfaceMethod(t, method, objectClass(t, instance)));
+      (t, findCachedInterfaceMethod(t, method, objectClass(t, instance)));
   } else {
     throwNew(t, Machine::NullPointerExceptionType);
   }
@@ -2403,8 +2856,8 @@ checkField(Thread* t, object field, bool shouldBeStatic)
   }
 }
 
-int64_t
-findSpecialMethodFromReference(MyThread* t, object pair)
+object
+resolveSpecialMethod(MyThread* t, object pair)
 {
   PROTECT(t, pair);
 
@@ -2417,17 +2870,73 @@ findSpecialMethodFromReference(MyThread* t, object pair)
 
   checkMethod(t, target, false);
 
-  return prepareMethodForCall(t, target);
+  return target;
 }
 
-int64_t
-findStaticMethodFromReference(MyThread* t, object pair)
+object
+resolveStaticMethod(MyThread* t, object pair)
 {
   object target = resolveMethod(t, pair);
 
   checkMethod(t, target, true);
 
-  return prepareMethodForCall(t, target);
+  return target;
+}
+
+int64_t
+findSpecialMethodFromReference(MyThread* t, object pair)
+{
+  return prepareMethodForCall(t, resolveSpecialMethod(t, pair));
+}
+
+int64_t
+findStaticMethodFromReference(MyThread* t, object pair)
+{
+  return prepareMethodForCall(t, resolveStaticMethod(t, pair));
+}
+
+object
+makeReferenceStub(MyThread* t, object pair, bool isStatic)
+{
+  // A reference stub stands in for the target of an invokestatic or
+  // invokespecial whose class was not loaded when the caller was
+  // compiled.  The call site is compiled as an ordinary unresolved
+  // direct call to the stub, so the first call traps into
+  // compileMethod, which resolves the reference and patches the call
+  // to go straight to the real target from then on.  Until then, the
+  // stub's flags and spec tell the stack walker which of the pushed
+  // arguments are object references.
+
+  PROTECT(t, pair);
+
+  object reference = pairSecond(t, pair);
+  PROTECT(t, reference);
+
+  const char* spec = reinterpret_cast<const char*>
+    (&byteArrayBody(t, referenceSpec(t, reference), 0));
+
+  unsigned parameterCount;
+  unsigned returnCode;
+  scanMethodSpec(t, spec, &parameterCount, &returnCode);
+
+  unsigned footprint = parameterFootprint(t, spec, isStatic);
+
+  object code = makeCode(t, pair, 0, 0, 0, 0, 0, 0, 0);
+
+  return t->m->processor->makeMethod
+    (t, ReferenceStubFlag, returnCode, parameterCount, footprint,
+     isStatic ? ACC_STATIC : 0, 0, referenceName(t, reference),
+     referenceSpec(t, reference), 0, methodClass(t, pairFirst(t, pair)),
+     code);
+}
+
+object
+resolveReferenceStub(MyThread* t, object stub)
+{
+  object pair = codePool(t, methodCode(t, stub));
+
+  return (methodFlags(t, stub) & ACC_STATIC)
+    ? resolveStaticMethod(t, pair) : resolveSpecialMethod(t, pair);
 }
 
 int64_t
@@ -2454,10 +2963,7 @@ int64_t
 getJClassFromReference(MyThread* t, object pair)
 {
   return reinterpret_cast<intptr_t>
-    (getJClass
-     (t, resolveClass
-      (t, classLoader(t, methodClass(t, pairFirst(t, pair))),
-       referenceName(t, pairSecond(t, pair)))));
+    (getJClass(t, resolveReferencedClass(t, pair)));
 }
 
 int64_t
@@ -2540,10 +3046,177 @@ compareLongs(uint64_t b, uint64_t a)
   }
 }
 
-uint64_t
-addDouble(uint64_t b, uint64_t a)
+int64_t
+minimumLong(int64_t a, int64_t b)
 {
-  return doubleToBits(bitsToDouble(a) + bitsToDouble(b));
+  return a < b ? a : b;
+}
+
+int64_t
+maximumLong(int64_t a, int64_t b)
+{
+  return a > b ? a : b;
+}
+
+uint64_t
+moveIntBits(uint32_t a)
+{
+  return a;
+}
+
+uint64_t
+moveLongBits(uint64_t a)
+{
+  return a;
+}
+
+int64_t
+bitCountInt(uint32_t a)
+{
+  a = a - ((a >> 1) & 0x55555555);
+  a = (a & 0x33333333) + ((a >> 2) & 0x33333333);
+  a = (a + (a >> 4)) & 0x0F0F0F0F;
+  return (a * 0x01010101) >> 24;
+}
+
+int64_t
+bitCountLong(uint64_t a)
+{
+  return bitCountInt(a) + bitCountInt(a >> 32);
+}
+
+int64_t
+leadingZerosInt(uint32_t a)
+{
+  if (a == 0) {
+    return 32;
+  }
+
+  int64_t n = 0;
+  if ((a & 0xFFFF0000) == 0) { n += 16; a <<= 16; }
+  if ((a & 0xFF000000) == 0) { n +=  8; a <<=  8; }
+  if ((a & 0xF0000000) == 0) { n +=  4; a <<=  4; }
+  if ((a & 0xC0000000) == 0) { n +=  2; a <<=  2; }
+  if ((a & 0x80000000) == 0) { n +=  1; }
+  return n;
+}
+
+int64_t
+leadingZerosLong(uint64_t a)
+{
+  uint32_t high = a >> 32;
+  return high ? leadingZerosInt(high) : 32 + leadingZerosInt(a);
+}
+
+int64_t
+trailingZerosInt(uint32_t a)
+{
+  return a ? 31 - leadingZerosInt(a & -a) : 32;
+}
+
+int64_t
+trailingZerosLong(uint64_t a)
+{
+  uint32_t low = a;
+  return low ? trailingZerosInt(low) : 32 + trailingZerosInt(a >> 32);
+}
+
+int64_t
+reverseBytesInt(uint32_t a)
+{
+  return static_cast<int32_t>
+    ((a << 24) | ((a & 0xFF00) << 8) | ((a >> 8) & 0xFF00) | (a >> 24));
+}
+
+uint64_t
+reverseBytesLong(uint64_t a)
+{
+  return (static_cast<uint64_t>(static_cast<uint32_t>(reverseBytesInt(a)))
+          << 32)
+    | static_cast<uint32_t>(reverseBytesInt(a >> 32));
+}
+
+// The following implement AtomicOperations for architectures which
+// can't do them inline (see appendAtomic in compiler.cpp).  Reference
+// operands use the variant for the target word size, leaving the card
+// marking to the caller.
+
+uint64_t
+compareAndSwapInt(uint32_t* p, int32_t expect, int32_t update)
+{
+  return atomicCompareAndSwap32(p, expect, update);
+}
+
+int64_t
+getAndAddInt(uint32_t* p, int32_t delta)
+{
+  uint32_t old;
+  do {
+    old = *p;
+  } while (not atomicCompareAndSwap32(p, old, old + delta));
+
+  return static_cast<int32_t>(old);
+}
+
+int64_t
+getAndSetInt(uint32_t* p, int32_t value)
+{
+  uint32_t old;
+  do {
+    old = *p;
+  } while (not atomicCompareAndSwap32(p, old, value));
+
+  return static_cast<int32_t>(old);
+}
+
+// The long variants are only used on 64-bit targets, all of which
+// can do a 64-bit compare-and-swap (see the intrinsic() cases below).
+
+uint64_t
+compareAndSwapLong(MyThread* t UNUSED, uint64_t* p UNUSED,
+                   int64_t expect UNUSED, int64_t update UNUSED)
+{
+#ifdef AVIAN_HAS_CAS64
+  return atomicCompareAndSwap64(p, expect, update);
+#else
+  abort(t);
+#endif
+}
+
+int64_t
+getAndAddLong(MyThread* t UNUSED, uint64_t* p UNUSED, int64_t delta UNUSED)
+{
+#ifdef AVIAN_HAS_CAS64
+  uint64_t old;
+  do {
+    old = *p;
+  } while (not atomicCompareAndSwap64(p, old, old + delta));
+
+  return old;
+#else
+  abort(t);
+#endif
+}
+
+int64_t
+getAndSetLong(MyThread* t UNUSED, uint64_t* p UNUSED, int64_t value UNUSED)
+{
+#ifdef AVIAN_HAS_CAS64
+  uint64_t old;
+  do {
+    old = *p;
+  } while (not atomicCompareAndSwap64(p, old, value));
+
+  return old;
+#else
+  abort(t);
+#endif
+}
+
+uint64_t
+addDouble(uint64_t b, uint64_t a)
+{
+  return doubleToBits(bitsToDouble(a) + bitsToDouble(b));
 }
 
 uint64_t
@@ -2683,8 +3356,8 @@ traceSize(Thread* t)
 
   t->m->processor->walkStack(t, &counter);
 
-  return FixedSizeOfArray + (counter.count * ArrayElementSizeOfArray)
-    + (counter.count * FixedSizeOfTraceElement);
+  return FixedSizeOfTrace + (counter.count * ArrayElementSizeOfTrace)
+    + FixedSizeOfIntArray + (counter.count * ArrayElementSizeOfIntArray);
 }
 
 void NO_RETURN
@@ -2809,56 +3482,58 @@ uint64_t
 makeBlankObjectArrayFromReference(MyThread* t, object pair,
                                   int32_t length)
 {
-  return makeBlankObjectArray
-    (t, resolveClass
-     (t, classLoader(t, methodClass(t, pairFirst(t, pair))),
-      referenceName(t, pairSecond(t, pair))), length);
+  return makeBlankObjectArray(t, resolveReferencedClass(t, pair), length);
 }
 
 uint64_t
-makeBlankArray(MyThread* t, unsigned type, int32_t length)
+makeBlankArrayOfClass(MyThread* t, object class_, int32_t length)
 {
   if (length >= 0) {
-    object (*constructor)(Thread*, uintptr_t);
-    switch (type) {
-    case T_BOOLEAN:
-      constructor = makeBooleanArray;
-      break;
+    PROTECT(t, class_);
 
-    case T_CHAR:
-      constructor = makeCharArray;
-      break;
+    object array = allocate
+      (t, pad(classFixedSize(t, class_)
+              + (length * classArrayElementSize(t, class_))),
+       classObjectMask(t, class_));
 
-    case T_FLOAT:
-      constructor = makeFloatArray;
-      break;
+    setObjectClass(t, array, class_);
+    cast<uintptr_t>(array, BytesPerWord) = length;
 
-    case T_DOUBLE:
-      constructor = makeDoubleArray;
-      break;
+    return reinterpret_cast<uintptr_t>(array);
+  } else {
+    throwNew(t, Machine::NegativeArraySizeExceptionType, "%d", length);
+  }
+}
 
-    case T_BYTE:
-      constructor = makeByteArray;
-      break;
+object
+blankArrayClass(MyThread* t, unsigned type)
+{
+  switch (type) {
+  case T_BOOLEAN:
+    return vm::type(t, Machine::BooleanArrayType);
 
-    case T_SHORT:
-      constructor = makeShortArray;
-      break;
+  case T_CHAR:
+    return vm::type(t, Machine::CharArrayType);
 
-    case T_INT:
-      constructor = makeIntArray;
-      break;
+  case T_FLOAT:
+    return vm::type(t, Machine::FloatArrayType);
 
-    case T_LONG:
-      constructor = makeLongArray;
-      break;
+  case T_DOUBLE:
+    return vm::type(t, Machine::DoubleArrayType);
 
-    default: abort(t);
-    }
+  case T_BYTE:
+    return vm::type(t, Machine::ByteArrayType);
 
-    return reinterpret_cast<uintptr_t>(constructor(t, length));
-  } else {
-    throwNew(t, Machine::NegativeArraySizeExceptionType, "%d", length);
+  case T_SHORT:
+    return vm::type(t, Machine::ShortArrayType);
+
+  case T_INT:
+    return vm::type(t, Machine::IntArrayType);
+
+  case T_LONG:
+    return vm::type(t, Machine::LongArrayType);
+
+  default: abort(t);
   }
 }
 
@@ -2885,16 +3560,6 @@ lookUpAddress(int32_t key, uintptr_t* start, int32_t count,
   return default_;
 }
 
-void
-setMaybeNull(MyThread* t, object o, unsigned offset, object value)
-{
-  if (LIKELY(o)) {
-    set(t, o, offset, value);
-  } else {
-    throwNew(t, Machine::NullPointerExceptionType);
-  }
-}
-
 void
 acquireMonitorForObject(MyThread* t, object o)
 {
@@ -2967,9 +3632,7 @@ makeMultidimensionalArrayFromReference(MyThread* t, object pair,
                                        int32_t offset)
 {
   return makeMultidimensionalArray
-    (t, resolveClass
-     (t, classLoader(t, methodClass(t, pairFirst(t, pair))),
-      referenceName(t, pairSecond(t, pair))), dimensions, offset);
+    (t, resolveReferencedClass(t, pair), dimensions, offset);
 }
 
 void NO_RETURN
@@ -2993,6 +3656,16 @@ throwStackOverflow(MyThread* t)
   throwNew(t, Machine::StackOverflowErrorType); 
 }
 
+uint64_t
+safepoint(MyThread* t)
+{
+  { ENTER(t, Thread::IdleState); }
+
+  // the poll which brought us here is retried on return, reading the
+  // page from the register we return it in:
+  return reinterpret_cast<uintptr_t>(t->pollPage);
+}
+
 void NO_RETURN
 throw_(MyThread* t, object o)
 {
@@ -3019,9 +3692,7 @@ checkCastFromReference(MyThread* t, object pair, object o)
 {
   PROTECT(t, o);
 
-  object c = resolveClass
-    (t, classLoader(t, methodClass(t, pairFirst(t, pair))),
-     referenceName(t, pairSecond(t, pair)));
+  object c = resolveReferencedClass(t, pair);
 
   checkCast(t, c, o);
 }
@@ -3029,6 +3700,13 @@ checkCastFromReference(MyThread* t, object pair, object o)
 object
 resolveField(Thread* t, object pair)
 {
+  object field = resolvedReference(t, pair, Machine::FieldType);
+  if (field) {
+    return field;
+  }
+
+  PROTECT(t, pair);
+
   object reference = pairSecond(t, pair);
   PROTECT(t, reference);
 
@@ -3036,9 +3714,10 @@ resolveField(Thread* t, object pair)
     (t, classLoader(t, methodClass(t, pairFirst(t, pair))), reference,
      ReferenceClass);
 
-  return findInHierarchy
-    (t, class_, referenceName(t, reference), referenceSpec(t, reference),
-     findFieldInClass, Machine::NoSuchFieldErrorType);
+  return resolved
+    (t, pair, findInHierarchy
+     (t, class_, referenceName(t, reference), referenceSpec(t, reference),
+      findFieldInClass, Machine::NoSuchFieldErrorType));
 }
 
 uint64_t
@@ -3215,13 +3894,85 @@ instanceOfFromReference(Thread* t, object pair, object o)
 {
   PROTECT(t, o);
 
-  object c = resolveClass
-    (t, classLoader(t, methodClass(t, pairFirst(t, pair))),
-     referenceName(t, pairSecond(t, pair)));
+  object c = resolveReferencedClass(t, pair);
 
   return instanceOf64(t, c, o);
 }
 
+uint64_t
+stringEqual64(Thread* t, object a, object b)
+{
+  if (LIKELY(a)) {
+    return b
+      and objectClass(t, b) == type(t, Machine::StringType)
+      and stringEqual(t, a, b);
+  } else {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+}
+
+void
+arrayFill32(Thread* t, object array, int32_t value)
+{
+  arrayFill(t, array, static_cast<uint32_t>(value));
+}
+
+void
+arrayFill64(Thread* t, object array, int64_t value)
+{
+  arrayFill(t, array, value);
+}
+
+uint64_t
+stringHash64(Thread* t, object s)
+{
+  if (LIKELY(s)) {
+    return stringHash(t, s);
+  } else {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+}
+
+int64_t
+stringIndexOf64(Thread* t, object s, int32_t c, int32_t start)
+{
+  if (LIKELY(s)) {
+    return stringIndexOf(t, s, c, start);
+  } else {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+}
+
+int64_t
+stringCharAt64(Thread* t, object s, int32_t index)
+{
+  if (UNLIKELY(s == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  } else if (UNLIKELY(index < 0 or index >= static_cast<int32_t>
+                      (stringLength(t, s))))
+  {
+    throwNew(t, Machine::IndexOutOfBoundsExceptionType);
+  }
+
+  return stringCharAt(t, s, index);
+}
+
+uint64_t
+getClass64(Thread* t, object o)
+{
+  if (LIKELY(o)) {
+    return reinterpret_cast<uintptr_t>(getJClass(t, objectClass(t, o)));
+  } else {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+}
+
+uint64_t
+currentThread64(Thread* t)
+{
+  return reinterpret_cast<uintptr_t>(t->javaThread);
+}
+
 uint64_t
 makeNewGeneral64(Thread* t, object class_)
 {
@@ -3237,10 +3988,7 @@ makeNew64(Thread* t, object class_)
 uint64_t
 makeNewFromReference(Thread* t, object pair)
 {
-  return makeNewGeneral64
-    (t, resolveClass
-     (t, classLoader(t, methodClass(t, pairFirst(t, pair))),
-      referenceName(t, pairSecond(t, pair))));
+  return makeNewGeneral64(t, resolveReferencedClass(t, pair));
 }
 
 uint64_t
@@ -3334,6 +4082,26 @@ popField(MyThread* t, Frame* frame, int code)
   }
 }
 
+// records a reference store to the specified address for the next
+// minor collection (see CardShift in heap.h)
+void
+markCard(MyThread* t, Compiler* c, Compiler::Operand* address)
+{
+  c->store
+    (TargetBytesPerWord, c->constant(1, Compiler::IntegerType), 1,
+     c->memory
+     (c->add
+      (TargetBytesPerWord, c->memory
+       (c->register_(t->arch->thread()), Compiler::AddressType,
+        TARGET_THREAD_CARDTABLE),
+       c->and_
+       (TargetBytesPerWord, c->constant(CardMask, Compiler::IntegerType),
+        c->ushr
+        (TargetBytesPerWord, c->constant(CardShift, Compiler::IntegerType),
+         address))),
+      Compiler::IntegerType));
+}
+
 Compiler::OperandType
 operandTypeForFieldCode(Thread* t, unsigned code)
 {
@@ -3560,15 +4328,22 @@ compileDirectReferenceInvoke(MyThread* t, Frame* frame, Thunk thunk,
 
   object pair = makePair(t, frame->context->method, reference);
 
-  compileReferenceInvoke
-    (t, frame, c->call
-     (c->constant(getThunk(t, thunk), Compiler::AddressType),
-      0,
-      frame->trace(0, 0),
-      TargetBytesPerWord,
-      Compiler::AddressType,
-      2, c->register_(t->arch->thread()), frame->append(pair)),
-     reference, isStatic, tailCall);
+  if (frame->context->bootContext) {
+    // reference stubs are not written to the boot image, so calls
+    // compiled for it resolve the reference on every execution
+    compileReferenceInvoke
+      (t, frame, c->call
+       (c->constant(getThunk(t, thunk), Compiler::AddressType),
+        0,
+        frame->trace(0, 0),
+        TargetBytesPerWord,
+        Compiler::AddressType,
+        2, c->register_(t->arch->thread()), frame->append(pair)),
+       reference, isStatic, tailCall);
+  } else {
+    compileDirectInvoke
+      (t, frame, makeReferenceStub(t, pair, isStatic), tailCall);
+  }
 }
 
 void
@@ -3663,6 +4438,56 @@ handleExit(MyThread* t, Frame* frame)
     (t, frame, getThunk(t, releaseMonitorForObjectThunk));
 }
 
+bool
+useSafepointPolls(MyThread* t)
+{
+  // a poll fault is turned into a call to the safepoint thunk by
+  // pushing the faulting address as the return address, which only
+  // works where calls keep their return address on the stack:
+  return t->pollPage != 0 and t->arch->frameReturnAddressSize() != 0;
+}
+
+void
+poll(MyThread* t, Frame* frame)
+{
+  if (useSafepointPolls(t)) {
+    Compiler* c = frame->c;
+
+    c->poll
+      (c->load
+       (TargetBytesPerWord, TargetBytesPerWord,
+        c->memory
+        (c->register_(t->arch->thread()), Compiler::AddressType,
+         TARGET_THREAD_POLLPAGE, 0, 1), TargetBytesPerWord),
+       frame->trace(0, 0));
+  }
+}
+
+void
+pollIfBackward(MyThread* t, Frame* frame, object code, unsigned ip)
+{
+  // polls for fused compare-and-branch sequences must be emitted
+  // before the compare pops its operands, since the poll only
+  // preserves values which are still on the Java stack:
+  if (ip + 3 <= codeLength(t, code)) {
+    switch (codeBody(t, code, ip)) {
+    case ifeq:
+    case ifne:
+    case ifgt:
+    case ifge:
+    case iflt:
+    case ifle: {
+      unsigned offsetIp = ip + 1;
+      if (codeReadInt16(t, code, offsetIp) <= 0) {
+        poll(t, frame);
+      }
+    } break;
+
+    default: break;
+    }
+  }
+}
+
 bool
 inTryBlock(MyThread* t, object code, unsigned ip)
 {
@@ -3681,6 +4506,14 @@ inTryBlock(MyThread* t, object code, unsigned ip)
   return false;
 }
 
+bool
+needsBoundsCheck(Context* context, unsigned ip)
+{
+  return CheckArrayBounds
+    and (context->boundsTable == 0
+         or getBit(context->boundsTable, ip) == 0);
+}
+
 bool
 needsReturnBarrier(MyThread* t, object method)
 {
@@ -3873,1116 +4706,2795 @@ popLongAddress(Frame* frame)
     (8, 8, frame->popLong(), TargetBytesPerWord);
 }
 
-bool
-intrinsic(MyThread* t, Frame* frame, object target)
+Compiler::Operand*
+popUnsafeAddress(Frame* frame)
 {
-#define MATCH(name, constant)                                           \
-  (byteArrayLength(t, name) == sizeof(constant)                         \
-   and ::strcmp(reinterpret_cast<char*>(&byteArrayBody(t, name, 0)),    \
-                constant) == 0)
+  // pops the (Object base, long offset) pair used by the field and
+  // array accessors in sun.misc.Unsafe and returns their sum; a null
+  // base means the offset is an absolute address
+  Compiler::Operand* offset = popLongAddress(frame);
+  return frame->c->add(TargetBytesPerWord, frame->popObject(), offset);
+}
 
-  object className = vm::className(t, methodClass(t, target));
-  if (UNLIKELY(MATCH(className, "java/lang/Math"))) {
-    Compiler* c = frame->c;
-    if (MATCH(methodName(t, target), "sqrt")
-        and MATCH(methodSpec(t, target), "(D)D"))
-    {
-      frame->pushLong(c->fsqrt(8, frame->popLong()));
-      return true;
-    } else if (MATCH(methodName(t, target), "abs")) {
-      if (MATCH(methodSpec(t, target), "(I)I")) {
-        frame->pushInt(c->abs(4, frame->popInt()));
-        return true;
-      } else if (MATCH(methodSpec(t, target), "(J)J")) {
-        frame->pushLong(c->abs(8, frame->popLong()));
-        return true;
-      } else if (MATCH(methodSpec(t, target), "(F)F")) {
-        frame->pushInt(c->fabs(4, frame->popInt()));
-        return true;
-      }
-    }
-  } else if (UNLIKELY(MATCH(className, "sun/misc/Unsafe"))) {
-    Compiler* c = frame->c;
-    if (MATCH(methodName(t, target), "getByte")
-        and MATCH(methodSpec(t, target), "(J)B"))
-    {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      frame->pushInt
-        (c->load
-         (1, 1, c->memory(address, Compiler::IntegerType, 0, 0, 1),
-          TargetBytesPerWord));
-      return true;
-    } else if (MATCH(methodName(t, target), "putByte")
-               and MATCH(methodSpec(t, target), "(JB)V"))
-    {
-      Compiler::Operand* value = frame->popInt();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      c->store
-        (TargetBytesPerWord, value, 1, c->memory
-         (address, Compiler::IntegerType, 0, 0, 1));
-      return true;
-    } else if ((MATCH(methodName(t, target), "getShort")
-                and MATCH(methodSpec(t, target), "(J)S"))
-               or (MATCH(methodName(t, target), "getChar")
-                   and MATCH(methodSpec(t, target), "(J)C")))
-    {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      frame->pushInt
-        (c->load
-         (2, 2, c->memory(address, Compiler::IntegerType, 0, 0, 1),
-          TargetBytesPerWord));
-      return true;
-    } else if ((MATCH(methodName(t, target), "putShort")
-                and MATCH(methodSpec(t, target), "(JS)V"))
-               or (MATCH(methodName(t, target), "putChar")
-                   and MATCH(methodSpec(t, target), "(JC)V")))
-    {
-      Compiler::Operand* value = frame->popInt();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      c->store
-        (TargetBytesPerWord, value, 2, c->memory
-         (address, Compiler::IntegerType, 0, 0, 1));
-      return true;
-    } else if ((MATCH(methodName(t, target), "getInt")
-                and MATCH(methodSpec(t, target), "(J)I"))
-               or (MATCH(methodName(t, target), "getFloat")
-                   and MATCH(methodSpec(t, target), "(J)F")))
-    {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      frame->pushInt
-        (c->load
-         (4, 4, c->memory
-          (address, MATCH(methodName(t, target), "getInt")
-           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1),
-          TargetBytesPerWord));
-      return true;
-    } else if ((MATCH(methodName(t, target), "putInt")
-                and MATCH(methodSpec(t, target), "(JI)V"))
-               or (MATCH(methodName(t, target), "putFloat")
-                   and MATCH(methodSpec(t, target), "(JF)V")))
-    {
-      Compiler::Operand* value = frame->popInt();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      c->store
-        (TargetBytesPerWord, value, 4, c->memory
-         (address, MATCH(methodName(t, target), "putInt")
-           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1));
-      return true;
-    } else if ((MATCH(methodName(t, target), "getLong")
-                and MATCH(methodSpec(t, target), "(J)J"))
-               or (MATCH(methodName(t, target), "getDouble")
-                   and MATCH(methodSpec(t, target), "(J)D")))
-    {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      frame->pushLong
-        (c->load
-         (8, 8, c->memory
-          (address, MATCH(methodName(t, target), "getLong")
-           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1),
-          8));
-      return true;
-    } else if ((MATCH(methodName(t, target), "putLong")
-                and MATCH(methodSpec(t, target), "(JJ)V"))
-               or (MATCH(methodName(t, target), "putDouble")
-                   and MATCH(methodSpec(t, target), "(JD)V")))
-    {
-      Compiler::Operand* value = frame->popLong();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      c->store
-        (8, value, 8, c->memory
-         (address, MATCH(methodName(t, target), "putLong")
-           ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1));
-      return true;
-    } else if (MATCH(methodName(t, target), "getAddress")
-                and MATCH(methodSpec(t, target), "(J)J"))
-    {
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      frame->pushLong
-        (c->load
-         (TargetBytesPerWord, TargetBytesPerWord,
-          c->memory(address, Compiler::AddressType, 0, 0, 1), 8));
-      return true;
-    } else if (MATCH(methodName(t, target), "putAddress")
-               and MATCH(methodSpec(t, target), "(JJ)V"))
-    {
-      Compiler::Operand* value = frame->popLong();
-      Compiler::Operand* address = popLongAddress(frame);
-      frame->popObject();
-      c->store
-        (8, value, TargetBytesPerWord, c->memory
-         (address, Compiler::AddressType, 0, 0, 1));
-      return true;
+unsigned
+targetFieldOffset(Context* context, object field);
+
+enum IntrinsicType {
+  MathSqrtIntrinsic,
+  MathAbsIntIntrinsic,
+  MathAbsLongIntrinsic,
+  MathAbsFloatIntrinsic,
+  MathMinIntIntrinsic,
+  MathMaxIntIntrinsic,
+  MathMinLongIntrinsic,
+  MathMaxLongIntrinsic,
+  FloatToRawIntBitsIntrinsic,
+  IntBitsToFloatIntrinsic,
+  DoubleToRawLongBitsIntrinsic,
+  LongBitsToDoubleIntrinsic,
+  IntegerBitCountIntrinsic,
+  IntegerLeadingZerosIntrinsic,
+  IntegerTrailingZerosIntrinsic,
+  IntegerReverseBytesIntrinsic,
+  LongBitCountIntrinsic,
+  LongLeadingZerosIntrinsic,
+  LongTrailingZerosIntrinsic,
+  LongReverseBytesIntrinsic,
+  StringLengthIntrinsic,
+  StringCharAtIntrinsic,
+  StringEqualsIntrinsic,
+  StringHashCodeIntrinsic,
+  StringIndexOfIntrinsic,
+  SystemArrayCopyIntrinsic,
+  ArraysFillIntIntrinsic,
+  ArraysFillLongIntrinsic,
+  ObjectGetClassIntrinsic,
+  ThreadCurrentThreadIntrinsic,
+  UnsafeGetByteIntrinsic,
+  UnsafePutByteIntrinsic,
+  UnsafeGetShortIntrinsic,
+  UnsafePutShortIntrinsic,
+  UnsafeGetIntIntrinsic,
+  UnsafePutIntIntrinsic,
+  UnsafeGetFloatIntrinsic,
+  UnsafePutFloatIntrinsic,
+  UnsafeGetLongIntrinsic,
+  UnsafePutLongIntrinsic,
+  UnsafeGetDoubleIntrinsic,
+  UnsafePutDoubleIntrinsic,
+  UnsafeGetAddressIntrinsic,
+  UnsafePutAddressIntrinsic,
+  UnsafeGetIntVolatileIntrinsic,
+  UnsafeGetLongVolatileIntrinsic,
+  UnsafeGetObjectVolatileIntrinsic,
+  UnsafePutIntVolatileIntrinsic,
+  UnsafePutLongVolatileIntrinsic,
+  UnsafePutObjectVolatileIntrinsic,
+  UnsafePutOrderedIntIntrinsic,
+  UnsafePutOrderedLongIntrinsic,
+  UnsafePutOrderedObjectIntrinsic,
+  UnsafeCompareAndSwapIntIntrinsic,
+  UnsafeCompareAndSwapLongIntrinsic,
+  UnsafeCompareAndSwapObjectIntrinsic,
+  UnsafeGetAndAddIntIntrinsic,
+  UnsafeGetAndAddLongIntrinsic,
+  UnsafeGetAndSetIntIntrinsic,
+  UnsafeGetAndSetLongIntrinsic,
+  UnsafeGetAndSetObjectIntrinsic
+};
+
+struct IntrinsicDescriptor {
+  const char* className;
+  const char* name;
+  const char* spec;
+  IntrinsicType type;
+};
+
+const IntrinsicDescriptor intrinsics[] = {
+  { "java/lang/Math", "sqrt", "(D)D", MathSqrtIntrinsic },
+  { "java/lang/Math", "abs", "(I)I", MathAbsIntIntrinsic },
+  { "java/lang/Math", "abs", "(J)J", MathAbsLongIntrinsic },
+  { "java/lang/Math", "abs", "(F)F", MathAbsFloatIntrinsic },
+  { "java/lang/Math", "min", "(II)I", MathMinIntIntrinsic },
+  { "java/lang/Math", "max", "(II)I", MathMaxIntIntrinsic },
+  { "java/lang/Math", "min", "(JJ)J", MathMinLongIntrinsic },
+  { "java/lang/Math", "max", "(JJ)J", MathMaxLongIntrinsic },
+  { "java/lang/Float", "floatToRawIntBits", "(F)I",
+    FloatToRawIntBitsIntrinsic },
+  { "java/lang/Float", "intBitsToFloat", "(I)F", IntBitsToFloatIntrinsic },
+  { "java/lang/Double", "doubleToRawLongBits", "(D)J",
+    DoubleToRawLongBitsIntrinsic },
+  { "java/lang/Double", "longBitsToDouble", "(J)D",
+    LongBitsToDoubleIntrinsic },
+  { "java/lang/Integer", "bitCount", "(I)I", IntegerBitCountIntrinsic },
+  { "java/lang/Integer", "numberOfLeadingZeros", "(I)I",
+    IntegerLeadingZerosIntrinsic },
+  { "java/lang/Integer", "numberOfTrailingZeros", "(I)I",
+    IntegerTrailingZerosIntrinsic },
+  { "java/lang/Integer", "reverseBytes", "(I)I",
+    IntegerReverseBytesIntrinsic },
+  { "java/lang/Long", "bitCount", "(J)I", LongBitCountIntrinsic },
+  { "java/lang/Long", "numberOfLeadingZeros", "(J)I",
+    LongLeadingZerosIntrinsic },
+  { "java/lang/Long", "numberOfTrailingZeros", "(J)I",
+    LongTrailingZerosIntrinsic },
+  { "java/lang/Long", "reverseBytes", "(J)J", LongReverseBytesIntrinsic },
+  { "java/lang/String", "length", "()I", StringLengthIntrinsic },
+  { "java/lang/String", "charAt", "(I)C", StringCharAtIntrinsic },
+  { "java/lang/String", "equals", "(Ljava/lang/Object;)Z",
+    StringEqualsIntrinsic },
+  { "java/lang/String", "hashCode", "()I", StringHashCodeIntrinsic },
+  { "java/lang/String", "indexOf", "(II)I", StringIndexOfIntrinsic },
+  { "java/lang/System", "arraycopy",
+    "(Ljava/lang/Object;ILjava/lang/Object;II)V", SystemArrayCopyIntrinsic },
+  { "java/util/Arrays", "fill", "([ZZ)V", ArraysFillIntIntrinsic },
+  { "java/util/Arrays", "fill", "([BB)V", ArraysFillIntIntrinsic },
+  { "java/util/Arrays", "fill", "([SS)V", ArraysFillIntIntrinsic },
+  { "java/util/Arrays", "fill", "([CC)V", ArraysFillIntIntrinsic },
+  { "java/util/Arrays", "fill", "([II)V", ArraysFillIntIntrinsic },
+  { "java/util/Arrays", "fill", "([FF)V", ArraysFillIntIntrinsic },
+  { "java/util/Arrays", "fill", "([JJ)V", ArraysFillLongIntrinsic },
+  { "java/util/Arrays", "fill", "([DD)V", ArraysFillLongIntrinsic },
+  { "java/lang/Object", "getClass", "()Ljava/lang/Class;",
+    ObjectGetClassIntrinsic },
+  { "java/lang/Thread", "currentThread", "()Ljava/lang/Thread;",
+    ThreadCurrentThreadIntrinsic },
+  { "sun/misc/Unsafe", "getByte", "(J)B", UnsafeGetByteIntrinsic },
+  { "sun/misc/Unsafe", "putByte", "(JB)V", UnsafePutByteIntrinsic },
+  { "sun/misc/Unsafe", "getShort", "(J)S", UnsafeGetShortIntrinsic },
+  { "sun/misc/Unsafe", "getChar", "(J)C", UnsafeGetShortIntrinsic },
+  { "sun/misc/Unsafe", "putShort", "(JS)V", UnsafePutShortIntrinsic },
+  { "sun/misc/Unsafe", "putChar", "(JC)V", UnsafePutShortIntrinsic },
+  { "sun/misc/Unsafe", "getInt", "(J)I", UnsafeGetIntIntrinsic },
+  { "sun/misc/Unsafe", "putInt", "(JI)V", UnsafePutIntIntrinsic },
+  { "sun/misc/Unsafe", "getFloat", "(J)F", UnsafeGetFloatIntrinsic },
+  { "sun/misc/Unsafe", "putFloat", "(JF)V", UnsafePutFloatIntrinsic },
+  { "sun/misc/Unsafe", "getLong", "(J)J", UnsafeGetLongIntrinsic },
+  { "sun/misc/Unsafe", "putLong", "(JJ)V", UnsafePutLongIntrinsic },
+  { "sun/misc/Unsafe", "getDouble", "(J)D", UnsafeGetDoubleIntrinsic },
+  { "sun/misc/Unsafe", "putDouble", "(JD)V", UnsafePutDoubleIntrinsic },
+  { "sun/misc/Unsafe", "getAddress", "(J)J", UnsafeGetAddressIntrinsic },
+  { "sun/misc/Unsafe", "putAddress", "(JJ)V", UnsafePutAddressIntrinsic },
+  { "sun/misc/Unsafe", "getIntVolatile", "(Ljava/lang/Object;J)I",
+    UnsafeGetIntVolatileIntrinsic },
+  { "sun/misc/Unsafe", "getLongVolatile", "(Ljava/lang/Object;J)J",
+    UnsafeGetLongVolatileIntrinsic },
+  { "sun/misc/Unsafe", "getObjectVolatile",
+    "(Ljava/lang/Object;J)Ljava/lang/Object;",
+    UnsafeGetObjectVolatileIntrinsic },
+  { "sun/misc/Unsafe", "putIntVolatile", "(Ljava/lang/Object;JI)V",
+    UnsafePutIntVolatileIntrinsic },
+  { "sun/misc/Unsafe", "putLongVolatile", "(Ljava/lang/Object;JJ)V",
+    UnsafePutLongVolatileIntrinsic },
+  { "sun/misc/Unsafe", "putObjectVolatile",
+    "(Ljava/lang/Object;JLjava/lang/Object;)V",
+    UnsafePutObjectVolatileIntrinsic },
+  { "sun/misc/Unsafe", "putOrderedInt", "(Ljava/lang/Object;JI)V",
+    UnsafePutOrderedIntIntrinsic },
+  { "sun/misc/Unsafe", "putOrderedLong", "(Ljava/lang/Object;JJ)V",
+    UnsafePutOrderedLongIntrinsic },
+  { "sun/misc/Unsafe", "putOrderedObject",
+    "(Ljava/lang/Object;JLjava/lang/Object;)V",
+    UnsafePutOrderedObjectIntrinsic },
+  { "sun/misc/Unsafe", "compareAndSwapInt", "(Ljava/lang/Object;JII)Z",
+    UnsafeCompareAndSwapIntIntrinsic },
+  { "sun/misc/Unsafe", "compareAndSwapLong", "(Ljava/lang/Object;JJJ)Z",
+    UnsafeCompareAndSwapLongIntrinsic },
+  { "sun/misc/Unsafe", "compareAndSwapObject",
+    "(Ljava/lang/Object;JLjava/lang/Object;Ljava/lang/Object;)Z",
+    UnsafeCompareAndSwapObjectIntrinsic },
+  { "sun/misc/Unsafe", "getAndAddInt", "(Ljava/lang/Object;JI)I",
+    UnsafeGetAndAddIntIntrinsic },
+  { "sun/misc/Unsafe", "getAndAddLong", "(Ljava/lang/Object;JJ)J",
+    UnsafeGetAndAddLongIntrinsic },
+  { "sun/misc/Unsafe", "getAndSetInt", "(Ljava/lang/Object;JI)I",
+    UnsafeGetAndSetIntIntrinsic },
+  { "sun/misc/Unsafe", "getAndSetLong", "(Ljava/lang/Object;JJ)J",
+    UnsafeGetAndSetLongIntrinsic },
+  { "sun/misc/Unsafe", "getAndSetObject",
+    "(Ljava/lang/Object;JLjava/lang/Object;)Ljava/lang/Object;",
+    UnsafeGetAndSetObjectIntrinsic }
+};
+
+const unsigned IntrinsicCount
+= sizeof(intrinsics) / sizeof(IntrinsicDescriptor);
+
+// size of the open-addressed table MyProcessor uses to find an
+// intrinsic by class, method name and spec; must be a power of two
+// comfortably larger than IntrinsicCount
+const unsigned IntrinsicIndexSize = 128;
+
+inline uint32_t
+intrinsicHash(uint32_t classHash, uint32_t nameHash, uint32_t specHash)
+{
+  return (((classHash * 31) + nameHash) * 31) + specHash;
+}
+
+inline uint32_t
+intrinsicHash(const IntrinsicDescriptor* d)
+{
+  return intrinsicHash(hash(d->className), hash(d->name), hash(d->spec));
+}
+
+inline uint32_t
+intrinsicHash(Thread* t, object array)
+{
+  // byte array names include the terminating null, which hash(const
+  // char*) does not see
+  return hash(&byteArrayBody(t, array, 0), byteArrayLength(t, array) - 1);
+}
+
+inline bool
+intrinsicMatch(Thread* t, object array, const char* s)
+{
+  return ::strcmp(reinterpret_cast<char*>(&byteArrayBody(t, array, 0)), s)
+    == 0;
+}
+
+// fills in index, mapping hash buckets to 1 + the position of the
+// matching entry in intrinsics (zero means empty):
+void
+makeIntrinsicIndex(uint8_t* index)
+{
+  memset(index, 0, IntrinsicIndexSize);
+  for (unsigned i = 0; i < IntrinsicCount; ++i) {
+    unsigned j = intrinsicHash(intrinsics + i) & (IntrinsicIndexSize - 1);
+    while (index[j]) {
+      j = (j + 1) & (IntrinsicIndexSize - 1);
     }
+    index[j] = i + 1;
   }
-  return false;
 }
 
-unsigned
-targetFieldOffset(Context* context, object field)
+const IntrinsicDescriptor*
+findIntrinsic(MyThread* t, object target);
+
+object
+findFieldByName(Thread* t, object class_, const char* name)
 {
-  if (context->bootContext) {
-    return context->bootContext->resolver->fieldOffset(context->thread, field);
-  } else {
-    return fieldOffset(context->thread, field);
+  object table = classFieldTable(t, class_);
+  if (table) {
+    for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+      object field = arrayBody(t, table, i);
+      if (intrinsicMatch(t, fieldName(t, field), name)) {
+        return field;
+      }
+    }
   }
+  return 0;
 }
 
-class Stack {
- public:
-  class MyResource: public Thread::Resource {
-   public:
-    MyResource(Stack* s): Resource(s->thread), s(s) { }
+bool
+intrinsic(MyThread* t, Frame* frame, object target)
+{
+  PROTECT(t, target);
 
-    virtual void release() {
-      s->zone.dispose();
-    }
+  const IntrinsicDescriptor* d = findIntrinsic(t, target);
+  if (LIKELY(d == 0)) {
+    return false;
+  }
 
-    Stack* s;
-  };
+  Compiler* c = frame->c;
+  switch (d->type) {
+  case MathSqrtIntrinsic:
+    frame->pushLong(c->fsqrt(8, frame->popLong()));
+    return true;
 
-  Stack(MyThread* t):
-    thread(t),
-    zone(t->m->system, t->m->heap, 0),
-    resource(this)
-  { }
+  case MathAbsIntIntrinsic:
+    frame->pushInt(c->abs(4, frame->popInt()));
+    return true;
 
-  ~Stack() {
-    zone.dispose();
-  }
+  case MathAbsLongIntrinsic:
+    frame->pushLong(c->abs(8, frame->popLong()));
+    return true;
 
-  void pushValue(uintptr_t v) {
-    *static_cast<uintptr_t*>(push(BytesPerWord)) = v;
-  }
+  case MathAbsFloatIntrinsic:
+    frame->pushInt(c->fabs(4, frame->popInt()));
+    return true;
 
-  uintptr_t peekValue(unsigned offset) {
-    return *static_cast<uintptr_t*>(peek((offset + 1) * BytesPerWord));
-  }
+  case MathMinIntIntrinsic:
+  case MathMaxIntIntrinsic: {
+    // branch-free: with d = a - b computed in 64 bits (so it can't
+    // overflow) and m = d >> 63, min(a, b) is b + (d & m) and max(a, b)
+    // is a - (d & m)
+    Compiler::Operand* b = c->load
+      (TargetBytesPerWord, 4, frame->popInt(), 8);
+    Compiler::Operand* a = c->load
+      (TargetBytesPerWord, 4, frame->popInt(), 8);
+
+    Compiler::Operand* difference = c->sub(8, b, a);
+    Compiler::Operand* masked = c->and_
+      (8, difference, c->shr
+       (8, c->constant(63, Compiler::IntegerType), difference));
+
+    Compiler::Operand* result = d->type == MathMinIntIntrinsic
+      ? c->add(8, masked, b) : c->sub(8, masked, a);
+
+    frame->pushInt(c->load(8, 8, result, TargetBytesPerWord));
+  } return true;
+
+  case MathMinLongIntrinsic:
+  case MathMaxLongIntrinsic: {
+    Compiler::Operand* b = frame->popLong();
+    Compiler::Operand* a = frame->popLong();
+
+    if (TargetBytesPerWord == 8) {
+      // branch-free, as for ints, but a - b may overflow here, so we
+      // take a < b from the sign of (a - b) ^ ((a ^ b) & ((a - b) ^ a))
+      // (see Hacker's Delight, 2-12) and, with m = -1 if a < b and 0
+      // otherwise, select min(a, b) as b ^ ((a ^ b) & m) and max(a, b)
+      // as a ^ ((a ^ b) & m)
+      Compiler::Operand* difference = c->sub(8, b, a);
+      Compiler::Operand* either = c->xor_(8, b, a);
+      Compiler::Operand* less = c->xor_
+        (8, c->and_(8, c->xor_(8, a, difference), either), difference);
+      Compiler::Operand* masked = c->and_
+        (8, c->shr(8, c->constant(63, Compiler::IntegerType), less),
+         either);
 
-  uintptr_t popValue() {
-    uintptr_t v = peekValue(0);
-    pop(BytesPerWord);
-    return v;
-  }
+      frame->pushLong
+        (c->xor_(8, masked, d->type == MathMinLongIntrinsic ? b : a));
+    } else {
+      frame->pushLong
+        (c->call
+         (c->constant
+          (getThunk(t, d->type == MathMinLongIntrinsic
+                    ? minimumLongThunk : maximumLongThunk),
+           Compiler::AddressType),
+          0, 0, 8, Compiler::IntegerType, 4,
+          static_cast<Compiler::Operand*>(0), a,
+          static_cast<Compiler::Operand*>(0), b));
+    }
+  } return true;
+
+  case FloatToRawIntBitsIntrinsic:
+    frame->pushInt(c->f2bits(4, frame->popInt()));
+    return true;
 
-  void* push(unsigned size) {
-    return zone.allocate(size);
-  }
+  case IntBitsToFloatIntrinsic:
+    frame->pushInt(c->bits2f(4, frame->popInt()));
+    return true;
 
-  void* peek(unsigned size) {
-    return zone.peek(size);
-  }
+  case DoubleToRawLongBitsIntrinsic:
+    frame->pushLong(c->f2bits(8, frame->popLong()));
+    return true;
 
-  void pop(unsigned size) {
-    zone.pop(size);
-  }
+  case LongBitsToDoubleIntrinsic:
+    frame->pushLong(c->bits2f(8, frame->popLong()));
+    return true;
 
-  MyThread* thread;
-  Zone zone;
-  MyResource resource;
-};
+  case IntegerBitCountIntrinsic:
+    frame->pushInt(c->bitCount(4, frame->popInt()));
+    return true;
 
-class SwitchState {
- public:
-  SwitchState(Compiler::State* state,
-              unsigned count,
-              unsigned defaultIp,
-              Compiler::Operand* key,
-              Promise* start,
-              int bottom,
-              int top):
-    state(state),
-    count(count),
-    defaultIp(defaultIp),
-    key(key),
-    start(start),
-    bottom(bottom),
-    top(top),
-    index(0)
-  { }
+  case IntegerLeadingZerosIntrinsic:
+    frame->pushInt(c->leadingZeros(4, frame->popInt()));
+    return true;
 
-  Frame* frame() {
-    return reinterpret_cast<Frame*>
-      (reinterpret_cast<uint8_t*>(this) - pad(count * 4) - pad(sizeof(Frame)));
-  }
+  case IntegerTrailingZerosIntrinsic:
+    frame->pushInt(c->trailingZeros(4, frame->popInt()));
+    return true;
 
-  uint32_t* ipTable() {
-    return reinterpret_cast<uint32_t*>
-      (reinterpret_cast<uint8_t*>(this) - pad(count * 4));
-  }
+  case IntegerReverseBytesIntrinsic:
+    frame->pushInt(c->reverseBytes(4, frame->popInt()));
+    return true;
 
-  Compiler::State* state;
-  unsigned count;
-  unsigned defaultIp;
-  Compiler::Operand* key;
-  Promise* start;
-  int bottom;
-  int top;
-  unsigned index;
-};
+  case LongBitCountIntrinsic:
+    frame->pushInt(c->bitCount(8, frame->popLong()));
+    return true;
 
-void
-compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
-        int exceptionHandlerStart = -1)
-{
-  enum {
-    Return,
-    Unbranch,
-    Unsubroutine,
-    Untable0,
-    Untable1,
-    Unswitch
-  };
+  case LongLeadingZerosIntrinsic:
+    frame->pushInt(c->leadingZeros(8, frame->popLong()));
+    return true;
 
-  Frame* frame = initialFrame;
-  Compiler* c = frame->c;
-  Context* context = frame->context;
-  unsigned stackSize = codeMaxStack(t, methodCode(t, context->method));
-  Stack stack(t);
-  unsigned ip = initialIp;
-  unsigned newIp;
-  stack.pushValue(Return);
+  case LongTrailingZerosIntrinsic:
+    frame->pushInt(c->trailingZeros(8, frame->popLong()));
+    return true;
 
- start:
-  uint8_t* stackMap = static_cast<uint8_t*>(stack.push(stackSize));
-  frame = new (stack.push(sizeof(Frame))) Frame(frame, stackMap);
+  case LongReverseBytesIntrinsic:
+    frame->pushLong(c->reverseBytes(8, frame->popLong()));
+    return true;
 
- loop:
-  object code = methodCode(t, context->method);
-  PROTECT(t, code);
-  
-  while (ip < codeLength(t, code)) {
-    if (context->visitTable[ip] ++) {
-      // we've already visited this part of the code
-      frame->visitLogicalIp(ip);
-      goto next;
+  case StringLengthIntrinsic: {
+    // the field is named "length" in our class library and "count" in
+    // OpenJDK's; if neither exists, just call the method
+    object field = findFieldByName(t, methodClass(t, target), "length");
+    if (field == 0) {
+      field = findFieldByName(t, methodClass(t, target), "count");
     }
 
-    frame->startLogicalIp(ip);
+    if (field == 0 or fieldCode(t, field) != IntField) {
+      return false;
+    }
 
-    if (exceptionHandlerStart >= 0) {
-      c->initLocalsFromLogicalIp(exceptionHandlerStart);
+    frame->pushInt
+      (c->load
+       (4, 4, c->memory
+        (frame->popObject(), Compiler::IntegerType, targetFieldOffset
+         (frame->context, field), 0, 1), TargetBytesPerWord));
+  } return true;
+
+  case StringCharAtIntrinsic: {
+    Compiler::Operand* index = frame->popInt();
+    Compiler::Operand* this_ = frame->popObject();
+
+    frame->pushInt
+      (c->call
+       (c->constant(getThunk(t, stringCharAt64Thunk), Compiler::AddressType),
+        0, frame->trace(0, 0), 4, Compiler::IntegerType,
+        3, c->register_(t->arch->thread()), this_, index));
+  } return true;
+
+  case StringEqualsIntrinsic: {
+    Compiler::Operand* other = frame->popObject();
+    Compiler::Operand* this_ = frame->popObject();
+
+    frame->pushInt
+      (c->call
+       (c->constant(getThunk(t, stringEqual64Thunk), Compiler::AddressType),
+        0, frame->trace(0, 0), 4, Compiler::IntegerType,
+        3, c->register_(t->arch->thread()), this_, other));
+  } return true;
+
+  case StringHashCodeIntrinsic:
+    frame->pushInt
+      (c->call
+       (c->constant(getThunk(t, stringHash64Thunk), Compiler::AddressType),
+        0, frame->trace(0, 0), 4, Compiler::IntegerType,
+        2, c->register_(t->arch->thread()), frame->popObject()));
+    return true;
 
-      exceptionHandlerStart = -1;
+  case StringIndexOfIntrinsic: {
+    Compiler::Operand* start = frame->popInt();
+    Compiler::Operand* ch = frame->popInt();
+    Compiler::Operand* this_ = frame->popObject();
+
+    frame->pushInt
+      (c->call
+       (c->constant
+        (getThunk(t, stringIndexOf64Thunk), Compiler::AddressType),
+        0, frame->trace(0, 0), 4, Compiler::IntegerType,
+        4, c->register_(t->arch->thread()), this_, ch, start));
+  } return true;
+
+  case SystemArrayCopyIntrinsic: {
+    // call the VM's copy routine directly rather than going through
+    // the native method machinery
+    Compiler::Operand* length = frame->popInt();
+    Compiler::Operand* dstOffset = frame->popInt();
+    Compiler::Operand* dst = frame->popObject();
+    Compiler::Operand* srcOffset = frame->popInt();
+    Compiler::Operand* src = frame->popObject();
+
+    c->call
+      (c->constant(getThunk(t, arrayCopyThunk), Compiler::AddressType),
+       0,
+       frame->trace(0, 0),
+       0,
+       Compiler::VoidType,
+       6, c->register_(t->arch->thread()), src, srcOffset, dst, dstOffset,
+       length);
+  } return true;
+
+  case ArraysFillIntIntrinsic: {
+    // floats travel as their bits, and narrower elements just take the
+    // low bits of the value
+    Compiler::Operand* value = frame->popInt();
+    Compiler::Operand* array = frame->popObject();
+
+    c->call
+      (c->constant(getThunk(t, arrayFill32Thunk), Compiler::AddressType),
+       0, frame->trace(0, 0), 0, Compiler::VoidType,
+       3, c->register_(t->arch->thread()), array, value);
+  } return true;
+
+  case ArraysFillLongIntrinsic: {
+    Compiler::Operand* value = frame->popLong();
+    Compiler::Operand* array = frame->popObject();
+
+    c->call
+      (c->constant(getThunk(t, arrayFill64Thunk), Compiler::AddressType),
+       0, frame->trace(0, 0), 0, Compiler::VoidType,
+       4, c->register_(t->arch->thread()), array,
+       static_cast<Compiler::Operand*>(0), value);
+  } return true;
+
+  case ObjectGetClassIntrinsic:
+    frame->pushObject
+      (c->call
+       (c->constant(getThunk(t, getClass64Thunk), Compiler::AddressType),
+        0, frame->trace(0, 0), TargetBytesPerWord, Compiler::ObjectType,
+        2, c->register_(t->arch->thread()), frame->popObject()));
+    return true;
 
-      frame->pushObject();
-      
-      c->call
-        (c->constant(getThunk(t, gcIfNecessaryThunk), Compiler::AddressType),
-         0,
-         frame->trace(0, 0),
-         0,
-         Compiler::VoidType,
-         1, c->register_(t->arch->thread()));
+  case ThreadCurrentThreadIntrinsic:
+    frame->pushObject
+      (c->call
+       (c->constant
+        (getThunk(t, currentThread64Thunk), Compiler::AddressType),
+        0, 0, TargetBytesPerWord, Compiler::ObjectType,
+        1, c->register_(t->arch->thread())));
+    return true;
+
+  case UnsafeGetByteIntrinsic: {
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    frame->pushInt
+      (c->load
+       (1, 1, c->memory(address, Compiler::IntegerType, 0, 0, 1),
+        TargetBytesPerWord));
+  } return true;
+
+  case UnsafePutByteIntrinsic: {
+    Compiler::Operand* value = frame->popInt();
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    c->store
+      (TargetBytesPerWord, value, 1, c->memory
+       (address, Compiler::IntegerType, 0, 0, 1));
+  } return true;
+
+  case UnsafeGetShortIntrinsic: {
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    frame->pushInt
+      (c->load
+       (2, 2, c->memory(address, Compiler::IntegerType, 0, 0, 1),
+        TargetBytesPerWord));
+  } return true;
+
+  case UnsafePutShortIntrinsic: {
+    Compiler::Operand* value = frame->popInt();
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    c->store
+      (TargetBytesPerWord, value, 2, c->memory
+       (address, Compiler::IntegerType, 0, 0, 1));
+  } return true;
+
+  case UnsafeGetIntIntrinsic:
+  case UnsafeGetFloatIntrinsic: {
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    frame->pushInt
+      (c->load
+       (4, 4, c->memory
+        (address, d->type == UnsafeGetIntIntrinsic
+         ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1),
+        TargetBytesPerWord));
+  } return true;
+
+  case UnsafePutIntIntrinsic:
+  case UnsafePutFloatIntrinsic: {
+    Compiler::Operand* value = frame->popInt();
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    c->store
+      (TargetBytesPerWord, value, 4, c->memory
+       (address, d->type == UnsafePutIntIntrinsic
+        ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1));
+  } return true;
+
+  case UnsafeGetLongIntrinsic:
+  case UnsafeGetDoubleIntrinsic: {
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    frame->pushLong
+      (c->load
+       (8, 8, c->memory
+        (address, d->type == UnsafeGetLongIntrinsic
+         ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1),
+        8));
+  } return true;
+
+  case UnsafePutLongIntrinsic:
+  case UnsafePutDoubleIntrinsic: {
+    Compiler::Operand* value = frame->popLong();
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    c->store
+      (8, value, 8, c->memory
+       (address, d->type == UnsafePutLongIntrinsic
+        ? Compiler::IntegerType : Compiler::FloatType, 0, 0, 1));
+  } return true;
+
+  case UnsafeGetAddressIntrinsic: {
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    frame->pushLong
+      (c->load
+       (TargetBytesPerWord, TargetBytesPerWord,
+        c->memory(address, Compiler::AddressType, 0, 0, 1), 8));
+  } return true;
+
+  case UnsafePutAddressIntrinsic: {
+    Compiler::Operand* value = frame->popLong();
+    Compiler::Operand* address = popLongAddress(frame);
+    frame->popObject();
+    c->store
+      (8, value, TargetBytesPerWord, c->memory
+       (address, Compiler::AddressType, 0, 0, 1));
+  } return true;
+
+  case UnsafeGetIntVolatileIntrinsic: {
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
+    frame->pushInt
+      (c->load
+       (4, 4, c->memory(address, Compiler::IntegerType, 0, 0, 1),
+        TargetBytesPerWord));
+    c->loadBarrier();
+  } return true;
+
+  case UnsafeGetLongVolatileIntrinsic: {
+    // a 32-bit target cannot load a long atomically, so leave it to
+    // the native method
+    if (TargetBytesPerWord < 8) {
+      return false;
     }
-    
-//     fprintf(stderr, "ip: %d map: %ld\n", ip, *(frame->map));
 
-    unsigned instruction = codeBody(t, code, ip++);
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
+    frame->pushLong
+      (c->load
+       (8, 8, c->memory(address, Compiler::IntegerType, 0, 0, 1), 8));
+    c->loadBarrier();
+  } return true;
+
+  case UnsafeGetObjectVolatileIntrinsic: {
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
+    frame->pushObject
+      (c->load
+       (TargetBytesPerWord, TargetBytesPerWord,
+        c->memory(address, Compiler::ObjectType, 0, 0, 1),
+        TargetBytesPerWord));
+    c->loadBarrier();
+  } return true;
 
-    switch (instruction) {
-    case aaload:
-    case baload:
-    case caload:
-    case daload:
-    case faload:
-    case iaload:
-    case laload:
-    case saload: {
-      Compiler::Operand* index = frame->popInt();
-      Compiler::Operand* array = frame->popObject();
+  case UnsafePutIntVolatileIntrinsic:
+  case UnsafePutOrderedIntIntrinsic: {
+    Compiler::Operand* value = frame->popInt();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-      if (inTryBlock(t, code, ip - 1)) {
-        c->saveLocals();
-        frame->trace(0, 0);
-      }
+    c->storeStoreBarrier();
+    c->store
+      (TargetBytesPerWord, value, 4, c->memory
+       (address, Compiler::IntegerType, 0, 0, 1));
+    if (d->type == UnsafePutIntVolatileIntrinsic) {
+      c->storeLoadBarrier();
+    }
+  } return true;
 
-      if (CheckArrayBounds) {
-        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
-      }
+  case UnsafePutLongVolatileIntrinsic:
+  case UnsafePutOrderedLongIntrinsic: {
+    if (TargetBytesPerWord < 8) {
+      return false;
+    }
 
-      switch (instruction) {
-      case aaload:
-        frame->pushObject
-          (c->load
-           (TargetBytesPerWord, TargetBytesPerWord, c->memory
-            (array, Compiler::ObjectType, TargetArrayBody, index,
-             TargetBytesPerWord),
-            TargetBytesPerWord));
-        break;
-
-      case faload:
-        frame->pushInt
-          (c->load
-           (4, 4, c->memory
-            (array, Compiler::FloatType, TargetArrayBody, index, 4),
-            TargetBytesPerWord));
-        break;
+    Compiler::Operand* value = frame->popLong();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-      case iaload:
-        frame->pushInt
-          (c->load
-           (4, 4, c->memory
-            (array, Compiler::IntegerType, TargetArrayBody, index, 4),
-            TargetBytesPerWord));
-        break;
+    c->storeStoreBarrier();
+    c->store
+      (8, value, 8, c->memory(address, Compiler::IntegerType, 0, 0, 1));
+    if (d->type == UnsafePutLongVolatileIntrinsic) {
+      c->storeLoadBarrier();
+    }
+  } return true;
 
-      case baload:
-        frame->pushInt
-          (c->load
-           (1, 1, c->memory
-            (array, Compiler::IntegerType, TargetArrayBody, index, 1),
-            TargetBytesPerWord));
-        break;
+  case UnsafePutObjectVolatileIntrinsic:
+  case UnsafePutOrderedObjectIntrinsic: {
+    Compiler::Operand* value = frame->popObject();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-      case caload:
-        frame->pushInt
-          (c->loadz
-           (2, 2, c->memory
-            (array, Compiler::IntegerType, TargetArrayBody, index, 2),
-            TargetBytesPerWord));
-        break;
+    c->storeStoreBarrier();
+    c->store
+      (TargetBytesPerWord, value, TargetBytesPerWord, c->memory
+       (address, Compiler::ObjectType, 0, 0, 1));
+    markCard(t, c, address);
+    if (d->type == UnsafePutObjectVolatileIntrinsic) {
+      c->storeLoadBarrier();
+    }
+  } return true;
 
-      case daload:
-        frame->pushLong
-          (c->load
-           (8, 8, c->memory
-            (array, Compiler::FloatType, TargetArrayBody, index, 8), 8));
-        break;
+  case UnsafeCompareAndSwapIntIntrinsic: {
+    Compiler::Operand* update = frame->popInt();
+    Compiler::Operand* expect = frame->popInt();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-      case laload:
-        frame->pushLong
-          (c->load
-           (8, 8, c->memory
-            (array, Compiler::IntegerType, TargetArrayBody, index, 8), 8));
-        break;
+    frame->pushInt(c->compareAndSwap(4, address, expect, update));
+  } return true;
 
-      case saload:
-        frame->pushInt
-          (c->load
-           (2, 2, c->memory
-            (array, Compiler::IntegerType, TargetArrayBody, index, 2),
-            TargetBytesPerWord));
-        break;
-      }
-    } break;
+  case UnsafeGetAndAddIntIntrinsic: {
+    Compiler::Operand* delta = frame->popInt();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-    case aastore:
-    case bastore:
-    case castore:
-    case dastore:
-    case fastore:
-    case iastore:
-    case lastore:
-    case sastore: {
-      Compiler::Operand* value;
-      if (instruction == dastore or instruction == lastore) {
-        value = frame->popLong();
-      } else if (instruction == aastore) {
-        value = frame->popObject();
-      } else {
-        value = frame->popInt();
-      }
+    frame->pushInt(c->getAndAdd(4, address, delta));
+  } return true;
 
-      Compiler::Operand* index = frame->popInt();
-      Compiler::Operand* array = frame->popObject();
+  case UnsafeGetAndSetIntIntrinsic: {
+    Compiler::Operand* value = frame->popInt();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-      if (inTryBlock(t, code, ip - 1)) {
-        c->saveLocals();
-        frame->trace(0, 0);
-      }
+    frame->pushInt(c->getAndSet(4, address, value));
+  } return true;
 
-      if (CheckArrayBounds) {
-        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
-      }
+  case UnsafeCompareAndSwapLongIntrinsic: {
+    if (TargetBytesPerWord < 8) {
+      return false;
+    }
 
-      switch (instruction) {
-      case aastore: {
-        c->call
-          (c->constant(getThunk(t, setMaybeNullThunk), Compiler::AddressType),
-           0,
-           frame->trace(0, 0),
-           0,
-           Compiler::VoidType,
-           4, c->register_(t->arch->thread()), array,
-           c->add
-           (4, c->constant(TargetArrayBody, Compiler::IntegerType),
-            c->shl
-            (4, c->constant(log(TargetBytesPerWord), Compiler::IntegerType),
-             index)),
-           value);
-      } break;
+    Compiler::Operand* update = frame->popLong();
+    Compiler::Operand* expect = frame->popLong();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-      case fastore:
-        c->store
-          (TargetBytesPerWord, value, 4, c->memory
-           (array, Compiler::FloatType, TargetArrayBody, index, 4));
-        break;
+    frame->pushInt(c->compareAndSwap(8, address, expect, update));
+  } return true;
 
-      case iastore:
-        c->store
-          (TargetBytesPerWord, value, 4, c->memory
-           (array, Compiler::IntegerType, TargetArrayBody, index, 4));
-        break;
+  case UnsafeGetAndAddLongIntrinsic: {
+    if (TargetBytesPerWord < 8) {
+      return false;
+    }
 
-      case bastore:
-        c->store
-          (TargetBytesPerWord, value, 1, c->memory
-           (array, Compiler::IntegerType, TargetArrayBody, index, 1));
-        break;
+    Compiler::Operand* delta = frame->popLong();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-      case castore:
-      case sastore:
-        c->store
-          (TargetBytesPerWord, value, 2, c->memory
-           (array, Compiler::IntegerType, TargetArrayBody, index, 2));
-        break;
+    frame->pushLong(c->getAndAdd(8, address, delta));
+  } return true;
 
-      case dastore:
-        c->store
-          (8, value, 8, c->memory
-           (array, Compiler::FloatType, TargetArrayBody, index, 8));
-        break;
+  case UnsafeGetAndSetLongIntrinsic: {
+    if (TargetBytesPerWord < 8) {
+      return false;
+    }
 
-      case lastore:
-        c->store
-          (8, value, 8, c->memory
-           (array, Compiler::IntegerType, TargetArrayBody, index, 8));
-        break;
-      }
-    } break;
+    Compiler::Operand* value = frame->popLong();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-    case aconst_null:
-      frame->pushObject(c->constant(0, Compiler::ObjectType));
-      break;
+    frame->pushLong(c->getAndSet(8, address, value));
+  } return true;
 
-    case aload:
-      frame->loadObject(codeBody(t, code, ip++));
-      break;
+  case UnsafeCompareAndSwapObjectIntrinsic: {
+    Compiler::Operand* update = frame->popObject();
+    Compiler::Operand* expect = frame->popObject();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-    case aload_0:
-      frame->loadObject(0);
-      break;
+    // the card is marked whether or not the swap succeeds, which the
+    // collector tolerates (see CardShift in heap.h):
+    frame->pushInt
+      (c->compareAndSwap(TargetBytesPerWord, address, expect, update));
+    markCard(t, c, address);
+  } return true;
 
-    case aload_1:
-      frame->loadObject(1);
-      break;
+  case UnsafeGetAndSetObjectIntrinsic: {
+    Compiler::Operand* value = frame->popObject();
+    Compiler::Operand* address = popUnsafeAddress(frame);
+    frame->popObject();
 
-    case aload_2:
-      frame->loadObject(2);
-      break;
+    frame->pushObject(c->getAndSet(TargetBytesPerWord, address, value));
+    markCard(t, c, address);
+  } return true;
 
-    case aload_3:
-      frame->loadObject(3);
-      break;
+  default:
+    abort(t);
+  }
+}
 
-    case anewarray: {
-      uint16_t index = codeReadInt16(t, code, ip);
-      
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
+unsigned
+targetFieldOffset(Context* context, object field)
+{
+  if (context->bootContext) {
+    return context->bootContext->resolver->fieldOffset(context->thread, field);
+  } else {
+    return fieldOffset(context->thread, field);
+  }
+}
 
-      PROTECT(t, reference);
+Compiler::Operand*
+loadField(MyThread* t, Frame* frame, Compiler::Operand* table, object field)
+{
+  Compiler* c = frame->c;
+  unsigned offset = targetFieldOffset(frame->context, field);
 
-      object class_ = resolveClassInPool(t, context->method, index - 1, false);
+  switch (fieldCode(t, field)) {
+  case ByteField:
+  case BooleanField:
+    return c->load
+      (1, 1, c->memory(table, Compiler::IntegerType, offset, 0, 1),
+       TargetBytesPerWord);
 
-      Compiler::Operand* length = frame->popInt();
+  case CharField:
+    return c->loadz
+      (2, 2, c->memory(table, Compiler::IntegerType, offset, 0, 1),
+       TargetBytesPerWord);
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        thunk = makeBlankObjectArrayThunk;
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = makeBlankObjectArrayFromReferenceThunk;
-      }
+  case ShortField:
+    return c->load
+      (2, 2, c->memory(table, Compiler::IntegerType, offset, 0, 1),
+       TargetBytesPerWord);
 
-      frame->pushObject
-        (c->call
-         (c->constant(getThunk(t, thunk), Compiler::AddressType),
-          0,
-          frame->trace(0, 0),
-          TargetBytesPerWord,
-          Compiler::ObjectType,
-          3, c->register_(t->arch->thread()), frame->append(argument),
-          length));
-    } break;
+  case FloatField:
+    return c->load
+      (4, 4, c->memory(table, Compiler::FloatType, offset, 0, 1),
+       TargetBytesPerWord);
 
-    case areturn: {
-      handleExit(t, frame);
-      c->return_(TargetBytesPerWord, frame->popObject());
-    } goto next;
+  case IntField:
+    return c->load
+      (4, 4, c->memory(table, Compiler::IntegerType, offset, 0, 1),
+       TargetBytesPerWord);
 
-    case arraylength: {
-      frame->pushInt
-        (c->load
-         (TargetBytesPerWord, TargetBytesPerWord,
-          c->memory
-          (frame->popObject(), Compiler::IntegerType,
-           TargetArrayLength, 0, 1),
-          TargetBytesPerWord));
-    } break;
+  case DoubleField:
+    return c->load
+      (8, 8, c->memory(table, Compiler::FloatType, offset, 0, 1), 8);
 
-    case astore:
-      frame->storeObjectOrAddress(codeBody(t, code, ip++));
-      break;
+  case LongField:
+    return c->load
+      (8, 8, c->memory(table, Compiler::IntegerType, offset, 0, 1), 8);
 
-    case astore_0:
-      frame->storeObjectOrAddress(0);
-      break;
+  case ObjectField:
+    return c->load
+      (TargetBytesPerWord, TargetBytesPerWord,
+       c->memory(table, Compiler::ObjectType, offset, 0, 1),
+       TargetBytesPerWord);
 
-    case astore_1:
-      frame->storeObjectOrAddress(1);
-      break;
+  default:
+    abort(t);
+  }
+}
 
-    case astore_2:
-      frame->storeObjectOrAddress(2);
-      break;
+void
+storeField(MyThread* t, Frame* frame, Compiler::Operand* table, object field,
+           Compiler::Operand* value)
+{
+  Compiler* c = frame->c;
+  unsigned offset = targetFieldOffset(frame->context, field);
 
-    case astore_3:
-      frame->storeObjectOrAddress(3);
-      break;
+  switch (fieldCode(t, field)) {
+  case ByteField:
+  case BooleanField:
+    c->store
+      (TargetBytesPerWord, value, 1,
+       c->memory(table, Compiler::IntegerType, offset, 0, 1));
+    break;
 
-    case athrow: {
-      Compiler::Operand* target = frame->popObject();
-      c->call
-        (c->constant(getThunk(t, throw_Thunk), Compiler::AddressType),
-         Compiler::NoReturn,
-         frame->trace(0, 0),
-         0,
-         Compiler::VoidType,
-         2, c->register_(t->arch->thread()), target);
+  case CharField:
+  case ShortField:
+    c->store
+      (TargetBytesPerWord, value, 2,
+       c->memory(table, Compiler::IntegerType, offset, 0, 1));
+    break;
 
-      if (ip == codeLength(t, code)) {
-        c->trap();
-      }
-    } goto next;
+  case FloatField:
+    c->store
+      (TargetBytesPerWord, value, 4,
+       c->memory(table, Compiler::FloatType, offset, 0, 1));
+    break;
 
-    case bipush:
-      frame->pushInt
-        (c->constant
-         (static_cast<int8_t>(codeBody(t, code, ip++)),
-          Compiler::IntegerType));
-      break;
+  case IntField:
+    c->store
+      (TargetBytesPerWord, value, 4,
+       c->memory(table, Compiler::IntegerType, offset, 0, 1));
+    break;
 
-    case checkcast: {
-      uint16_t index = codeReadInt16(t, code, ip);
-
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
+  case DoubleField:
+    c->store
+      (8, value, 8, c->memory(table, Compiler::FloatType, offset, 0, 1));
+    break;
 
-      PROTECT(t, reference);
+  case LongField:
+    c->store
+      (8, value, 8, c->memory(table, Compiler::IntegerType, offset, 0, 1));
+    break;
 
-      object class_ = resolveClassInPool(t, context->method, index - 1, false);
+  case ObjectField:
+    c->store
+      (TargetBytesPerWord, value, TargetBytesPerWord,
+       c->memory(table, Compiler::ObjectType, offset, 0, 1));
+
+    markCard
+      (t, c, c->add
+       (TargetBytesPerWord, table,
+        c->constant(offset, Compiler::IntegerType)));
+    break;
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        thunk = checkCastThunk;
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = checkCastFromReferenceThunk;
-      }
+  default: abort(t);
+  }
+}
 
-      Compiler::Operand* instance = c->peek(1, 0);
+// Calls to small, straight-line methods are compiled in place when
+// everything the callee does can be expressed without a call or a
+// branch: loading arguments and constants, simple arithmetic,
+// accessing non-volatile fields of its receiver or of initialized
+// classes, and invoking other such methods.  An inlined body never
+// calls out or reaches a safepoint, so the stack walker never sees
+// a frame for it, and the only exception it can raise is the
+// NullPointerException from dereferencing a null receiver, which
+// belongs to the call site in any case.
 
-      c->call
-        (c->constant(getThunk(t, thunk), Compiler::AddressType),
-         0,
-         frame->trace(0, 0),
-         0,
-         Compiler::VoidType,
-         3, c->register_(t->arch->thread()), frame->append(argument),
-         instance);
-    } break;
+const unsigned InlineBytecodeLimit = 32;
+const unsigned InlineDepthLimit = 3;
+const unsigned InlineStackLimit = 8;
+const unsigned InlineLocalLimit = 8;
 
-    case d2f: {
-        frame->pushInt(c->f2f(8, 4, frame->popLong()));
-    } break;
+class InlineValue {
+ public:
+  InlineValue(Compiler::Operand* operand = 0, bool receiver = false):
+    operand(operand), receiver(receiver)
+  { }
 
-    case d2i: {
-      frame->pushInt(c->f2i(8, 4, frame->popLong()));
-    } break;
+  Compiler::Operand* operand;
+  bool receiver;
+};
 
-    case d2l: {
-      frame->pushLong(c->f2i(8, 8, frame->popLong()));
-    } break;
+class InlineContext {
+ public:
+  InlineContext(Frame* frame, bool emit, bool needsCheck):
+    frame(frame), emit(emit), dereferenced(false), needsCheck(needsCheck)
+  { }
 
-    case dadd: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+  Frame* frame;
+  // false while deciding whether the call may be inlined at all
+  bool emit;
+  // whether the receiver has been dereferenced so far
+  bool dereferenced;
+  // whether a virtual call still owes a null check of its receiver
+  bool needsCheck;
+};
 
-      frame->pushLong(c->fadd(8, a, b));
-    } break;
+bool
+inlinable(MyThread* t, Frame* frame, object method)
+{
+  object code = methodCode(t, method);
+  return (methodFlags(t, method)
+          & (ACC_NATIVE | ACC_ABSTRACT | ACC_SYNCHRONIZED)) == 0
+    and code
+    and codeLength(t, code) <= InlineBytecodeLimit
+    and codeMaxStack(t, code) <= InlineStackLimit
+    and codeMaxLocals(t, code) <= InlineLocalLimit
+    and codeExceptionHandlerTable(t, code) == 0
+    and ((methodFlags(t, method) & ACC_STATIC) == 0
+         or methodClass(t, method) == methodClass(t, frame->context->method)
+         or (not classNeedsInit(t, methodClass(t, method))))
+    and findIntrinsic(t, method) == 0;
+}
 
-    case dcmpg: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+bool
+monomorphic(MyThread* t, object method)
+{
+  return (not methodVirtual(t, method))
+    or (methodFlags(t, method) & ACC_FINAL)
+    or (classFlags(t, methodClass(t, method)) & ACC_FINAL);
+}
 
-      if (floatBranch(t, frame, code, ip, 8, false, a, b, &newIp)) {
-        goto branch;
-      } else {
-        frame->pushInt
-          (c->call
-           (c->constant
-            (getThunk(t, compareDoublesGThunk), Compiler::AddressType),
-            0, 0, 4, Compiler::IntegerType, 4,
-            static_cast<Compiler::Operand*>(0), a,
-            static_cast<Compiler::Operand*>(0), b));
-      }
-    } break;
+bool
+inlinableField(MyThread* t, Frame* frame, object field, bool static_)
+{
+  return ((fieldFlags(t, field) & ACC_STATIC) != 0) == static_
+    and (fieldFlags(t, field) & ACC_VOLATILE) == 0
+    and ((not static_)
+         or fieldClass(t, field) == methodClass(t, frame->context->method)
+         or (not classNeedsInit(t, fieldClass(t, field))));
+}
 
-    case dcmpl: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+unsigned
+inlineParameters(MyThread* t, object method, unsigned* slots, unsigned* codes)
+{
+  unsigned count = 0;
+  unsigned slot = 0;
 
-      if (floatBranch(t, frame, code, ip, 8, true, a, b, &newIp)) {
-        goto branch;
-      } else {
-        frame->pushInt
-          (c->call
-           (c->constant
-            (getThunk(t, compareDoublesLThunk), Compiler::AddressType),
-            0, 0, 4, Compiler::IntegerType, 4,
-            static_cast<Compiler::Operand*>(0), a,
-            static_cast<Compiler::Operand*>(0), b));
-      }
-    } break;
+  if ((methodFlags(t, method) & ACC_STATIC) == 0) {
+    slots[count] = slot++;
+    codes[count++] = ObjectField;
+  }
 
-    case dconst_0:
-      frame->pushLong(c->constant(doubleToBits(0.0), Compiler::FloatType));
-      break;
-      
-    case dconst_1:
-      frame->pushLong(c->constant(doubleToBits(1.0), Compiler::FloatType));
-      break;
+  for (MethodSpecIterator it
+         (t, reinterpret_cast<const char*>
+          (&byteArrayBody(t, methodSpec(t, method), 0)));
+       it.hasNext();)
+  {
+    unsigned code = fieldCode(t, *it.next());
+    slots[count] = slot;
+    codes[count++] = code;
+    slot += (code == LongField or code == DoubleField) ? 2 : 1;
+  }
 
-    case ddiv: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+  return count;
+}
 
-      frame->pushLong(c->fdiv(8, a, b));
-    } break;
+Compiler::Operand*
+inlineConstant(InlineContext* ic, int64_t value,
+               Compiler::OperandType type = Compiler::IntegerType)
+{
+  return ic->emit ? ic->frame->c->constant(value, type) : 0;
+}
 
-    case dmul: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+Compiler::Operand*
+inlineArithmetic(MyThread* t, Compiler* c, unsigned instruction,
+                 Compiler::Operand* a, Compiler::Operand* b)
+{
+  switch (instruction) {
+  case iadd: return c->add(4, a, b);
+  case isub: return c->sub(4, a, b);
+  case imul: return c->mul(4, a, b);
+  case iand: return c->and_(4, a, b);
+  case ior: return c->or_(4, a, b);
+  case ixor: return c->xor_(4, a, b);
+  case ishl: return c->shl(4, a, b);
+  case ishr: return c->shr(4, a, b);
+  case iushr: return c->ushr(4, a, b);
+  case ladd: return c->add(8, a, b);
+  case lsub: return c->sub(8, a, b);
+  case land: return c->and_(8, a, b);
+  case lor: return c->or_(8, a, b);
+  case lxor: return c->xor_(8, a, b);
+  case lshl: return c->shl(8, a, b);
+  case lshr: return c->shr(8, a, b);
+  case lushr: return c->ushr(8, a, b);
+  default: abort(t);
+  }
+}
 
-      frame->pushLong(c->fmul(8, a, b));
-    } break;
+Compiler::Operand*
+inlineConversion(MyThread* t, Compiler* c, unsigned instruction,
+                 Compiler::Operand* a)
+{
+  switch (instruction) {
+  case ineg: return c->neg(4, a);
+  case lneg: return c->neg(8, a);
+  case i2l: return c->load(TargetBytesPerWord, 4, a, 8);
+  case l2i: return c->load(8, 8, a, TargetBytesPerWord);
+  case i2b: return c->load(TargetBytesPerWord, 1, a, TargetBytesPerWord);
+  case i2c: return c->loadz(TargetBytesPerWord, 2, a, TargetBytesPerWord);
+  case i2s: return c->load(TargetBytesPerWord, 2, a, TargetBytesPerWord);
+  default: abort(t);
+  }
+}
 
-    case dneg: {
-      frame->pushLong(c->fneg(8, frame->popLong()));
-    } break;
+bool
+inlineBody(MyThread* t, InlineContext* ic, object method, InlineValue* locals,
+           unsigned depth, InlineValue* result)
+{
+  PROTECT(t, method);
 
-    case vm::drem: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+  Frame* frame = ic->frame;
+  Compiler* c = frame->c;
 
-      frame->pushLong(c->frem(8, a, b));
-    } break;
+  InlineValue stack[InlineStackLimit];
+  unsigned sp = 0;
 
-    case dsub: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+  unsigned ip = 0;
+  while (ip < codeLength(t, methodCode(t, method))) {
+    object code = methodCode(t, method);
+    unsigned instruction = codeBody(t, code, ip++);
 
-      frame->pushLong(c->fsub(8, a, b));
-    } break;
+    switch (instruction) {
+    case aload_0:
+    case aload_1:
+    case aload_2:
+    case aload_3:
+      stack[sp++] = locals[instruction - aload_0];
+      break;
 
-    case dup:
-      frame->dup();
+    case iload_0:
+    case iload_1:
+    case iload_2:
+    case iload_3:
+      stack[sp++] = locals[instruction - iload_0];
       break;
 
-    case dup_x1:
-      frame->dupX1();
+    case fload_0:
+    case fload_1:
+    case fload_2:
+    case fload_3:
+      stack[sp++] = locals[instruction - fload_0];
       break;
 
-    case dup_x2:
-      frame->dupX2();
+    case lload_0:
+    case lload_1:
+    case lload_2:
+    case lload_3:
+      stack[sp++] = locals[instruction - lload_0];
       break;
 
-    case dup2:
-      frame->dup2();
+    case dload_0:
+    case dload_1:
+    case dload_2:
+    case dload_3:
+      stack[sp++] = locals[instruction - dload_0];
       break;
 
-    case dup2_x1:
-      frame->dup2X1();
+    case aload:
+    case iload:
+    case fload:
+    case lload:
+    case dload:
+      stack[sp++] = locals[codeBody(t, code, ip++)];
       break;
 
-    case dup2_x2:
-      frame->dup2X2();
+    case aconst_null:
+      stack[sp++] = inlineConstant(ic, 0, Compiler::ObjectType);
       break;
 
-    case f2d: {
-      frame->pushLong(c->f2f(4, 8, frame->popInt()));
-    } break;
+    case iconst_m1:
+    case iconst_0:
+    case iconst_1:
+    case iconst_2:
+    case iconst_3:
+    case iconst_4:
+    case iconst_5:
+      stack[sp++] = inlineConstant
+        (ic, static_cast<int>(instruction) - iconst_0);
+      break;
 
-    case f2i: {
-      frame->pushInt(c->f2i(4, 4, frame->popInt()));
-    } break;
+    case lconst_0:
+    case lconst_1:
+      stack[sp++] = inlineConstant(ic, instruction - lconst_0);
+      break;
 
-    case f2l: {
-      frame->pushLong(c->f2i(4, 8, frame->popInt()));
-    } break;
+    case fconst_0:
+    case fconst_1:
+    case fconst_2:
+      stack[sp++] = inlineConstant
+        (ic, floatToBits(instruction - fconst_0), Compiler::FloatType);
+      break;
 
-    case fadd: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
+    case bipush:
+      stack[sp++] = inlineConstant
+        (ic, static_cast<int8_t>(codeBody(t, code, ip++)));
+      break;
 
-      frame->pushInt(c->fadd(4, a, b));
-    } break;
+    case sipush:
+      stack[sp++] = inlineConstant
+        (ic, static_cast<int16_t>(codeReadInt16(t, code, ip)));
+      break;
 
-    case fcmpg: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
+    case ldc:
+    case ldc_w: {
+      uint16_t index;
 
-      if (floatBranch(t, frame, code, ip, 4, false, a, b, &newIp)) {
-        goto branch;
+      if (instruction == ldc) {
+        index = codeBody(t, code, ip++);
       } else {
-        frame->pushInt
-          (c->call
-           (c->constant
-            (getThunk(t, compareFloatsGThunk), Compiler::AddressType),
-            0, 0, 4, Compiler::IntegerType, 2, a, b));
+        index = codeReadInt16(t, code, ip);
       }
-    } break;
 
-    case fcmpl: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
+      object pool = codePool(t, code);
 
-      if (floatBranch(t, frame, code, ip, 4, true, a, b, &newIp)) {
-        goto branch;
-      } else {
-        frame->pushInt
-          (c->call
-           (c->constant
-            (getThunk(t, compareFloatsLThunk), Compiler::AddressType),
-            0, 0, 4, Compiler::IntegerType, 2, a, b));
+      if (singletonIsObject(t, pool, index - 1)) {
+        return false;
       }
-    } break;
-
-    case fconst_0:
-      frame->pushInt(c->constant(floatToBits(0.0), Compiler::FloatType));
-      break;
-      
-    case fconst_1:
-      frame->pushInt(c->constant(floatToBits(1.0), Compiler::FloatType));
-      break;
-      
-    case fconst_2:
-      frame->pushInt(c->constant(floatToBits(2.0), Compiler::FloatType));
-      break;
-
-    case fdiv: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
 
-      frame->pushInt(c->fdiv(4, a, b));
+      stack[sp++] = inlineConstant
+        (ic, singletonValue(t, pool, index - 1),
+         singletonBit(t, pool, poolSize(t, pool), index - 1)
+         ? Compiler::FloatType : Compiler::IntegerType);
     } break;
 
-    case fmul: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
+    case ldc2_w: {
+      uint16_t index = codeReadInt16(t, code, ip);
 
-      frame->pushInt(c->fmul(4, a, b));
-    } break;
+      object pool = codePool(t, code);
 
-    case fneg: {
-      frame->pushInt(c->fneg(4, frame->popInt()));
+      uint64_t v;
+      memcpy(&v, &singletonValue(t, pool, index - 1), 8);
+      stack[sp++] = inlineConstant
+        (ic, v, singletonBit(t, pool, poolSize(t, pool), index - 1)
+         ? Compiler::FloatType : Compiler::IntegerType);
     } break;
 
-    case vm::frem: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-
-      frame->pushInt(c->frem(4, a, b));   	
+    case iadd:
+    case isub:
+    case imul:
+    case iand:
+    case ior:
+    case ixor:
+    case ishl:
+    case ishr:
+    case iushr:
+    case ladd:
+    case lsub:
+    case land:
+    case lor:
+    case lxor:
+    case lshl:
+    case lshr:
+    case lushr: {
+      InlineValue a = stack[--sp];
+      InlineValue b = stack[--sp];
+      stack[sp++] = ic->emit
+        ? inlineArithmetic(t, c, instruction, a.operand, b.operand) : 0;
     } break;
 
-    case fsub: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-
-      frame->pushInt(c->fsub(4, a, b));
+    case ineg:
+    case lneg:
+    case i2l:
+    case l2i:
+    case i2b:
+    case i2c:
+    case i2s: {
+      InlineValue a = stack[--sp];
+      stack[sp++] = ic->emit
+        ? inlineConversion(t, c, instruction, a.operand) : 0;
     } break;
 
     case getfield:
     case getstatic: {
       uint16_t index = codeReadInt16(t, code, ip);
-        
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
 
-      PROTECT(t, reference);
+      object field = resolveField(t, method, index - 1, false);
 
-      object field = resolveField(t, context->method, index - 1, false);
+      if (field == 0
+          or not inlinableField(t, frame, field, instruction == getstatic))
+      {
+        return false;
+      }
 
-      if (LIKELY(field)) {
-        if ((fieldFlags(t, field) & ACC_VOLATILE)
-            and TargetBytesPerWord == 4
-            and (fieldCode(t, field) == DoubleField
-                 or fieldCode(t, field) == LongField))
-        {
-          PROTECT(t, field);
+      PROTECT(t, field);
 
-          c->call
-            (c->constant
-             (getThunk(t, acquireMonitorForObjectThunk),
-              Compiler::AddressType),
-             0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-             c->register_(t->arch->thread()),
-             frame->append(field));
+      Compiler::Operand* table;
+
+      if (instruction == getstatic) {
+        table = ic->emit
+          ? frame->append(classStaticTable(t, fieldClass(t, field))) : 0;
+      } else {
+        InlineValue instance = stack[--sp];
+        if (not instance.receiver) {
+          return false;
         }
 
-        Compiler::Operand* table;
+        ic->dereferenced = true;
+        table = instance.operand;
+      }
 
-        if (instruction == getstatic) {
-          checkField(t, field, true);
+      stack[sp++] = ic->emit ? loadField(t, frame, table, field) : 0;
+    } break;
 
-          PROTECT(t, field);
+    case putfield:
+    case putstatic: {
+      uint16_t index = codeReadInt16(t, code, ip);
 
-          if (fieldClass(t, field) != methodClass(t, context->method)
-              and classNeedsInit(t, fieldClass(t, field)))
-          {
-            c->call
-              (c->constant
-               (getThunk(t, tryInitClassThunk), Compiler::AddressType),
-               0,
-               frame->trace(0, 0),
-               0,
-               Compiler::VoidType,
-               2, c->register_(t->arch->thread()),
-               frame->append(fieldClass(t, field)));
-          }
+      object field = resolveField(t, method, index - 1, false);
 
-          table = frame->append(classStaticTable(t, fieldClass(t, field)));
-        } else {
-          checkField(t, field, false);
+      if (field == 0
+          or not inlinableField(t, frame, field, instruction == putstatic))
+      {
+        return false;
+      }
 
-          table = frame->popObject();
+      PROTECT(t, field);
 
-          if (inTryBlock(t, code, ip - 3)) {
-            c->saveLocals();
-            frame->trace(0, 0);
-          }
-        }
+      InlineValue value = stack[--sp];
 
-        switch (fieldCode(t, field)) {
-        case ByteField:
-        case BooleanField:
-          frame->pushInt
-            (c->load
-             (1, 1, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
+      Compiler::Operand* table;
 
-        case CharField:
-          frame->pushInt
-            (c->loadz
-             (2, 2, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
+      if (instruction == putstatic) {
+        // the store must not be visible if the call should have
+        // thrown a NullPointerException instead
+        if (ic->needsCheck and not ic->dereferenced) {
+          return false;
+        }
 
-        case ShortField:
-          frame->pushInt
-            (c->load
-             (2, 2, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
+        table = ic->emit
+          ? frame->append(classStaticTable(t, fieldClass(t, field))) : 0;
+      } else {
+        InlineValue instance = stack[--sp];
+        if (not instance.receiver) {
+          return false;
+        }
 
-        case FloatField:
-          frame->pushInt
-            (c->load
-             (4, 4, c->memory
-              (table, Compiler::FloatType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
+        ic->dereferenced = true;
+        table = instance.operand;
+      }
 
-        case IntField:
-          frame->pushInt
-            (c->load
-             (4, 4, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
+      if (ic->emit) {
+        storeField(t, frame, table, field, value.operand);
+      }
+    } break;
 
-        case DoubleField:
-          frame->pushLong
-            (c->load
-             (8, 8, c->memory
-              (table, Compiler::FloatType, targetFieldOffset
-               (context, field), 0, 1), 8));
-          break;
+    case invokespecial:
+    case invokestatic:
+    case invokevirtual: {
+      if (depth + 1 >= InlineDepthLimit) {
+        return false;
+      }
 
-        case LongField:
-          frame->pushLong
-            (c->load
-             (8, 8, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), 8));
-          break;
+      uint16_t index = codeReadInt16(t, code, ip);
 
-        case ObjectField:
-          frame->pushObject
-            (c->load
-             (TargetBytesPerWord, TargetBytesPerWord,
-              c->memory
-              (table, Compiler::ObjectType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
+      object target = resolveMethod(t, method, index - 1, false);
 
-        default:
-          abort(t);
-        }
+      if (target == 0) {
+        return false;
+      }
 
-        if (fieldFlags(t, field) & ACC_VOLATILE) {
-          if (TargetBytesPerWord == 4
-              and (fieldCode(t, field) == DoubleField
-                   or fieldCode(t, field) == LongField))
-          {
-            c->call
-              (c->constant
-               (getThunk(t, releaseMonitorForObjectThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-               c->register_(t->arch->thread()),
-               frame->append(field));
-          } else {
-            c->loadBarrier();
-          }
+      if (instruction == invokespecial) {
+        object class_ = methodClass(t, method);
+        if (isSpecialMethod(t, target, class_)) {
+          target = findVirtualMethod(t, target, classSuper(t, class_));
         }
-      } else {
-        int fieldCode = vm::fieldCode
-          (t, byteArrayBody(t, referenceSpec(t, reference), 0));
+      }
 
-        object pair = makePair(t, context->method, reference);
+      // inlinable may allocate
+      PROTECT(t, target);
 
-        unsigned rSize = resultSize(t, fieldCode);
-        Compiler::OperandType rType = operandTypeForFieldCode(t, fieldCode);
+      if (((methodFlags(t, target) & ACC_STATIC) != 0)
+          != (instruction == invokestatic)
+          or not inlinable(t, frame, target)
+          or (instruction == invokevirtual and not monomorphic(t, target)))
+      {
+        return false;
+      }
 
-        Compiler::Operand* result;
-        if (instruction == getstatic) {
-          result = c->call
-            (c->constant
-             (getThunk(t, getStaticFieldValueFromReferenceThunk),
-              Compiler::AddressType),
-             0, frame->trace(0, 0), rSize, rType, 2,
-             c->register_(t->arch->thread()), frame->append(pair));
-        } else {
-          Compiler::Operand* instance = frame->popObject();
+      unsigned slots[InlineLocalLimit];
+      unsigned codes[InlineLocalLimit];
+      unsigned count = inlineParameters(t, target, slots, codes);
 
-          result = c->call
-            (c->constant
-             (getThunk(t, getFieldValueFromReferenceThunk),
-              Compiler::AddressType),
-             0, frame->trace(0, 0), rSize, rType, 3,
-             c->register_(t->arch->thread()), frame->append(pair),
-             instance);
+      InlineValue arguments[InlineLocalLimit];
+      for (unsigned i = count; i > 0; --i) {
+        arguments[slots[i - 1]] = stack[--sp];
+      }
+
+      if (instruction == invokevirtual) {
+        // we can only check the outermost receiver for null, and only
+        // by dereferencing it later on
+        if (not arguments[0].receiver) {
+          return false;
         }
 
-        pushReturnValue(t, frame, fieldCode, result);
+        if (not ic->dereferenced) {
+          ic->needsCheck = true;
+        }
       }
-    } break;
 
-    case goto_: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      uint32_t newIp = (ip - 3) + offset;
-      assert(t, newIp < codeLength(t, code));
+      InlineValue r;
+      if (not inlineBody(t, ic, target, arguments, depth + 1, &r)) {
+        return false;
+      }
 
-      c->jmp(frame->machineIp(newIp));
-      ip = newIp;
+      if (methodReturnCode(t, target) != VoidField) {
+        stack[sp++] = r;
+      }
     } break;
 
-    case goto_w: {
-      uint32_t offset = codeReadInt32(t, code, ip);
-      uint32_t newIp = (ip - 5) + offset;
-      assert(t, newIp < codeLength(t, code));
+    case return_:
+    case ireturn:
+    case lreturn:
+    case freturn:
+    case dreturn:
+    case areturn:
+      if (ip != codeLength(t, code)) {
+        return false;
+      }
 
-      c->jmp(frame->machineIp(newIp));
-      ip = newIp;
-    } break;
+      *result = instruction == return_ ? InlineValue() : stack[--sp];
 
-    case i2b: {
-      frame->pushInt
-        (c->load(TargetBytesPerWord, 1, frame->popInt(), TargetBytesPerWord));
-    } break;
+      if (ic->emit and needsReturnBarrier(t, method)) {
+        c->storeStoreBarrier();
+      }
+      return true;
 
-    case i2c: {
-      frame->pushInt
-        (c->loadz(TargetBytesPerWord, 2, frame->popInt(), TargetBytesPerWord));
-    } break;
+    default:
+      return false;
+    }
+  }
 
-    case i2d: {
-      frame->pushLong(c->i2f(4, 8, frame->popInt()));
-    } break;
+  return false;
+}
 
-    case i2f: {
-      frame->pushInt(c->i2f(4, 4, frame->popInt()));
-    } break;
+bool
+inlineInvoke(MyThread* t, Frame* frame, object target, unsigned instruction,
+             bool inTry)
+{
+  PROTECT(t, target);
 
-    case i2l:
-      frame->pushLong(c->load(TargetBytesPerWord, 4, frame->popInt(), 8));
-      break;
+  if (not (inlinable(t, frame, target)
+           and (instruction != invokevirtual or monomorphic(t, target))))
+  {
+    return false;
+  }
 
-    case i2s: {
-      frame->pushInt
-        (c->load(TargetBytesPerWord, 2, frame->popInt(), TargetBytesPerWord));
-    } break;
-      
-    case iadd: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-      frame->pushInt(c->add(4, a, b));
-    } break;
-      
-    case iand: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-      frame->pushInt(c->and_(4, a, b));
-    } break;
+  unsigned slots[InlineLocalLimit];
+  unsigned codes[InlineLocalLimit];
+  unsigned count = inlineParameters(t, target, slots, codes);
 
-    case iconst_m1:
-      frame->pushInt(c->constant(-1, Compiler::IntegerType));
-      break;
+  bool hasReceiver = (methodFlags(t, target) & ACC_STATIC) == 0;
 
-    case iconst_0:
+  InlineValue arguments[InlineLocalLimit];
+  if (hasReceiver) {
+    arguments[0] = InlineValue(0, true);
+  }
+
+  // make sure the whole body qualifies before generating any code for
+  // it, since the compiler cannot take code back once it is appended
+  InlineContext check(frame, false, instruction == invokevirtual);
+  InlineValue result;
+  if ((not inlineBody(t, &check, target, arguments, 0, &result))
+      or (check.needsCheck and not check.dereferenced))
+  {
+    return false;
+  }
+
+  for (unsigned i = count; i > 0; --i) {
+    arguments[slots[i - 1]] = InlineValue
+      (popField(t, frame, codes[i - 1]), hasReceiver and i == 1);
+  }
+
+  if (check.dereferenced and inTry) {
+    frame->c->saveLocals();
+    frame->trace(0, 0);
+  }
+
+  InlineContext ic(frame, true, instruction == invokevirtual);
+  bool success = inlineBody(t, &ic, target, arguments, 0, &result);
+  expect(t, success);
+
+  if (methodReturnCode(t, target) != VoidField) {
+    pushReturnValue(t, frame, methodReturnCode(t, target), result.operand);
+  }
+
+  return true;
+}
+
+class Stack {
+ public:
+  class MyResource: public Thread::Resource {
+   public:
+    MyResource(Stack* s): Resource(s->thread), s(s) { }
+
+    virtual void release() {
+      s->zone.dispose();
+    }
+
+    Stack* s;
+  };
+
+  Stack(MyThread* t):
+    thread(t),
+    zone(t->m->system, t->m->heap, 0),
+    resource(this)
+  { }
+
+  ~Stack() {
+    zone.dispose();
+  }
+
+  void pushValue(uintptr_t v) {
+    *static_cast<uintptr_t*>(push(BytesPerWord)) = v;
+  }
+
+  uintptr_t peekValue(unsigned offset) {
+    return *static_cast<uintptr_t*>(peek((offset + 1) * BytesPerWord));
+  }
+
+  uintptr_t popValue() {
+    uintptr_t v = peekValue(0);
+    pop(BytesPerWord);
+    return v;
+  }
+
+  void* push(unsigned size) {
+    return zone.allocate(size);
+  }
+
+  void* peek(unsigned size) {
+    return zone.peek(size);
+  }
+
+  void pop(unsigned size) {
+    zone.pop(size);
+  }
+
+  MyThread* thread;
+  Zone zone;
+  MyResource resource;
+};
+
+class SwitchState {
+ public:
+  SwitchState(Compiler::State* state,
+              unsigned count,
+              unsigned defaultIp,
+              Compiler::Operand* key,
+              Promise* start,
+              int bottom,
+              int top):
+    state(state),
+    count(count),
+    defaultIp(defaultIp),
+    key(key),
+    start(start),
+    bottom(bottom),
+    top(top),
+    index(0)
+  { }
+
+  Frame* frame() {
+    return reinterpret_cast<Frame*>
+      (reinterpret_cast<uint8_t*>(this) - pad(count * 4) - pad(sizeof(Frame)));
+  }
+
+  uint32_t* ipTable() {
+    return reinterpret_cast<uint32_t*>
+      (reinterpret_cast<uint8_t*>(this) - pad(count * 4));
+  }
+
+  Compiler::State* state;
+  unsigned count;
+  unsigned defaultIp;
+  Compiler::Operand* key;
+  Promise* start;
+  int bottom;
+  int top;
+  unsigned index;
+};
+
+void
+compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
+        int exceptionHandlerStart = -1)
+{
+  enum {
+    Return,
+    Unbranch,
+    Unsubroutine,
+    Untable0,
+    Untable1,
+    Unswitch
+  };
+
+  Frame* frame = initialFrame;
+  Compiler* c = frame->c;
+  Context* context = frame->context;
+  unsigned stackSize = codeMaxStack(t, methodCode(t, context->method));
+  Stack stack(t);
+  unsigned ip = initialIp;
+  unsigned newIp;
+  stack.pushValue(Return);
+
+ start:
+  uint8_t* stackMap = static_cast<uint8_t*>(stack.push(stackSize));
+  frame = new (stack.push(sizeof(Frame))) Frame(frame, stackMap);
+
+ loop:
+  object code = methodCode(t, context->method);
+  PROTECT(t, code);
+  
+  while (ip < codeLength(t, code)) {
+    if (context->visitTable[ip] ++) {
+      // we've already visited this part of the code
+      frame->visitLogicalIp(ip);
+      goto next;
+    }
+
+    frame->startLogicalIp(ip);
+
+    if (exceptionHandlerStart >= 0) {
+      c->initLocalsFromLogicalIp(exceptionHandlerStart);
+
+      exceptionHandlerStart = -1;
+
+      frame->pushObject();
+      
+      c->call
+        (c->constant(getThunk(t, gcIfNecessaryThunk), Compiler::AddressType),
+         0,
+         frame->trace(0, 0),
+         0,
+         Compiler::VoidType,
+         1, c->register_(t->arch->thread()));
+    }
+    
+//     fprintf(stderr, "ip: %d map: %ld\n", ip, *(frame->map));
+
+    unsigned instruction = codeBody(t, code, ip++);
+
+    switch (instruction) {
+    case aaload:
+    case baload:
+    case caload:
+    case daload:
+    case faload:
+    case iaload:
+    case laload:
+    case saload: {
+      Compiler::Operand* index = frame->popInt();
+      Compiler::Operand* array = frame->popObject();
+
+      if (inTryBlock(t, code, ip - 1)) {
+        c->saveLocals();
+        frame->trace(0, 0);
+      }
+
+      if (needsBoundsCheck(context, ip - 1)) {
+        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
+      }
+
+      switch (instruction) {
+      case aaload:
+        frame->pushObject
+          (c->load
+           (TargetBytesPerWord, TargetBytesPerWord, c->memory
+            (array, Compiler::ObjectType, TargetArrayBody, index,
+             TargetBytesPerWord),
+            TargetBytesPerWord));
+        break;
+
+      case faload:
+        frame->pushInt
+          (c->load
+           (4, 4, c->memory
+            (array, Compiler::FloatType, TargetArrayBody, index, 4),
+            TargetBytesPerWord));
+        break;
+
+      case iaload:
+        frame->pushInt
+          (c->load
+           (4, 4, c->memory
+            (array, Compiler::IntegerType, TargetArrayBody, index, 4),
+            TargetBytesPerWord));
+        break;
+
+      case baload:
+        frame->pushInt
+          (c->load
+           (1, 1, c->memory
+            (array, Compiler::IntegerType, TargetArrayBody, index, 1),
+            TargetBytesPerWord));
+        break;
+
+      case caload:
+        frame->pushInt
+          (c->loadz
+           (2, 2, c->memory
+            (array, Compiler::IntegerType, TargetArrayBody, index, 2),
+            TargetBytesPerWord));
+        break;
+
+      case daload:
+        frame->pushLong
+          (c->load
+           (8, 8, c->memory
+            (array, Compiler::FloatType, TargetArrayBody, index, 8), 8));
+        break;
+
+      case laload:
+        frame->pushLong
+          (c->load
+           (8, 8, c->memory
+            (array, Compiler::IntegerType, TargetArrayBody, index, 8), 8));
+        break;
+
+      case saload:
+        frame->pushInt
+          (c->load
+           (2, 2, c->memory
+            (array, Compiler::IntegerType, TargetArrayBody, index, 2),
+            TargetBytesPerWord));
+        break;
+      }
+    } break;
+
+    case aastore:
+    case bastore:
+    case castore:
+    case dastore:
+    case fastore:
+    case iastore:
+    case lastore:
+    case sastore: {
+      Compiler::Operand* value;
+      if (instruction == dastore or instruction == lastore) {
+        value = frame->popLong();
+      } else if (instruction == aastore) {
+        value = frame->popObject();
+      } else {
+        value = frame->popInt();
+      }
+
+      Compiler::Operand* index = frame->popInt();
+      Compiler::Operand* array = frame->popObject();
+
+      if (inTryBlock(t, code, ip - 1)) {
+        c->saveLocals();
+        frame->trace(0, 0);
+      }
+
+      if (needsBoundsCheck(context, ip - 1)) {
+        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
+      }
+
+      switch (instruction) {
+      case aastore: {
+        c->store
+          (TargetBytesPerWord, value, TargetBytesPerWord, c->memory
+           (array, Compiler::ObjectType, TargetArrayBody, index,
+            TargetBytesPerWord));
+
+        markCard
+          (t, c, c->add
+           (TargetBytesPerWord, array, c->load
+            (TargetBytesPerWord, 4, c->add
+             (4, c->constant(TargetArrayBody, Compiler::IntegerType),
+              c->shl
+              (4, c->constant(log(TargetBytesPerWord), Compiler::IntegerType),
+               index)), TargetBytesPerWord)));
+      } break;
+
+      case fastore:
+        c->store
+          (TargetBytesPerWord, value, 4, c->memory
+           (array, Compiler::FloatType, TargetArrayBody, index, 4));
+        break;
+
+      case iastore:
+        c->store
+          (TargetBytesPerWord, value, 4, c->memory
+           (array, Compiler::IntegerType, TargetArrayBody, index, 4));
+        break;
+
+      case bastore:
+        c->store
+          (TargetBytesPerWord, value, 1, c->memory
+           (array, Compiler::IntegerType, TargetArrayBody, index, 1));
+        break;
+
+      case castore:
+      case sastore:
+        c->store
+          (TargetBytesPerWord, value, 2, c->memory
+           (array, Compiler::IntegerType, TargetArrayBody, index, 2));
+        break;
+
+      case dastore:
+        c->store
+          (8, value, 8, c->memory
+           (array, Compiler::FloatType, TargetArrayBody, index, 8));
+        break;
+
+      case lastore:
+        c->store
+          (8, value, 8, c->memory
+           (array, Compiler::IntegerType, TargetArrayBody, index, 8));
+        break;
+      }
+    } break;
+
+    case aconst_null:
+      frame->pushObject(c->constant(0, Compiler::ObjectType));
+      break;
+
+    case aload:
+      frame->loadObject(codeBody(t, code, ip++));
+      break;
+
+    case aload_0:
+      frame->loadObject(0);
+      break;
+
+    case aload_1:
+      frame->loadObject(1);
+      break;
+
+    case aload_2:
+      frame->loadObject(2);
+      break;
+
+    case aload_3:
+      frame->loadObject(3);
+      break;
+
+    case anewarray: {
+      uint16_t index = codeReadInt16(t, code, ip);
+      
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
+
+      PROTECT(t, reference);
+
+      object class_ = resolveClassInPool(t, context->method, index - 1, false);
+
+      Compiler::Operand* length = frame->popInt();
+
+      object argument;
+      uintptr_t thunk;
+      if (LIKELY(class_)) {
+        argument = resolveObjectArrayClass
+          (t, classLoader(t, class_), class_);
+        thunk = allocateArrayThunk(t);
+      } else {
+        argument = makePair(t, context->method, reference);
+        thunk = getThunk(t, makeBlankObjectArrayFromReferenceThunk);
+      }
+
+      frame->pushObject
+        (c->call
+         (c->constant(thunk, Compiler::AddressType),
+          0,
+          frame->trace(0, 0),
+          TargetBytesPerWord,
+          Compiler::ObjectType,
+          3, c->register_(t->arch->thread()), frame->append(argument),
+          length));
+    } break;
+
+    case areturn: {
+      poll(t, frame);
+      handleExit(t, frame);
+      c->return_(TargetBytesPerWord, frame->popObject());
+    } goto next;
+
+    case arraylength: {
+      frame->pushInt
+        (c->load
+         (TargetBytesPerWord, TargetBytesPerWord,
+          c->memory
+          (frame->popObject(), Compiler::IntegerType,
+           TargetArrayLength, 0, 1),
+          TargetBytesPerWord));
+    } break;
+
+    case astore:
+      frame->storeObjectOrAddress(codeBody(t, code, ip++));
+      break;
+
+    case astore_0:
+      frame->storeObjectOrAddress(0);
+      break;
+
+    case astore_1:
+      frame->storeObjectOrAddress(1);
+      break;
+
+    case astore_2:
+      frame->storeObjectOrAddress(2);
+      break;
+
+    case astore_3:
+      frame->storeObjectOrAddress(3);
+      break;
+
+    case athrow: {
+      Compiler::Operand* target = frame->popObject();
+      c->call
+        (c->constant(getThunk(t, throw_Thunk), Compiler::AddressType),
+         Compiler::NoReturn,
+         frame->trace(0, 0),
+         0,
+         Compiler::VoidType,
+         2, c->register_(t->arch->thread()), target);
+
+      if (ip == codeLength(t, code)) {
+        c->trap();
+      }
+    } goto next;
+
+    case bipush:
+      frame->pushInt
+        (c->constant
+         (static_cast<int8_t>(codeBody(t, code, ip++)),
+          Compiler::IntegerType));
+      break;
+
+    case checkcast: {
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
+
+      PROTECT(t, reference);
+
+      object class_ = resolveClassInPool(t, context->method, index - 1, false);
+
+      object argument;
+      Thunk thunk;
+      if (LIKELY(class_)) {
+        argument = class_;
+        thunk = checkCastThunk;
+      } else {
+        argument = makePair(t, context->method, reference);
+        thunk = checkCastFromReferenceThunk;
+      }
+
+      Compiler::Operand* instance = c->peek(1, 0);
+
+      c->call
+        (c->constant(getThunk(t, thunk), Compiler::AddressType),
+         0,
+         frame->trace(0, 0),
+         0,
+         Compiler::VoidType,
+         3, c->register_(t->arch->thread()), frame->append(argument),
+         instance);
+    } break;
+
+    case d2f: {
+        frame->pushInt(c->f2f(8, 4, frame->popLong()));
+    } break;
+
+    case d2i: {
+      frame->pushInt(c->f2i(8, 4, frame->popLong()));
+    } break;
+
+    case d2l: {
+      frame->pushLong(c->f2i(8, 8, frame->popLong()));
+    } break;
+
+    case dadd: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+
+      frame->pushLong(c->fadd(8, a, b));
+    } break;
+
+    case dcmpg: {
+      pollIfBackward(t, frame, code, ip);
+
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+
+      if (floatBranch(t, frame, code, ip, 8, false, a, b, &newIp)) {
+        goto branch;
+      } else {
+        frame->pushInt
+          (c->call
+           (c->constant
+            (getThunk(t, compareDoublesGThunk), Compiler::AddressType),
+            0, 0, 4, Compiler::IntegerType, 4,
+            static_cast<Compiler::Operand*>(0), a,
+            static_cast<Compiler::Operand*>(0), b));
+      }
+    } break;
+
+    case dcmpl: {
+      pollIfBackward(t, frame, code, ip);
+
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+
+      if (floatBranch(t, frame, code, ip, 8, true, a, b, &newIp)) {
+        goto branch;
+      } else {
+        frame->pushInt
+          (c->call
+           (c->constant
+            (getThunk(t, compareDoublesLThunk), Compiler::AddressType),
+            0, 0, 4, Compiler::IntegerType, 4,
+            static_cast<Compiler::Operand*>(0), a,
+            static_cast<Compiler::Operand*>(0), b));
+      }
+    } break;
+
+    case dconst_0:
+      frame->pushLong(c->constant(doubleToBits(0.0), Compiler::FloatType));
+      break;
+      
+    case dconst_1:
+      frame->pushLong(c->constant(doubleToBits(1.0), Compiler::FloatType));
+      break;
+
+    case ddiv: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+
+      frame->pushLong(c->fdiv(8, a, b));
+    } break;
+
+    case dmul: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+
+      frame->pushLong(c->fmul(8, a, b));
+    } break;
+
+    case dneg: {
+      frame->pushLong(c->fneg(8, frame->popLong()));
+    } break;
+
+    case vm::drem: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+
+      frame->pushLong(c->frem(8, a, b));
+    } break;
+
+    case dsub: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+
+      frame->pushLong(c->fsub(8, a, b));
+    } break;
+
+    case dup:
+      frame->dup();
+      break;
+
+    case dup_x1:
+      frame->dupX1();
+      break;
+
+    case dup_x2:
+      frame->dupX2();
+      break;
+
+    case dup2:
+      frame->dup2();
+      break;
+
+    case dup2_x1:
+      frame->dup2X1();
+      break;
+
+    case dup2_x2:
+      frame->dup2X2();
+      break;
+
+    case f2d: {
+      frame->pushLong(c->f2f(4, 8, frame->popInt()));
+    } break;
+
+    case f2i: {
+      frame->pushInt(c->f2i(4, 4, frame->popInt()));
+    } break;
+
+    case f2l: {
+      frame->pushLong(c->f2i(4, 8, frame->popInt()));
+    } break;
+
+    case fadd: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+
+      frame->pushInt(c->fadd(4, a, b));
+    } break;
+
+    case fcmpg: {
+      pollIfBackward(t, frame, code, ip);
+
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+
+      if (floatBranch(t, frame, code, ip, 4, false, a, b, &newIp)) {
+        goto branch;
+      } else {
+        frame->pushInt
+          (c->call
+           (c->constant
+            (getThunk(t, compareFloatsGThunk), Compiler::AddressType),
+            0, 0, 4, Compiler::IntegerType, 2, a, b));
+      }
+    } break;
+
+    case fcmpl: {
+      pollIfBackward(t, frame, code, ip);
+
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+
+      if (floatBranch(t, frame, code, ip, 4, true, a, b, &newIp)) {
+        goto branch;
+      } else {
+        frame->pushInt
+          (c->call
+           (c->constant
+            (getThunk(t, compareFloatsLThunk), Compiler::AddressType),
+            0, 0, 4, Compiler::IntegerType, 2, a, b));
+      }
+    } break;
+
+    case fconst_0:
+      frame->pushInt(c->constant(floatToBits(0.0), Compiler::FloatType));
+      break;
+      
+    case fconst_1:
+      frame->pushInt(c->constant(floatToBits(1.0), Compiler::FloatType));
+      break;
+      
+    case fconst_2:
+      frame->pushInt(c->constant(floatToBits(2.0), Compiler::FloatType));
+      break;
+
+    case fdiv: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+
+      frame->pushInt(c->fdiv(4, a, b));
+    } break;
+
+    case fmul: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+
+      frame->pushInt(c->fmul(4, a, b));
+    } break;
+
+    case fneg: {
+      frame->pushInt(c->fneg(4, frame->popInt()));
+    } break;
+
+    case vm::frem: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+
+      frame->pushInt(c->frem(4, a, b));   	
+    } break;
+
+    case fsub: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+
+      frame->pushInt(c->fsub(4, a, b));
+    } break;
+
+    case getfield:
+    case getstatic: {
+      uint16_t index = codeReadInt16(t, code, ip);
+        
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
+
+      PROTECT(t, reference);
+
+      object field = resolveField(t, context->method, index - 1, false);
+
+      if (LIKELY(field)) {
+        if ((fieldFlags(t, field) & ACC_VOLATILE)
+            and TargetBytesPerWord == 4
+            and (fieldCode(t, field) == DoubleField
+                 or fieldCode(t, field) == LongField))
+        {
+          PROTECT(t, field);
+
+          c->call
+            (c->constant
+             (getThunk(t, acquireMonitorForObjectThunk),
+              Compiler::AddressType),
+             0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
+             c->register_(t->arch->thread()),
+             frame->append(field));
+        }
+
+        Compiler::Operand* table;
+
+        if (instruction == getstatic) {
+          checkField(t, field, true);
+
+          PROTECT(t, field);
+
+          if (fieldClass(t, field) != methodClass(t, context->method)
+              and classNeedsInit(t, fieldClass(t, field)))
+          {
+            c->call
+              (c->constant
+               (getThunk(t, tryInitClassThunk), Compiler::AddressType),
+               0,
+               frame->trace(0, 0),
+               0,
+               Compiler::VoidType,
+               2, c->register_(t->arch->thread()),
+               frame->append(fieldClass(t, field)));
+          }
+
+          table = frame->append(classStaticTable(t, fieldClass(t, field)));
+        } else {
+          checkField(t, field, false);
+
+          table = frame->popObject();
+
+          if (inTryBlock(t, code, ip - 3)) {
+            c->saveLocals();
+            frame->trace(0, 0);
+          }
+        }
+
+        pushReturnValue
+          (t, frame, fieldCode(t, field), loadField(t, frame, table, field));
+
+        if (fieldFlags(t, field) & ACC_VOLATILE) {
+          if (TargetBytesPerWord == 4
+              and (fieldCode(t, field) == DoubleField
+                   or fieldCode(t, field) == LongField))
+          {
+            c->call
+              (c->constant
+               (getThunk(t, releaseMonitorForObjectThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
+               c->register_(t->arch->thread()),
+               frame->append(field));
+          } else {
+            c->loadBarrier();
+          }
+        }
+      } else {
+        int fieldCode = vm::fieldCode
+          (t, byteArrayBody(t, referenceSpec(t, reference), 0));
+
+        object pair = makePair(t, context->method, reference);
+
+        unsigned rSize = resultSize(t, fieldCode);
+        Compiler::OperandType rType = operandTypeForFieldCode(t, fieldCode);
+
+        Compiler::Operand* result;
+        if (instruction == getstatic) {
+          result = c->call
+            (c->constant
+             (getThunk(t, getStaticFieldValueFromReferenceThunk),
+              Compiler::AddressType),
+             0, frame->trace(0, 0), rSize, rType, 2,
+             c->register_(t->arch->thread()), frame->append(pair));
+        } else {
+          Compiler::Operand* instance = frame->popObject();
+
+          result = c->call
+            (c->constant
+             (getThunk(t, getFieldValueFromReferenceThunk),
+              Compiler::AddressType),
+             0, frame->trace(0, 0), rSize, rType, 3,
+             c->register_(t->arch->thread()), frame->append(pair),
+             instance);
+        }
+
+        pushReturnValue(t, frame, fieldCode, result);
+      }
+    } break;
+
+    case goto_: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      uint32_t newIp = (ip - 3) + offset;
+      assert(t, newIp < codeLength(t, code));
+
+      if (newIp <= ip - 3) {
+        poll(t, frame);
+      }
+
+      c->jmp(frame->machineIp(newIp));
+      ip = newIp;
+    } break;
+
+    case goto_w: {
+      uint32_t offset = codeReadInt32(t, code, ip);
+      uint32_t newIp = (ip - 5) + offset;
+      assert(t, newIp < codeLength(t, code));
+
+      if (newIp <= ip - 5) {
+        poll(t, frame);
+      }
+
+      c->jmp(frame->machineIp(newIp));
+      ip = newIp;
+    } break;
+
+    case i2b: {
+      frame->pushInt
+        (c->load(TargetBytesPerWord, 1, frame->popInt(), TargetBytesPerWord));
+    } break;
+
+    case i2c: {
+      frame->pushInt
+        (c->loadz(TargetBytesPerWord, 2, frame->popInt(), TargetBytesPerWord));
+    } break;
+
+    case i2d: {
+      frame->pushLong(c->i2f(4, 8, frame->popInt()));
+    } break;
+
+    case i2f: {
+      frame->pushInt(c->i2f(4, 4, frame->popInt()));
+    } break;
+
+    case i2l:
+      frame->pushLong(c->load(TargetBytesPerWord, 4, frame->popInt(), 8));
+      break;
+
+    case i2s: {
+      frame->pushInt
+        (c->load(TargetBytesPerWord, 2, frame->popInt(), TargetBytesPerWord));
+    } break;
+      
+    case iadd: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+      frame->pushInt(c->add(4, a, b));
+    } break;
+      
+    case iand: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+      frame->pushInt(c->and_(4, a, b));
+    } break;
+
+    case iconst_m1:
+      frame->pushInt(c->constant(-1, Compiler::IntegerType));
+      break;
+
+    case iconst_0:
       frame->pushInt(c->constant(0, Compiler::IntegerType));
       break;
 
-    case iconst_1:
-      frame->pushInt(c->constant(1, Compiler::IntegerType));
+    case iconst_1:
+      frame->pushInt(c->constant(1, Compiler::IntegerType));
+      break;
+
+    case iconst_2:
+      frame->pushInt(c->constant(2, Compiler::IntegerType));
+      break;
+
+    case iconst_3:
+      frame->pushInt(c->constant(3, Compiler::IntegerType));
+      break;
+
+    case iconst_4:
+      frame->pushInt(c->constant(4, Compiler::IntegerType));
+      break;
+
+    case iconst_5:
+      frame->pushInt(c->constant(5, Compiler::IntegerType));
+      break;
+
+    case idiv: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+
+      if (inTryBlock(t, code, ip - 1)) {
+        c->saveLocals();
+        frame->trace(0, 0);
+      }
+
+      frame->pushInt(c->div(4, a, b));
+    } break;
+
+    case if_acmpeq:
+    case if_acmpne: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      newIp = (ip - 3) + offset;
+      assert(t, newIp < codeLength(t, code));
+
+      if (newIp <= ip - 3) {
+        poll(t, frame);
+      }
+        
+      Compiler::Operand* a = frame->popObject();
+      Compiler::Operand* b = frame->popObject();
+      Compiler::Operand* target = frame->machineIp(newIp);
+
+      if (instruction == if_acmpeq) {
+        c->jumpIfEqual(TargetBytesPerWord, a, b, target);
+      } else {
+        c->jumpIfNotEqual(TargetBytesPerWord, a, b, target);
+      }
+    } goto branch;
+
+    case if_icmpeq:
+    case if_icmpne:
+    case if_icmpgt:
+    case if_icmpge:
+    case if_icmplt:
+    case if_icmple: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      newIp = (ip - 3) + offset;
+      assert(t, newIp < codeLength(t, code));
+
+      if (newIp <= ip - 3) {
+        poll(t, frame);
+      }
+        
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+      Compiler::Operand* target = frame->machineIp(newIp);
+
+      switch (instruction) {
+      case if_icmpeq:
+        c->jumpIfEqual(4, a, b, target);
+        break;
+      case if_icmpne:
+        c->jumpIfNotEqual(4, a, b, target);
+        break;
+      case if_icmpgt:
+        c->jumpIfGreater(4, a, b, target);
+        break;
+      case if_icmpge:
+        c->jumpIfGreaterOrEqual(4, a, b, target);
+        break;
+      case if_icmplt:
+        c->jumpIfLess(4, a, b, target);
+        break;
+      case if_icmple:
+        c->jumpIfLessOrEqual(4, a, b, target);
+        break;
+      default:
+        abort(t);
+      }
+    } goto branch;
+
+    case ifeq:
+    case ifne:
+    case ifgt:
+    case ifge:
+    case iflt:
+    case ifle: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      newIp = (ip - 3) + offset;
+      assert(t, newIp < codeLength(t, code));
+
+      if (newIp <= ip - 3) {
+        poll(t, frame);
+      }
+
+      Compiler::Operand* target = frame->machineIp(newIp);
+
+      Compiler::Operand* a = c->constant(0, Compiler::IntegerType);
+      Compiler::Operand* b = frame->popInt();
+
+      switch (instruction) {
+      case ifeq:
+        c->jumpIfEqual(4, a, b, target);
+        break;
+      case ifne:
+        c->jumpIfNotEqual(4, a, b, target);
+        break;
+      case ifgt:
+        c->jumpIfGreater(4, a, b, target);
+        break;
+      case ifge:
+        c->jumpIfGreaterOrEqual(4, a, b, target);
+        break;
+      case iflt:
+        c->jumpIfLess(4, a, b, target);
+        break;
+      case ifle:
+        c->jumpIfLessOrEqual(4, a, b, target);
+        break;
+      default:
+        abort(t);
+      }
+    } goto branch;
+
+    case ifnull:
+    case ifnonnull: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      newIp = (ip - 3) + offset;
+      assert(t, newIp < codeLength(t, code));
+
+      if (newIp <= ip - 3) {
+        poll(t, frame);
+      }
+
+      Compiler::Operand* a = c->constant(0, Compiler::ObjectType);
+      Compiler::Operand* b = frame->popObject();
+      Compiler::Operand* target = frame->machineIp(newIp);
+
+      if (instruction == ifnull) {
+        c->jumpIfEqual(TargetBytesPerWord, a, b, target);
+      } else {
+        c->jumpIfNotEqual(TargetBytesPerWord, a, b, target);
+      }
+    } goto branch;
+
+    case iinc: {
+      uint8_t index = codeBody(t, code, ip++);
+      int8_t count = codeBody(t, code, ip++);
+
+      storeLocal
+        (context, 1,
+         c->add
+         (4, c->constant(count, Compiler::IntegerType),
+          loadLocal(context, 1, index)),
+         index);
+    } break;
+
+    case iload:
+    case fload:
+      frame->loadInt(codeBody(t, code, ip++));
+      break;
+
+    case iload_0:
+    case fload_0:
+      frame->loadInt(0);
+      break;
+
+    case iload_1:
+    case fload_1:
+      frame->loadInt(1);
+      break;
+
+    case iload_2:
+    case fload_2:
+      frame->loadInt(2);
+      break;
+
+    case iload_3:
+    case fload_3:
+      frame->loadInt(3);
       break;
 
-    case iconst_2:
-      frame->pushInt(c->constant(2, Compiler::IntegerType));
-      break;
+    case imul: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+      frame->pushInt(c->mul(4, a, b));
+    } break;
+
+    case ineg: {
+      frame->pushInt(c->neg(4, frame->popInt()));
+    } break;
+
+    case instanceof: {
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
+
+      PROTECT(t, reference);
+
+      object class_ = resolveClassInPool(t, context->method, index - 1, false);
+
+      Compiler::Operand* instance = frame->popObject();
+
+      object argument;
+      Thunk thunk;
+      if (LIKELY(class_)) {
+        argument = class_;
+        thunk = instanceOf64Thunk;
+      } else {
+        argument = makePair(t, context->method, reference);
+        thunk = instanceOfFromReferenceThunk;
+      }
+
+      frame->pushInt
+        (c->call
+         (c->constant(getThunk(t, thunk), Compiler::AddressType),
+          0, frame->trace(0, 0), 4, Compiler::IntegerType,
+          3, c->register_(t->arch->thread()), frame->append(argument),
+          instance));
+    } break;
+
+    case invokeinterface: {
+      context->leaf = false;
+
+      uint16_t index = codeReadInt16(t, code, ip);
+      ip += 2;
+
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
+
+      PROTECT(t, reference);
+
+      object target = resolveMethod(t, context->method, index - 1, false);
+
+      object argument;
+      Thunk thunk;
+      unsigned parameterFootprint;
+      int returnCode;
+      bool tailCall;
+      if (LIKELY(target)) {
+        checkMethod(t, target, false);
+
+        argument = target;
+        thunk = findInterfaceMethodFromInstanceThunk;
+        parameterFootprint = methodParameterFootprint(t, target);
+        returnCode = methodReturnCode(t, target);
+        tailCall = isTailCall(t, code, ip, context->method, target);
+      } else {
+        argument = makePair(t, context->method, reference);
+        thunk = findInterfaceMethodFromInstanceAndReferenceThunk;
+        parameterFootprint = methodReferenceParameterFootprint
+          (t, reference, false);
+        returnCode = methodReferenceReturnCode(t, reference);
+        tailCall = isReferenceTailCall
+          (t, code, ip, context->method, reference);
+      }
+
+      unsigned rSize = resultSize(t, returnCode);
+
+      Compiler::Operand* result;
+      if (LIKELY(target)
+          and context->bootContext == 0
+          and (not tailCall)
+          and (not useLongJump(t, defaultInterfaceThunk(t))))
+      {
+        // call through defaultInterfaceThunk, which will patch this
+        // call site to point to an inline cache stub specialized for
+        // the receiver classes seen here (see compileInterfaceMethod):
+        result = c->stackCall
+          (c->constant(defaultInterfaceThunk(t), Compiler::AddressType),
+           Compiler::Aligned,
+           frame->trace(target, TraceElement::VirtualCall),
+           rSize,
+           operandTypeForFieldCode(t, returnCode),
+           parameterFootprint);
+      } else {
+        result = c->stackCall
+          (c->call
+           (c->constant(getThunk(t, thunk), Compiler::AddressType),
+            0,
+            frame->trace(0, 0),
+            TargetBytesPerWord,
+            Compiler::AddressType,
+            3, c->register_(t->arch->thread()), frame->append(argument),
+            c->peek(1, parameterFootprint - 1)),
+           tailCall ? Compiler::TailJump : 0,
+           frame->trace(0, 0),
+           rSize,
+           operandTypeForFieldCode(t, returnCode),
+           parameterFootprint);
+      }
+
+      frame->pop(parameterFootprint);
+
+      if (rSize) {
+        pushReturnValue(t, frame, returnCode, result);
+      }
+    } break;
+
+    case invokespecial: {
+      context->leaf = false;
+
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
+
+      PROTECT(t, reference);
+
+      object target = resolveMethod(t, context->method, index - 1, false);
+
+      if (LIKELY(target)) {
+        object class_ = methodClass(t, context->method);
+        if (isSpecialMethod(t, target, class_)) {
+          target = findVirtualMethod(t, target, classSuper(t, class_));
+        }
+
+        checkMethod(t, target, false);
+
+        if (not inlineInvoke
+            (t, frame, target, instruction, inTryBlock(t, code, ip - 3)))
+        {
+          bool tailCall = isTailCall(t, code, ip, context->method, target);
+
+          if (UNLIKELY(methodAbstract(t, target))) {
+            compileDirectAbstractInvoke
+              (t, frame, getMethodAddressThunk, target, tailCall);
+          } else {
+            compileDirectInvoke(t, frame, target, tailCall);
+          }
+        }
+      } else {
+        compileDirectReferenceInvoke
+          (t, frame, findSpecialMethodFromReferenceThunk, reference, false,
+           isReferenceTailCall(t, code, ip, context->method, reference));
+      }
+    } break;
+
+    case invokestatic: {
+      context->leaf = false;
+
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
+
+      PROTECT(t, reference);
+
+      object target = resolveMethod(t, context->method, index - 1, false);
+
+      if (LIKELY(target)) {
+        // intrinsic may allocate
+        PROTECT(t, target);
+
+        checkMethod(t, target, true);
+
+        if (not (intrinsic(t, frame, target)
+                 or inlineInvoke
+                 (t, frame, target, instruction,
+                  inTryBlock(t, code, ip - 3))))
+        {
+          bool tailCall = isTailCall(t, code, ip, context->method, target);
+          compileDirectInvoke(t, frame, target, tailCall);
+        }
+      } else {
+        compileDirectReferenceInvoke
+          (t, frame, findStaticMethodFromReferenceThunk, reference, true,
+           isReferenceTailCall(t, code, ip, context->method, reference));
+      }
+    } break;
+
+    case invokevirtual: {
+      context->leaf = false;
+
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
+
+      PROTECT(t, reference);
+
+      object target = resolveMethod(t, context->method, index - 1, false);
+
+      if (LIKELY(target)) {
+        // intrinsic may allocate
+        PROTECT(t, target);
+
+        checkMethod(t, target, false);
+         
+        if (not (intrinsic(t, frame, target)
+                 or inlineInvoke
+                 (t, frame, target, instruction,
+                  inTryBlock(t, code, ip - 3))))
+        {
+          bool tailCall = isTailCall(t, code, ip, context->method, target);
+
+          if (LIKELY(methodVirtual(t, target))) {
+            unsigned parameterFootprint = methodParameterFootprint(t, target);
+
+            unsigned offset = TargetClassVtable
+              + (methodOffset(t, target) * TargetBytesPerWord);
+
+            Compiler::Operand* instance = c->peek(1, parameterFootprint - 1);
+
+            unsigned rSize = resultSize(t, methodReturnCode(t, target));
+
+            Compiler::Operand* result = c->stackCall
+              (c->memory
+               (c->and_
+                (TargetBytesPerWord, c->constant
+                 (TargetPointerMask, Compiler::IntegerType),
+                 c->memory(instance, Compiler::ObjectType, 0, 0, 1)),
+                Compiler::ObjectType, offset, 0, 1),
+               tailCall ? Compiler::TailJump : 0,
+               frame->trace(0, 0),
+               rSize,
+               operandTypeForFieldCode(t, methodReturnCode(t, target)),
+               parameterFootprint);
+
+            frame->pop(parameterFootprint);
+
+            if (rSize) {
+              pushReturnValue(t, frame, methodReturnCode(t, target), result);
+            }
+          } else {
+            // OpenJDK generates invokevirtual calls to private methods
+            // (e.g. readObject and writeObject for serialization), so
+            // we must handle such cases here.
 
-    case iconst_3:
-      frame->pushInt(c->constant(3, Compiler::IntegerType));
-      break;
+            compileDirectInvoke(t, frame, target, tailCall);          
+          }
+        }
+      } else {
+        PROTECT(t, reference);
 
-    case iconst_4:
-      frame->pushInt(c->constant(4, Compiler::IntegerType));
-      break;
+        object pair = makePair(t, context->method, reference);
 
-    case iconst_5:
-      frame->pushInt(c->constant(5, Compiler::IntegerType));
-      break;
+        compileReferenceInvoke
+          (t, frame, c->call
+           (c->constant(getThunk(t, findVirtualMethodFromReferenceThunk),
+                        Compiler::AddressType),
+            0,
+            frame->trace(0, 0),
+            TargetBytesPerWord,
+            Compiler::AddressType,
+            3, c->register_(t->arch->thread()), frame->append(pair),
+            c->peek(1, methodReferenceParameterFootprint
+                    (t, reference, false) - 1)),
+           reference, false, isReferenceTailCall
+           (t, code, ip, context->method, reference));
+      }
+    } break;
 
-    case idiv: {
+    case ior: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+      frame->pushInt(c->or_(4, a, b));
+    } break;
+
+    case irem: {
       Compiler::Operand* a = frame->popInt();
       Compiler::Operand* b = frame->popInt();
 
@@ -4991,2406 +7503,3103 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         frame->trace(0, 0);
       }
 
-      frame->pushInt(c->div(4, a, b));
+      frame->pushInt(c->rem(4, a, b));
     } break;
 
-    case if_acmpeq:
-    case if_acmpne: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      newIp = (ip - 3) + offset;
-      assert(t, newIp < codeLength(t, code));
-        
-      Compiler::Operand* a = frame->popObject();
-      Compiler::Operand* b = frame->popObject();
-      Compiler::Operand* target = frame->machineIp(newIp);
-
-      if (instruction == if_acmpeq) {
-        c->jumpIfEqual(TargetBytesPerWord, a, b, target);
-      } else {
-        c->jumpIfNotEqual(TargetBytesPerWord, a, b, target);
-      }
-    } goto branch;
+    case ireturn:
+    case freturn: {
+      poll(t, frame);
+      handleExit(t, frame);
+      c->return_(4, frame->popInt());
+    } goto next;
 
-    case if_icmpeq:
-    case if_icmpne:
-    case if_icmpgt:
-    case if_icmpge:
-    case if_icmplt:
-    case if_icmple: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      newIp = (ip - 3) + offset;
-      assert(t, newIp < codeLength(t, code));
-        
+    case ishl: {
       Compiler::Operand* a = frame->popInt();
       Compiler::Operand* b = frame->popInt();
-      Compiler::Operand* target = frame->machineIp(newIp);
-
-      switch (instruction) {
-      case if_icmpeq:
-        c->jumpIfEqual(4, a, b, target);
-        break;
-      case if_icmpne:
-        c->jumpIfNotEqual(4, a, b, target);
-        break;
-      case if_icmpgt:
-        c->jumpIfGreater(4, a, b, target);
-        break;
-      case if_icmpge:
-        c->jumpIfGreaterOrEqual(4, a, b, target);
-        break;
-      case if_icmplt:
-        c->jumpIfLess(4, a, b, target);
-        break;
-      case if_icmple:
-        c->jumpIfLessOrEqual(4, a, b, target);
-        break;
-      default:
-        abort(t);
-      }
-    } goto branch;
-
-    case ifeq:
-    case ifne:
-    case ifgt:
-    case ifge:
-    case iflt:
-    case ifle: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      newIp = (ip - 3) + offset;
-      assert(t, newIp < codeLength(t, code));
-
-      Compiler::Operand* target = frame->machineIp(newIp);
+      frame->pushInt(c->shl(4, a, b));
+    } break;
 
-      Compiler::Operand* a = c->constant(0, Compiler::IntegerType);
+    case ishr: {
+      Compiler::Operand* a = frame->popInt();
       Compiler::Operand* b = frame->popInt();
-
-      switch (instruction) {
-      case ifeq:
-        c->jumpIfEqual(4, a, b, target);
-        break;
-      case ifne:
-        c->jumpIfNotEqual(4, a, b, target);
-        break;
-      case ifgt:
-        c->jumpIfGreater(4, a, b, target);
-        break;
-      case ifge:
-        c->jumpIfGreaterOrEqual(4, a, b, target);
-        break;
-      case iflt:
-        c->jumpIfLess(4, a, b, target);
-        break;
-      case ifle:
-        c->jumpIfLessOrEqual(4, a, b, target);
-        break;
-      default:
-        abort(t);
-      }
-    } goto branch;
-
-    case ifnull:
-    case ifnonnull: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      newIp = (ip - 3) + offset;
-      assert(t, newIp < codeLength(t, code));
-
-      Compiler::Operand* a = c->constant(0, Compiler::ObjectType);
-      Compiler::Operand* b = frame->popObject();
-      Compiler::Operand* target = frame->machineIp(newIp);
-
-      if (instruction == ifnull) {
-        c->jumpIfEqual(TargetBytesPerWord, a, b, target);
-      } else {
-        c->jumpIfNotEqual(TargetBytesPerWord, a, b, target);
-      }
-    } goto branch;
-
-    case iinc: {
-      uint8_t index = codeBody(t, code, ip++);
-      int8_t count = codeBody(t, code, ip++);
-
-      storeLocal
-        (context, 1,
-         c->add
-         (4, c->constant(count, Compiler::IntegerType),
-          loadLocal(context, 1, index)),
-         index);
+      frame->pushInt(c->shr(4, a, b));
     } break;
 
-    case iload:
-    case fload:
-      frame->loadInt(codeBody(t, code, ip++));
+    case istore:
+    case fstore:
+      frame->storeInt(codeBody(t, code, ip++));
       break;
 
-    case iload_0:
-    case fload_0:
-      frame->loadInt(0);
+    case istore_0:
+    case fstore_0:
+      frame->storeInt(0);
       break;
 
-    case iload_1:
-    case fload_1:
-      frame->loadInt(1);
+    case istore_1:
+    case fstore_1:
+      frame->storeInt(1);
       break;
 
-    case iload_2:
-    case fload_2:
-      frame->loadInt(2);
+    case istore_2:
+    case fstore_2:
+      frame->storeInt(2);
       break;
 
-    case iload_3:
-    case fload_3:
-      frame->loadInt(3);
+    case istore_3:
+    case fstore_3:
+      frame->storeInt(3);
       break;
 
-    case imul: {
+    case isub: {
       Compiler::Operand* a = frame->popInt();
       Compiler::Operand* b = frame->popInt();
-      frame->pushInt(c->mul(4, a, b));
+      frame->pushInt(c->sub(4, a, b));
     } break;
 
-    case ineg: {
-      frame->pushInt(c->neg(4, frame->popInt()));
+    case iushr: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+      frame->pushInt(c->ushr(4, a, b));
     } break;
 
-    case instanceof: {
-      uint16_t index = codeReadInt16(t, code, ip);
+    case ixor: {
+      Compiler::Operand* a = frame->popInt();
+      Compiler::Operand* b = frame->popInt();
+      frame->pushInt(c->xor_(4, a, b));
+    } break;
 
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
+    case jsr:
+    case jsr_w: {
+      uint32_t thisIp;
 
-      PROTECT(t, reference);
+      if (instruction == jsr) {
+        uint32_t offset = codeReadInt16(t, code, ip);
+        thisIp = ip - 3;
+        newIp = thisIp + offset;
+      } else {
+        uint32_t offset = codeReadInt32(t, code, ip);
+        thisIp = ip - 5;
+        newIp = thisIp + offset;
+      }
 
-      object class_ = resolveClassInPool(t, context->method, index - 1, false);
+      assert(t, newIp < codeLength(t, code));
 
-      Compiler::Operand* instance = frame->popObject();
+      unsigned start = frame->startSubroutine(newIp, c->machineIp(ip));
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        thunk = instanceOf64Thunk;
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = instanceOfFromReferenceThunk;
-      }
+      c->jmp(frame->machineIp(newIp));
+
+      stack.pushValue(start);
+      stack.pushValue(ip);
+      stack.pushValue(Unsubroutine);
+      ip = newIp;
+    } goto start;
 
-      frame->pushInt
-        (c->call
-         (c->constant(getThunk(t, thunk), Compiler::AddressType),
-          0, frame->trace(0, 0), 4, Compiler::IntegerType,
-          3, c->register_(t->arch->thread()), frame->append(argument),
-          instance));
+    case l2d: {
+      frame->pushLong(c->i2f(8, 8, frame->popLong()));
     } break;
 
-    case invokeinterface: {
-      context->leaf = false;
+    case l2f: {
+      frame->pushInt(c->i2f(8, 4, frame->popLong()));
+    } break;
 
-      uint16_t index = codeReadInt16(t, code, ip);
-      ip += 2;
+    case l2i:
+      frame->pushInt(c->load(8, 8, frame->popLong(), TargetBytesPerWord));
+      break;
 
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
+    case ladd: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+      frame->pushLong(c->add(8, a, b));
+    } break;
 
-      PROTECT(t, reference);
+    case land: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+      frame->pushLong(c->and_(8, a, b));
+    } break;
 
-      object target = resolveMethod(t, context->method, index - 1, false);
+    case lcmp: {
+      pollIfBackward(t, frame, code, ip);
 
-      object argument;
-      Thunk thunk;
-      unsigned parameterFootprint;
-      int returnCode;
-      bool tailCall;
-      if (LIKELY(target)) {
-        checkMethod(t, target, false);
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
 
-        argument = target;
-        thunk = findInterfaceMethodFromInstanceThunk;
-        parameterFootprint = methodParameterFootprint(t, target);
-        returnCode = methodReturnCode(t, target);
-        tailCall = isTailCall(t, code, ip, context->method, target);
+      if (integerBranch(t, frame, code, ip, 8, a, b, &newIp)) {
+        goto branch;
       } else {
-        argument = makePair(t, context->method, reference);
-        thunk = findInterfaceMethodFromInstanceAndReferenceThunk;
-        parameterFootprint = methodReferenceParameterFootprint
-          (t, reference, false);
-        returnCode = methodReferenceReturnCode(t, reference);
-        tailCall = isReferenceTailCall
-          (t, code, ip, context->method, reference);
+        frame->pushInt
+          (c->call
+           (c->constant
+            (getThunk(t, compareLongsThunk), Compiler::AddressType),
+            0, 0, 4, Compiler::IntegerType, 4,
+            static_cast<Compiler::Operand*>(0), a,
+            static_cast<Compiler::Operand*>(0), b));
       }
+    } break;
 
-      unsigned rSize = resultSize(t, returnCode);
+    case lconst_0:
+      frame->pushLong(c->constant(0, Compiler::IntegerType));
+      break;
 
-      Compiler::Operand* result = c->stackCall
-        (c->call
-         (c->constant(getThunk(t, thunk), Compiler::AddressType),
-          0,
-          frame->trace(0, 0),
-          TargetBytesPerWord,
-          Compiler::AddressType,
-          3, c->register_(t->arch->thread()), frame->append(argument),
-          c->peek(1, parameterFootprint - 1)),
-         tailCall ? Compiler::TailJump : 0,
-         frame->trace(0, 0),
-         rSize,
-         operandTypeForFieldCode(t, returnCode),
-         parameterFootprint);
+    case lconst_1:
+      frame->pushLong(c->constant(1, Compiler::IntegerType));
+      break;
 
-      frame->pop(parameterFootprint);
+    case ldc:
+    case ldc_w: {
+      uint16_t index;
 
-      if (rSize) {
-        pushReturnValue(t, frame, returnCode, result);
+      if (instruction == ldc) {
+        index = codeBody(t, code, ip++);
+      } else {
+        index = codeReadInt16(t, code, ip);
       }
-    } break;
 
-    case invokespecial: {
-      context->leaf = false;
+      object pool = codePool(t, code);
 
-      uint16_t index = codeReadInt16(t, code, ip);
+      if (singletonIsObject(t, pool, index - 1)) {
+        object v = singletonObject(t, pool, index - 1);
 
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
+        loadMemoryBarrier();  
 
-      PROTECT(t, reference);
+        if (objectClass(t, v) == type(t, Machine::ReferenceType)) {
+          object reference = v;
+          PROTECT(t, reference);
 
-      object target = resolveMethod(t, context->method, index - 1, false);
+          v = resolveClassInPool(t, context->method, index - 1, false);
 
-      if (LIKELY(target)) {
-        object class_ = methodClass(t, context->method);
-        if (isSpecialMethod(t, target, class_)) {
-          target = findVirtualMethod(t, target, classSuper(t, class_));
+          if (UNLIKELY(v == 0)) {
+            frame->pushObject
+              (c->call
+               (c->constant
+                (getThunk(t, getJClassFromReferenceThunk),
+                 Compiler::AddressType),
+                0,
+                frame->trace(0, 0),
+                TargetBytesPerWord,
+                Compiler::ObjectType,
+                2, c->register_(t->arch->thread()),
+                frame->append(makePair(t, context->method, reference))));
+          }
         }
 
-        checkMethod(t, target, false);
-
-        bool tailCall = isTailCall(t, code, ip, context->method, target);
-
-        if (UNLIKELY(methodAbstract(t, target))) {
-          compileDirectAbstractInvoke
-            (t, frame, getMethodAddressThunk, target, tailCall);
-        } else {
-          compileDirectInvoke(t, frame, target, tailCall);
+        if (v) {
+          if (objectClass(t, v) == type(t, Machine::ClassType)) {
+            frame->pushObject
+              (c->call
+               (c->constant
+                (getThunk(t, getJClass64Thunk), Compiler::AddressType),
+                0,
+                frame->trace(0, 0),
+                TargetBytesPerWord,
+                Compiler::ObjectType,
+                2, c->register_(t->arch->thread()), frame->append(v)));
+          } else {
+            frame->pushObject(frame->append(v));
+          }
         }
       } else {
-        compileDirectReferenceInvoke
-          (t, frame, findSpecialMethodFromReferenceThunk, reference, false,
-           isReferenceTailCall(t, code, ip, context->method, reference));
+        frame->pushInt
+          (c->constant
+           (singletonValue(t, pool, index - 1),
+            singletonBit(t, pool, poolSize(t, pool), index - 1)
+            ? Compiler::FloatType : Compiler::IntegerType));
       }
     } break;
 
-    case invokestatic: {
-      context->leaf = false;
-
+    case ldc2_w: {
       uint16_t index = codeReadInt16(t, code, ip);
 
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
-
-      PROTECT(t, reference);
+      object pool = codePool(t, code);
 
-      object target = resolveMethod(t, context->method, index - 1, false);
+      uint64_t v;
+      memcpy(&v, &singletonValue(t, pool, index - 1), 8);
+      frame->pushLong
+        (c->constant
+         (v, singletonBit(t, pool, poolSize(t, pool), index - 1)
+          ? Compiler::FloatType : Compiler::IntegerType));
+    } break;
 
-      if (LIKELY(target)) {
-        checkMethod(t, target, true);
+    case ldiv_: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
 
-        if (not intrinsic(t, frame, target)) {
-          bool tailCall = isTailCall(t, code, ip, context->method, target);
-          compileDirectInvoke(t, frame, target, tailCall);
-        }
-      } else {
-        compileDirectReferenceInvoke
-          (t, frame, findStaticMethodFromReferenceThunk, reference, true,
-           isReferenceTailCall(t, code, ip, context->method, reference));
+      if (inTryBlock(t, code, ip - 1)) {
+        c->saveLocals();
+        frame->trace(0, 0);
       }
+
+      frame->pushLong(c->div(8, a, b));
     } break;
 
-    case invokevirtual: {
-      context->leaf = false;
+    case lload:
+    case dload:
+      frame->loadLong(codeBody(t, code, ip++));
+      break;
 
-      uint16_t index = codeReadInt16(t, code, ip);
+    case lload_0:
+    case dload_0:
+      frame->loadLong(0);
+      break;
 
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
+    case lload_1:
+    case dload_1:
+      frame->loadLong(1);
+      break;
 
-      PROTECT(t, reference);
+    case lload_2:
+    case dload_2:
+      frame->loadLong(2);
+      break;
 
-      object target = resolveMethod(t, context->method, index - 1, false);
+    case lload_3:
+    case dload_3:
+      frame->loadLong(3);
+      break;
 
-      if (LIKELY(target)) {
-        checkMethod(t, target, false);
-         
-        if (not intrinsic(t, frame, target)) {
-          bool tailCall = isTailCall(t, code, ip, context->method, target);
+    case lmul: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+      frame->pushLong(c->mul(8, a, b));
+    } break;
 
-          if (LIKELY(methodVirtual(t, target))) {
-            unsigned parameterFootprint = methodParameterFootprint(t, target);
+    case lneg:
+      frame->pushLong(c->neg(8, frame->popLong()));
+      break;
 
-            unsigned offset = TargetClassVtable
-              + (methodOffset(t, target) * TargetBytesPerWord);
+    case lookupswitch: {
+      int32_t base = ip - 1;
 
-            Compiler::Operand* instance = c->peek(1, parameterFootprint - 1);
+      ip = (ip + 3) & ~3; // pad to four byte boundary
 
-            unsigned rSize = resultSize(t, methodReturnCode(t, target));
+      Compiler::Operand* key = frame->popInt();
+    
+      uint32_t defaultIp = base + codeReadInt32(t, code, ip);
+      assert(t, defaultIp < codeLength(t, code));
 
-            Compiler::Operand* result = c->stackCall
-              (c->memory
-               (c->and_
-                (TargetBytesPerWord, c->constant
-                 (TargetPointerMask, Compiler::IntegerType),
-                 c->memory(instance, Compiler::ObjectType, 0, 0, 1)),
-                Compiler::ObjectType, offset, 0, 1),
-               tailCall ? Compiler::TailJump : 0,
-               frame->trace(0, 0),
-               rSize,
-               operandTypeForFieldCode(t, methodReturnCode(t, target)),
-               parameterFootprint);
+      int32_t pairCount = codeReadInt32(t, code, ip);
+
+      if (pairCount) {
+        Compiler::Operand* default_ = frame->addressOperand
+          (frame->addressPromise(c->machineIp(defaultIp)));
 
-            frame->pop(parameterFootprint);
+        Promise* start = 0;
+        uint32_t* ipTable = static_cast<uint32_t*>
+          (stack.push(sizeof(uint32_t) * pairCount));
+        for (int32_t i = 0; i < pairCount; ++i) {
+          unsigned index = ip + (i * 8);
+          int32_t key = codeReadInt32(t, code, index);
+          uint32_t newIp = base + codeReadInt32(t, code, index);
+          assert(t, newIp < codeLength(t, code));
 
-            if (rSize) {
-              pushReturnValue(t, frame, methodReturnCode(t, target), result);
-            }
-          } else {
-            // OpenJDK generates invokevirtual calls to private methods
-            // (e.g. readObject and writeObject for serialization), so
-            // we must handle such cases here.
+          ipTable[i] = newIp;
 
-            compileDirectInvoke(t, frame, target, tailCall);          
+          Promise* p = c->poolAppend(key);
+          if (i == 0) {
+            start = p;
           }
+          c->poolAppendPromise
+            (frame->addressPromise(c->machineIp(newIp)));
         }
-      } else {
-        PROTECT(t, reference);
+        assert(t, start);
 
-        object pair = makePair(t, context->method, reference);
+        Compiler::Operand* address = c->call
+          (c->constant(getThunk(t, lookUpAddressThunk), Compiler::AddressType),
+           0, 0, TargetBytesPerWord, Compiler::AddressType,
+           4, key, frame->absoluteAddressOperand(start),
+           c->constant(pairCount, Compiler::IntegerType), default_);
 
-        compileReferenceInvoke
-          (t, frame, c->call
-           (c->constant(getThunk(t, findVirtualMethodFromReferenceThunk),
-                        Compiler::AddressType),
-            0,
-            frame->trace(0, 0),
-            TargetBytesPerWord,
-            Compiler::AddressType,
-            3, c->register_(t->arch->thread()), frame->append(pair),
-            c->peek(1, methodReferenceParameterFootprint
-                    (t, reference, false) - 1)),
-           reference, false, isReferenceTailCall
-           (t, code, ip, context->method, reference));
+        c->jmp
+          (context->bootContext ? c->add
+           (TargetBytesPerWord, c->memory
+            (c->register_(t->arch->thread()), Compiler::AddressType,
+             TARGET_THREAD_CODEIMAGE), address)
+           : address);
+
+        new (stack.push(sizeof(SwitchState))) SwitchState
+          (c->saveState(), pairCount, defaultIp, 0, 0, 0, 0);
+
+        goto switchloop;
+      } else {
+        // a switch statement with no cases, apparently
+        c->jmp(frame->machineIp(defaultIp));
+        ip = defaultIp;
       }
     } break;
 
-    case ior: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-      frame->pushInt(c->or_(4, a, b));
+    case lor: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+      frame->pushLong(c->or_(8, a, b));
     } break;
 
-    case irem: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
+    case lrem: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
 
       if (inTryBlock(t, code, ip - 1)) {
         c->saveLocals();
         frame->trace(0, 0);
       }
 
-      frame->pushInt(c->rem(4, a, b));
+      frame->pushLong(c->rem(8, a, b));
     } break;
 
-    case ireturn:
-    case freturn: {
+    case lreturn:
+    case dreturn: {
+      poll(t, frame);
       handleExit(t, frame);
-      c->return_(4, frame->popInt());
+      c->return_(8, frame->popLong());
     } goto next;
 
-    case ishl: {
+    case lshl: {
       Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-      frame->pushInt(c->shl(4, a, b));
+      Compiler::Operand* b = frame->popLong();
+      frame->pushLong(c->shl(8, a, b));
     } break;
 
-    case ishr: {
+    case lshr: {
       Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-      frame->pushInt(c->shr(4, a, b));
+      Compiler::Operand* b = frame->popLong();
+      frame->pushLong(c->shr(8, a, b));
     } break;
 
-    case istore:
-    case fstore:
-      frame->storeInt(codeBody(t, code, ip++));
+    case lstore:
+    case dstore:
+      frame->storeLong(codeBody(t, code, ip++));
       break;
 
-    case istore_0:
-    case fstore_0:
-      frame->storeInt(0);
+    case lstore_0:
+    case dstore_0:
+      frame->storeLong(0);
       break;
 
-    case istore_1:
-    case fstore_1:
-      frame->storeInt(1);
+    case lstore_1:
+    case dstore_1:
+      frame->storeLong(1);
       break;
 
-    case istore_2:
-    case fstore_2:
-      frame->storeInt(2);
+    case lstore_2:
+    case dstore_2:
+      frame->storeLong(2);
       break;
 
-    case istore_3:
-    case fstore_3:
-      frame->storeInt(3);
+    case lstore_3:
+    case dstore_3:
+      frame->storeLong(3);
       break;
 
-    case isub: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-      frame->pushInt(c->sub(4, a, b));
+    case lsub: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+      frame->pushLong(c->sub(8, a, b));
     } break;
 
-    case iushr: {
+    case lushr: {
       Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-      frame->pushInt(c->ushr(4, a, b));
+      Compiler::Operand* b = frame->popLong();
+      frame->pushLong(c->ushr(8, a, b));
     } break;
 
-    case ixor: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popInt();
-      frame->pushInt(c->xor_(4, a, b));
+    case lxor: {
+      Compiler::Operand* a = frame->popLong();
+      Compiler::Operand* b = frame->popLong();
+      frame->pushLong(c->xor_(8, a, b));
     } break;
 
-    case jsr:
-    case jsr_w: {
-      uint32_t thisIp;
+    case monitorenter: {
+      Compiler::Operand* target = frame->popObject();
+      c->call
+        (c->constant
+         (getThunk(t, acquireMonitorForObjectThunk), Compiler::AddressType),
+         0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
+         c->register_(t->arch->thread()), target);
+    } break;
 
-      if (instruction == jsr) {
-        uint32_t offset = codeReadInt16(t, code, ip);
-        thisIp = ip - 3;
-        newIp = thisIp + offset;
-      } else {
-        uint32_t offset = codeReadInt32(t, code, ip);
-        thisIp = ip - 5;
-        newIp = thisIp + offset;
-      }
+    case monitorexit: {
+      Compiler::Operand* target = frame->popObject();
+      c->call
+        (c->constant
+         (getThunk(t, releaseMonitorForObjectThunk), Compiler::AddressType),
+         0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
+         c->register_(t->arch->thread()), target);
+    } break;
 
-      assert(t, newIp < codeLength(t, code));
+    case multianewarray: {
+      uint16_t index = codeReadInt16(t, code, ip);
+      uint8_t dimensions = codeBody(t, code, ip++);
 
-      unsigned start = frame->startSubroutine(newIp, c->machineIp(ip));
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
 
-      c->jmp(frame->machineIp(newIp));
+      PROTECT(t, reference);
 
-      stack.pushValue(start);
-      stack.pushValue(ip);
-      stack.pushValue(Unsubroutine);
-      ip = newIp;
-    } goto start;
+      object class_ = resolveClassInPool(t, context->method, index - 1, false);
 
-    case l2d: {
-      frame->pushLong(c->i2f(8, 8, frame->popLong()));
-    } break;
+      object argument;
+      Thunk thunk;
+      if (LIKELY(class_)) {
+        argument = class_;
+        thunk = makeMultidimensionalArrayThunk;
+      } else {
+        argument = makePair(t, context->method, reference);
+        thunk = makeMultidimensionalArrayFromReferenceThunk;
+      }
 
-    case l2f: {
-      frame->pushInt(c->i2f(8, 4, frame->popLong()));
-    } break;
+      unsigned offset
+        = localOffset
+        (t, localSize(t, context->method) + c->topOfStack(), context->method)
+        + t->arch->frameReturnAddressSize();
 
-    case l2i:
-      frame->pushInt(c->load(8, 8, frame->popLong(), TargetBytesPerWord));
-      break;
+      Compiler::Operand* result = c->call
+        (c->constant
+         (getThunk(t, thunk), Compiler::AddressType),
+         0,
+         frame->trace(0, 0),
+         TargetBytesPerWord,
+         Compiler::ObjectType,
+         4, c->register_(t->arch->thread()), frame->append(argument),
+         c->constant(dimensions, Compiler::IntegerType),
+         c->constant(offset, Compiler::IntegerType));
 
-    case ladd: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
-      frame->pushLong(c->add(8, a, b));
+      frame->pop(dimensions);
+      frame->pushObject(result);
     } break;
 
-    case land: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
-      frame->pushLong(c->and_(8, a, b));
+    case new_: {
+      uint16_t index = codeReadInt16(t, code, ip);
+        
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
+
+      PROTECT(t, reference);
+
+      object class_ = resolveClassInPool(t, context->method, index - 1, false);
+
+      object argument;
+      uintptr_t thunk;
+      if (LIKELY(class_)) {
+        argument = class_;
+        if (classVmFlags(t, class_) & (WeakReferenceFlag | HasFinalizerFlag)) {
+          thunk = getThunk(t, makeNewGeneral64Thunk);
+        } else {
+          thunk = allocateThunk(t);
+        }
+      } else {
+        argument = makePair(t, context->method, reference);
+        thunk = getThunk(t, makeNewFromReferenceThunk);
+      }
+
+      frame->pushObject
+        (c->call
+         (c->constant(thunk, Compiler::AddressType),
+          0,
+          frame->trace(0, 0),
+          TargetBytesPerWord,
+          Compiler::ObjectType,
+          2, c->register_(t->arch->thread()), frame->append(argument)));
     } break;
 
-    case lcmp: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+    case newarray: {
+      uint8_t type = codeBody(t, code, ip++);
 
-      if (integerBranch(t, frame, code, ip, 8, a, b, &newIp)) {
-        goto branch;
-      } else {
-        frame->pushInt
-          (c->call
-           (c->constant
-            (getThunk(t, compareLongsThunk), Compiler::AddressType),
-            0, 0, 4, Compiler::IntegerType, 4,
-            static_cast<Compiler::Operand*>(0), a,
-            static_cast<Compiler::Operand*>(0), b));
-      }
+      Compiler::Operand* length = frame->popInt();
+
+      frame->pushObject
+        (c->call
+         (c->constant(allocateArrayThunk(t), Compiler::AddressType),
+          0,
+          frame->trace(0, 0),
+          TargetBytesPerWord,
+          Compiler::ObjectType,
+          3, c->register_(t->arch->thread()),
+          frame->append(blankArrayClass(t, type)), length));
     } break;
 
-    case lconst_0:
-      frame->pushLong(c->constant(0, Compiler::IntegerType));
+    case nop: break;
+
+    case pop_:
+      frame->pop(1);
       break;
 
-    case lconst_1:
-      frame->pushLong(c->constant(1, Compiler::IntegerType));
+    case pop2:
+      frame->pop(2);
       break;
 
-    case ldc:
-    case ldc_w: {
-      uint16_t index;
+    case putfield:
+    case putstatic: {
+      uint16_t index = codeReadInt16(t, code, ip);
+    
+      object reference = singletonObject
+        (t, codePool(t, methodCode(t, context->method)), index - 1);
 
-      if (instruction == ldc) {
-        index = codeBody(t, code, ip++);
-      } else {
-        index = codeReadInt16(t, code, ip);
-      }
+      PROTECT(t, reference);
 
-      object pool = codePool(t, code);
+      object field = resolveField(t, context->method, index - 1, false);
 
-      if (singletonIsObject(t, pool, index - 1)) {
-        object v = singletonObject(t, pool, index - 1);
+      if (LIKELY(field)) {
+        int fieldCode = vm::fieldCode(t, field);
 
-        loadMemoryBarrier();  
+        object staticTable = 0;
 
-        if (objectClass(t, v) == type(t, Machine::ReferenceType)) {
-          object reference = v;
-          PROTECT(t, reference);
+        if (instruction == putstatic) {
+          checkField(t, field, true);
 
-          v = resolveClassInPool(t, context->method, index - 1, false);
+          if (fieldClass(t, field) != methodClass(t, context->method)
+              and classNeedsInit(t, fieldClass(t, field)))
+          {
+            PROTECT(t, field);
 
-          if (UNLIKELY(v == 0)) {
-            frame->pushObject
-              (c->call
-               (c->constant
-                (getThunk(t, getJClassFromReferenceThunk),
-                 Compiler::AddressType),
-                0,
-                frame->trace(0, 0),
-                TargetBytesPerWord,
-                Compiler::ObjectType,
-                2, c->register_(t->arch->thread()),
-                frame->append(makePair(t, context->method, reference))));
+            c->call
+              (c->constant
+               (getThunk(t, tryInitClassThunk), Compiler::AddressType),
+               0,
+               frame->trace(0, 0),
+               0,
+               Compiler::VoidType,
+               2, c->register_(t->arch->thread()),
+               frame->append(fieldClass(t, field)));
+          }
+
+          staticTable = classStaticTable(t, fieldClass(t, field));      
+        } else {
+          checkField(t, field, false);
+
+          if (inTryBlock(t, code, ip - 3)) {
+            c->saveLocals();
+            frame->trace(0, 0);
           }
         }
 
-        if (v) {
-          if (objectClass(t, v) == type(t, Machine::ClassType)) {
-            frame->pushObject
-              (c->call
-               (c->constant
-                (getThunk(t, getJClass64Thunk), Compiler::AddressType),
-                0,
-                frame->trace(0, 0),
-                TargetBytesPerWord,
-                Compiler::ObjectType,
-                2, c->register_(t->arch->thread()), frame->append(v)));
+        if (fieldFlags(t, field) & ACC_VOLATILE) {
+          if (TargetBytesPerWord == 4
+              and (fieldCode == DoubleField or fieldCode == LongField))
+          {
+            PROTECT(t, field);
+
+            c->call
+              (c->constant
+               (getThunk(t, acquireMonitorForObjectThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
+               c->register_(t->arch->thread()), frame->append(field));
           } else {
-            frame->pushObject(frame->append(v));
+            c->storeStoreBarrier();
+          }
+        }
+
+        Compiler::Operand* value = popField(t, frame, fieldCode);
+
+        Compiler::Operand* table;
+
+        if (instruction == putstatic) {
+          PROTECT(t, field);
+
+          table = frame->append(staticTable);
+        } else {
+          table = frame->popObject();
+        }
+
+        storeField(t, frame, table, field, value);
+
+        if (fieldFlags(t, field) & ACC_VOLATILE) {
+          if (TargetBytesPerWord == 4
+              and (fieldCode == DoubleField or fieldCode == LongField))
+          {
+            c->call
+              (c->constant
+               (getThunk(t, releaseMonitorForObjectThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
+               c->register_(t->arch->thread()), frame->append(field));
+          } else {
+            c->storeLoadBarrier();
           }
         }
       } else {
-        frame->pushInt
-          (c->constant
-           (singletonValue(t, pool, index - 1),
-            singletonBit(t, pool, poolSize(t, pool), index - 1)
-            ? Compiler::FloatType : Compiler::IntegerType));
-      }
-    } break;
+        int fieldCode = vm::fieldCode
+          (t, byteArrayBody(t, referenceSpec(t, reference), 0));
 
-    case ldc2_w: {
-      uint16_t index = codeReadInt16(t, code, ip);
+        Compiler::Operand* value = popField(t, frame, fieldCode);
+        unsigned rSize = resultSize(t, fieldCode);
+        Compiler::OperandType rType = operandTypeForFieldCode(t, fieldCode);
 
-      object pool = codePool(t, code);
+        object pair = makePair(t, context->method, reference);
 
-      uint64_t v;
-      memcpy(&v, &singletonValue(t, pool, index - 1), 8);
-      frame->pushLong
-        (c->constant
-         (v, singletonBit(t, pool, poolSize(t, pool), index - 1)
-          ? Compiler::FloatType : Compiler::IntegerType));
-    } break;
+        switch (fieldCode) {
+        case ByteField:
+        case BooleanField:
+        case CharField:
+        case ShortField:
+        case FloatField:
+        case IntField: {
+          if (instruction == putstatic) {
+            c->call
+              (c->constant
+               (getThunk(t, setStaticFieldValueFromReferenceThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), rSize, rType, 3,
+               c->register_(t->arch->thread()), frame->append(pair),
+               value);
+          } else {
+            Compiler::Operand* instance = frame->popObject();
 
-    case ldiv_: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+            c->call
+              (c->constant
+               (getThunk(t, setFieldValueFromReferenceThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), rSize, rType, 4,
+               c->register_(t->arch->thread()), frame->append(pair),
+               instance, value);
+          }
+        } break;
 
-      if (inTryBlock(t, code, ip - 1)) {
-        c->saveLocals();
-        frame->trace(0, 0);
+        case DoubleField:
+        case LongField: {
+          if (instruction == putstatic) {
+            c->call
+              (c->constant
+               (getThunk(t, setStaticLongFieldValueFromReferenceThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), rSize, rType, 4,
+               c->register_(t->arch->thread()), frame->append(pair),
+               static_cast<Compiler::Operand*>(0), value);
+          } else {
+            Compiler::Operand* instance = frame->popObject();
+
+            c->call
+              (c->constant
+               (getThunk(t, setLongFieldValueFromReferenceThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), rSize, rType, 5,
+               c->register_(t->arch->thread()), frame->append(pair),
+               instance, static_cast<Compiler::Operand*>(0), value);
+          }
+        } break;
+
+        case ObjectField: {
+          if (instruction == putstatic) {
+            c->call
+              (c->constant
+               (getThunk(t, setStaticObjectFieldValueFromReferenceThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), rSize, rType, 3,
+               c->register_(t->arch->thread()), frame->append(pair),
+               value);
+          } else {
+            Compiler::Operand* instance = frame->popObject();
+
+            c->call
+              (c->constant
+               (getThunk(t, setObjectFieldValueFromReferenceThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), rSize, rType, 4,
+               c->register_(t->arch->thread()), frame->append(pair),
+               instance, value);
+          }
+        } break;
+
+        default: abort(t);
+        }
       }
-
-      frame->pushLong(c->div(8, a, b));
     } break;
 
-    case lload:
-    case dload:
-      frame->loadLong(codeBody(t, code, ip++));
-      break;
-
-    case lload_0:
-    case dload_0:
-      frame->loadLong(0);
-      break;
+    case ret: {
+      unsigned index = codeBody(t, code, ip);
+      frame->returnFromSubroutine(index);
+    } goto next;
 
-    case lload_1:
-    case dload_1:
-      frame->loadLong(1);
-      break;
+    case return_:
+      if (needsReturnBarrier(t, context->method)) {
+        c->storeStoreBarrier();
+      }
 
-    case lload_2:
-    case dload_2:
-      frame->loadLong(2);
-      break;
+      poll(t, frame);
+      handleExit(t, frame);
+      c->return_(0, 0);
+      goto next;
 
-    case lload_3:
-    case dload_3:
-      frame->loadLong(3);
+    case sipush:
+      frame->pushInt
+        (c->constant
+         (static_cast<int16_t>(codeReadInt16(t, code, ip)),
+          Compiler::IntegerType));
       break;
 
-    case lmul: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
-      frame->pushLong(c->mul(8, a, b));
-    } break;
-
-    case lneg:
-      frame->pushLong(c->neg(8, frame->popLong()));
+    case swap:
+      frame->swap();
       break;
 
-    case lookupswitch: {
+    case tableswitch: {
       int32_t base = ip - 1;
 
       ip = (ip + 3) & ~3; // pad to four byte boundary
 
-      Compiler::Operand* key = frame->popInt();
-    
       uint32_t defaultIp = base + codeReadInt32(t, code, ip);
       assert(t, defaultIp < codeLength(t, code));
+      
+      int32_t bottom = codeReadInt32(t, code, ip);
+      int32_t top = codeReadInt32(t, code, ip);
+        
+      Promise* start = 0;
+      unsigned count = top - bottom + 1;
+      uint32_t* ipTable = static_cast<uint32_t*>
+        (stack.push(sizeof(uint32_t) * count));
+      for (int32_t i = 0; i < top - bottom + 1; ++i) {
+        unsigned index = ip + (i * 4);
+        uint32_t newIp = base + codeReadInt32(t, code, index);
+        assert(t, newIp < codeLength(t, code));
 
-      int32_t pairCount = codeReadInt32(t, code, ip);
+        ipTable[i] = newIp;
 
-      if (pairCount) {
-        Compiler::Operand* default_ = frame->addressOperand
-          (frame->addressPromise(c->machineIp(defaultIp)));
+        Promise* p = c->poolAppendPromise
+          (frame->addressPromise(c->machineIp(newIp)));
+        if (i == 0) {
+          start = p;
+        }
+      }
+      assert(t, start);
 
-        Promise* start = 0;
-        uint32_t* ipTable = static_cast<uint32_t*>
-          (stack.push(sizeof(uint32_t) * pairCount));
-        for (int32_t i = 0; i < pairCount; ++i) {
-          unsigned index = ip + (i * 8);
-          int32_t key = codeReadInt32(t, code, index);
-          uint32_t newIp = base + codeReadInt32(t, code, index);
-          assert(t, newIp < codeLength(t, code));
+      Compiler::Operand* key = frame->popInt();
+      
+      c->jumpIfLess(4, c->constant(bottom, Compiler::IntegerType), key,
+                    frame->machineIp(defaultIp));
 
-          ipTable[i] = newIp;
+      c->save(1, key);
 
-          Promise* p = c->poolAppend(key);
-          if (i == 0) {
-            start = p;
-          }
-          c->poolAppendPromise
-            (frame->addressPromise(c->machineIp(newIp)));
-        }
-        assert(t, start);
+      new (stack.push(sizeof(SwitchState))) SwitchState
+        (c->saveState(), count, defaultIp, key, start, bottom, top);
 
-        Compiler::Operand* address = c->call
-          (c->constant(getThunk(t, lookUpAddressThunk), Compiler::AddressType),
-           0, 0, TargetBytesPerWord, Compiler::AddressType,
-           4, key, frame->absoluteAddressOperand(start),
-           c->constant(pairCount, Compiler::IntegerType), default_);
+      stack.pushValue(Untable0);
+      ip = defaultIp;
+    } goto start;
 
-        c->jmp
-          (context->bootContext ? c->add
-           (TargetBytesPerWord, c->memory
-            (c->register_(t->arch->thread()), Compiler::AddressType,
-             TARGET_THREAD_CODEIMAGE), address)
-           : address);
+    case wide: {
+      switch (codeBody(t, code, ip++)) {
+      case aload: {
+        frame->loadObject(codeReadInt16(t, code, ip));
+      } break;
 
-        new (stack.push(sizeof(SwitchState))) SwitchState
-          (c->saveState(), pairCount, defaultIp, 0, 0, 0, 0);
+      case astore: {
+        frame->storeObject(codeReadInt16(t, code, ip));
+      } break;
 
-        goto switchloop;
-      } else {
-        // a switch statement with no cases, apparently
-        c->jmp(frame->machineIp(defaultIp));
-        ip = defaultIp;
+      case iinc: {
+        uint16_t index = codeReadInt16(t, code, ip);
+        int16_t count = codeReadInt16(t, code, ip);
+
+        storeLocal
+          (context, 1,
+           c->add
+           (4, c->constant(count, Compiler::IntegerType), 
+            loadLocal(context, 1, index)),
+           index);
+      } break;
+
+      case iload: {
+        frame->loadInt(codeReadInt16(t, code, ip));
+      } break;
+
+      case istore: {
+        frame->storeInt(codeReadInt16(t, code, ip));
+      } break;
+
+      case lload: {
+        frame->loadLong(codeReadInt16(t, code, ip));
+      } break;
+
+      case lstore: {
+        frame->storeLong(codeReadInt16(t, code, ip));
+      } break;
+
+      case ret: {
+        unsigned index = codeReadInt16(t, code, ip);
+        c->jmp(loadLocal(context, 1, index));
+        frame->returnFromSubroutine(index);
+      } goto next;
+
+      default: abort(t);
       }
     } break;
 
-    case lor: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
-      frame->pushLong(c->or_(8, a, b));
-    } break;
+    default: abort(t);
+    }
+  }
 
-    case lrem: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
+ next:
+  frame->dispose();
+  frame = 0;
+  stack.pop(sizeof(Frame));
+  stack.pop(stackSize);
+  switch (stack.popValue()) {
+  case Return:
+    return;
 
-      if (inTryBlock(t, code, ip - 1)) {
-        c->saveLocals();
-        frame->trace(0, 0);
-      }
+  case Unbranch:
+    ip = stack.popValue();
+    c->restoreState(reinterpret_cast<Compiler::State*>(stack.popValue()));
+    frame = static_cast<Frame*>(stack.peek(sizeof(Frame)));
+    goto loop;
 
-      frame->pushLong(c->rem(8, a, b));
-    } break;
+  case Untable0: {
+    SwitchState* s = static_cast<SwitchState*>
+      (stack.peek(sizeof(SwitchState)));
 
-    case lreturn:
-    case dreturn: {
-      handleExit(t, frame);
-      c->return_(8, frame->popLong());
-    } goto next;
+    frame = s->frame();
 
-    case lshl: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popLong();
-      frame->pushLong(c->shl(8, a, b));
-    } break;
+    c->restoreState(s->state);
 
-    case lshr: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popLong();
-      frame->pushLong(c->shr(8, a, b));
-    } break;
+    c->jumpIfGreater(4, c->constant(s->top, Compiler::IntegerType), s->key,
+                     frame->machineIp(s->defaultIp));
+  
+    c->save(1, s->key);
+    ip = s->defaultIp;
+    stack.pushValue(Untable1);
+  } goto start;
 
-    case lstore:
-    case dstore:
-      frame->storeLong(codeBody(t, code, ip++));
-      break;
+  case Untable1: {
+    SwitchState* s = static_cast<SwitchState*>
+      (stack.peek(sizeof(SwitchState)));
+
+    frame = s->frame();
+
+    c->restoreState(s->state);
+
+    Compiler::Operand* normalizedKey
+      = (s->bottom
+         ? c->sub(4, c->constant(s->bottom, Compiler::IntegerType), s->key)
+         : s->key);
+
+    Compiler::Operand* entry = c->memory
+      (frame->absoluteAddressOperand(s->start), Compiler::AddressType, 0,
+       normalizedKey, TargetBytesPerWord);
+
+    c->jmp
+      (c->load
+       (TargetBytesPerWord, TargetBytesPerWord, context->bootContext
+        ? c->add
+        (TargetBytesPerWord, c->memory
+         (c->register_(t->arch->thread()), Compiler::AddressType,
+          TARGET_THREAD_CODEIMAGE), entry)
+        : entry,
+        TargetBytesPerWord));
+
+    s->state = c->saveState();
+  } goto switchloop;
+
+  case Unswitch: {
+    SwitchState* s = static_cast<SwitchState*>
+      (stack.peek(sizeof(SwitchState)));
+    
+    frame = s->frame();
 
-    case lstore_0:
-    case dstore_0:
-      frame->storeLong(0);
-      break;
+    c->restoreState
+      (static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)))->state);
+  } goto switchloop;
 
-    case lstore_1:
-    case dstore_1:
-      frame->storeLong(1);
-      break;
+  case Unsubroutine: {
+    ip = stack.popValue();
+    unsigned start = stack.popValue();
+    frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
+    frame->endSubroutine(start);
+  } goto loop;
 
-    case lstore_2:
-    case dstore_2:
-      frame->storeLong(2);
-      break;
+  default:
+    abort(t);
+  }
 
-    case lstore_3:
-    case dstore_3:
-      frame->storeLong(3);
-      break;
+ switchloop: {
+    SwitchState* s = static_cast<SwitchState*>
+      (stack.peek(sizeof(SwitchState)));
 
-    case lsub: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
-      frame->pushLong(c->sub(8, a, b));
-    } break;
+    if (s->index < s->count) {
+      ip = s->ipTable()[s->index++];
+      stack.pushValue(Unswitch);
+      goto start;
+    } else {
+      ip = s->defaultIp;
+      unsigned count = s->count * 4;
+      stack.pop(sizeof(SwitchState));
+      stack.pop(count);
+      frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
+      goto loop;
+    }
+  }
 
-    case lushr: {
-      Compiler::Operand* a = frame->popInt();
-      Compiler::Operand* b = frame->popLong();
-      frame->pushLong(c->ushr(8, a, b));
-    } break;
+ branch:
+  stack.pushValue(reinterpret_cast<uintptr_t>(c->saveState()));
+  stack.pushValue(ip);
+  stack.pushValue(Unbranch);
+  ip = newIp;
+  goto start;
+}
 
-    case lxor: {
-      Compiler::Operand* a = frame->popLong();
-      Compiler::Operand* b = frame->popLong();
-      frame->pushLong(c->xor_(8, a, b));
-    } break;
+FILE* compileLog = 0;
 
-    case monitorenter: {
-      Compiler::Operand* target = frame->popObject();
-      c->call
-        (c->constant
-         (getThunk(t, acquireMonitorForObjectThunk), Compiler::AddressType),
-         0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-         c->register_(t->arch->thread()), target);
-    } break;
+void
+logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
+           const char* name, const char* spec);
 
-    case monitorexit: {
-      Compiler::Operand* target = frame->popObject();
-      c->call
-        (c->constant
-         (getThunk(t, releaseMonitorForObjectThunk), Compiler::AddressType),
-         0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-         c->register_(t->arch->thread()), target);
-    } break;
+int
+resolveIpForwards(Context* context, int start, int end)
+{
+  if (start < 0) {
+    start = 0;
+  }
 
-    case multianewarray: {
-      uint16_t index = codeReadInt16(t, code, ip);
-      uint8_t dimensions = codeBody(t, code, ip++);
+  while (start < end and context->visitTable[start] == 0) {
+    ++ start;
+  }
+  
+  if (start >= end) {
+    return -1;
+  } else {
+    return start;
+  }
+}
 
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
+int
+resolveIpBackwards(Context* context, int start, int end)
+{
+  Thread* t = context->thread;
+  if (start >= static_cast<int>
+      (codeLength(t, methodCode(t, context->method))))
+  {
+    start = codeLength(t, methodCode(t, context->method)) - 1;
+  }
 
-      PROTECT(t, reference);
+  while (start >= end and context->visitTable[start] == 0) {
+    -- start;
+  }
+  
+  if (start < end) {
+    return -1;
+  } else {
+    return start;
+  }
+}
 
-      object class_ = resolveClassInPool(t, context->method, index - 1, false);
+object
+truncateIntArray(Thread* t, object array, unsigned length)
+{
+  expect(t, intArrayLength(t, array) > length);
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        thunk = makeMultidimensionalArrayThunk;
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = makeMultidimensionalArrayFromReferenceThunk;
-      }
+  PROTECT(t, array);
 
-      unsigned offset
-        = localOffset
-        (t, localSize(t, context->method) + c->topOfStack(), context->method)
-        + t->arch->frameReturnAddressSize();
+  object newArray = makeIntArray(t, length);
+  if (length) {
+    memcpy(&intArrayBody(t, newArray, 0), &intArrayBody(t, array, 0),
+           length * 4);
+  }
 
-      Compiler::Operand* result = c->call
-        (c->constant
-         (getThunk(t, thunk), Compiler::AddressType),
-         0,
-         frame->trace(0, 0),
-         TargetBytesPerWord,
-         Compiler::ObjectType,
-         4, c->register_(t->arch->thread()), frame->append(argument),
-         c->constant(dimensions, Compiler::IntegerType),
-         c->constant(offset, Compiler::IntegerType));
+  return newArray;
+}
 
-      frame->pop(dimensions);
-      frame->pushObject(result);
-    } break;
+object
+truncateArray(Thread* t, object array, unsigned length)
+{
+  expect(t, arrayLength(t, array) > length);
 
-    case new_: {
-      uint16_t index = codeReadInt16(t, code, ip);
-        
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
+  PROTECT(t, array);
 
-      PROTECT(t, reference);
+  object newArray = makeArray(t, length);
+  if (length) {
+    memcpy(&arrayBody(t, newArray, 0), &arrayBody(t, array, 0),
+           length * BytesPerWord);
+  }
 
-      object class_ = resolveClassInPool(t, context->method, index - 1, false);
+  return newArray;
+}
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        if (classVmFlags(t, class_) & (WeakReferenceFlag | HasFinalizerFlag)) {
-          thunk = makeNewGeneral64Thunk;
-        } else {
-          thunk = makeNew64Thunk;
-        }
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = makeNewFromReferenceThunk;
-      }
+object
+truncateLineNumberTable(Thread* t, object table, unsigned length)
+{
+  expect(t, lineNumberTableLength(t, table) > length);
 
-      frame->pushObject
-        (c->call
-         (c->constant(getThunk(t, thunk), Compiler::AddressType),
-          0,
-          frame->trace(0, 0),
-          TargetBytesPerWord,
-          Compiler::ObjectType,
-          2, c->register_(t->arch->thread()), frame->append(argument)));
-    } break;
+  PROTECT(t, table);
 
-    case newarray: {
-      uint8_t type = codeBody(t, code, ip++);
+  object newTable = makeLineNumberTable(t, length);
+  if (length) {
+    memcpy(&lineNumberTableBody(t, newTable, 0),
+           &lineNumberTableBody(t, table, 0),
+           length * sizeof(uint64_t));
+  }
 
-      Compiler::Operand* length = frame->popInt();
+  return newTable;
+}
 
-      frame->pushObject
-        (c->call
-         (c->constant(getThunk(t, makeBlankArrayThunk), Compiler::AddressType),
-          0,
-          frame->trace(0, 0),
-          TargetBytesPerWord,
-          Compiler::ObjectType,
-          3, c->register_(t->arch->thread()),
-          c->constant(type, Compiler::IntegerType), length));
-    } break;
+object
+translateExceptionHandlerTable(MyThread* t, Context* context, intptr_t start)
+{
+  Compiler* c = context->compiler;
 
-    case nop: break;
+  object oldTable = codeExceptionHandlerTable
+    (t, methodCode(t, context->method));
 
-    case pop_:
-      frame->pop(1);
-      break;
+  if (oldTable) {
+    PROTECT(t, oldTable);
 
-    case pop2:
-      frame->pop(2);
-      break;
+    unsigned length = exceptionHandlerTableLength(t, oldTable);
 
-    case putfield:
-    case putstatic: {
-      uint16_t index = codeReadInt16(t, code, ip);
-    
-      object reference = singletonObject
-        (t, codePool(t, methodCode(t, context->method)), index - 1);
+    object newIndex = makeIntArray(t, length * 3);
+    PROTECT(t, newIndex);
 
-      PROTECT(t, reference);
+    object newTable = makeArray(t, length + 1);
+    PROTECT(t, newTable);
 
-      object field = resolveField(t, context->method, index - 1, false);
+    unsigned ni = 0;
+    for (unsigned oi = 0; oi < length; ++ oi) {
+      uint64_t oldHandler = exceptionHandlerTableBody
+        (t, oldTable, oi);
 
-      if (LIKELY(field)) {
-        int fieldCode = vm::fieldCode(t, field);
+      int handlerStart = resolveIpForwards
+        (context, exceptionHandlerStart(oldHandler),
+         exceptionHandlerEnd(oldHandler));
 
-        object staticTable = 0;
+      if (LIKELY(handlerStart >= 0)) {
+        assert(t, handlerStart < static_cast<int>
+               (codeLength(t, methodCode(t, context->method))));
 
-        if (instruction == putstatic) {
-          checkField(t, field, true);
+        int handlerEnd = resolveIpBackwards
+          (context, exceptionHandlerEnd(oldHandler),
+           exceptionHandlerStart(oldHandler));
 
-          if (fieldClass(t, field) != methodClass(t, context->method)
-              and classNeedsInit(t, fieldClass(t, field)))
-          {
-            PROTECT(t, field);
+        assert(t, handlerEnd >= 0);
+        assert(t, handlerEnd < static_cast<int>
+               (codeLength(t, methodCode(t, context->method))));
 
-            c->call
-              (c->constant
-               (getThunk(t, tryInitClassThunk), Compiler::AddressType),
-               0,
-               frame->trace(0, 0),
-               0,
-               Compiler::VoidType,
-               2, c->register_(t->arch->thread()),
-               frame->append(fieldClass(t, field)));
-          }
+        intArrayBody(t, newIndex, ni * 3)
+          = c->machineIp(handlerStart)->value() - start;
 
-          staticTable = classStaticTable(t, fieldClass(t, field));      
-        } else {
-          checkField(t, field, false);
+        intArrayBody(t, newIndex, (ni * 3) + 1)
+          = c->machineIp(handlerEnd)->value() - start;
 
-          if (inTryBlock(t, code, ip - 3)) {
-            c->saveLocals();
-            frame->trace(0, 0);
-          }
+        intArrayBody(t, newIndex, (ni * 3) + 2)
+          = c->machineIp(exceptionHandlerIp(oldHandler))->value() - start;
+
+        object type;
+        if (exceptionHandlerCatchType(oldHandler)) {
+          type = resolveClassInPool
+            (t, context->method, exceptionHandlerCatchType(oldHandler) - 1);
+        } else {
+          type = 0;
         }
 
-        if (fieldFlags(t, field) & ACC_VOLATILE) {
-          if (TargetBytesPerWord == 4
-              and (fieldCode == DoubleField or fieldCode == LongField))
-          {
-            PROTECT(t, field);
+        set(t, newTable, ArrayBody + ((ni + 1) * BytesPerWord), type);
 
-            c->call
-              (c->constant
-               (getThunk(t, acquireMonitorForObjectThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-               c->register_(t->arch->thread()), frame->append(field));
-          } else {
-            c->storeStoreBarrier();
-          }
-        }
+        ++ ni;
+      }
+    }
 
-        Compiler::Operand* value = popField(t, frame, fieldCode);
+    if (UNLIKELY(ni < length)) {
+      newIndex = truncateIntArray(t, newIndex, ni * 3);
+      newTable = truncateArray(t, newTable, ni + 1);
+    }
 
-        Compiler::Operand* table;
+    set(t, newTable, ArrayBody, newIndex);
 
-        if (instruction == putstatic) {
-          PROTECT(t, field);
+    return newTable;
+  } else {
+    return 0;
+  }
+}
 
-          table = frame->append(staticTable);
-        } else {
-          table = frame->popObject();
-        }
+object
+translateLineNumberTable(MyThread* t, Context* context, intptr_t start)
+{
+  object oldTable = codeLineNumberTable(t, methodCode(t, context->method));
+  if (oldTable) {
+    PROTECT(t, oldTable);
 
-        switch (fieldCode) {
-        case ByteField:
-        case BooleanField:
-          c->store
-            (TargetBytesPerWord, value, 1, c->memory
-             (table, Compiler::IntegerType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
+    unsigned length = lineNumberTableLength(t, oldTable);
+    object newTable = makeLineNumberTable(t, length);
+    unsigned ni = 0;
+    for (unsigned oi = 0; oi < length; ++oi) {
+      uint64_t oldLine = lineNumberTableBody(t, oldTable, oi);
 
-        case CharField:
-        case ShortField:
-          c->store
-            (TargetBytesPerWord, value, 2, c->memory
-             (table, Compiler::IntegerType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
-            
-        case FloatField:
-          c->store
-            (TargetBytesPerWord, value, 4, c->memory
-             (table, Compiler::FloatType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
+      int ip = resolveIpForwards
+        (context, lineNumberIp(oldLine), oi + 1 < length
+         ? lineNumberIp(lineNumberTableBody(t, oldTable, oi + 1)) - 1
+         : lineNumberIp(oldLine) + 1);
 
-        case IntField:
-          c->store
-            (TargetBytesPerWord, value, 4, c->memory
-             (table, Compiler::IntegerType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
+      if (LIKELY(ip >= 0)) {
+        lineNumberTableBody(t, newTable, ni++) = lineNumber
+          (context->compiler->machineIp(ip)->value() - start,
+           lineNumberLine(oldLine));
+      }
+    }
 
-        case DoubleField:
-          c->store
-            (8, value, 8, c->memory
-             (table, Compiler::FloatType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
+    if (UNLIKELY(ni < length)) {
+      newTable = truncateLineNumberTable(t, newTable, ni);      
+    }
 
-        case LongField:
-          c->store
-            (8, value, 8, c->memory
-             (table, Compiler::IntegerType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
+    return newTable;
+  } else {
+    return 0;
+  }
+}
 
-        case ObjectField:
-          if (instruction == putfield) {
-            c->call
-              (c->constant
-               (getThunk(t, setMaybeNullThunk), Compiler::AddressType),
-               0,
-               frame->trace(0, 0),
-               0,
-               Compiler::VoidType,
-               4, c->register_(t->arch->thread()), table,
-               c->constant(targetFieldOffset(context, field),
-                           Compiler::IntegerType),
-               value);
-          } else {
-            c->call
-              (c->constant(getThunk(t, setThunk), Compiler::AddressType),
-               0, 0, 0, Compiler::VoidType,
-               4, c->register_(t->arch->thread()), table,
-               c->constant(targetFieldOffset(context, field),
-                           Compiler::IntegerType),
-               value);
+void
+printSet(uintptr_t m, unsigned limit)
+{
+  if (limit) {
+    for (unsigned i = 0; i < 16; ++i) {
+      if ((m >> i) & 1) {
+        fprintf(stderr, "1");
+      } else {
+        fprintf(stderr, "_");
+      }
+    }
+  }
+}
+
+void
+calculateTryCatchRoots(Context* context, SubroutinePath* subroutinePath,
+                       uintptr_t* roots, unsigned mapSize, unsigned start,
+                       unsigned end)
+{
+  memset(roots, 0xFF, mapSize * BytesPerWord);
+
+  if (DebugFrameMaps) {
+    fprintf(stderr, "calculate try/catch roots from %d to %d", start, end);
+    if (subroutinePath) {
+      fprintf(stderr, " ");
+      print(subroutinePath);
+    }
+    fprintf(stderr, "\n");
+  }
+
+  for (TraceElement* te = context->traceLog; te; te = te->next) {
+    if (te->ip >= start and te->ip < end) {
+      uintptr_t* traceRoots = 0;
+      if (subroutinePath == 0) {
+        traceRoots = te->map;
+        te->watch = true;
+      } else {
+        for (SubroutineTrace* t = te->subroutineTrace; t; t = t->next) {
+          if (t->path == subroutinePath) {
+            traceRoots = t->map;
+            t->watch = true;
+            break;
           }
-          break;
+        }        
+      }
 
-        default: abort(t);
+      if (traceRoots) {
+        if (DebugFrameMaps) {
+          fprintf(stderr, "   use roots at ip %3d: ", te->ip);
+          printSet(*traceRoots, mapSize);
+          fprintf(stderr, "\n");
         }
 
-        if (fieldFlags(t, field) & ACC_VOLATILE) {
-          if (TargetBytesPerWord == 4
-              and (fieldCode == DoubleField or fieldCode == LongField))
-          {
-            c->call
-              (c->constant
-               (getThunk(t, releaseMonitorForObjectThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-               c->register_(t->arch->thread()), frame->append(field));
-          } else {
-            c->storeLoadBarrier();
-          }
+        for (unsigned wi = 0; wi < mapSize; ++wi) {
+          roots[wi] &= traceRoots[wi];
         }
       } else {
-        int fieldCode = vm::fieldCode
-          (t, byteArrayBody(t, referenceSpec(t, reference), 0));
+        if (DebugFrameMaps) {
+          fprintf(stderr, "  skip roots at ip %3d\n", te->ip);
+        }
+      }
+    }
+  }
+
+  if (DebugFrameMaps) {
+    fprintf(stderr, "result roots          : ");
+    printSet(*roots, mapSize);
+    fprintf(stderr, "\n");
+  }
+}
+
+unsigned
+calculateFrameMaps(MyThread* t, Context* context, uintptr_t* originalRoots,
+                   unsigned eventIndex, SubroutinePath* subroutinePath = 0,
+                   uintptr_t* resultRoots = 0)
+{
+  // for each instruction with more than one predecessor, and for each
+  // stack position, determine if there exists a path to that
+  // instruction such that there is not an object pointer left at that
+  // stack position (i.e. it is uninitialized or contains primitive
+  // data).
+
+  unsigned mapSize = frameMapSizeInWords(t, context->method);
+
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, roots, mapSize);
+  if (originalRoots) {
+    memcpy(RUNTIME_ARRAY_BODY(roots), originalRoots, mapSize * BytesPerWord);
+  } else {
+    memset(RUNTIME_ARRAY_BODY(roots), 0, mapSize * BytesPerWord);
+  }
+
+  int32_t ip = -1;
+
+  // invariant: for each stack position, roots contains a zero at that
+  // position if there exists some path to the current instruction
+  // such that there is definitely not an object pointer at that
+  // position.  Otherwise, roots contains a one at that position,
+  // meaning either all known paths result in an object pointer at
+  // that position, or the contents of that position are as yet
+  // unknown.
 
-        Compiler::Operand* value = popField(t, frame, fieldCode);
-        unsigned rSize = resultSize(t, fieldCode);
-        Compiler::OperandType rType = operandTypeForFieldCode(t, fieldCode);
+  unsigned length = context->eventLog.length();
+  while (eventIndex < length) {
+    Event e = static_cast<Event>(context->eventLog.get(eventIndex++));
+    switch (e) {
+    case PushContextEvent: {
+      eventIndex = calculateFrameMaps
+        (t, context, RUNTIME_ARRAY_BODY(roots), eventIndex, subroutinePath,
+         resultRoots);
+    } break;
 
-        object pair = makePair(t, context->method, reference);
+    case PopContextEvent:
+      goto exit;
 
-        switch (fieldCode) {
-        case ByteField:
-        case BooleanField:
-        case CharField:
-        case ShortField:
-        case FloatField:
-        case IntField: {
-          if (instruction == putstatic) {
-            c->call
-              (c->constant
-               (getThunk(t, setStaticFieldValueFromReferenceThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), rSize, rType, 3,
-               c->register_(t->arch->thread()), frame->append(pair),
-               value);
-          } else {
-            Compiler::Operand* instance = frame->popObject();
+    case IpEvent: {
+      ip = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
 
-            c->call
-              (c->constant
-               (getThunk(t, setFieldValueFromReferenceThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), rSize, rType, 4,
-               c->register_(t->arch->thread()), frame->append(pair),
-               instance, value);
-          }
-        } break;
+      if (DebugFrameMaps) {
+        fprintf(stderr, "       roots at ip %3d: ", ip);
+        printSet(*RUNTIME_ARRAY_BODY(roots), mapSize);
+        fprintf(stderr, "\n");
+      }
 
-        case DoubleField:
-        case LongField: {
-          if (instruction == putstatic) {
-            c->call
-              (c->constant
-               (getThunk(t, setStaticLongFieldValueFromReferenceThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), rSize, rType, 4,
-               c->register_(t->arch->thread()), frame->append(pair),
-               static_cast<Compiler::Operand*>(0), value);
-          } else {
-            Compiler::Operand* instance = frame->popObject();
+      uintptr_t* tableRoots
+        = (subroutinePath ? subroutinePath->rootTable : context->rootTable)
+        + (ip * mapSize);
 
-            c->call
-              (c->constant
-               (getThunk(t, setLongFieldValueFromReferenceThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), rSize, rType, 5,
-               c->register_(t->arch->thread()), frame->append(pair),
-               instance, static_cast<Compiler::Operand*>(0), value);
-          }
-        } break;
+      if (context->visitTable[ip] > 1) {
+        for (unsigned wi = 0; wi < mapSize; ++wi) {
+          uintptr_t newRoots = tableRoots[wi] & RUNTIME_ARRAY_BODY(roots)[wi];
 
-        case ObjectField: {
-          if (instruction == putstatic) {
-            c->call
-              (c->constant
-               (getThunk(t, setStaticObjectFieldValueFromReferenceThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), rSize, rType, 3,
-               c->register_(t->arch->thread()), frame->append(pair),
-               value);
-          } else {
-            Compiler::Operand* instance = frame->popObject();
+          if ((eventIndex == length
+               or context->eventLog.get(eventIndex) == PopContextEvent)
+              and newRoots != tableRoots[wi])
+          {
+            if (DebugFrameMaps) {
+              fprintf(stderr, "dirty roots!\n");
+            }
 
-            c->call
-              (c->constant
-               (getThunk(t, setObjectFieldValueFromReferenceThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), rSize, rType, 4,
-               c->register_(t->arch->thread()), frame->append(pair),
-               instance, value);
+            context->dirtyRoots = true;
           }
-        } break;
 
-        default: abort(t);
+          tableRoots[wi] = newRoots;
+          RUNTIME_ARRAY_BODY(roots)[wi] &= tableRoots[wi];
+        }
+
+        if (DebugFrameMaps) {
+          fprintf(stderr, " table roots at ip %3d: ", ip);
+          printSet(*tableRoots, mapSize);
+          fprintf(stderr, "\n");
         }
+      } else {
+        memcpy(tableRoots, RUNTIME_ARRAY_BODY(roots), mapSize * BytesPerWord);
       }
     } break;
 
-    case ret: {
-      unsigned index = codeBody(t, code, ip);
-      frame->returnFromSubroutine(index);
-    } goto next;
+    case MarkEvent: {
+      unsigned i = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
 
-    case return_:
-      if (needsReturnBarrier(t, context->method)) {
-        c->storeStoreBarrier();
-      }
+      markBit(RUNTIME_ARRAY_BODY(roots), i);
+    } break;
 
-      handleExit(t, frame);
-      c->return_(0, 0);
-      goto next;
+    case ClearEvent: {
+      unsigned i = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
 
-    case sipush:
-      frame->pushInt
-        (c->constant
-         (static_cast<int16_t>(codeReadInt16(t, code, ip)),
-          Compiler::IntegerType));
-      break;
+      clearBit(RUNTIME_ARRAY_BODY(roots), i);
+    } break;
 
-    case swap:
-      frame->swap();
-      break;
+    case PushExceptionHandlerEvent: {
+      unsigned start = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
+      unsigned end = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
 
-    case tableswitch: {
-      int32_t base = ip - 1;
+      if (context->subroutineTable and context->subroutineTable[start]) {
+        Subroutine* s = context->subroutineTable[start];
+        unsigned originalEventIndex = eventIndex;
 
-      ip = (ip + 3) & ~3; // pad to four byte boundary
+        for (SubroutineCall* c = s->calls; c; c = c->next) {
+          for (SubroutinePath* p = c->paths; p; p = p->listNext) {
+            calculateTryCatchRoots
+              (context, p, RUNTIME_ARRAY_BODY(roots), mapSize, start, end);
 
-      uint32_t defaultIp = base + codeReadInt32(t, code, ip);
-      assert(t, defaultIp < codeLength(t, code));
-      
-      int32_t bottom = codeReadInt32(t, code, ip);
-      int32_t top = codeReadInt32(t, code, ip);
-        
-      Promise* start = 0;
-      unsigned count = top - bottom + 1;
-      uint32_t* ipTable = static_cast<uint32_t*>
-        (stack.push(sizeof(uint32_t) * count));
-      for (int32_t i = 0; i < top - bottom + 1; ++i) {
-        unsigned index = ip + (i * 4);
-        uint32_t newIp = base + codeReadInt32(t, code, index);
-        assert(t, newIp < codeLength(t, code));
+            eventIndex = calculateFrameMaps
+              (t, context, RUNTIME_ARRAY_BODY(roots), originalEventIndex, p);
+          }
+        }
+      } else {
+        calculateTryCatchRoots
+          (context, 0, RUNTIME_ARRAY_BODY(roots), mapSize, start, end);
 
-        ipTable[i] = newIp;
+        eventIndex = calculateFrameMaps
+          (t, context, RUNTIME_ARRAY_BODY(roots), eventIndex, 0);
+      }
+    } break;
 
-        Promise* p = c->poolAppendPromise
-          (frame->addressPromise(c->machineIp(newIp)));
-        if (i == 0) {
-          start = p;
+    case TraceEvent: {
+      TraceElement* te; context->eventLog.get(eventIndex, &te, BytesPerWord);
+      if (DebugFrameMaps) {
+        fprintf(stderr, " trace roots at ip %3d: ", ip);
+        printSet(*RUNTIME_ARRAY_BODY(roots), mapSize);
+        if (subroutinePath) {
+          fprintf(stderr, " ");
+          print(subroutinePath);
         }
+        fprintf(stderr, "\n");
       }
-      assert(t, start);
-
-      Compiler::Operand* key = frame->popInt();
-      
-      c->jumpIfLess(4, c->constant(bottom, Compiler::IntegerType), key,
-                    frame->machineIp(defaultIp));
-
-      c->save(1, key);
-
-      new (stack.push(sizeof(SwitchState))) SwitchState
-        (c->saveState(), count, defaultIp, key, start, bottom, top);
-
-      stack.pushValue(Untable0);
-      ip = defaultIp;
-    } goto start;
-
-    case wide: {
-      switch (codeBody(t, code, ip++)) {
-      case aload: {
-        frame->loadObject(codeReadInt16(t, code, ip));
-      } break;
-
-      case astore: {
-        frame->storeObject(codeReadInt16(t, code, ip));
-      } break;
-
-      case iinc: {
-        uint16_t index = codeReadInt16(t, code, ip);
-        int16_t count = codeReadInt16(t, code, ip);
+        
+      uintptr_t* map;
+      bool watch;
+      if (subroutinePath == 0) {
+        map = te->map;
+        watch = te->watch;
+      } else {
+        SubroutineTrace* trace = 0;
+        for (SubroutineTrace* t = te->subroutineTrace; t; t = t->next) {
+          if (t->path == subroutinePath) {
+            trace = t;
+            break;
+          }
+        }
 
-        storeLocal
-          (context, 1,
-           c->add
-           (4, c->constant(count, Compiler::IntegerType), 
-            loadLocal(context, 1, index)),
-           index);
-      } break;
+        if (trace == 0) {
+          te->subroutineTrace = trace = new
+            (context->zone.allocate
+             (sizeof(SubroutineTrace) + (mapSize * BytesPerWord)))
+            SubroutineTrace(subroutinePath, te->subroutineTrace, mapSize);
 
-      case iload: {
-        frame->loadInt(codeReadInt16(t, code, ip));
-      } break;
+          ++ te->subroutineTraceCount;
+        }
 
-      case istore: {
-        frame->storeInt(codeReadInt16(t, code, ip));
-      } break;
+        map = trace->map;
+        watch = trace->watch;
+      }
 
-      case lload: {
-        frame->loadLong(codeReadInt16(t, code, ip));
-      } break;
+      for (unsigned wi = 0; wi < mapSize; ++wi) {
+        uintptr_t v = RUNTIME_ARRAY_BODY(roots)[wi];
 
-      case lstore: {
-        frame->storeLong(codeReadInt16(t, code, ip));
-      } break;
+        if (watch and map[wi] != v) {
+          if (DebugFrameMaps) {
+            fprintf(stderr, "dirty roots due to trace watch!\n");
+          }
 
-      case ret: {
-        unsigned index = codeReadInt16(t, code, ip);
-        c->jmp(loadLocal(context, 1, index));
-        frame->returnFromSubroutine(index);
-      } goto next;
+          context->dirtyRoots = true;
+        }
 
-      default: abort(t);
+        map[wi] = v;
       }
-    } break;
-
-    default: abort(t);
-    }
-  }
 
- next:
-  frame->dispose();
-  frame = 0;
-  stack.pop(sizeof(Frame));
-  stack.pop(stackSize);
-  switch (stack.popValue()) {
-  case Return:
-    return;
+      eventIndex += BytesPerWord;
+    } break;
 
-  case Unbranch:
-    ip = stack.popValue();
-    c->restoreState(reinterpret_cast<Compiler::State*>(stack.popValue()));
-    frame = static_cast<Frame*>(stack.peek(sizeof(Frame)));
-    goto loop;
+    case PushSubroutineEvent: {
+      SubroutineCall* call;
+      context->eventLog.get(eventIndex, &call, BytesPerWord);
+      eventIndex += BytesPerWord;
 
-  case Untable0: {
-    SwitchState* s = static_cast<SwitchState*>
-      (stack.peek(sizeof(SwitchState)));
+      unsigned nextIndex = context->eventLog.get2(eventIndex);
 
-    frame = s->frame();
+      eventIndex = nextIndex;
 
-    c->restoreState(s->state);
+      SubroutinePath* path = 0;
+      for (SubroutinePath* p = call->paths; p; p = p->listNext) {
+        if (p->stackNext == subroutinePath) {
+          path = p;
+          break;
+        }
+      }
 
-    c->jumpIfGreater(4, c->constant(s->top, Compiler::IntegerType), s->key,
-                     frame->machineIp(s->defaultIp));
-  
-    c->save(1, s->key);
-    ip = s->defaultIp;
-    stack.pushValue(Untable1);
-  } goto start;
+      if (path == 0) {
+        path = new(&context->zone)
+          SubroutinePath(call, subroutinePath,
+                         makeRootTable(t, &(context->zone), context->method));
+      }
 
-  case Untable1: {
-    SwitchState* s = static_cast<SwitchState*>
-      (stack.peek(sizeof(SwitchState)));
+      THREAD_RUNTIME_ARRAY(t, uintptr_t, subroutineRoots, mapSize);
 
-    frame = s->frame();
+      calculateFrameMaps
+        (t, context, RUNTIME_ARRAY_BODY(roots), call->subroutine->logIndex,
+         path, RUNTIME_ARRAY_BODY(subroutineRoots));
 
-    c->restoreState(s->state);
+      for (unsigned wi = 0; wi < mapSize; ++wi) {
+        RUNTIME_ARRAY_BODY(roots)[wi]
+          &= RUNTIME_ARRAY_BODY(subroutineRoots)[wi];
+      }      
+    } break;
 
-    Compiler::Operand* normalizedKey
-      = (s->bottom
-         ? c->sub(4, c->constant(s->bottom, Compiler::IntegerType), s->key)
-         : s->key);
+    case PopSubroutineEvent:
+      eventIndex = static_cast<unsigned>(-1);
+      goto exit;
 
-    Compiler::Operand* entry = c->memory
-      (frame->absoluteAddressOperand(s->start), Compiler::AddressType, 0,
-       normalizedKey, TargetBytesPerWord);
+    default: abort(t);
+    }
+  }
 
-    c->jmp
-      (c->load
-       (TargetBytesPerWord, TargetBytesPerWord, context->bootContext
-        ? c->add
-        (TargetBytesPerWord, c->memory
-         (c->register_(t->arch->thread()), Compiler::AddressType,
-          TARGET_THREAD_CODEIMAGE), entry)
-        : entry,
-        TargetBytesPerWord));
+ exit:
+  if (resultRoots and ip != -1) {
+    if (DebugFrameMaps) {
+      fprintf(stderr, "result roots at ip %3d: ", ip);
+      printSet(*RUNTIME_ARRAY_BODY(roots), mapSize);
+      if (subroutinePath) {
+        fprintf(stderr, " ");
+        print(subroutinePath);
+      }
+      fprintf(stderr, "\n");
+    }
 
-    s->state = c->saveState();
-  } goto switchloop;
+    memcpy(resultRoots, RUNTIME_ARRAY_BODY(roots), mapSize * BytesPerWord);
+  }
 
-  case Unswitch: {
-    SwitchState* s = static_cast<SwitchState*>
-      (stack.peek(sizeof(SwitchState)));
-    
-    frame = s->frame();
+  return eventIndex;
+}
 
-    c->restoreState
-      (static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)))->state);
-  } goto switchloop;
+int
+compareTraceElementPointers(const void* va, const void* vb)
+{
+  TraceElement* a = *static_cast<TraceElement* const*>(va);
+  TraceElement* b = *static_cast<TraceElement* const*>(vb);
+  if (a->address->value() > b->address->value()) {
+    return 1;
+  } else if (a->address->value() < b->address->value()) {
+    return -1;
+  } else {
+    return 0;
+  }
+}
 
-  case Unsubroutine: {
-    ip = stack.popValue();
-    unsigned start = stack.popValue();
-    frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
-    frame->endSubroutine(start);
-  } goto loop;
+unsigned
+simpleFrameMapTableSize(MyThread* t, object method, object map)
+{
+  int size = frameMapSizeInBits(t, method);
+  return ceiling(intArrayLength(t, map) * size, 32 + size);
+}
 
-  default:
-    abort(t);
-  }
+uint8_t*
+finish(MyThread* t, FixedAllocator* allocator, Assembler* a, const char* name,
+       unsigned length)
+{
+  uint8_t* start = static_cast<uint8_t*>
+    (allocator->allocate(length, TargetBytesPerWord));
 
- switchloop: {
-    SwitchState* s = static_cast<SwitchState*>
-      (stack.peek(sizeof(SwitchState)));
+  a->setDestination(start);
+  a->write();
 
-    if (s->index < s->count) {
-      ip = s->ipTable()[s->index++];
-      stack.pushValue(Unswitch);
-      goto start;
-    } else {
-      ip = s->defaultIp;
-      unsigned count = s->count * 4;
-      stack.pop(sizeof(SwitchState));
-      stack.pop(count);
-      frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
-      goto loop;
-    }
-  }
+  logCompile(t, start, length, 0, name, 0);
 
- branch:
-  stack.pushValue(reinterpret_cast<uintptr_t>(c->saveState()));
-  stack.pushValue(ip);
-  stack.pushValue(Unbranch);
-  ip = newIp;
-  goto start;
+  return start;
 }
 
-FILE* compileLog = 0;
+void
+setBit(int32_t* dst, unsigned index)
+{
+  dst[index / 32] |= static_cast<int32_t>(1) << (index % 32);
+}
 
 void
-logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
-           const char* name, const char* spec);
+clearBit(int32_t* dst, unsigned index)
+{
+  dst[index / 32] &= ~(static_cast<int32_t>(1) << (index % 32));
+}
 
-int
-resolveIpForwards(Context* context, int start, int end)
+void
+copyFrameMap(int32_t* dst, uintptr_t* src, unsigned mapSizeInBits,
+             unsigned offset, TraceElement* p,
+             SubroutinePath* subroutinePath)
 {
-  if (start < 0) {
-    start = 0;
-  }
+  if (DebugFrameMaps) {
+    fprintf(stderr, "  orig roots at ip %3d: ", p->ip);
+    printSet(src[0], ceiling(mapSizeInBits, BitsPerWord));
+    print(subroutinePath);
+    fprintf(stderr, "\n");
 
-  while (start < end and context->visitTable[start] == 0) {
-    ++ start;
-  }
-  
-  if (start >= end) {
-    return -1;
-  } else {
-    return start;
+    fprintf(stderr, " final roots at ip %3d: ", p->ip);
   }
-}
 
-int
-resolveIpBackwards(Context* context, int start, int end)
-{
-  Thread* t = context->thread;
-  if (start >= static_cast<int>
-      (codeLength(t, methodCode(t, context->method))))
-  {
-    start = codeLength(t, methodCode(t, context->method)) - 1;
+  for (unsigned j = 0; j < p->argumentIndex; ++j) {
+    if (getBit(src, j)) {
+      if (DebugFrameMaps) {
+        fprintf(stderr, "1");
+      }
+      setBit(dst, offset + j);
+    } else {
+      if (DebugFrameMaps) {
+        fprintf(stderr, "_");
+      }
+      clearBit(dst, offset + j);
+    }
   }
 
-  while (start >= end and context->visitTable[start] == 0) {
-    -- start;
-  }
-  
-  if (start < end) {
-    return -1;
-  } else {
-    return start;
+  if (DebugFrameMaps) {
+    print(subroutinePath);
+    fprintf(stderr, "\n");
   }
 }
 
-object
-truncateIntArray(Thread* t, object array, unsigned length)
-{
-  expect(t, intArrayLength(t, array) > length);
-
-  PROTECT(t, array);
+class FrameMapTableHeader {
+ public:
+  FrameMapTableHeader(unsigned indexCount):
+    indexCount(indexCount)
+  { }
 
-  object newArray = makeIntArray(t, length);
-  if (length) {
-    memcpy(&intArrayBody(t, newArray, 0), &intArrayBody(t, array, 0),
-           length * 4);
-  }
+  unsigned indexCount;
+};
 
-  return newArray;
-}
+class FrameMapTableIndexElement {
+ public:
+  FrameMapTableIndexElement(int offset, unsigned base, unsigned path):
+    offset(offset),
+    base(base),
+    path(path)
+  { }
 
-object
-truncateArray(Thread* t, object array, unsigned length)
-{
-  expect(t, arrayLength(t, array) > length);
+  int offset;
+  unsigned base;
+  unsigned path;
+};
 
-  PROTECT(t, array);
+class FrameMapTablePath {
+ public:
+  FrameMapTablePath(unsigned stackIndex, unsigned elementCount, unsigned next):
+    stackIndex(stackIndex),
+    elementCount(elementCount),
+    next(next)
+  { }
 
-  object newArray = makeArray(t, length);
-  if (length) {
-    memcpy(&arrayBody(t, newArray, 0), &arrayBody(t, array, 0),
-           length * BytesPerWord);
-  }
+  unsigned stackIndex;
+  unsigned elementCount;
+  unsigned next;
+  int32_t elements[0];
+};
 
-  return newArray;
+int
+compareInt32s(const void* va, const void* vb)
+{
+  return *static_cast<int32_t const*>(va) - *static_cast<int32_t const*>(vb);
 }
 
-object
-truncateLineNumberTable(Thread* t, object table, unsigned length)
+int
+compare(SubroutinePath* a, SubroutinePath* b)
 {
-  expect(t, lineNumberTableLength(t, table) > length);
-
-  PROTECT(t, table);
-
-  object newTable = makeLineNumberTable(t, length);
-  if (length) {
-    memcpy(&lineNumberTableBody(t, newTable, 0),
-           &lineNumberTableBody(t, table, 0),
-           length * sizeof(uint64_t));
+  if (a->stackNext) {
+    int d = compare(a->stackNext, b->stackNext);
+    if (d) return d;
+  }
+  int64_t av = a->call->returnAddress->value();
+  int64_t bv = b->call->returnAddress->value();
+  if (av > bv) {
+    return 1;
+  } else if (av < bv) {
+    return -1;
+  } else {
+    return 0;
   }
+}
 
-  return newTable;
+int
+compareSubroutineTracePointers(const void* va, const void* vb)
+{
+  return compare((*static_cast<SubroutineTrace* const*>(va))->path,
+                 (*static_cast<SubroutineTrace* const*>(vb))->path);
 }
 
 object
-translateExceptionHandlerTable(MyThread* t, Context* context, intptr_t start)
+makeGeneralFrameMapTable(MyThread* t, Context* context, uint8_t* start,
+                         TraceElement** elements, unsigned elementCount,
+                         unsigned pathFootprint, unsigned mapCount)
 {
-  Compiler* c = context->compiler;
-
-  object oldTable = codeExceptionHandlerTable
-    (t, methodCode(t, context->method));
-
-  if (oldTable) {
-    PROTECT(t, oldTable);
-
-    unsigned length = exceptionHandlerTableLength(t, oldTable);
-
-    object newIndex = makeIntArray(t, length * 3);
-    PROTECT(t, newIndex);
+  unsigned mapSize = frameMapSizeInBits(t, context->method);
+  unsigned indexOffset = sizeof(FrameMapTableHeader);
+  unsigned mapsOffset = indexOffset
+    + (elementCount * sizeof(FrameMapTableIndexElement));
+  unsigned pathsOffset = mapsOffset + (ceiling(mapCount * mapSize, 32) * 4);
 
-    object newTable = makeArray(t, length + 1);
-    PROTECT(t, newTable);
+  object table = makeByteArray(t, pathsOffset + pathFootprint);
+  
+  int8_t* body = &byteArrayBody(t, table, 0);
+  new (body) FrameMapTableHeader(elementCount);
+ 
+  unsigned nextTableIndex = pathsOffset;
+  unsigned nextMapIndex = 0;
+  for (unsigned i = 0; i < elementCount; ++i) {
+    TraceElement* p = elements[i];
+    unsigned mapBase = nextMapIndex;
 
-    unsigned ni = 0;
-    for (unsigned oi = 0; oi < length; ++ oi) {
-      uint64_t oldHandler = exceptionHandlerTableBody
-        (t, oldTable, oi);
+    unsigned pathIndex;
+    if (p->subroutineTrace) {
+      FrameMapTablePath* previous = 0;
+      Subroutine* subroutine = p->subroutineTrace->path->call->subroutine;
+      for (Subroutine* s = subroutine; s; s = s->stackNext) {
+        if (s->tableIndex == 0) {
+          unsigned pathObjectSize = sizeof(FrameMapTablePath)
+            + (sizeof(int32_t) * s->callCount);
 
-      int handlerStart = resolveIpForwards
-        (context, exceptionHandlerStart(oldHandler),
-         exceptionHandlerEnd(oldHandler));
+          assert(t, nextTableIndex + pathObjectSize
+                 <= byteArrayLength(t, table));
 
-      if (LIKELY(handlerStart >= 0)) {
-        assert(t, handlerStart < static_cast<int>
-               (codeLength(t, methodCode(t, context->method))));
+          s->tableIndex = nextTableIndex;
+          
+          nextTableIndex += pathObjectSize;
 
-        int handlerEnd = resolveIpBackwards
-          (context, exceptionHandlerEnd(oldHandler),
-           exceptionHandlerStart(oldHandler));
+          FrameMapTablePath* current = new (body + s->tableIndex)
+            FrameMapTablePath
+            (s->stackIndex, s->callCount,
+             s->stackNext ? s->stackNext->tableIndex : 0);
 
-        assert(t, handlerEnd >= 0);
-        assert(t, handlerEnd < static_cast<int>
-               (codeLength(t, methodCode(t, context->method))));
+          unsigned i = 0;
+          for (SubroutineCall* c = subroutine->calls; c; c = c->next) {
+            assert(t, i < s->callCount);
 
-        intArrayBody(t, newIndex, ni * 3)
-          = c->machineIp(handlerStart)->value() - start;
+            current->elements[i++]
+              = static_cast<intptr_t>(c->returnAddress->value())
+              - reinterpret_cast<intptr_t>(start);
+          }
+          assert(t, i == s->callCount);
 
-        intArrayBody(t, newIndex, (ni * 3) + 1)
-          = c->machineIp(handlerEnd)->value() - start;
+          qsort(current->elements, s->callCount, sizeof(int32_t),
+                compareInt32s);
 
-        intArrayBody(t, newIndex, (ni * 3) + 2)
-          = c->machineIp(exceptionHandlerIp(oldHandler))->value() - start;
+          if (previous) {
+            previous->next = s->tableIndex;
+          }
 
-        object type;
-        if (exceptionHandlerCatchType(oldHandler)) {
-          type = resolveClassInPool
-            (t, context->method, exceptionHandlerCatchType(oldHandler) - 1);
+          previous = current;
         } else {
-          type = 0;
+          break;
         }
-
-        set(t, newTable, ArrayBody + ((ni + 1) * BytesPerWord), type);
-
-        ++ ni;
       }
-    }
 
-    if (UNLIKELY(ni < length)) {
-      newIndex = truncateIntArray(t, newIndex, ni * 3);
-      newTable = truncateArray(t, newTable, ni + 1);
-    }
+      pathIndex = subroutine->tableIndex;
 
-    set(t, newTable, ArrayBody, newIndex);
+      THREAD_RUNTIME_ARRAY
+        (t, SubroutineTrace*, traces, p->subroutineTraceCount);
 
-    return newTable;
-  } else {
-    return 0;
-  }
-}
+      unsigned i = 0;
+      for (SubroutineTrace* trace = p->subroutineTrace;
+           trace; trace = trace->next)
+      {
+        assert(t, i < p->subroutineTraceCount);
+        RUNTIME_ARRAY_BODY(traces)[i++] = trace;
+      }
+      assert(t, i == p->subroutineTraceCount);
 
-object
-translateLineNumberTable(MyThread* t, Context* context, intptr_t start)
-{
-  object oldTable = codeLineNumberTable(t, methodCode(t, context->method));
-  if (oldTable) {
-    PROTECT(t, oldTable);
+      qsort(RUNTIME_ARRAY_BODY(traces), p->subroutineTraceCount,
+            sizeof(SubroutineTrace*), compareSubroutineTracePointers);
 
-    unsigned length = lineNumberTableLength(t, oldTable);
-    object newTable = makeLineNumberTable(t, length);
-    unsigned ni = 0;
-    for (unsigned oi = 0; oi < length; ++oi) {
-      uint64_t oldLine = lineNumberTableBody(t, oldTable, oi);
+      for (unsigned i = 0; i < p->subroutineTraceCount; ++i) {
+        assert(t, mapsOffset + ceiling(nextMapIndex + mapSize, 32) * 4
+               <= pathsOffset);
 
-      int ip = resolveIpForwards
-        (context, lineNumberIp(oldLine), oi + 1 < length
-         ? lineNumberIp(lineNumberTableBody(t, oldTable, oi + 1)) - 1
-         : lineNumberIp(oldLine) + 1);
+        copyFrameMap(reinterpret_cast<int32_t*>(body + mapsOffset),
+                     RUNTIME_ARRAY_BODY(traces)[i]->map, mapSize,
+                     nextMapIndex, p, RUNTIME_ARRAY_BODY(traces)[i]->path);
 
-      if (LIKELY(ip >= 0)) {
-        lineNumberTableBody(t, newTable, ni++) = lineNumber
-          (context->compiler->machineIp(ip)->value() - start,
-           lineNumberLine(oldLine));
+        nextMapIndex += mapSize;
       }
-    }
+    } else {
+      pathIndex = 0;
+
+      assert(t, mapsOffset + ceiling(nextMapIndex + mapSize, 32) * 4
+             <= pathsOffset);
 
-    if (UNLIKELY(ni < length)) {
-      newTable = truncateLineNumberTable(t, newTable, ni);      
+      copyFrameMap(reinterpret_cast<int32_t*>(body + mapsOffset), p->map,
+                   mapSize, nextMapIndex, p, 0);
+      
+      nextMapIndex += mapSize;
     }
 
-    return newTable;
-  } else {
-    return 0;
+    unsigned elementIndex = indexOffset
+      + (i * sizeof(FrameMapTableIndexElement));
+
+    assert(t, elementIndex + sizeof(FrameMapTableIndexElement) <= mapsOffset);
+
+    new (body + elementIndex) FrameMapTableIndexElement
+      (static_cast<intptr_t>(p->address->value())
+       - reinterpret_cast<intptr_t>(start), mapBase, pathIndex);
   }
+
+  assert(t, nextMapIndex == mapCount * mapSize);
+
+  return table;
 }
 
-void
-printSet(uintptr_t m, unsigned limit)
+object
+makeSimpleFrameMapTable(MyThread* t, Context* context, uint8_t* start, 
+                        TraceElement** elements, unsigned elementCount)
 {
-  if (limit) {
-    for (unsigned i = 0; i < 16; ++i) {
-      if ((m >> i) & 1) {
-        fprintf(stderr, "1");
-      } else {
-        fprintf(stderr, "_");
-      }
+  unsigned mapSize = frameMapSizeInBits(t, context->method);
+  object table = makeIntArray
+    (t, elementCount + ceiling(elementCount * mapSize, 32));
+
+  assert(t, intArrayLength(t, table) == elementCount
+         + simpleFrameMapTableSize(t, context->method, table));
+
+  for (unsigned i = 0; i < elementCount; ++i) {
+    TraceElement* p = elements[i];
+
+    intArrayBody(t, table, i) = static_cast<intptr_t>(p->address->value())
+      - reinterpret_cast<intptr_t>(start);
+
+    assert(t, elementCount + ceiling((i + 1) * mapSize, 32)
+           <= intArrayLength(t, table));
+
+    if (mapSize) {
+      copyFrameMap(&intArrayBody(t, table, elementCount), p->map,
+                   mapSize, i * mapSize, p, 0);
     }
   }
+
+  return table;
 }
 
 void
-calculateTryCatchRoots(Context* context, SubroutinePath* subroutinePath,
-                       uintptr_t* roots, unsigned mapSize, unsigned start,
-                       unsigned end)
+finish(MyThread* t, FixedAllocator* allocator, Context* context)
 {
-  memset(roots, 0xFF, mapSize * BytesPerWord);
+  Compiler* c = context->compiler;
 
-  if (DebugFrameMaps) {
-    fprintf(stderr, "calculate try/catch roots from %d to %d", start, end);
-    if (subroutinePath) {
-      fprintf(stderr, " ");
-      print(subroutinePath);
-    }
-    fprintf(stderr, "\n");
+  if (false) {
+    logCompile
+      (t, 0, 0,
+       reinterpret_cast<const char*>
+       (&byteArrayBody(t, className(t, methodClass(t, context->method)), 0)),
+       reinterpret_cast<const char*>
+       (&byteArrayBody(t, methodName(t, context->method), 0)),
+       reinterpret_cast<const char*>
+       (&byteArrayBody(t, methodSpec(t, context->method), 0)));
   }
 
-  for (TraceElement* te = context->traceLog; te; te = te->next) {
-    if (te->ip >= start and te->ip < end) {
-      uintptr_t* traceRoots = 0;
-      if (subroutinePath == 0) {
-        traceRoots = te->map;
-        te->watch = true;
-      } else {
-        for (SubroutineTrace* t = te->subroutineTrace; t; t = t->next) {
-          if (t->path == subroutinePath) {
-            traceRoots = t->map;
-            t->watch = true;
-            break;
-          }
-        }        
-      }
+  // for debugging:
+  if (false and
+      ::strcmp
+      (reinterpret_cast<const char*>
+       (&byteArrayBody(t, className(t, methodClass(t, context->method)), 0)),
+       "java/lang/System") == 0 and
+      ::strcmp
+      (reinterpret_cast<const char*>
+       (&byteArrayBody(t, methodName(t, context->method), 0)),
+       "<clinit>") == 0)
+  {
+    trap();
+  }
 
-      if (traceRoots) {
-        if (DebugFrameMaps) {
-          fprintf(stderr, "   use roots at ip %3d: ", te->ip);
-          printSet(*traceRoots, mapSize);
-          fprintf(stderr, "\n");
-        }
+  // the machine code has already been generated by
+  // compile(MyThread*, FixedAllocator*, BootContext*, object); what
+  // remains is to place it in the executable area and build the
+  // tables which refer to its address
 
-        for (unsigned wi = 0; wi < mapSize; ++wi) {
-          roots[wi] &= traceRoots[wi];
-        }
-      } else {
-        if (DebugFrameMaps) {
-          fprintf(stderr, "  skip roots at ip %3d\n", te->ip);
-        }
-      }
-    }
+  unsigned codeSize;
+  if (context->bootContext) {
+    codeSize = c->resolve(allocator->base + allocator->offset);
+  } else {
+    allocator = reserveCode(t, context, &codeSize);
   }
 
-  if (DebugFrameMaps) {
-    fprintf(stderr, "result roots          : ");
-    printSet(*roots, mapSize);
-    fprintf(stderr, "\n");
-  }
-}
+  unsigned total = pad(codeSize, TargetBytesPerWord)
+    + pad(c->poolSize(), TargetBytesPerWord);
 
-unsigned
-calculateFrameMaps(MyThread* t, Context* context, uintptr_t* originalRoots,
-                   unsigned eventIndex, SubroutinePath* subroutinePath = 0,
-                   uintptr_t* resultRoots = 0)
-{
-  // for each instruction with more than one predecessor, and for each
-  // stack position, determine if there exists a path to that
-  // instruction such that there is not an object pointer left at that
-  // stack position (i.e. it is uninitialized or contains primitive
-  // data).
+  target_uintptr_t* code = static_cast<target_uintptr_t*>
+    (allocator->allocate(total, TargetBytesPerWord));
+  uint8_t* start = reinterpret_cast<uint8_t*>(code);
 
-  unsigned mapSize = frameMapSizeInWords(t, context->method);
+  context->executableAllocator = allocator;
+  context->executableStart = code;
+  context->executableSize = total;
 
-  THREAD_RUNTIME_ARRAY(t, uintptr_t, roots, mapSize);
-  if (originalRoots) {
-    memcpy(RUNTIME_ARRAY_BODY(roots), originalRoots, mapSize * BytesPerWord);
-  } else {
-    memset(RUNTIME_ARRAY_BODY(roots), 0, mapSize * BytesPerWord);
+  if (context->objectPool) {
+    object pool = allocate3
+      (t, allocator, Machine::ImmortalAllocation,
+       FixedSizeOfArray + ((context->objectPoolCount + 1) * BytesPerWord),
+       true);
+
+    initArray(t, pool, context->objectPoolCount + 1);
+    mark(t, pool, 0);
+
+    // other threads may be linking their pools into the list at the
+    // same time:
+    object next;
+    do {
+      next = root(t, ObjectPools);
+      set(t, pool, ArrayBody, next);
+    } while (not compareAndSwapRoot(t, ObjectPools, next, pool));
+
+    unsigned i = 1;
+    for (PoolElement* p = context->objectPool; p; p = p->next) {
+      unsigned offset = ArrayBody + ((i++) * BytesPerWord);
+
+      p->address = reinterpret_cast<uintptr_t>(pool) + offset;
+
+      set(t, pool, offset, p->target);
+    }
   }
 
-  int32_t ip = -1;
+  c->write();
 
-  // invariant: for each stack position, roots contains a zero at that
-  // position if there exists some path to the current instruction
-  // such that there is definitely not an object pointer at that
-  // position.  Otherwise, roots contains a one at that position,
-  // meaning either all known paths result in an object pointer at
-  // that position, or the contents of that position are as yet
-  // unknown.
+  BootContext* bc = context->bootContext;
+  if (bc) {
+    for (DelayedPromise* p = bc->addresses;
+         p != bc->addressSentinal;
+         p = p->next)
+    {
+      p->basis = new(bc->zone) ResolvedPromise(p->basis->value());
+    }
+  }
 
-  unsigned length = context->eventLog.length();
-  while (eventIndex < length) {
-    Event e = static_cast<Event>(context->eventLog.get(eventIndex++));
-    switch (e) {
-    case PushContextEvent: {
-      eventIndex = calculateFrameMaps
-        (t, context, RUNTIME_ARRAY_BODY(roots), eventIndex, subroutinePath,
-         resultRoots);
-    } break;
+  { object newExceptionHandlerTable = translateExceptionHandlerTable
+      (t, context, reinterpret_cast<intptr_t>(start));
 
-    case PopContextEvent:
-      goto exit;
+    PROTECT(t, newExceptionHandlerTable);
 
-    case IpEvent: {
-      ip = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
+    object newLineNumberTable = translateLineNumberTable
+      (t, context, reinterpret_cast<intptr_t>(start));
 
-      if (DebugFrameMaps) {
-        fprintf(stderr, "       roots at ip %3d: ", ip);
-        printSet(*RUNTIME_ARRAY_BODY(roots), mapSize);
-        fprintf(stderr, "\n");
-      }
+    object code = methodCode(t, context->method);
 
-      uintptr_t* tableRoots
-        = (subroutinePath ? subroutinePath->rootTable : context->rootTable)
-        + (ip * mapSize);
+    code = makeCode
+      (t, 0, newExceptionHandlerTable, newLineNumberTable,
+       reinterpret_cast<uintptr_t>(start), codeSize, codeMaxStack(t, code),
+       codeMaxLocals(t, code), 0);
 
-      if (context->visitTable[ip] > 1) {
-        for (unsigned wi = 0; wi < mapSize; ++wi) {
-          uintptr_t newRoots = tableRoots[wi] & RUNTIME_ARRAY_BODY(roots)[wi];
+    set(t, context->method, MethodCode, code);
+  }
 
-          if ((eventIndex == length
-               or context->eventLog.get(eventIndex) == PopContextEvent)
-              and newRoots != tableRoots[wi])
+  if (context->traceLogCount) {
+    THREAD_RUNTIME_ARRAY(t, TraceElement*, elements, context->traceLogCount);
+    unsigned index = 0;
+    unsigned pathFootprint = 0;
+    unsigned mapCount = 0;
+    for (TraceElement* p = context->traceLog; p; p = p->next) {
+      assert(t, index < context->traceLogCount);
+
+      if (p->address) {
+        SubroutineTrace* trace = p->subroutineTrace;
+        unsigned myMapCount = 1;
+        if (trace) {
+          for (Subroutine* s = trace->path->call->subroutine;
+               s; s = s->stackNext)
           {
-            if (DebugFrameMaps) {
-              fprintf(stderr, "dirty roots!\n");
+            unsigned callCount = s->callCount;
+            myMapCount *= callCount;
+            if (not s->visited) {
+              s->visited = true;
+              pathFootprint += sizeof(FrameMapTablePath)
+                + (sizeof(int32_t) * callCount);
             }
-
-            context->dirtyRoots = true;
-          }
-
-          tableRoots[wi] = newRoots;
-          RUNTIME_ARRAY_BODY(roots)[wi] &= tableRoots[wi];
+          }
         }
+      
+        mapCount += myMapCount;
 
-        if (DebugFrameMaps) {
-          fprintf(stderr, " table roots at ip %3d: ", ip);
-          printSet(*tableRoots, mapSize);
-          fprintf(stderr, "\n");
+        RUNTIME_ARRAY_BODY(elements)[index++] = p;
+
+        if (p->target) {
+          insertCallNode
+            (t, makeCallNode
+             (t, p->address->value(), p->target, p->flags, 0));
         }
-      } else {
-        memcpy(tableRoots, RUNTIME_ARRAY_BODY(roots), mapSize * BytesPerWord);
       }
-    } break;
-
-    case MarkEvent: {
-      unsigned i = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
+    }
 
-      markBit(RUNTIME_ARRAY_BODY(roots), i);
-    } break;
+    qsort(RUNTIME_ARRAY_BODY(elements), index,
+          sizeof(TraceElement*), compareTraceElementPointers);
 
-    case ClearEvent: {
-      unsigned i = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
+    object map;
+    if (pathFootprint) {
+      map = makeGeneralFrameMapTable
+        (t, context, start, RUNTIME_ARRAY_BODY(elements), index, pathFootprint,
+         mapCount);
+    } else {
+      map = makeSimpleFrameMapTable
+        (t, context, start, RUNTIME_ARRAY_BODY(elements), index);
+    }
 
-      clearBit(RUNTIME_ARRAY_BODY(roots), i);
-    } break;
+    set(t, methodCode(t, context->method), CodePool, map);
+  }
 
-    case PushExceptionHandlerEvent: {
-      unsigned start = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
-      unsigned end = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
+  logCompile
+    (t, start, codeSize,
+     reinterpret_cast<const char*>
+     (&byteArrayBody(t, className(t, methodClass(t, context->method)), 0)),
+     reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodName(t, context->method), 0)),
+     reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodSpec(t, context->method), 0)));
 
-      if (context->subroutineTable and context->subroutineTable[start]) {
-        Subroutine* s = context->subroutineTable[start];
-        unsigned originalEventIndex = eventIndex;
+  // for debugging:
+  if (false and
+      ::strcmp
+      (reinterpret_cast<const char*>
+       (&byteArrayBody(t, className(t, methodClass(t, context->method)), 0)),
+       "java/lang/System") == 0 and
+      ::strcmp
+      (reinterpret_cast<const char*>
+       (&byteArrayBody(t, methodName(t, context->method), 0)),
+       "<clinit>") == 0)
+  {
+    trap();
+  }
 
-        for (SubroutineCall* c = s->calls; c; c = c->next) {
-          for (SubroutinePath* p = c->paths; p; p = p->listNext) {
-            calculateTryCatchRoots
-              (context, p, RUNTIME_ARRAY_BODY(roots), mapSize, start, end);
+  syncInstructionCache(start, codeSize);
+}
 
-            eventIndex = calculateFrameMaps
-              (t, context, RUNTIME_ARRAY_BODY(roots), originalEventIndex, p);
-          }
-        }
-      } else {
-        calculateTryCatchRoots
-          (context, 0, RUNTIME_ARRAY_BODY(roots), mapSize, start, end);
+// The bounds checks for array accesses of the form a[i] are redundant
+// inside a counted loop of the form
+//
+//   for (int i = C; i < a.length; ++i) { ... }
+//
+// where C is a non-negative constant, provided the loop assigns
+// neither a nor i apart from the increment at the end of its body and
+// can only be entered through its header.  We look for such loops in
+// the bytecode before compiling a method and record the accesses they
+// contain in Context::boundsTable.
 
-        eventIndex = calculateFrameMaps
-          (t, context, RUNTIME_ARRAY_BODY(roots), eventIndex, 0);
-      }
-    } break;
+class BranchVisitor {
+ public:
+  virtual void visit(unsigned target) = 0;
+};
 
-    case TraceEvent: {
-      TraceElement* te; context->eventLog.get(eventIndex, &te, BytesPerWord);
-      if (DebugFrameMaps) {
-        fprintf(stderr, " trace roots at ip %3d: ", ip);
-        printSet(*RUNTIME_ARRAY_BODY(roots), mapSize);
-        if (subroutinePath) {
-          fprintf(stderr, " ");
-          print(subroutinePath);
-        }
-        fprintf(stderr, "\n");
-      }
-        
-      uintptr_t* map;
-      bool watch;
-      if (subroutinePath == 0) {
-        map = te->map;
-        watch = te->watch;
-      } else {
-        SubroutineTrace* trace = 0;
-        for (SubroutineTrace* t = te->subroutineTrace; t; t = t->next) {
-          if (t->path == subroutinePath) {
-            trace = t;
-            break;
-          }
-        }
+// returns the offset of the instruction following the one at ip, or
+// zero if we do not know how to decode it
+unsigned
+nextInstruction(MyThread* t, object code, unsigned ip)
+{
+  switch (codeBody(t, code, ip)) {
+  case bipush:
+  case ldc:
+  case newarray:
+  case iload:
+  case lload:
+  case fload:
+  case dload:
+  case aload:
+  case istore:
+  case lstore:
+  case fstore:
+  case dstore:
+  case astore:
+  case ret:
+    return ip + 2;
+
+  case sipush:
+  case ldc_w:
+  case ldc2_w:
+  case iinc:
+  case ifeq:
+  case ifne:
+  case iflt:
+  case ifge:
+  case ifgt:
+  case ifle:
+  case if_icmpeq:
+  case if_icmpne:
+  case if_icmplt:
+  case if_icmpge:
+  case if_icmpgt:
+  case if_icmple:
+  case if_acmpeq:
+  case if_acmpne:
+  case ifnull:
+  case ifnonnull:
+  case goto_:
+  case jsr:
+  case getstatic:
+  case putstatic:
+  case getfield:
+  case putfield:
+  case invokevirtual:
+  case invokespecial:
+  case invokestatic:
+  case new_:
+  case anewarray:
+  case checkcast:
+  case instanceof:
+    return ip + 3;
+
+  case multianewarray:
+    return ip + 4;
+
+  case invokeinterface:
+  case goto_w:
+  case jsr_w:
+    return ip + 5;
+
+  case arraylength:
+  case athrow:
+  case monitorenter:
+  case monitorexit:
+    return ip + 1;
+
+  case wide:
+    return ip + (codeBody(t, code, ip + 1) == iinc ? 6 : 4);
+
+  case tableswitch: {
+    unsigned p = ((ip + 4) & ~3) + 4;
+    int32_t bottom = codeReadInt32(t, code, p);
+    int32_t top = codeReadInt32(t, code, p);
+    return p + ((top - bottom + 1) * 4);
+  }
+
+  case lookupswitch: {
+    unsigned p = ((ip + 4) & ~3) + 4;
+    int32_t pairCount = codeReadInt32(t, code, p);
+    return p + (pairCount * 8);
+  }
 
-        if (trace == 0) {
-          te->subroutineTrace = trace = new
-            (context->zone.allocate
-             (sizeof(SubroutineTrace) + (mapSize * BytesPerWord)))
-            SubroutineTrace(subroutinePath, te->subroutineTrace, mapSize);
+  default:
+    // everything else below invokeinterface is a single byte
+    return codeBody(t, code, ip) < invokeinterface ? ip + 1 : 0;
+  }
+}
 
-          ++ te->subroutineTraceCount;
-        }
+// visits the branch targets of the instruction at ip and returns
+// whether control may also continue with the next instruction
+bool
+visitBranches(MyThread* t, object code, unsigned ip, BranchVisitor* v)
+{
+  unsigned p = ip + 1;
 
-        map = trace->map;
-        watch = trace->watch;
-      }
+  switch (codeBody(t, code, ip)) {
+  case ifeq:
+  case ifne:
+  case iflt:
+  case ifge:
+  case ifgt:
+  case ifle:
+  case if_icmpeq:
+  case if_icmpne:
+  case if_icmplt:
+  case if_icmpge:
+  case if_icmpgt:
+  case if_icmple:
+  case if_acmpeq:
+  case if_acmpne:
+  case ifnull:
+  case ifnonnull:
+  case jsr:
+    v->visit(ip + codeReadInt16(t, code, p));
+    return true;
 
-      for (unsigned wi = 0; wi < mapSize; ++wi) {
-        uintptr_t v = RUNTIME_ARRAY_BODY(roots)[wi];
+  case jsr_w:
+    v->visit(ip + codeReadInt32(t, code, p));
+    return true;
 
-        if (watch and map[wi] != v) {
-          if (DebugFrameMaps) {
-            fprintf(stderr, "dirty roots due to trace watch!\n");
-          }
+  case goto_:
+    v->visit(ip + codeReadInt16(t, code, p));
+    return false;
 
-          context->dirtyRoots = true;
-        }
+  case goto_w:
+    v->visit(ip + codeReadInt32(t, code, p));
+    return false;
 
-        map[wi] = v;
-      }
+  case tableswitch: {
+    p = (p + 3) & ~3;
+    v->visit(ip + codeReadInt32(t, code, p));
+    int32_t bottom = codeReadInt32(t, code, p);
+    int32_t top = codeReadInt32(t, code, p);
+    for (int32_t i = bottom; i <= top; ++i) {
+      v->visit(ip + codeReadInt32(t, code, p));
+    }
+  } return false;
 
-      eventIndex += BytesPerWord;
-    } break;
+  case lookupswitch: {
+    p = (p + 3) & ~3;
+    v->visit(ip + codeReadInt32(t, code, p));
+    int32_t pairCount = codeReadInt32(t, code, p);
+    for (int32_t i = 0; i < pairCount; ++i) {
+      p += 4;
+      v->visit(ip + codeReadInt32(t, code, p));
+    }
+  } return false;
 
-    case PushSubroutineEvent: {
-      SubroutineCall* call;
-      context->eventLog.get(eventIndex, &call, BytesPerWord);
-      eventIndex += BytesPerWord;
+  case ireturn:
+  case lreturn:
+  case freturn:
+  case dreturn:
+  case areturn:
+  case return_:
+  case athrow:
+  case ret:
+    return false;
 
-      unsigned nextIndex = context->eventLog.get2(eventIndex);
+  default:
+    return true;
+  }
+}
 
-      eventIndex = nextIndex;
+// returns the local accessed by the instruction at ip if it is an
+// iload, aload, or istore (as specified by op), or -1 otherwise
+int
+localOperand(MyThread* t, object code, unsigned ip, unsigned op)
+{
+  unsigned instruction = codeBody(t, code, ip);
+  unsigned first = (op == iload ? iload_0
+                    : op == aload ? aload_0 : istore_0);
+
+  if (instruction == op) {
+    return codeBody(t, code, ip + 1);
+  } else if (instruction >= first and instruction <= first + 3) {
+    return instruction - first;
+  } else if (instruction == wide and codeBody(t, code, ip + 1) == op) {
+    unsigned p = ip + 2;
+    return static_cast<uint16_t>(codeReadInt16(t, code, p));
+  } else {
+    return -1;
+  }
+}
 
-      SubroutinePath* path = 0;
-      for (SubroutinePath* p = call->paths; p; p = p->listNext) {
-        if (p->stackNext == subroutinePath) {
-          path = p;
-          break;
-        }
-      }
+bool
+assignsLocal(MyThread* t, object code, unsigned ip, unsigned index)
+{
+  unsigned instruction = codeBody(t, code, ip);
+  unsigned local;
+  unsigned footprint = 1;
 
-      if (path == 0) {
-        path = new(&context->zone)
-          SubroutinePath(call, subroutinePath,
-                         makeRootTable(t, &(context->zone), context->method));
-      }
+  switch (instruction) {
+  case istore:
+  case fstore:
+  case astore:
+  case iinc:
+    local = codeBody(t, code, ip + 1);
+    break;
 
-      THREAD_RUNTIME_ARRAY(t, uintptr_t, subroutineRoots, mapSize);
+  case lstore:
+  case dstore:
+    local = codeBody(t, code, ip + 1);
+    footprint = 2;
+    break;
 
-      calculateFrameMaps
-        (t, context, RUNTIME_ARRAY_BODY(roots), call->subroutine->logIndex,
-         path, RUNTIME_ARRAY_BODY(subroutineRoots));
+  case wide: {
+    unsigned p = ip + 2;
+    local = static_cast<uint16_t>(codeReadInt16(t, code, p));
 
-      for (unsigned wi = 0; wi < mapSize; ++wi) {
-        RUNTIME_ARRAY_BODY(roots)[wi]
-          &= RUNTIME_ARRAY_BODY(subroutineRoots)[wi];
-      }      
-    } break;
+    switch (codeBody(t, code, ip + 1)) {
+    case istore:
+    case fstore:
+    case astore:
+    case iinc:
+      break;
 
-    case PopSubroutineEvent:
-      eventIndex = static_cast<unsigned>(-1);
-      goto exit;
+    case lstore:
+    case dstore:
+      footprint = 2;
+      break;
 
-    default: abort(t);
+    default:
+      return false;
     }
-  }
+  } break;
 
- exit:
-  if (resultRoots and ip != -1) {
-    if (DebugFrameMaps) {
-      fprintf(stderr, "result roots at ip %3d: ", ip);
-      printSet(*RUNTIME_ARRAY_BODY(roots), mapSize);
-      if (subroutinePath) {
-        fprintf(stderr, " ");
-        print(subroutinePath);
-      }
-      fprintf(stderr, "\n");
+  default:
+    if (instruction >= istore_0 and instruction <= astore_3) {
+      // istore_n, lstore_n, fstore_n, dstore_n and astore_n, in that
+      // order
+      unsigned kind = (instruction - istore_0) / 4;
+      local = (instruction - istore_0) % 4;
+      footprint = (kind == 1 or kind == 3) ? 2 : 1;
+    } else {
+      return false;
     }
-
-    memcpy(resultRoots, RUNTIME_ARRAY_BODY(roots), mapSize * BytesPerWord);
   }
 
-  return eventIndex;
+  return index >= local and index < local + footprint;
 }
 
-int
-compareTraceElementPointers(const void* va, const void* vb)
+bool
+pushesNonNegativeConstant(MyThread* t, object code, unsigned ip)
 {
-  TraceElement* a = *static_cast<TraceElement* const*>(va);
-  TraceElement* b = *static_cast<TraceElement* const*>(vb);
-  if (a->address->value() > b->address->value()) {
-    return 1;
-  } else if (a->address->value() < b->address->value()) {
-    return -1;
-  } else {
-    return 0;
+  switch (codeBody(t, code, ip)) {
+  case iconst_0:
+  case iconst_1:
+  case iconst_2:
+  case iconst_3:
+  case iconst_4:
+  case iconst_5:
+    return true;
+
+  case bipush:
+    return static_cast<int8_t>(codeBody(t, code, ip + 1)) >= 0;
+
+  case sipush: {
+    unsigned p = ip + 1;
+    return codeReadInt16(t, code, p) >= 0;
+  }
+
+  default:
+    return false;
   }
 }
 
 unsigned
-simpleFrameMapTableSize(MyThread* t, object method, object map)
+slotCount(unsigned code)
 {
-  int size = frameMapSizeInBits(t, method);
-  return ceiling(intArrayLength(t, map) * size, 32 + size);
+  switch (code) {
+  case VoidField:
+    return 0;
+
+  case LongField:
+  case DoubleField:
+    return 2;
+
+  default:
+    return 1;
+  }
 }
 
-uint8_t*
-finish(MyThread* t, FixedAllocator* allocator, Assembler* a, const char* name,
-       unsigned length)
+// computes how many stack slots the instruction at ip consumes and
+// produces, returning false if we do not know
+bool
+stackEffect(MyThread* t, object code, unsigned ip, unsigned* pops,
+            unsigned* pushes)
 {
-  uint8_t* start = static_cast<uint8_t*>
-    (allocator->allocate(length, TargetBytesPerWord));
+  unsigned instruction = codeBody(t, code, ip);
 
-  a->setDestination(start);
-  a->write();
+  switch (instruction) {
+  case nop:
+  case iinc:
+  case goto_:
+  case goto_w:
+  case return_:
+    *pops = 0; *pushes = 0;
+    return true;
 
-  logCompile(t, start, length, 0, name, 0);
+  case aconst_null:
+  case iconst_m1:
+  case iconst_0:
+  case iconst_1:
+  case iconst_2:
+  case iconst_3:
+  case iconst_4:
+  case iconst_5:
+  case fconst_0:
+  case fconst_1:
+  case fconst_2:
+  case bipush:
+  case sipush:
+  case ldc:
+  case ldc_w:
+  case iload:
+  case fload:
+  case aload:
+  case new_:
+    *pops = 0; *pushes = 1;
+    return true;
 
-  return start;
-}
+  case lconst_0:
+  case lconst_1:
+  case dconst_0:
+  case dconst_1:
+  case ldc2_w:
+  case lload:
+  case dload:
+    *pops = 0; *pushes = 2;
+    return true;
 
-void
-setBit(int32_t* dst, unsigned index)
-{
-  dst[index / 32] |= static_cast<int32_t>(1) << (index % 32);
-}
+  case iaload:
+  case faload:
+  case aaload:
+  case baload:
+  case caload:
+  case saload:
+  case iadd:
+  case fadd:
+  case isub:
+  case fsub:
+  case imul:
+  case fmul:
+  case idiv:
+  case fdiv:
+  case irem:
+  case vm::frem:
+  case ishl:
+  case ishr:
+  case iushr:
+  case iand:
+  case ior:
+  case ixor:
+  case fcmpl:
+  case fcmpg:
+    *pops = 2; *pushes = 1;
+    return true;
 
-void
-clearBit(int32_t* dst, unsigned index)
-{
-  dst[index / 32] &= ~(static_cast<int32_t>(1) << (index % 32));
-}
+  case laload:
+  case daload:
+  case lneg:
+  case dneg:
+  case l2d:
+  case d2l:
+    *pops = 2; *pushes = 2;
+    return true;
 
-void
-copyFrameMap(int32_t* dst, uintptr_t* src, unsigned mapSizeInBits,
-             unsigned offset, TraceElement* p,
-             SubroutinePath* subroutinePath)
-{
-  if (DebugFrameMaps) {
-    fprintf(stderr, "  orig roots at ip %3d: ", p->ip);
-    printSet(src[0], ceiling(mapSizeInBits, BitsPerWord));
-    print(subroutinePath);
-    fprintf(stderr, "\n");
+  case istore:
+  case fstore:
+  case astore:
+  case pop_:
+  case ifeq:
+  case ifne:
+  case iflt:
+  case ifge:
+  case ifgt:
+  case ifle:
+  case ifnull:
+  case ifnonnull:
+  case tableswitch:
+  case lookupswitch:
+  case ireturn:
+  case freturn:
+  case areturn:
+  case athrow:
+  case monitorenter:
+  case monitorexit:
+    *pops = 1; *pushes = 0;
+    return true;
 
-    fprintf(stderr, " final roots at ip %3d: ", p->ip);
-  }
+  case lstore:
+  case dstore:
+  case pop2:
+  case if_icmpeq:
+  case if_icmpne:
+  case if_icmplt:
+  case if_icmpge:
+  case if_icmpgt:
+  case if_icmple:
+  case if_acmpeq:
+  case if_acmpne:
+  case lreturn:
+  case dreturn:
+    *pops = 2; *pushes = 0;
+    return true;
 
-  for (unsigned j = 0; j < p->argumentIndex; ++j) {
-    if (getBit(src, j)) {
-      if (DebugFrameMaps) {
-        fprintf(stderr, "1");
-      }
-      setBit(dst, offset + j);
-    } else {
-      if (DebugFrameMaps) {
-        fprintf(stderr, "_");
-      }
-      clearBit(dst, offset + j);
-    }
-  }
+  case iastore:
+  case fastore:
+  case aastore:
+  case bastore:
+  case castore:
+  case sastore:
+    *pops = 3; *pushes = 0;
+    return true;
 
-  if (DebugFrameMaps) {
-    print(subroutinePath);
-    fprintf(stderr, "\n");
-  }
-}
+  case lastore:
+  case dastore:
+    *pops = 4; *pushes = 0;
+    return true;
 
-class FrameMapTableHeader {
- public:
-  FrameMapTableHeader(unsigned indexCount):
-    indexCount(indexCount)
-  { }
+  case ladd:
+  case dadd:
+  case lsub:
+  case dsub:
+  case lmul:
+  case dmul:
+  case ldiv_:
+  case ddiv:
+  case lrem:
+  case vm::drem:
+  case land:
+  case lor:
+  case lxor:
+    *pops = 4; *pushes = 2;
+    return true;
 
-  unsigned indexCount;
-};
+  case lshl:
+  case lshr:
+  case lushr:
+    *pops = 3; *pushes = 2;
+    return true;
 
-class FrameMapTableIndexElement {
- public:
-  FrameMapTableIndexElement(int offset, unsigned base, unsigned path):
-    offset(offset),
-    base(base),
-    path(path)
-  { }
+  case ineg:
+  case fneg:
+  case i2f:
+  case f2i:
+  case i2b:
+  case i2c:
+  case i2s:
+  case newarray:
+  case anewarray:
+  case arraylength:
+  case checkcast:
+  case instanceof:
+    *pops = 1; *pushes = 1;
+    return true;
 
-  int offset;
-  unsigned base;
-  unsigned path;
-};
+  case i2l:
+  case i2d:
+  case f2l:
+  case f2d:
+    *pops = 1; *pushes = 2;
+    return true;
 
-class FrameMapTablePath {
- public:
-  FrameMapTablePath(unsigned stackIndex, unsigned elementCount, unsigned next):
-    stackIndex(stackIndex),
-    elementCount(elementCount),
-    next(next)
-  { }
+  case l2i:
+  case l2f:
+  case d2i:
+  case d2f:
+    *pops = 2; *pushes = 1;
+    return true;
 
-  unsigned stackIndex;
-  unsigned elementCount;
-  unsigned next;
-  int32_t elements[0];
-};
+  case lcmp:
+  case dcmpl:
+  case dcmpg:
+    *pops = 4; *pushes = 1;
+    return true;
 
-int
-compareInt32s(const void* va, const void* vb)
-{
-  return *static_cast<int32_t const*>(va) - *static_cast<int32_t const*>(vb);
-}
+  case getstatic:
+  case putstatic:
+  case getfield:
+  case putfield: {
+    unsigned p = ip + 1;
+    uint16_t index = codeReadInt16(t, code, p);
+    object field = singletonObject(t, codePool(t, code), index - 1);
 
-int
-compare(SubroutinePath* a, SubroutinePath* b)
-{
-  if (a->stackNext) {
-    int d = compare(a->stackNext, b->stackNext);
-    if (d) return d;
-  }
-  int64_t av = a->call->returnAddress->value();
-  int64_t bv = b->call->returnAddress->value();
-  if (av > bv) {
-    return 1;
-  } else if (av < bv) {
-    return -1;
-  } else {
-    return 0;
-  }
-}
+    unsigned size = slotCount
+      (objectClass(t, field) == type(t, Machine::ReferenceType)
+       ? fieldCode(t, byteArrayBody(t, referenceSpec(t, field), 0))
+       : fieldCode(t, field));
 
-int
-compareSubroutineTracePointers(const void* va, const void* vb)
-{
-  return compare((*static_cast<SubroutineTrace* const*>(va))->path,
-                 (*static_cast<SubroutineTrace* const*>(vb))->path);
-}
+    unsigned instance = (instruction == getfield
+                         or instruction == putfield) ? 1 : 0;
 
-object
-makeGeneralFrameMapTable(MyThread* t, Context* context, uint8_t* start,
-                         TraceElement** elements, unsigned elementCount,
-                         unsigned pathFootprint, unsigned mapCount)
-{
-  unsigned mapSize = frameMapSizeInBits(t, context->method);
-  unsigned indexOffset = sizeof(FrameMapTableHeader);
-  unsigned mapsOffset = indexOffset
-    + (elementCount * sizeof(FrameMapTableIndexElement));
-  unsigned pathsOffset = mapsOffset + (ceiling(mapCount * mapSize, 32) * 4);
+    if (instruction == getstatic or instruction == getfield) {
+      *pops = instance; *pushes = size;
+    } else {
+      *pops = instance + size; *pushes = 0;
+    }
+  } return true;
+
+  case invokevirtual:
+  case invokespecial:
+  case invokestatic:
+  case invokeinterface: {
+    unsigned p = ip + 1;
+    uint16_t index = codeReadInt16(t, code, p);
+    object method = singletonObject(t, codePool(t, code), index - 1);
+
+    if (objectClass(t, method) == type(t, Machine::ReferenceType)) {
+      *pops = methodReferenceParameterFootprint
+        (t, method, instruction == invokestatic);
+      *pushes = slotCount(methodReferenceReturnCode(t, method));
+    } else {
+      *pops = methodParameterFootprint(t, method);
+      *pushes = slotCount(methodReturnCode(t, method));
+    }
+  } return true;
 
-  object table = makeByteArray(t, pathsOffset + pathFootprint);
-  
-  int8_t* body = &byteArrayBody(t, table, 0);
-  new (body) FrameMapTableHeader(elementCount);
- 
-  unsigned nextTableIndex = pathsOffset;
-  unsigned nextMapIndex = 0;
-  for (unsigned i = 0; i < elementCount; ++i) {
-    TraceElement* p = elements[i];
-    unsigned mapBase = nextMapIndex;
+  case multianewarray:
+    *pops = codeBody(t, code, ip + 3); *pushes = 1;
+    return true;
 
-    unsigned pathIndex;
-    if (p->subroutineTrace) {
-      FrameMapTablePath* previous = 0;
-      Subroutine* subroutine = p->subroutineTrace->path->call->subroutine;
-      for (Subroutine* s = subroutine; s; s = s->stackNext) {
-        if (s->tableIndex == 0) {
-          unsigned pathObjectSize = sizeof(FrameMapTablePath)
-            + (sizeof(int32_t) * s->callCount);
+  case wide:
+    switch (codeBody(t, code, ip + 1)) {
+    case iload:
+    case fload:
+    case aload:
+      *pops = 0; *pushes = 1;
+      return true;
 
-          assert(t, nextTableIndex + pathObjectSize
-                 <= byteArrayLength(t, table));
+    case lload:
+    case dload:
+      *pops = 0; *pushes = 2;
+      return true;
 
-          s->tableIndex = nextTableIndex;
-          
-          nextTableIndex += pathObjectSize;
+    case istore:
+    case fstore:
+    case astore:
+      *pops = 1; *pushes = 0;
+      return true;
 
-          FrameMapTablePath* current = new (body + s->tableIndex)
-            FrameMapTablePath
-            (s->stackIndex, s->callCount,
-             s->stackNext ? s->stackNext->tableIndex : 0);
+    case lstore:
+    case dstore:
+      *pops = 2; *pushes = 0;
+      return true;
 
-          unsigned i = 0;
-          for (SubroutineCall* c = subroutine->calls; c; c = c->next) {
-            assert(t, i < s->callCount);
+    case iinc:
+      *pops = 0; *pushes = 0;
+      return true;
 
-            current->elements[i++]
-              = static_cast<intptr_t>(c->returnAddress->value())
-              - reinterpret_cast<intptr_t>(start);
-          }
-          assert(t, i == s->callCount);
+    default:
+      return false;
+    }
 
-          qsort(current->elements, s->callCount, sizeof(int32_t),
-                compareInt32s);
+  default:
+    if ((instruction >= iload_0 and instruction <= aload_3)) {
+      // iload_n, lload_n, fload_n, dload_n and aload_n, in that order
+      unsigned kind = (instruction - iload_0) / 4;
+      *pops = 0; *pushes = (kind == 1 or kind == 3) ? 2 : 1;
+      return true;
+    } else if (instruction >= istore_0 and instruction <= astore_3) {
+      unsigned kind = (instruction - istore_0) / 4;
+      *pops = (kind == 1 or kind == 3) ? 2 : 1; *pushes = 0;
+      return true;
+    } else {
+      return false;
+    }
+  }
+}
 
-          if (previous) {
-            previous->next = s->tableIndex;
-          }
+// what we know about a stack slot while scanning a loop
+enum {
+  UnknownSlot,
+  ArraySlot, // the array a
+  IndexSlot  // the index i
+};
 
-          previous = current;
-        } else {
-          break;
-        }
-      }
+class SlotState {
+ public:
+  // the topmost count slots of the stack; anything below them is
+  // unknown
+  uint8_t* slots;
+  unsigned count;
+  bool reached;
+};
 
-      pathIndex = subroutine->tableIndex;
+class CountedLoop {
+ public:
+  CountedLoop(MyThread* t, object code, unsigned* ips, unsigned* numbers,
+              unsigned instructionCount, unsigned stackSize):
+    t(t), code(code), ips(ips), numbers(numbers),
+    instructionCount(instructionCount), stackSize(stackSize)
+  { }
 
-      THREAD_RUNTIME_ARRAY
-        (t, SubroutineTrace*, traces, p->subroutineTraceCount);
+  unsigned ip(unsigned instruction) {
+    return ips[instruction];
+  }
+
+  // returns the number of the instruction at offset ip, or
+  // instructionCount if there is none
+  unsigned number(unsigned ip) {
+    return ip < codeLength(t, code) and numbers[ip]
+      ? numbers[ip] - 1 : instructionCount;
+  }
+
+  MyThread* t;
+  object code;
+  unsigned* ips;
+  unsigned* numbers;
+  unsigned instructionCount;
+  unsigned stackSize;
+  // instructions in the loop, inclusive
+  unsigned first;
+  unsigned last;
+  // instructions in the body, inclusive, not including the increment
+  unsigned bodyFirst;
+  unsigned bodyLast;
+  // the first instruction of the condition, where control enters
+  unsigned condition;
+  unsigned array;
+  unsigned index;
+};
+
+class RangeVisitor: public BranchVisitor {
+ public:
+  RangeVisitor(unsigned start, unsigned end):
+    start(start), end(end), hit(false)
+  { }
 
-      unsigned i = 0;
-      for (SubroutineTrace* trace = p->subroutineTrace;
-           trace; trace = trace->next)
-      {
-        assert(t, i < p->subroutineTraceCount);
-        RUNTIME_ARRAY_BODY(traces)[i++] = trace;
-      }
-      assert(t, i == p->subroutineTraceCount);
+  virtual void visit(unsigned target) {
+    if (target >= start and target <= end) {
+      hit = true;
+    }
+  }
 
-      qsort(RUNTIME_ARRAY_BODY(traces), p->subroutineTraceCount,
-            sizeof(SubroutineTrace*), compareSubroutineTracePointers);
+  unsigned start;
+  unsigned end;
+  bool hit;
+};
 
-      for (unsigned i = 0; i < p->subroutineTraceCount; ++i) {
-        assert(t, mapsOffset + ceiling(nextMapIndex + mapSize, 32) * 4
-               <= pathsOffset);
+bool
+branchesInto(MyThread* t, object code, unsigned ip, unsigned start,
+             unsigned end)
+{
+  RangeVisitor v(start, end);
+  visitBranches(t, code, ip, &v);
+  return v.hit;
+}
 
-        copyFrameMap(reinterpret_cast<int32_t*>(body + mapsOffset),
-                     RUNTIME_ARRAY_BODY(traces)[i]->map, mapSize,
-                     nextMapIndex, p, RUNTIME_ARRAY_BODY(traces)[i]->path);
+// makes at least count slots of the state explicit
+bool
+expose(CountedLoop* loop, SlotState* s, unsigned count)
+{
+  if (s->count < count) {
+    if (count > loop->stackSize) {
+      return false;
+    }
 
-        nextMapIndex += mapSize;
-      }
-    } else {
-      pathIndex = 0;
+    unsigned missing = count - s->count;
+    memmove(s->slots + missing, s->slots, s->count);
+    memset(s->slots, UnknownSlot, missing);
+    s->count = count;
+  }
+  return true;
+}
 
-      assert(t, mapsOffset + ceiling(nextMapIndex + mapSize, 32) * 4
-             <= pathsOffset);
+// updates the state according to the instruction at ip, returning
+// false if we cannot tell what it does
+bool
+simulate(CountedLoop* loop, SlotState* s, unsigned ip)
+{
+  MyThread* t = loop->t;
+  object code = loop->code;
 
-      copyFrameMap(reinterpret_cast<int32_t*>(body + mapsOffset), p->map,
-                   mapSize, nextMapIndex, p, 0);
-      
-      nextMapIndex += mapSize;
+  int local = localOperand(t, code, ip, iload);
+  if (local < 0) {
+    local = localOperand(t, code, ip, aload);
+    if (local >= 0 and static_cast<unsigned>(local) == loop->array) {
+      if (s->count == loop->stackSize) return false;
+      s->slots[s->count++] = ArraySlot;
+      return true;
     }
+  } else if (static_cast<unsigned>(local) == loop->index) {
+    if (s->count == loop->stackSize) return false;
+    s->slots[s->count++] = IndexSlot;
+    return true;
+  }
 
-    unsigned elementIndex = indexOffset
-      + (i * sizeof(FrameMapTableIndexElement));
+  unsigned size;
+  unsigned depth;
+  switch (codeBody(t, code, ip)) {
+  case dup: size = 1; depth = 0; break;
+  case dup_x1: size = 1; depth = 1; break;
+  case dup_x2: size = 1; depth = 2; break;
+  case dup2: size = 2; depth = 0; break;
+  case dup2_x1: size = 2; depth = 1; break;
+  case dup2_x2: size = 2; depth = 2; break;
+
+  case swap: {
+    if (not expose(loop, s, 2)) return false;
+    uint8_t top = s->slots[s->count - 1];
+    s->slots[s->count - 1] = s->slots[s->count - 2];
+    s->slots[s->count - 2] = top;
+  } return true;
+
+  default: {
+    unsigned pops;
+    unsigned pushes;
+    if ((not stackEffect(t, code, ip, &pops, &pushes))
+        or (not expose(loop, s, pops)))
+    {
+      return false;
+    }
 
-    assert(t, elementIndex + sizeof(FrameMapTableIndexElement) <= mapsOffset);
+    s->count -= pops;
+    if (s->count + pushes > loop->stackSize) {
+      return false;
+    }
 
-    new (body + elementIndex) FrameMapTableIndexElement
-      (static_cast<intptr_t>(p->address->value())
-       - reinterpret_cast<intptr_t>(start), mapBase, pathIndex);
+    memset(s->slots + s->count, UnknownSlot, pushes);
+    s->count += pushes;
+  } return true;
   }
 
-  assert(t, nextMapIndex == mapCount * mapSize);
+  // copy the top size slots to below the depth slots under them
+  if ((not expose(loop, s, size + depth))
+      or s->count + size > loop->stackSize)
+  {
+    return false;
+  }
 
-  return table;
+  uint8_t* p = s->slots + s->count - size - depth;
+  memmove(p + size, p, size + depth);
+  memcpy(p, p + size + depth, size);
+  s->count += size;
+  return true;
 }
 
-object
-makeSimpleFrameMapTable(MyThread* t, Context* context, uint8_t* start, 
-                        TraceElement** elements, unsigned elementCount)
+bool
+merge(SlotState* dst, SlotState* src, unsigned stackSize)
 {
-  unsigned mapSize = frameMapSizeInBits(t, context->method);
-  object table = makeIntArray
-    (t, elementCount + ceiling(elementCount * mapSize, 32));
+  if (not dst->reached) {
+    dst->reached = true;
+    dst->count = src->count;
+    memcpy(dst->slots, src->slots, stackSize);
+    return true;
+  }
 
-  assert(t, intArrayLength(t, table) == elementCount
-         + simpleFrameMapTableSize(t, context->method, table));
+  // line the two stacks up at the top, forgetting whatever only one
+  // of them knows about
+  unsigned count = min(dst->count, src->count);
+  uint8_t* d = dst->slots + dst->count - count;
+  uint8_t* s = src->slots + src->count - count;
 
-  for (unsigned i = 0; i < elementCount; ++i) {
-    TraceElement* p = elements[i];
+  bool changed = count != dst->count;
+  for (unsigned i = 0; i < count; ++i) {
+    if (d[i] != s[i] and d[i] != UnknownSlot) {
+      d[i] = UnknownSlot;
+      changed = true;
+    }
+  }
 
-    intArrayBody(t, table, i) = static_cast<intptr_t>(p->address->value())
-      - reinterpret_cast<intptr_t>(start);
+  if (count != dst->count) {
+    memmove(dst->slots, d, count);
+    dst->count = count;
+  }
 
-    assert(t, elementCount + ceiling((i + 1) * mapSize, 32)
-           <= intArrayLength(t, table));
+  return changed;
+}
 
-    if (mapSize) {
-      copyFrameMap(&intArrayBody(t, table, elementCount), p->map,
-                   mapSize, i * mapSize, p, 0);
+class MergeVisitor: public BranchVisitor {
+ public:
+  MergeVisitor(CountedLoop* loop, SlotState* states, SlotState* state):
+    loop(loop), states(states), state(state), changed(false)
+  { }
+
+  virtual void visit(unsigned target) {
+    unsigned n = loop->number(target);
+    if (n >= loop->first and n <= loop->last
+        and merge(states + (n - loop->first), state, loop->stackSize))
+    {
+      changed = true;
     }
   }
 
-  return table;
+  CountedLoop* loop;
+  SlotState* states;
+  SlotState* state;
+  bool changed;
+};
+
+// returns the slot at the specified depth below the top of the stack
+unsigned
+slotAt(SlotState* s, unsigned depth)
+{
+  if (depth < s->count) {
+    return s->slots[s->count - depth - 1];
+  } else {
+    return UnknownSlot;
+  }
 }
 
+// tracks which stack slots hold a and i throughout the loop, and marks
+// the accesses in its body which use both as needing no bounds check
 void
-finish(MyThread* t, FixedAllocator* allocator, Context* context)
+markAccesses(CountedLoop* loop, Zone* zone, uintptr_t* table)
 {
-  Compiler* c = context->compiler;
+  MyThread* t = loop->t;
+  object code = loop->code;
 
-  if (false) {
-    logCompile
-      (t, 0, 0,
-       reinterpret_cast<const char*>
-       (&byteArrayBody(t, className(t, methodClass(t, context->method)), 0)),
-       reinterpret_cast<const char*>
-       (&byteArrayBody(t, methodName(t, context->method), 0)),
-       reinterpret_cast<const char*>
-       (&byteArrayBody(t, methodSpec(t, context->method), 0)));
-  }
+  unsigned count = loop->last - loop->first + 1;
+  unsigned stackSize = loop->stackSize;
 
-  // for debugging:
-  if (false and
-      ::strcmp
-      (reinterpret_cast<const char*>
-       (&byteArrayBody(t, className(t, methodClass(t, context->method)), 0)),
-       "java/lang/System") == 0 and
-      ::strcmp
-      (reinterpret_cast<const char*>
-       (&byteArrayBody(t, methodName(t, context->method), 0)),
-       "<clinit>") == 0)
-  {
-    trap();
+  SlotState* states = static_cast<SlotState*>
+    (zone->allocate(sizeof(SlotState) * (count + 1)));
+  uint8_t* slots = static_cast<uint8_t*>
+    (zone->allocate(stackSize * (count + 1)));
+  memset(slots, UnknownSlot, stackSize * (count + 1));
+
+  for (unsigned i = 0; i < count + 1; ++i) {
+    states[i].slots = slots + (i * stackSize);
+    states[i].count = 0;
+    states[i].reached = false;
   }
 
-  // todo: this is a CPU-intensive operation, so consider doing it
-  // earlier before we've acquired the global class lock to improve
-  // parallelism (the downside being that it may end up being a waste
-  // of cycles if another thread compiles the same method in parallel,
-  // which might be mitigated by fine-grained, per-method locking):
-  c->compile(context->leaf ? 0 : stackOverflowThunk(t),
-             TARGET_THREAD_STACKLIMIT);
+  // control enters the loop at its condition with nothing known about
+  // the stack
+  SlotState* scratch = states + count;
+  states[loop->condition - loop->first].reached = true;
 
-  // we must acquire the class lock here at the latest
- 
-  unsigned codeSize = c->resolve
-    (allocator->base + allocator->offset);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (unsigned i = 0; i < count; ++i) {
+      if (states[i].reached) {
+        scratch->count = states[i].count;
+        memcpy(scratch->slots, states[i].slots, stackSize);
 
-  unsigned total = pad(codeSize, TargetBytesPerWord)
-    + pad(c->poolSize(), TargetBytesPerWord);
+        unsigned ip = loop->ip(loop->first + i);
+        if (not simulate(loop, scratch, ip)) {
+          return;
+        }
 
-  target_uintptr_t* code = static_cast<target_uintptr_t*>
-    (allocator->allocate(total, TargetBytesPerWord));
-  uint8_t* start = reinterpret_cast<uint8_t*>(code);
+        MergeVisitor v(loop, states, scratch);
+        if (visitBranches(t, code, ip, &v)
+            and i + 1 < count
+            and merge(states + i + 1, scratch, stackSize))
+        {
+          changed = true;
+        }
 
-  context->executableAllocator = allocator;
-  context->executableStart = code;
-  context->executableSize = total;
+        if (v.changed) {
+          changed = true;
+        }
+      }
+    }
+  }
 
-  if (context->objectPool) {
-    object pool = allocate3
-      (t, allocator, Machine::ImmortalAllocation,
-       FixedSizeOfArray + ((context->objectPoolCount + 1) * BytesPerWord),
-       true);
+  for (unsigned n = loop->bodyFirst; n <= loop->bodyLast; ++n) {
+    SlotState* s = states + (n - loop->first);
+    if (s->reached) {
+      unsigned ip = loop->ip(n);
+      unsigned valueSize;
+      switch (codeBody(t, code, ip)) {
+      case iaload:
+      case laload:
+      case faload:
+      case daload:
+      case aaload:
+      case baload:
+      case caload:
+      case saload:
+        valueSize = 0;
+        break;
 
-    initArray(t, pool, context->objectPoolCount + 1);
-    mark(t, pool, 0);
+      case iastore:
+      case fastore:
+      case aastore:
+      case bastore:
+      case castore:
+      case sastore:
+        valueSize = 1;
+        break;
 
-    set(t, pool, ArrayBody, root(t, ObjectPools));
-    setRoot(t, ObjectPools, pool);
+      case lastore:
+      case dastore:
+        valueSize = 2;
+        break;
 
-    unsigned i = 1;
-    for (PoolElement* p = context->objectPool; p; p = p->next) {
-      unsigned offset = ArrayBody + ((i++) * BytesPerWord);
+      default:
+        continue;
+      }
 
-      p->address = reinterpret_cast<uintptr_t>(pool) + offset;
+      if (slotAt(s, valueSize) == IndexSlot
+          and slotAt(s, valueSize + 1) == ArraySlot)
+      {
+        markBit(table, ip);
+      }
+    }
+  }
+}
 
-      set(t, pool, offset, p->target);
+// checks that the loop can only be entered as intended and that only
+// the increment assigns a or i within it.  The instructions from the
+// store of i's initial value up to the start of the loop must not be
+// branch targets, and the only branch into the loop from outside may
+// be the one at entry, if any.
+bool
+isolated(CountedLoop* loop, unsigned init, unsigned entry,
+         unsigned increment)
+{
+  MyThread* t = loop->t;
+  object code = loop->code;
+
+  unsigned start = loop->ip(loop->first);
+  unsigned end = loop->ip(loop->last);
+
+  for (unsigned n = 0; n < loop->instructionCount; ++n) {
+    unsigned ip = loop->ip(n);
+
+    if (branchesInto(t, code, ip, loop->ip(init + 1), start - 1)
+        or ((n < loop->first or n > loop->last) and n != entry
+            and branchesInto(t, code, ip, start, end)))
+    {
+      return false;
     }
   }
 
-  c->write();
+  for (unsigned n = loop->first; n <= loop->last; ++n) {
+    unsigned ip = loop->ip(n);
+    switch (codeBody(t, code, ip)) {
+    case jsr:
+    case jsr_w:
+    case ret:
+      return false;
 
-  BootContext* bc = context->bootContext;
-  if (bc) {
-    for (DelayedPromise* p = bc->addresses;
-         p != bc->addressSentinal;
-         p = p->next)
+    default:
+      break;
+    }
+
+    if (assignsLocal(t, code, ip, loop->array)
+        or (n != increment and assignsLocal(t, code, ip, loop->index)))
     {
-      p->basis = new(bc->zone) ResolvedPromise(p->basis->value());
+      return false;
     }
   }
 
-  { object newExceptionHandlerTable = translateExceptionHandlerTable
-      (t, context, reinterpret_cast<intptr_t>(start));
+  object table = codeExceptionHandlerTable(t, code);
+  if (table) {
+    for (unsigned i = 0; i < exceptionHandlerTableLength(t, table); ++i) {
+      unsigned handler = exceptionHandlerIp
+        (exceptionHandlerTableBody(t, table, i));
+      if (handler >= loop->ip(init) and handler <= end) {
+        return false;
+      }
+    }
+  }
 
-    PROTECT(t, newExceptionHandlerTable);
+  return true;
+}
 
-    object newLineNumberTable = translateLineNumberTable
-      (t, context, reinterpret_cast<intptr_t>(start));
+bool
+isIncrement(CountedLoop* loop, unsigned n)
+{
+  MyThread* t = loop->t;
+  unsigned ip = loop->ip(n);
+  return codeBody(t, loop->code, ip) == iinc
+    and codeBody(t, loop->code, ip + 1) == loop->index
+    and codeBody(t, loop->code, ip + 2) == 1;
+}
 
-    object code = methodCode(t, context->method);
+// matches iload i; aload a; arraylength; if_icmpXX starting at
+// instruction n
+bool
+matchCondition(CountedLoop* loop, unsigned n, unsigned op)
+{
+  MyThread* t = loop->t;
+  object code = loop->code;
 
-    code = makeCode
-      (t, 0, newExceptionHandlerTable, newLineNumberTable,
-       reinterpret_cast<uintptr_t>(start), codeSize, codeMaxStack(t, code),
-       codeMaxLocals(t, code), 0);
+  if (n + 3 >= loop->instructionCount
+      or codeBody(t, code, loop->ip(n + 2)) != arraylength
+      or codeBody(t, code, loop->ip(n + 3)) != op)
+  {
+    return false;
+  }
 
-    set(t, context->method, MethodCode, code);
+  int index = localOperand(t, code, loop->ip(n), iload);
+  int array = localOperand(t, code, loop->ip(n + 1), aload);
+  if (index < 0 or array < 0) {
+    return false;
   }
 
-  if (context->traceLogCount) {
-    THREAD_RUNTIME_ARRAY(t, TraceElement*, elements, context->traceLogCount);
-    unsigned index = 0;
-    unsigned pathFootprint = 0;
-    unsigned mapCount = 0;
-    for (TraceElement* p = context->traceLog; p; p = p->next) {
-      assert(t, index < context->traceLogCount);
+  loop->index = index;
+  loop->array = array;
+  return true;
+}
 
-      if (p->address) {
-        SubroutineTrace* trace = p->subroutineTrace;
-        unsigned myMapCount = 1;
-        if (trace) {
-          for (Subroutine* s = trace->path->call->subroutine;
-               s; s = s->stackNext)
-          {
-            unsigned callCount = s->callCount;
-            myMapCount *= callCount;
-            if (not s->visited) {
-              s->visited = true;
-              pathFootprint += sizeof(FrameMapTablePath)
-                + (sizeof(int32_t) * callCount);
-            }
-          }
-        }
-      
-        mapCount += myMapCount;
+// matches <constant> istore i ending just before instruction n
+bool
+matchInit(CountedLoop* loop, unsigned n)
+{
+  MyThread* t = loop->t;
+  object code = loop->code;
+
+  return n >= 2
+    and pushesNonNegativeConstant(t, code, loop->ip(n - 2))
+    and localOperand(t, code, loop->ip(n - 1), istore)
+    == static_cast<int>(loop->index);
+}
+
+unsigned
+branchTarget(MyThread* t, object code, unsigned ip)
+{
+  unsigned p = ip + 1;
+  return codeBody(t, code, ip) == goto_w
+    ? ip + codeReadInt32(t, code, p)
+    : ip + codeReadInt16(t, code, p);
+}
 
-        RUNTIME_ARRAY_BODY(elements)[index++] = p;
+uintptr_t*
+findRedundantBoundsChecks(MyThread* t, Context* context)
+{
+  object code = methodCode(t, context->method);
+  unsigned length = codeLength(t, code);
+
+  unsigned* ips = static_cast<unsigned*>
+    (context->zone.allocate(length * sizeof(unsigned)));
+  unsigned* numbers = static_cast<unsigned*>
+    (context->zone.allocate(length * sizeof(unsigned)));
+  memset(numbers, 0, length * sizeof(unsigned));
+
+  unsigned count = 0;
+  for (unsigned ip = 0; ip < length;) {
+    unsigned next = nextInstruction(t, code, ip);
+    if (next == 0 or next > length) {
+      return 0;
+    }
 
-        if (p->target) {
-          insertCallNode
-            (t, makeCallNode
-             (t, p->address->value(), p->target, p->flags, 0));
-        }
+    ips[count] = ip;
+    numbers[ip] = ++ count;
+    ip = next;
+  }
+
+  uintptr_t* table = 0;
+
+  CountedLoop loop(t, code, ips, numbers, count, codeMaxStack(t, code));
+  for (unsigned n = 0; n < count; ++n) {
+    unsigned ip = ips[n];
+    unsigned entry;
+    unsigned increment;
+    unsigned init;
+
+    switch (codeBody(t, code, ip)) {
+    case goto_:
+    case goto_w: {
+      // a bottom-tested loop:
+      //
+      //      <constant>; istore i; goto condition
+      // body: ...
+      //      iinc i 1
+      // condition:
+      //      iload i; aload a; arraylength; if_icmplt body
+      unsigned condition = loop.number(branchTarget(t, code, ip));
+      if (condition >= count
+          or condition < n + 2
+          or not matchCondition(&loop, condition, if_icmplt)
+          or loop.number(branchTarget(t, code, ips[condition + 3])) != n + 1
+          or not isIncrement(&loop, condition - 1)
+          or not matchInit(&loop, n))
+      {
+        continue;
       }
-    }
 
-    qsort(RUNTIME_ARRAY_BODY(elements), index,
-          sizeof(TraceElement*), compareTraceElementPointers);
+      loop.first = n + 1;
+      loop.last = condition + 3;
+      loop.bodyFirst = n + 1;
+      loop.bodyLast = condition - 2;
+      loop.condition = condition;
+      entry = n;
+      increment = condition - 1;
+      init = n - 2;
+    } break;
 
-    object map;
-    if (pathFootprint) {
-      map = makeGeneralFrameMapTable
-        (t, context, start, RUNTIME_ARRAY_BODY(elements), index, pathFootprint,
-         mapCount);
-    } else {
-      map = makeSimpleFrameMapTable
-        (t, context, start, RUNTIME_ARRAY_BODY(elements), index);
-    }
+    case if_icmpge: {
+      // a top-tested loop:
+      //
+      //      <constant>; istore i
+      // condition:
+      //      iload i; aload a; arraylength; if_icmpge end
+      //      ...
+      //      iinc i 1
+      //      goto condition
+      // end:
+      if (n < 3
+          or not matchCondition(&loop, n - 3, if_icmpge)
+          or not matchInit(&loop, n - 3))
+      {
+        continue;
+      }
 
-    set(t, methodCode(t, context->method), CodePool, map);
-  }
+      unsigned end = loop.number(branchTarget(t, code, ip));
+      if (end >= count
+          or end < n + 3
+          or (codeBody(t, code, ips[end - 1]) != goto_
+              and codeBody(t, code, ips[end - 1]) != goto_w)
+          or loop.number(branchTarget(t, code, ips[end - 1])) != n - 3
+          or not isIncrement(&loop, end - 2))
+      {
+        continue;
+      }
 
-  logCompile
-    (t, start, codeSize,
-     reinterpret_cast<const char*>
-     (&byteArrayBody(t, className(t, methodClass(t, context->method)), 0)),
-     reinterpret_cast<const char*>
-     (&byteArrayBody(t, methodName(t, context->method), 0)),
-     reinterpret_cast<const char*>
-     (&byteArrayBody(t, methodSpec(t, context->method), 0)));
+      loop.first = n - 3;
+      loop.last = end - 1;
+      loop.bodyFirst = n + 1;
+      loop.bodyLast = end - 3;
+      loop.condition = n - 3;
+      entry = count;
+      increment = end - 2;
+      init = n - 5;
+    } break;
 
-  // for debugging:
-  if (false and
-      ::strcmp
-      (reinterpret_cast<const char*>
-       (&byteArrayBody(t, className(t, methodClass(t, context->method)), 0)),
-       "java/lang/System") == 0 and
-      ::strcmp
-      (reinterpret_cast<const char*>
-       (&byteArrayBody(t, methodName(t, context->method), 0)),
-       "<clinit>") == 0)
-  {
-    trap();
+    default:
+      continue;
+    }
+
+    if (isolated(&loop, init, entry, increment)) {
+      if (table == 0) {
+        unsigned size = ceiling(length, BitsPerWord) * BytesPerWord;
+        table = static_cast<uintptr_t*>(context->zone.allocate(size));
+        memset(table, 0, size);
+      }
+
+      markAccesses(&loop, &(context->zone), table);
+    }
   }
 
-  syncInstructionCache(start, codeSize);
+  return table;
 }
 
 void
@@ -7456,6 +10665,10 @@ compile(MyThread* t, Context* context)
 
   handleEntrance(t, &frame);
 
+  if (CheckArrayBounds) {
+    context->boundsTable = findRedundantBoundsChecks(t, context);
+  }
+
   Compiler::State* state = c->saveState();
 
   compile(t, &frame, 0);
@@ -7574,6 +10787,13 @@ compileVirtualMethod2(MyThread* t, object class_, unsigned index)
   object target = resolveTarget(t, class_, index);
   PROTECT(t, target);
 
+  if (shouldInterpret(t, target)) {
+    // leave the vtable pointing at the virtual thunk so we come back
+    // here, and count another invocation, next time
+    t->trace->nativeMethod = target;
+    return reinterpret_cast<void*>(bootNativeThunk(t));
+  }
+
   compile(t, codeAllocator(t), 0, target);
 
   void* address = reinterpret_cast<void*>(methodAddress(t, target));
@@ -7788,6 +11008,309 @@ invokeNative2(MyThread* t, object method)
   }
 }
 
+// Cold methods run on the bytecode interpreter (see interpreter.h)
+// until shouldInterpret decides they are hot enough to compile.  Each
+// interpreted method gets its own activation of the interpreter,
+// beneath a MyThread::CallTrace whose nativeMethod field is set to
+// the method, so stack walkers report it as they would a native
+// frame.  Calls out of interpreted code come back through
+// InterpreterClient::invoke, which either starts another such
+// activation or calls the target's compiled code.
+
+Interpreter*
+interpreter(MyThread* t);
+
+uint64_t
+invokeMethod(MyThread* t, object method, uintptr_t* arguments,
+             unsigned footprint, bool interpret);
+
+void
+pushArguments(MyThread* t, object method, uintptr_t* arguments)
+{
+  Interpreter* s = interpreter(t);
+
+  unsigned footprint = methodParameterFootprint(t, method);
+  if (UNLIKELY(s->sp + footprint + 1 > stackSizeInWords(t) / 2)) {
+    throwNew(t, Machine::StackOverflowErrorType);
+  }
+
+  unsigned index = 0;
+  if ((methodFlags(t, method) & ACC_STATIC) == 0) {
+    pushObject(s, reinterpret_cast<object>(arguments[index++]));
+  }
+
+  for (MethodSpecIterator it
+         (t, reinterpret_cast<const char*>
+          (&byteArrayBody(t, methodSpec(t, method), 0)));
+       it.hasNext();)
+  {
+    switch (*it.next()) {
+    case 'L':
+    case '[':
+      pushObject(s, reinterpret_cast<object>(arguments[index++]));
+      break;
+
+    case 'J':
+    case 'D': {
+      uint64_t v; memcpy(&v, arguments + index, 8);
+      pushLong(s, v);
+      index += 2;
+    } break;
+
+    default:
+      pushInt(s, arguments[index++]);
+      break;
+    }
+  }
+}
+
+// Calls the compiled code for the specified method, popping its
+// arguments off the top of the interpreter's stack and leaving any
+// exception it throws in Thread::exception.
+uint64_t
+invokeCompiled(MyThread* t, object method)
+{
+  Interpreter* s = interpreter(t);
+
+  unsigned footprint = methodParameterFootprint(t, method);
+  RUNTIME_ARRAY(uintptr_t, arguments, footprint);
+
+  unsigned sp = s->sp - footprint;
+  unsigned index = 0;
+  if ((methodFlags(t, method) & ACC_STATIC) == 0) {
+    RUNTIME_ARRAY_BODY(arguments)[index++]
+      = reinterpret_cast<uintptr_t>(peekObject(s, sp++));
+  }
+
+  for (MethodSpecIterator it
+         (t, reinterpret_cast<const char*>
+          (&byteArrayBody(t, methodSpec(t, method), 0)));
+       it.hasNext();)
+  {
+    switch (*it.next()) {
+    case 'L':
+    case '[':
+      RUNTIME_ARRAY_BODY(arguments)[index++]
+        = reinterpret_cast<uintptr_t>(peekObject(s, sp++));
+      break;
+
+    case 'J':
+    case 'D': {
+      uint64_t v = peekLong(s, sp);
+      memcpy(RUNTIME_ARRAY_BODY(arguments) + index, &v, 8);
+      index += 2;
+      sp += 2;
+    } break;
+
+    default:
+      RUNTIME_ARRAY_BODY(arguments)[index++] = peekInt(s, sp++);
+      break;
+    }
+  }
+
+  // the arguments stay on the interpreter's stack, where we can find
+  // them during GC, until the call returns:
+  uint64_t result = invokeMethod
+    (t, method, RUNTIME_ARRAY_BODY(arguments), footprint, false);
+
+  s->sp -= footprint;
+
+  return result;
+}
+
+// Pushes an interpreter frame for the specified method, whose
+// arguments are on top of the interpreter's stack.  Returns false if
+// another thread has compiled the method since we decided to
+// interpret it, in which case its code no longer has any bytecode.
+bool
+enterInterpretedMethod(MyThread* t, object method)
+{
+  object code = methodCode(t, method);
+
+  if (UNLIKELY(not unresolved(t, codeCompiled(t, code)))) {
+    return false;
+  }
+
+  PROTECT(t, code);
+
+  // the method may be compiled while we run it, which replaces its
+  // code, so run a clone which keeps the bytecode and constant pool:
+  object clone = methodClone(t, method);
+  set(t, clone, MethodCode, code);
+
+  Interpreter* s = interpreter(t);
+  checkStack(s, clone);
+  pushFrame(s, clone);
+
+  return true;
+}
+
+// Runs the frame pushed by enterInterpretedMethod to completion,
+// leaving any exception it throws in Thread::exception.
+uint64_t
+runInterpretedMethod(MyThread* t, object method)
+{
+  Interpreter* s = interpreter(t);
+
+  object r = interpret(s);
+
+  if (UNLIKELY(t->exception)) {
+    return 0;
+  }
+
+  vm::popFrame(s);
+
+  switch (methodReturnCode(t, method)) {
+  case ByteField:
+  case BooleanField:
+  case CharField:
+  case ShortField:
+  case FloatField:
+  case IntField:
+    return intValue(t, r);
+
+  case LongField:
+  case DoubleField:
+    return longValue(t, r);
+
+  case ObjectField:
+    return reinterpret_cast<uintptr_t>(r);
+
+  case VoidField:
+    return 0;
+
+  default:
+    abort(t);
+  }
+}
+
+// Runs the specified method, whose arguments are on top of the
+// interpreter's stack, in a new activation of the interpreter,
+// leaving any exception it throws in Thread::exception.
+uint64_t
+interpretMethod(MyThread* t, object method)
+{
+  if (UNLIKELY(not enterInterpretedMethod(t, method))) {
+    return invokeCompiled(t, method);
+  }
+
+  MyThread::CallTrace trace(t, method);
+  trace.nativeMethod = method;
+
+  return runInterpretedMethod(t, method);
+}
+
+uint64_t
+invokeMethod(MyThread* t, object method, uintptr_t* arguments,
+             unsigned footprint, bool interpret)
+{
+  if (interpret) {
+    pushArguments(t, method, arguments);
+
+    return interpretMethod(t, method);
+  }
+
+  unsigned returnType = fieldType(t, methodReturnCode(t, method));
+
+  uint64_t result;
+
+  { MyThread::CallTrace trace(t, method);
+
+    MyCheckpoint checkpoint(t);
+
+    result = vmInvoke
+      (t, reinterpret_cast<void*>(methodAddress(t, method)),
+       arguments,
+       footprint * BytesPerWord,
+       t->arch->alignFrameSize(t->arch->argumentFootprint(footprint))
+       * BytesPerWord,
+       returnType);
+  }
+
+  return result;
+}
+
+void
+checkInterpreterStack(MyThread* t)
+{
+  uintptr_t stackPosition = reinterpret_cast<uintptr_t>(&t);
+  if (UNLIKELY(t->stackLimit and stackPosition < t->stackLimit)) {
+    throwNew(t, Machine::StackOverflowErrorType);
+  }
+}
+
+class InterpreterClient: public Interpreter::Client {
+ public:
+  virtual bool invoke(Interpreter* s, object method) {
+    MyThread* t = static_cast<MyThread*>(s->t);
+
+    if (UNLIKELY(methodAbstract(t, method))) {
+      throwNew(t, Machine::AbstractMethodErrorType, "%s.%s%s",
+               &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+               &byteArrayBody(t, methodName(t, method), 0),
+               &byteArrayBody(t, methodSpec(t, method), 0));
+    }
+
+    checkInterpreterStack(t);
+
+    PROTECT(t, method);
+
+    uint64_t result;
+    if (shouldInterpret(t, method)) {
+      result = interpretMethod(t, method);
+    } else {
+      compile(t, codeAllocator(t), 0, method);
+
+      result = invokeCompiled(t, method);
+    }
+
+    if (UNLIKELY(t->exception)) {
+      if (UNLIKELY(t->flags & Thread::UseBackupHeapFlag)) {
+        collect(t, Heap::MinorCollection);
+      }
+
+      object exception = t->exception;
+      t->exception = 0;
+      vm::throw_(t, exception);
+    }
+
+    pushResult(s, methodReturnCode(t, method), result, false);
+
+    return true;
+  }
+
+  virtual void backEdge(Interpreter* s) {
+    Thread* t = s->t;
+
+    ++ methodRuntimeDataBackEdgeCount
+      (t, getMethodRuntimeData(t, frameMethod(s, s->frame)));
+  }
+};
+
+uint64_t
+interpretFromNativeThunk(MyThread* t, object method)
+{
+  checkInterpreterStack(t);
+
+  pushArguments
+    (t, method, static_cast<uintptr_t*>(t->stack)
+     + t->arch->frameFooterSize()
+     + t->arch->frameReturnAddressSize());
+
+  // we're already beneath the CallTrace the native thunk made for
+  // this method, so there's no need for another:
+  uint64_t result = enterInterpretedMethod(t, method)
+    ? runInterpretedMethod(t, method) : invokeCompiled(t, method);
+
+  if (UNLIKELY(t->exception)) {
+    object exception = t->exception;
+    t->exception = 0;
+    vm::throw_(t, exception);
+  }
+
+  return result;
+}
+
 uint64_t
 invokeNative(MyThread* t)
 {
@@ -7814,9 +11337,13 @@ invokeNative(MyThread* t)
 
   t->trace->targetMethod = t->trace->nativeMethod;
 
-  t->m->classpath->resolveNative(t, t->trace->nativeMethod);
+  if (methodFlags(t, t->trace->nativeMethod) & ACC_NATIVE) {
+    t->m->classpath->resolveNative(t, t->trace->nativeMethod);
 
-  result = invokeNative2(t, t->trace->nativeMethod);
+    result = invokeNative2(t, t->trace->nativeMethod);
+  } else {
+    result = interpretFromNativeThunk(t, t->trace->nativeMethod);
+  }
 
   unsigned parameterFootprint = methodParameterFootprint
     (t, t->trace->targetMethod);
@@ -8014,13 +11541,16 @@ visitStack(MyThread* t, Heap::Visitor* v)
   object target = targetMethod;
   bool mostRecent = true;
 
-  while (stack) {
-    if (targetMethod) {
+  // a trace may have a null stack if it belongs to an interpreted
+  // method called from a thread with no compiled frames below it, so
+  // we keep walking as long as there are traces:
+  while (stack or trace) {
+    if (targetMethod and stack) {
       visitArguments(t, v, stack, targetMethod);
       targetMethod = 0;
     }
 
-    object method = methodForIp(t, ip);
+    object method = stack ? methodForIp(t, ip) : 0;
     if (method) {
       PROTECT(t, method);
 
@@ -8585,26 +12115,19 @@ invoke(Thread* thread, object method, ArgumentList* arguments)
   THREAD_RESOURCE(t, uintptr_t, stackLimit,
                   static_cast<MyThread*>(t)->stackLimit = stackLimit);
 
-  unsigned returnCode = methodReturnCode(t, method);
-  unsigned returnType = fieldType(t, returnCode);
-
-  uint64_t result;
+  PROTECT(t, method);
 
-  { MyThread::CallTrace trace(t, method);
+  bool interpret = shouldInterpret(t, method);
+  if (not interpret) {
+    compile(t, local::codeAllocator(t), 0, method);
+  }
 
-    MyCheckpoint checkpoint(t);
+  assert(t, arguments->position == arguments->size);
 
-    assert(t, arguments->position == arguments->size);
+  uint64_t result = invokeMethod
+    (t, method, arguments->array, arguments->position, interpret);
 
-    result = vmInvoke
-      (t, reinterpret_cast<void*>(methodAddress(t, method)),
-       arguments->array,
-       arguments->position * BytesPerWord,
-       t->arch->alignFrameSize
-       (t->arch->argumentFootprint(arguments->position))
-       * BytesPerWord,
-       returnType);
-  }
+  unsigned returnCode = methodReturnCode(t, method);
 
   if (t->exception) { 
     if (UNLIKELY(t->flags & Thread::UseBackupHeapFlag)) {
@@ -8702,15 +12225,47 @@ class SignalHandler: public System::SignalHandler {
   unsigned fixedSize;
 };
 
+class SafepointHandler: public System::SignalHandler {
+ public:
+  SafepointHandler(): m(0) { }
+
+  virtual bool handleSignal(void** ip, void**, void** stack, void** thread) {
+    MyThread* t = static_cast<MyThread*>(m->localThread->get());
+    if (t and t->state == Thread::ActiveState and methodForIp(t, *ip)) {
+      // make it look as though the poll called the safepoint thunk.
+      // The slot below the stack pointer belongs to the signal frame,
+      // which we never return through.
+      void** sp = static_cast<void**>(*stack) - 1;
+      *sp = *ip;
+
+      *stack = sp;
+      *ip = reinterpret_cast<void*>(safepointThunk(t));
+      *thread = t;
+
+      return true;
+    }
+
+    return false;
+  }
+
+  Machine* m;
+};
+
 bool
 isThunk(MyThread* t, void* ip);
 
 bool
 isVirtualThunk(MyThread* t, void* ip);
 
+bool
+isInterfaceStub(MyThread* t, void* ip);
+
 bool
 isThunkUnsafeStack(MyThread* t, void* ip);
 
+uint64_t
+compileInterfaceMethod(MyThread* t);
+
 void
 boot(MyThread* t, BootImage* image, uint8_t* code);
 
@@ -8771,10 +12326,14 @@ class MyProcessor: public Processor {
    public:
     Thunk default_;
     Thunk defaultVirtual;
+    Thunk defaultInterface;
     Thunk native;
     Thunk aioob;
     Thunk stackOverflow;
+    Thunk safepoint;
     Thunk table;
+    Thunk allocate;
+    Thunk allocateArray;
   };
 
   MyProcessor(System* s, Allocator* allocator, bool useNativeFeatures):
@@ -8792,16 +12351,34 @@ class MyProcessor: public Processor {
                         Machine::ArithmeticException,
                         FixedSizeOfArithmeticException),
     codeAllocator(s, 0, 0),
+    codeChunks(0),
+    codeChunkCount(0),
+    codeChunkCapacity(0),
     callTableSize(0),
+    interfaceCacheTableSize(0),
+    interfaceStubCount(0),
     useNativeFeatures(useNativeFeatures),
-    compilationHandlers(0)
+    compilationHandlers(0),
+    statistics(false),
+    compiledMethodCount(0),
+    compiledBytecodeSize(0),
+    compiledCodeSize(0),
+    compileTime(0),
+    invocationThreshold(0),
+    backEdgeThreshold(0),
+    interpretedCallCount(0)
   {
+    expect(s, s->success(s->make(&tableLock)));
+
     thunkTable[compileMethodIndex] = voidPointer(local::compileMethod);
     thunkTable[compileVirtualMethodIndex] = voidPointer(compileVirtualMethod);
+    thunkTable[compileInterfaceMethodIndex] = voidPointer
+      (compileInterfaceMethod);
     thunkTable[invokeNativeIndex] = voidPointer(invokeNative);
     thunkTable[throwArrayIndexOutOfBoundsIndex] = voidPointer
       (throwArrayIndexOutOfBounds);
     thunkTable[throwStackOverflowIndex] = voidPointer(throwStackOverflow);
+    thunkTable[safepointIndex] = voidPointer(safepoint);
 #define THUNK(s) thunkTable[s##Index] = voidPointer(s);
 #include "thunks.cpp"
 #undef THUNK
@@ -8813,6 +12390,8 @@ class MyProcessor: public Processor {
     // table.
     thunkTable[dummyIndex] = reinterpret_cast<void*>
       (static_cast<uintptr_t>(UINT64_C(0x5555555555555555)));
+
+    makeIntrinsicIndex(intrinsicIndex);
   }
 
   virtual Thread*
@@ -8825,11 +12404,16 @@ class MyProcessor: public Processor {
     t->heapImage = heapImage;
     t->codeImage = codeImage;
     t->thunkTable = thunkTable;
+    t->cardTable = m->heap->cardTable();
+    t->pollPage = static_cast<uint8_t*>(m->system->pollPage());
 
 #if TARGET_BYTES_PER_WORD == BYTES_PER_WORD
 
     int mismatches =
       checkConstant(t, TARGET_THREAD_EXCEPTION, &Thread::exception, "TARGET_THREAD_EXCEPTION") +
+      checkConstant(t, TARGET_THREAD_HEAPINDEX, &Thread::heapIndex, "TARGET_THREAD_HEAPINDEX") +
+      checkConstant(t, TARGET_THREAD_HEAP, &Thread::heap, "TARGET_THREAD_HEAP") +
+      checkConstant(t, TARGET_THREAD_HEAPSIZE, &Thread::heapSizeInWords, "TARGET_THREAD_HEAPSIZE") +
       checkConstant(t, TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT, &MyThread::exceptionStackAdjustment, "TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT") +
       checkConstant(t, TARGET_THREAD_EXCEPTIONOFFSET, &MyThread::exceptionOffset, "TARGET_THREAD_EXCEPTIONOFFSET") +
       checkConstant(t, TARGET_THREAD_EXCEPTIONHANDLER, &MyThread::exceptionHandler, "TARGET_THREAD_EXCEPTIONHANDLER") +
@@ -8842,7 +12426,9 @@ class MyProcessor: public Processor {
       checkConstant(t, TARGET_THREAD_HEAPIMAGE, &MyThread::heapImage, "TARGET_THREAD_HEAPIMAGE") +
       checkConstant(t, TARGET_THREAD_CODEIMAGE, &MyThread::codeImage, "TARGET_THREAD_CODEIMAGE") +
       checkConstant(t, TARGET_THREAD_THUNKTABLE, &MyThread::thunkTable, "TARGET_THREAD_THUNKTABLE") +
-      checkConstant(t, TARGET_THREAD_STACKLIMIT, &MyThread::stackLimit, "TARGET_THREAD_STACKLIMIT");
+      checkConstant(t, TARGET_THREAD_STACKLIMIT, &MyThread::stackLimit, "TARGET_THREAD_STACKLIMIT") +
+      checkConstant(t, TARGET_THREAD_CARDTABLE, &MyThread::cardTable, "TARGET_THREAD_CARDTABLE") +
+      checkConstant(t, TARGET_THREAD_POLLPAGE, &MyThread::pollPage, "TARGET_THREAD_POLLPAGE");
 
     if(mismatches > 0) {
       fprintf(stderr, "%d constant mismatches\n", mismatches);
@@ -8940,6 +12526,12 @@ class MyProcessor: public Processor {
     }
 
     visitStack(t, v);
+
+    if (t->interpreter) {
+      vm::visitObjects(t->interpreter, v);
+    }
+
+    memset(t->handlerCache, 0, sizeof(t->handlerCache));
   }
 
   virtual void
@@ -9038,11 +12630,6 @@ class MyProcessor: public Processor {
       (t, RUNTIME_ARRAY_BODY(array), size, RUNTIME_ARRAY_BODY(objectMask),
        this_, spec, arguments);
     
-    PROTECT(t, method);
-
-    compile(static_cast<MyThread*>(t),
-            local::codeAllocator(static_cast<MyThread*>(t)), 0, method);
-
     return local::invoke(t, method, &list);
   }
 
@@ -9068,11 +12655,6 @@ class MyProcessor: public Processor {
       (t, RUNTIME_ARRAY_BODY(array), size, RUNTIME_ARRAY_BODY(objectMask),
        this_, spec, arguments);
 
-    PROTECT(t, method);
-
-    compile(static_cast<MyThread*>(t),
-            local::codeAllocator(static_cast<MyThread*>(t)), 0, method);
-
     return local::invoke(t, method, &list);
   }
 
@@ -9099,11 +12681,6 @@ class MyProcessor: public Processor {
       (t, RUNTIME_ARRAY_BODY(array), size, RUNTIME_ARRAY_BODY(objectMask),
        this_, spec, indirectObjects, arguments);
 
-    PROTECT(t, method);
-
-    compile(static_cast<MyThread*>(t),
-            local::codeAllocator(static_cast<MyThread*>(t)), 0, method);
-
     return local::invoke(t, method, &list);
   }
 
@@ -9129,11 +12706,6 @@ class MyProcessor: public Processor {
 
     assert(t, ((methodFlags(t, method) & ACC_STATIC) == 0) xor (this_ == 0));
 
-    PROTECT(t, method);
-      
-    compile(static_cast<MyThread*>(t), 
-            local::codeAllocator(static_cast<MyThread*>(t)), 0, method);
-
     return local::invoke(t, method, &list);
   }
 
@@ -9144,6 +12716,11 @@ class MyProcessor: public Processor {
       vm::dispose(t, t->reference);
     }
 
+    if (t->interpreter) {
+      t->m->heap->free
+        (t->interpreter, sizeof(Interpreter) + t->m->stackSizeInBytes);
+    }
+
     t->arch->release();
 
     t->m->heap->free(t, sizeof(*t));
@@ -9151,13 +12728,42 @@ class MyProcessor: public Processor {
   }
 
   virtual void dispose() {
+    if (statistics) {
+      fprintf(stderr, "compiled %u methods (%"LLD" bytes of bytecode, "
+              "%"LLD" bytes of machine code) in %"LLD" ms\n",
+              compiledMethodCount, compiledBytecodeSize, compiledCodeSize,
+              compileTime);
+
+      if (invocationThreshold) {
+        fprintf(stderr, "interpreted %"LLD" calls to cold methods\n",
+                interpretedCallCount);
+      }
+    }
+
     if (codeAllocator.base) {
       s->freeExecutable(codeAllocator.base, codeAllocator.capacity);
     }
 
+    codeIndex.dispose(allocator);
+    bootCodeIndex.dispose(allocator);
+
+    for (unsigned i = 0; i < codeChunkCount; ++i) {
+      codeChunks[i]->index.dispose(allocator);
+      allocator->free(codeChunks[i], sizeof(CodeChunk));
+    }
+
+    if (codeChunks) {
+      allocator->free(codeChunks, codeChunkCapacity * sizeof(CodeChunk*));
+    }
+
+    codeChunkIndex.dispose(allocator);
+
+    tableLock->dispose();
+
     compilationHandlers->dispose(allocator);
 
     s->handleSegFault(0);
+    s->handlePollFault(0);
 
     allocator->free(this, sizeof(*this));
   }
@@ -9195,14 +12801,17 @@ class MyProcessor: public Processor {
           c.stack = 0;
         } else if (target->stack
                    and (not isThunkUnsafeStack(t, ip))
-                   and (not isVirtualThunk(t, ip)))
+                   and (not isVirtualThunk(t, ip))
+                   and (not isInterfaceStub(t, ip)))
         {
           // we caught the thread in a thunk or native code, and the
           // saved stack pointer indicates the most recent Java frame
           // on the stack
           c.ip = getIp(target);
           c.stack = target->stack;
-        } else if (isThunk(t, ip) or isVirtualThunk(t, ip)) {
+        } else if (isThunk(t, ip) or isVirtualThunk(t, ip)
+                   or isInterfaceStub(t, ip))
+        {
           // we caught the thread in a thunk where the stack register
           // indicates the most recent Java frame on the stack
           
@@ -9244,7 +12853,7 @@ class MyProcessor: public Processor {
       collect(t, Heap::MinorCollection);
     }
 
-    return visitor.trace ? visitor.trace : makeObjectArray(t, 0);
+    return visitor.trace ? visitor.trace : makeEmptyTrace(t);
   }
 
   virtual void initialize(BootImage* image, uint8_t* code, unsigned capacity) {
@@ -9272,8 +12881,7 @@ class MyProcessor: public Processor {
   }
 
   virtual void visitRoots(Thread* t, HeapWalker* w) {
-    bootImage->methodTree = w->visitRoot(root(t, MethodTree));
-    bootImage->methodTreeSentinal = w->visitRoot(root(t, MethodTreeSentinal));
+    bootImage->compiledMethods = w->visitRoot(root(t, CompiledMethods));
     bootImage->virtualThunks = w->visitRoot(root(t, VirtualThunks));
   }
 
@@ -9313,27 +12921,52 @@ class MyProcessor: public Processor {
   }
 
   virtual void boot(Thread* t, BootImage* image, uint8_t* code) {
+    statistics = findProperty(t, "avian.jit.stats") != 0;
+
+    // tiering is off unless an invocation threshold is given, and is
+    // not supported in continuations builds, since the interpreter
+    // keeps its frames on the native stack where a continuation can't
+    // capture them
+    const char* threshold = findProperty(t, "avian.jit.invocation.threshold");
+    if (threshold and not Continuations) {
+      int n = atoi(threshold);
+      invocationThreshold = n > 0 ? n : 0;
+
+      threshold = findProperty(t, "avian.jit.backedge.threshold");
+      if (threshold) {
+        n = atoi(threshold);
+        backEdgeThreshold = n > 0 ? n : 0;
+      } else {
+        backEdgeThreshold = invocationThreshold;
+      }
+    }
+
     if (codeAllocator.base == 0) {
       codeAllocator.base = static_cast<uint8_t*>
         (s->tryAllocateExecutable(ExecutableAreaSizeInBytes));
       codeAllocator.capacity = ExecutableAreaSizeInBytes;
     }
 
+    codeIndex.init(allocator, codeAllocator.base, codeAllocator.capacity);
+
+    codeChunkIndex.init
+      (allocator, codeAllocator.base, codeAllocator.capacity);
+    codeChunkCapacity = (codeAllocator.capacity / CodeChunkSizeInBytes) + 1;
+    codeChunks = static_cast<CodeChunk**>
+      (allocator->allocate(codeChunkCapacity * sizeof(CodeChunk*)));
+
     if (image and code) {
       local::boot(static_cast<MyThread*>(t), image, code);
     } else {
       roots = makeArray(t, RootCount);
 
       setRoot(t, CallTable, makeArray(t, 128));
-      
-      setRoot(t, MethodTreeSentinal, makeTreeNode(t, 0, 0, 0));
-      setRoot(t, MethodTree, root(t, MethodTreeSentinal));
-      set(t, root(t, MethodTree), TreeNodeLeft,
-          root(t, MethodTreeSentinal));
-      set(t, root(t, MethodTree), TreeNodeRight,
-          root(t, MethodTreeSentinal));
+
+      setRoot(t, CompiledMethods, makeArray(t, 256));
     }
 
+    setRoot(t, CodeChunkMethods, makeArray(t, codeChunkCapacity));
+
     local::compileThunks(static_cast<MyThread*>(t), &codeAllocator);
 
     if (not (image and code)) {
@@ -9347,6 +12980,14 @@ class MyProcessor: public Processor {
     divideByZeroHandler.m = t->m;
     expect(t, t->m->system->success
            (t->m->system->handleDivideByZero(&divideByZeroHandler)));
+
+    safepointHandler.m = t->m;
+    if (t->m->system->success
+        (t->m->system->handlePollFault(&safepointHandler)))
+    {
+      static_cast<MyThread*>(t)->pollPage = static_cast<uint8_t*>
+        (t->m->system->pollPage());
+    }
   }
 
   virtual void callWithCurrentContinuation(Thread* t, object receiver) {
@@ -9406,13 +13047,33 @@ class MyProcessor: public Processor {
   unsigned codeImageSize;
   SignalHandler segFaultHandler;
   SignalHandler divideByZeroHandler;
+  SafepointHandler safepointHandler;
   FixedAllocator codeAllocator;
+  CodeIndex codeIndex;
+  CodeIndex bootCodeIndex;
+  CodeIndex codeChunkIndex;
+  CodeChunk** codeChunks;
+  unsigned codeChunkCount;
+  unsigned codeChunkCapacity;
+  System::Monitor* tableLock;
   ThunkCollection thunks;
   ThunkCollection bootThunks;
   unsigned callTableSize;
+  unsigned interfaceCacheTableSize;
+  unsigned interfaceStubCount;
   bool useNativeFeatures;
   void* thunkTable[dummyIndex + 1];
+  uint8_t intrinsicIndex[IntrinsicIndexSize];
   CompilationHandlerList* compilationHandlers;
+  bool statistics;
+  unsigned compiledMethodCount;
+  uint64_t compiledBytecodeSize;
+  uint64_t compiledCodeSize;
+  int64_t compileTime;
+  unsigned invocationThreshold;
+  unsigned backEdgeThreshold;
+  uint64_t interpretedCallCount;
+  InterpreterClient interpreterClient;
 };
 
 const char*
@@ -9462,6 +13123,42 @@ logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
   }
 }
 
+bool
+shouldInterpret(MyThread* t, object method)
+{
+  MyProcessor* p = processor(t);
+
+  if (p->invocationThreshold == 0
+      or (methodFlags(t, method) & ACC_NATIVE)
+      or methodAbstract(t, method)
+      or (not unresolved(t, methodAddress(t, method))))
+  {
+    return false;
+  }
+
+  PROTECT(t, method);
+
+  object data = getMethodRuntimeData(t, method);
+
+  // These counters are updated without synchronization, so concurrent
+  // callers may lose the odd increment.  That only delays promotion
+  // slightly, which is cheaper than a lock or atomic operation on
+  // every interpreted call.
+  if (++ methodRuntimeDataInvocationCount(t, data) > p->invocationThreshold
+      or methodRuntimeDataBackEdgeCount(t, data) > p->backEdgeThreshold)
+  {
+    return false;
+  }
+
+  initClass(t, methodClass(t, method));
+
+  if (p->statistics) {
+    ++ p->interpretedCallCount;
+  }
+
+  return true;
+}
+
 void*
 compileMethod2(MyThread* t, void* ip)
 {
@@ -9475,6 +13172,23 @@ compileMethod2(MyThread* t, void* ip)
 
   THREAD_RESOURCE0(t, static_cast<MyThread*>(t)->trace->targetMethod = 0);
 
+  if (methodVmFlags(t, target) & ReferenceStubFlag) {
+    target = resolveReferenceStub(t, target);
+
+    if (methodAbstract(t, target) or (methodFlags(t, target) & ACC_NATIVE)) {
+      // leave the call site pointing at the stub; these are rare
+      // enough that resolving the now-cached reference each time
+      // is not worth a separate path
+      return reinterpret_cast<void*>(prepareMethodForCall(t, target));
+    }
+  }
+
+  if (shouldInterpret(t, target)) {
+    // don't patch the caller until the target has been compiled
+    t->trace->nativeMethod = target;
+    return reinterpret_cast<void*>(bootNativeThunk(t));
+  }
+
   compile(t, codeAllocator(t), 0, target);
 
   uint8_t* updateIp = static_cast<uint8_t*>(ip);
@@ -9509,7 +13223,335 @@ compileMethod2(MyThread* t, void* ip)
     updateCall(t, op, updateIp, reinterpret_cast<void*>(address));
   }
 
-  return reinterpret_cast<void*>(address);
+  return reinterpret_cast<void*>(address);
+}
+
+object
+findInterfaceCacheNode(MyThread* t, void* address)
+{
+  object table = root(t, InterfaceCaches);
+  if (table == 0) {
+    return 0;
+  }
+
+  intptr_t key = reinterpret_cast<intptr_t>(address);
+  unsigned index = static_cast<uintptr_t>(key) & (arrayLength(t, table) - 1);
+
+  for (object n = arrayBody(t, table, index); n; n = callNodeNext(t, n)) {
+    if (callNodeAddress(t, n) == key) {
+      return n;
+    }
+  }
+
+  return 0;
+}
+
+// Resolves to the absolute address of a position within an interface
+// stub, once we know where the stub will be written.
+class StubLabel: public Promise {
+ public:
+  StubLabel(): start(0), offset(0) { }
+
+  virtual int64_t value() {
+    return reinterpret_cast<intptr_t>(start) + offset->value();
+  }
+
+  virtual bool resolved() {
+    return start != 0 and offset != 0 and offset->resolved();
+  }
+
+  uint8_t* start;
+  Promise* offset;
+};
+
+unsigned
+interfaceCacheClassOffset(unsigned index)
+{
+  return ArrayBody + ((index + 1) * BytesPerWord);
+}
+
+unsigned
+interfaceCacheMethodOffset(unsigned index)
+{
+  return ArrayBody + ((index + 1 + InterfaceCacheSize) * BytesPerWord);
+}
+
+uintptr_t
+compileInterfaceStub(MyThread* t, object pool, unsigned* size)
+{
+  // Each call site gets one stub, which compares the receiver's class
+  // against the InterfaceCacheSize entries of the site's pool and
+  // jumps to the compiled code of the matching method.  Both are read
+  // from the pool each time, so updateInterfaceCache can fill empty
+  // entries in place rather than compiling a new stub.  An empty entry
+  // has a null class, which never matches.
+
+  Context context(t);
+  Assembler* a = context.assembler;
+
+  // load the receiver and jump to defaultInterfaceThunk if it is null
+  // so that the NullPointerException is thrown from there:
+
+  Assembler::Register class_(t->arch->virtualCallTarget());
+  Assembler::Memory instance
+    (t->arch->stack(),
+     (t->arch->frameFooterSize() + t->arch->frameReturnAddressSize())
+     * TargetBytesPerWord);
+
+  a->apply(Move, TargetBytesPerWord, MemoryOperand, &instance,
+           TargetBytesPerWord, RegisterOperand, &class_);
+
+  ResolvedPromise missPromise(defaultInterfaceThunk(t));
+  Assembler::Constant miss(&missPromise);
+
+  ResolvedPromise nullPromise(0);
+  Assembler::Constant null(&nullPromise);
+
+  a->apply(JumpIfEqual, TargetBytesPerWord, ConstantOperand, &null,
+           TargetBytesPerWord, RegisterOperand, &class_,
+           TargetBytesPerWord, ConstantOperand, &miss);
+
+  Assembler::Memory header(class_.low, 0);
+  a->apply(Move, TargetBytesPerWord, MemoryOperand, &header,
+           TargetBytesPerWord, RegisterOperand, &class_);
+
+  // the mask may not fit in an immediate operand, and this assembler
+  // has no client to lend it a temporary register, so load it into
+  // one we're about to clobber anyway:
+
+  Assembler::Register cached(t->arch->virtualCallIndex());
+
+  ResolvedPromise maskPromise(TargetPointerMask);
+  Assembler::Constant mask(&maskPromise);
+  a->apply(Move, TargetBytesPerWord, ConstantOperand, &mask,
+           TargetBytesPerWord, RegisterOperand, &cached);
+  a->apply(And, TargetBytesPerWord, RegisterOperand, &cached,
+           TargetBytesPerWord, RegisterOperand, &class_,
+           TargetBytesPerWord, RegisterOperand, &class_);
+
+  // compare the receiver class against each cached class, reading
+  // the latter from the pool each time since the collector may move
+  // them:
+
+  ResolvedPromise poolPromise(reinterpret_cast<intptr_t>(pool));
+  Assembler::Constant poolConstant(&poolPromise);
+
+  StubLabel hits[InterfaceCacheSize];
+
+  for (unsigned i = 0; i < InterfaceCacheSize; ++i) {
+    a->apply(Move, TargetBytesPerWord, ConstantOperand, &poolConstant,
+             TargetBytesPerWord, RegisterOperand, &cached);
+
+    Assembler::Memory entry(cached.low, interfaceCacheClassOffset(i));
+    a->apply(Move, TargetBytesPerWord, MemoryOperand, &entry,
+             TargetBytesPerWord, RegisterOperand, &cached);
+
+    Assembler::Constant hit(hits + i);
+    a->apply(JumpIfEqual, TargetBytesPerWord, RegisterOperand, &cached,
+             TargetBytesPerWord, RegisterOperand, &class_,
+             TargetBytesPerWord, ConstantOperand, &hit);
+  }
+
+  a->apply(Jump, TargetBytesPerWord, ConstantOperand, &miss);
+
+  // on a hit, jump to the method's compiled code.  The method is
+  // stored before its class, so once we've seen the class we'll see
+  // the method too:
+
+  for (unsigned i = 0; i < InterfaceCacheSize; ++i) {
+    hits[i].offset = a->offset();
+
+    a->apply(LoadBarrier);
+
+    a->apply(Move, TargetBytesPerWord, ConstantOperand, &poolConstant,
+             TargetBytesPerWord, RegisterOperand, &cached);
+
+    Assembler::Memory method(cached.low, interfaceCacheMethodOffset(i));
+    a->apply(Move, TargetBytesPerWord, MemoryOperand, &method,
+             TargetBytesPerWord, RegisterOperand, &cached);
+
+    Assembler::Memory code(cached.low, MethodCode);
+    a->apply(Move, TargetBytesPerWord, MemoryOperand, &code,
+             TargetBytesPerWord, RegisterOperand, &cached);
+
+    Assembler::Memory compiled(cached.low, CodeCompiled);
+    a->apply(Move, TargetBytesPerWord, MemoryOperand, &compiled,
+             TargetBytesPerWord, RegisterOperand, &cached);
+
+    a->apply(Jump, TargetBytesPerWord, RegisterOperand, &cached);
+  }
+
+  *size = a->endBlock(false)->resolve(0, 0);
+
+  uint8_t* start = static_cast<uint8_t*>
+    (codeAllocator(t)->allocate(*size, TargetBytesPerWord));
+
+  for (unsigned i = 0; i < InterfaceCacheSize; ++i) {
+    hits[i].start = start;
+  }
+
+  a->setDestination(start);
+  a->write();
+
+  logCompile(t, start, *size, 0, "interfaceStub", 0);
+
+  return reinterpret_cast<uintptr_t>(start);
+}
+
+void
+recordInterfaceStub(MyThread* t, uintptr_t start, unsigned size)
+{
+  // Stubs are allocated from the code allocator, which never reuses
+  // memory, and we're called with the class lock held, so appending
+  // keeps the table sorted by address for isInterfaceStub to search.
+
+  MyProcessor* p = processor(t);
+
+  if (root(t, InterfaceStubs) == 0
+      or wordArrayLength(t, root(t, InterfaceStubs))
+      <= (p->interfaceStubCount + 1) * 2)
+  {
+    object newArray = makeWordArray
+      (t, nextPowerOfTwo((p->interfaceStubCount + 1) * 4));
+    if (root(t, InterfaceStubs)) {
+      memcpy(&wordArrayBody(t, newArray, 0),
+             &wordArrayBody(t, root(t, InterfaceStubs), 0),
+             wordArrayLength(t, root(t, InterfaceStubs)) * BytesPerWord);
+    }
+    setRoot(t, InterfaceStubs, newArray);
+  }
+
+  assert(t, p->interfaceStubCount == 0
+         or start > wordArrayBody
+         (t, root(t, InterfaceStubs), (p->interfaceStubCount - 1) * 2));
+
+  wordArrayBody(t, root(t, InterfaceStubs), p->interfaceStubCount * 2)
+    = start;
+  wordArrayBody(t, root(t, InterfaceStubs), (p->interfaceStubCount * 2) + 1)
+    = size;
+
+  // publish the entry before the count which makes it visible:
+  storeStoreMemoryBarrier();
+
+  ++ p->interfaceStubCount;
+}
+
+void
+updateInterfaceCache(MyThread* t, void* ip, object method, object class_,
+                     object target)
+{
+  PROTECT(t, method);
+  PROTECT(t, class_);
+  PROTECT(t, target);
+
+  ACQUIRE(t, t->m->classLock);
+
+  object node = findInterfaceCacheNode(t, ip);
+
+  if (node) {
+    // pools are immortal, so this one won't move if we trigger a GC:
+    object pool = callNodeTarget(t, node);
+
+    for (unsigned i = 0; i < InterfaceCacheSize; ++i) {
+      object c = cast<object>(pool, interfaceCacheClassOffset(i));
+      if (c == class_) {
+        // another thread got here first
+        return;
+      } else if (c == 0) {
+        // fill the empty entry in place; the stub reads the method
+        // only after matching the class, so store the class last:
+        set(t, pool, interfaceCacheMethodOffset(i), target);
+        storeStoreMemoryBarrier();
+        set(t, pool, interfaceCacheClassOffset(i), class_);
+        return;
+      }
+    }
+
+    // this call site is megamorphic, so leave its stub as it is and
+    // let misses fall back to findCachedInterfaceMethod
+    return;
+  }
+
+  object pool = allocate3
+    (t, codeAllocator(t), Machine::ImmortalAllocation,
+     FixedSizeOfArray + (((InterfaceCacheSize * 2) + 1) * BytesPerWord),
+     true);
+
+  initArray(t, pool, (InterfaceCacheSize * 2) + 1);
+  mark(t, pool, 0);
+
+  set(t, pool, ArrayBody, root(t, ObjectPools));
+  setRoot(t, ObjectPools, pool);
+
+  set(t, pool, interfaceCacheMethodOffset(0), target);
+  set(t, pool, interfaceCacheClassOffset(0), class_);
+
+  unsigned size;
+  uintptr_t stub = compileInterfaceStub(t, pool, &size);
+
+  recordInterfaceStub(t, stub, size);
+
+  if (root(t, InterfaceCaches) == 0) {
+    setRoot(t, InterfaceCaches, makeArray(t, 128));
+  }
+
+  MyProcessor* p = processor(t);
+  setRoot(t, InterfaceCaches, insertCallNode
+          (t, root(t, InterfaceCaches), &(p->interfaceCacheTableSize),
+           makeCallNode(t, reinterpret_cast<intptr_t>(ip), pool, 0, 0)));
+
+  updateCall(t, AlignedCall, ip, reinterpret_cast<void*>(stub));
+}
+
+uint64_t
+compileInterfaceMethod(MyThread* t)
+{
+  void* ip = getIp(t);
+
+  object node = findCallNode(t, ip);
+  object method = callNodeTarget(t, node);
+  PROTECT(t, method);
+
+  t->trace->targetMethod = method;
+
+  THREAD_RESOURCE0(t, static_cast<MyThread*>(t)->trace->targetMethod = 0);
+
+  object instance = resolveThisPointer(t, t->stack);
+  if (instance == 0) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  object class_ = objectClass(t, instance);
+  PROTECT(t, class_);
+
+  if (classVmFlags(t, class_) & BootstrapFlag) {
+    resolveSystemClass(t, root(t, Machine::BootLoader), className(t, class_));
+  }
+
+  object target = findCachedInterfaceMethod(t, method, class_);
+  PROTECT(t, target);
+
+  uintptr_t address = prepareMethodForCall(t, target);
+
+  // native and interpreted methods are reached via the native thunk,
+  // which relies on MyThread::trace::nativeMethod having been set by
+  // prepareMethodForCall, so we can't cache them in a stub:
+  if (t->trace->nativeMethod == 0
+      and (not useLongJump(t, address)))
+  {
+    updateInterfaceCache(t, ip, method, class_, target);
+  }
+
+  return address;
+}
+
+bool
+isThunk(MyProcessor::Thunk* thunk, void* ip)
+{
+  return reinterpret_cast<uintptr_t>(ip)
+    >= reinterpret_cast<uintptr_t>(thunk->start)
+    and reinterpret_cast<uintptr_t>(ip)
+    < reinterpret_cast<uintptr_t>(thunk->start + thunk->length);
 }
 
 bool
@@ -9522,7 +13564,9 @@ isThunk(MyProcessor::ThunkCollection* thunks, void* ip)
   return (reinterpret_cast<uintptr_t>(ip)
           >= reinterpret_cast<uintptr_t>(thunkStart)
           and reinterpret_cast<uintptr_t>(ip)
-          < reinterpret_cast<uintptr_t>(thunkEnd));
+          < reinterpret_cast<uintptr_t>(thunkEnd))
+    or isThunk(&(thunks->allocate), ip)
+    or isThunk(&(thunks->allocateArray), ip);
 }
 
 bool
@@ -9545,15 +13589,19 @@ isThunkUnsafeStack(MyProcessor::Thunk* thunk, void* ip)
 bool
 isThunkUnsafeStack(MyProcessor::ThunkCollection* thunks, void* ip)
 {
-  const unsigned NamedThunkCount = 5;
+  const unsigned NamedThunkCount = 9;
 
   MyProcessor::Thunk table[NamedThunkCount + ThunkCount];
 
   table[0] = thunks->default_;
   table[1] = thunks->defaultVirtual;
-  table[2] = thunks->native;
-  table[3] = thunks->aioob;
-  table[4] = thunks->stackOverflow;
+  table[2] = thunks->defaultInterface;
+  table[3] = thunks->native;
+  table[4] = thunks->aioob;
+  table[5] = thunks->stackOverflow;
+  table[6] = thunks->allocate;
+  table[7] = thunks->allocateArray;
+  table[8] = thunks->safepoint;
     
   for (unsigned i = 0; i < ThunkCount; ++i) {
     new (table + NamedThunkCount + i) MyProcessor::Thunk
@@ -9589,6 +13637,41 @@ isVirtualThunk(MyThread* t, void* ip)
   return false;
 }
 
+bool
+isInterfaceStub(MyThread* t, void* ip)
+{
+  object stubs = root(t, InterfaceStubs);
+  if (stubs == 0) {
+    return false;
+  }
+
+  unsigned count = processor(t)->interfaceStubCount;
+  loadMemoryBarrier();
+
+  if (count > wordArrayLength(t, stubs) / 2) {
+    count = wordArrayLength(t, stubs) / 2;
+  }
+
+  // the table is sorted by start address (see recordInterfaceStub):
+  uintptr_t address = reinterpret_cast<uintptr_t>(ip);
+  unsigned bottom = 0;
+  unsigned top = count;
+  for (unsigned span = top - bottom; span; span = top - bottom) {
+    unsigned middle = bottom + (span / 2);
+    uintptr_t start = wordArrayBody(t, stubs, middle * 2);
+
+    if (address < start) {
+      top = middle;
+    } else if (address >= start + wordArrayBody(t, stubs, (middle * 2) + 1)) {
+      bottom = middle + 1;
+    } else {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 bool
 isThunkUnsafeStack(MyThread* t, void* ip)
 {
@@ -9691,6 +13774,12 @@ insertCallNode(MyThread* t, object table, unsigned* size, object node)
 void
 insertCallNode(MyThread* t, object node)
 {
+  PROTECT(t, node);
+
+  // threads finishing compiled methods insert their call sites
+  // concurrently, while readers use findCallNode without locking:
+  ACQUIRE(t, processor(t)->tableLock);
+
   setRoot(t, CallTable, insertCallNode
           (t, root(t, CallTable), &(processor(t)->callTableSize), node));
 }
@@ -9892,11 +13981,17 @@ findThunks(MyThread* t, BootImage* image, uint8_t* code)
   p->bootThunks.default_ = thunkToThunk(image->thunks.default_, code);
   p->bootThunks.defaultVirtual
     = thunkToThunk(image->thunks.defaultVirtual, code);
+  p->bootThunks.defaultInterface
+    = thunkToThunk(image->thunks.defaultInterface, code);
   p->bootThunks.native = thunkToThunk(image->thunks.native, code);
   p->bootThunks.aioob = thunkToThunk(image->thunks.aioob, code);
   p->bootThunks.stackOverflow
     = thunkToThunk(image->thunks.stackOverflow, code);
+  p->bootThunks.safepoint = thunkToThunk(image->thunks.safepoint, code);
   p->bootThunks.table = thunkToThunk(image->thunks.table, code);
+  p->bootThunks.allocate = thunkToThunk(image->thunks.allocate, code);
+  p->bootThunks.allocateArray
+    = thunkToThunk(image->thunks.allocateArray, code);
 }
 
 void
@@ -9912,6 +14007,29 @@ fixupVirtualThunks(MyThread* t, uint8_t* code)
   }
 }
 
+void
+indexBootMethods(MyThread* t, BootImage* image, uint8_t* code)
+{
+  MyProcessor* p = processor(t);
+
+  p->bootCodeIndex.init(p->allocator, code, image->codeSize);
+
+  // the methods were recorded in the order their code was allocated,
+  // so they may be appended to the index in order
+  object methods = root(t, BootCompiledMethods);
+  for (unsigned i = 0; i < arrayLength(t, methods); ++i) {
+    object method = arrayBody(t, methods, i);
+    if (method == 0) {
+      break;
+    }
+
+    p->bootCodeIndex.add
+      (t, p->allocator, reinterpret_cast<void*>(methodCompiled(t, method)),
+       methodCompiledSize(t, method));
+    p->bootCodeIndex.publish();
+  }
+}
+
 void
 boot(MyThread* t, BootImage* image, uint8_t* code)
 {
@@ -9957,8 +14075,8 @@ boot(MyThread* t, BootImage* image, uint8_t* code)
 
   p->roots = makeArray(t, RootCount);
   
-  setRoot(t, MethodTree, bootObject(heap, image->methodTree));
-  setRoot(t, MethodTreeSentinal, bootObject(heap, image->methodTreeSentinal));
+  setRoot(t, BootCompiledMethods, bootObject(heap, image->compiledMethods));
+  setRoot(t, CompiledMethods, makeArray(t, 256));
 
   setRoot(t, VirtualThunks, bootObject(heap, image->virtualThunks));
 
@@ -10012,6 +14130,8 @@ boot(MyThread* t, BootImage* image, uint8_t* code)
       (t, classLoaderMap(t, root(t, Machine::AppLoader)), image, code);
   }
 
+  indexBootMethods(t, image, code);
+
   image->initialized = true;
 
   setRoot(t, Machine::BootstrapClassMap, makeHashMap(t, 0, 0));
@@ -10057,6 +14177,168 @@ compileCall(MyThread* t, Context* c, ThunkIndex index, bool call = true)
   }
 }
 
+bool
+useAllocateThunks(MyThread* t)
+{
+#ifdef VM_STRESS
+  return false;
+#else
+  // the fast path needs the class, the length, and two scratch
+  // registers without touching the stack:
+  return t->arch->argumentRegisterCount() >= 4;
+#endif
+}
+
+void
+compileAllocateThunk(MyThread* t, FixedAllocator* allocator,
+                     MyProcessor::Thunk* thunk, const char* name,
+                     Thunk fallback, bool array)
+{
+  Context context(t);
+  Assembler* a = context.assembler;
+
+  ResolvedPromise fallbackPromise(getThunk(t, fallback));
+  Assembler::Constant fallbackConstant(&fallbackPromise);
+
+  if (useAllocateThunks(t)) {
+    // bump t->heapIndex if the instance fits in what is left of the
+    // thread-local heap, which is kept zeroed ahead of time, and
+    // otherwise tail call the fallback thunk with the arguments
+    // untouched.  Nothing here can trigger a collection, so we never
+    // save the frame.
+
+    Assembler::Register thread(t->arch->thread());
+    Assembler::Register class_(t->arch->argumentRegister(1));
+    Assembler::Register size(t->arch->argumentRegister(3));
+    Assembler::Register index(t->arch->scratch());
+
+    Assembler::Memory fixedSize(class_.low, TargetClassFixedSize);
+
+    if (array) {
+      Assembler::Register length(t->arch->argumentRegister(2));
+
+      ResolvedPromise zeroPromise(0);
+      Assembler::Constant zero(&zeroPromise);
+
+      a->apply(JumpIfLess, 4, ConstantOperand, &zero,
+               4, RegisterOperand, &length,
+               TargetBytesPerWord, ConstantOperand, &fallbackConstant);
+
+      // no array with more elements than a thread-local heap has bytes
+      // can fit in one, and checking before we multiply ensures the
+      // size computed below cannot overflow a 32-bit word, since the
+      // element size is at most 8:
+      ResolvedPromise maxLengthPromise(MaxThreadHeapSizeInBytes);
+      Assembler::Constant maxLength(&maxLengthPromise);
+      a->apply(JumpIfGreater, 4, ConstantOperand, &maxLength,
+               4, RegisterOperand, &length,
+               TargetBytesPerWord, ConstantOperand, &fallbackConstant);
+
+      a->apply(Move, 4, RegisterOperand, &length,
+               TargetBytesPerWord, RegisterOperand, &size);
+
+      Assembler::Memory elementSize
+        (class_.low, TargetClassArrayElementSize);
+      a->apply(MoveZ, 1, MemoryOperand, &elementSize,
+               TargetBytesPerWord, RegisterOperand, &index);
+
+      a->apply(Multiply, TargetBytesPerWord, RegisterOperand, &index,
+               TargetBytesPerWord, RegisterOperand, &size,
+               TargetBytesPerWord, RegisterOperand, &size);
+
+      a->apply(MoveZ, 2, MemoryOperand, &fixedSize,
+               TargetBytesPerWord, RegisterOperand, &index);
+
+      a->apply(Add, TargetBytesPerWord, RegisterOperand, &index,
+               TargetBytesPerWord, RegisterOperand, &size,
+               TargetBytesPerWord, RegisterOperand, &size);
+    } else {
+      a->apply(MoveZ, 2, MemoryOperand, &fixedSize,
+               TargetBytesPerWord, RegisterOperand, &size);
+    }
+
+    ResolvedPromise roundPromise(TargetBytesPerWord - 1);
+    Assembler::Constant round(&roundPromise);
+    a->apply(Add, TargetBytesPerWord, ConstantOperand, &round,
+             TargetBytesPerWord, RegisterOperand, &size,
+             TargetBytesPerWord, RegisterOperand, &size);
+
+    ResolvedPromise shiftPromise(log(TargetBytesPerWord));
+    Assembler::Constant shift(&shiftPromise);
+    a->apply(UnsignedShiftRight, TargetBytesPerWord, ConstantOperand, &shift,
+             TargetBytesPerWord, RegisterOperand, &size,
+             TargetBytesPerWord, RegisterOperand, &size);
+
+    if (array) {
+      // nothing this big fits in a thread-local heap, and checking
+      // here means the comparison below can be done in 32 bits:
+      ResolvedPromise maxPromise
+        (MaxThreadHeapSizeInBytes / TargetBytesPerWord);
+      Assembler::Constant max(&maxPromise);
+      a->apply(JumpIfGreater, TargetBytesPerWord, ConstantOperand, &max,
+               TargetBytesPerWord, RegisterOperand, &size,
+               TargetBytesPerWord, ConstantOperand, &fallbackConstant);
+    }
+
+    Assembler::Memory heapIndex(thread.low, TARGET_THREAD_HEAPINDEX);
+    a->apply(Move, 4, MemoryOperand, &heapIndex,
+             TargetBytesPerWord, RegisterOperand, &index);
+
+    a->apply(Add, TargetBytesPerWord, RegisterOperand, &index,
+             TargetBytesPerWord, RegisterOperand, &size,
+             TargetBytesPerWord, RegisterOperand, &size);
+
+    Assembler::Memory heapSize(thread.low, TARGET_THREAD_HEAPSIZE);
+    a->apply(JumpIfLess, 4, RegisterOperand, &size,
+             4, MemoryOperand, &heapSize,
+             TargetBytesPerWord, ConstantOperand, &fallbackConstant);
+
+    a->apply(Move, 4, RegisterOperand, &size,
+             4, MemoryOperand, &heapIndex);
+
+    a->apply(ShiftLeft, TargetBytesPerWord, ConstantOperand, &shift,
+             TargetBytesPerWord, RegisterOperand, &index,
+             TargetBytesPerWord, RegisterOperand, &index);
+
+    Assembler::Memory heap(thread.low, TARGET_THREAD_HEAP);
+    a->apply(Move, TargetBytesPerWord, MemoryOperand, &heap,
+             TargetBytesPerWord, RegisterOperand, &size);
+
+    a->apply(Add, TargetBytesPerWord, RegisterOperand, &index,
+             TargetBytesPerWord, RegisterOperand, &size,
+             TargetBytesPerWord, RegisterOperand, &size);
+
+    Assembler::Memory header(size.low, 0);
+    a->apply(Move, TargetBytesPerWord, RegisterOperand, &class_,
+             TargetBytesPerWord, MemoryOperand, &header);
+
+    if (array) {
+      // the length is non-negative and the high half of the field
+      // (if any) is already zero:
+      Assembler::Register length(t->arch->argumentRegister(2));
+      Assembler::Memory lengthField
+        (size.low, TargetArrayLength + (t->arch->bigEndian()
+                                        ? TargetBytesPerWord - 4 : 0));
+      a->apply(Move, 4, RegisterOperand, &length,
+               4, MemoryOperand, &lengthField);
+    }
+
+    Assembler::Register result(t->arch->returnLow());
+    a->apply(Move, TargetBytesPerWord, RegisterOperand, &size,
+             TargetBytesPerWord, RegisterOperand, &result);
+
+    a->apply(Return);
+  } else {
+    a->apply(Jump, TargetBytesPerWord, ConstantOperand, &fallbackConstant);
+  }
+
+  thunk->frameSavedOffset = a->length();
+
+  thunk->length = a->endBlock(false)->resolve(0, 0);
+
+  thunk->start = finish(t, allocator, a, name, thunk->length);
+}
+
 void
 compileThunks(MyThread* t, FixedAllocator* allocator)
 {
@@ -10130,6 +14412,30 @@ compileThunks(MyThread* t, FixedAllocator* allocator)
       (t, allocator, a, "defaultVirtual", p->thunks.defaultVirtual.length);
   }
 
+  { Context context(t);
+    Assembler* a = context.assembler;
+    
+    a->saveFrame(TARGET_THREAD_STACK, TARGET_THREAD_IP);
+
+    p->thunks.defaultInterface.frameSavedOffset = a->length();
+
+    Assembler::Register thread(t->arch->thread());
+    a->pushFrame(1, TargetBytesPerWord, RegisterOperand, &thread);
+  
+    compileCall(t, &context, compileInterfaceMethodIndex);
+
+    a->popFrame(t->arch->alignFrameSize(1));
+
+    Assembler::Register result(t->arch->returnLow());
+    a->apply(Jump, TargetBytesPerWord, RegisterOperand, &result);
+
+    p->thunks.defaultInterface.length = a->endBlock(false)->resolve(0, 0);
+
+    p->thunks.defaultInterface.start = finish
+      (t, allocator, a, "defaultInterface",
+       p->thunks.defaultInterface.length);
+  }
+
   { Context context(t);
     Assembler* a = context.assembler;
 
@@ -10187,6 +14493,28 @@ compileThunks(MyThread* t, FixedAllocator* allocator)
       (t, allocator, a, "stackOverflow", p->thunks.stackOverflow.length);
   }
 
+  { Context context(t);
+    Assembler* a = context.assembler;
+      
+    a->saveFrame(TARGET_THREAD_STACK, TARGET_THREAD_IP);
+
+    p->thunks.safepoint.frameSavedOffset = a->length();
+
+    Assembler::Register thread(t->arch->thread());
+    a->pushFrame(1, TargetBytesPerWord, RegisterOperand, &thread);
+
+    compileCall(t, &context, safepointIndex);
+
+    a->popFrame(t->arch->alignFrameSize(1));
+
+    a->apply(Return);
+
+    p->thunks.safepoint.length = a->endBlock(false)->resolve(0, 0);
+
+    p->thunks.safepoint.start = finish
+      (t, allocator, a, "safepoint", p->thunks.safepoint.length);
+  }
+
   { { Context context(t);
       Assembler* a = context.assembler;
 
@@ -10229,6 +14557,13 @@ compileThunks(MyThread* t, FixedAllocator* allocator)
 #undef THUNK
   }
 
+  compileAllocateThunk
+    (t, allocator, &(p->thunks.allocate), "allocate", makeNew64Thunk, false);
+
+  compileAllocateThunk
+    (t, allocator, &(p->thunks.allocateArray), "allocateArray",
+     makeBlankArrayOfClassThunk, true);
+
   BootImage* image = p->bootImage;
 
   if (image) {
@@ -10237,11 +14572,17 @@ compileThunks(MyThread* t, FixedAllocator* allocator)
     image->thunks.default_ = thunkToThunk(p->thunks.default_, imageBase);
     image->thunks.defaultVirtual = thunkToThunk
       (p->thunks.defaultVirtual, imageBase);
+    image->thunks.defaultInterface = thunkToThunk
+      (p->thunks.defaultInterface, imageBase);
     image->thunks.native = thunkToThunk(p->thunks.native, imageBase);
     image->thunks.aioob = thunkToThunk(p->thunks.aioob, imageBase);
     image->thunks.stackOverflow = thunkToThunk
       (p->thunks.stackOverflow, imageBase);
+    image->thunks.safepoint = thunkToThunk(p->thunks.safepoint, imageBase);
     image->thunks.table = thunkToThunk(p->thunks.table, imageBase);
+    image->thunks.allocate = thunkToThunk(p->thunks.allocate, imageBase);
+    image->thunks.allocateArray = thunkToThunk
+      (p->thunks.allocateArray, imageBase);
   }
 }
 
@@ -10251,6 +14592,82 @@ processor(MyThread* t)
   return static_cast<MyProcessor*>(t->m->processor);
 }
 
+Interpreter*
+interpreter(MyThread* t)
+{
+  if (UNLIKELY(t->interpreter == 0)) {
+    void* p = t->m->heap->allocate
+      (sizeof(Interpreter) + t->m->stackSizeInBytes);
+
+    t->interpreter = new (p) Interpreter
+      (t, &(processor(t)->interpreterClient),
+       reinterpret_cast<uintptr_t*>(static_cast<Interpreter*>(p) + 1));
+  }
+
+  return t->interpreter;
+}
+
+const IntrinsicDescriptor*
+lookupIntrinsic(MyThread* t, object target)
+{
+  object name = methodName(t, target);
+  object spec = methodSpec(t, target);
+  object className = vm::className(t, methodClass(t, target));
+
+  const uint8_t* index = processor(t)->intrinsicIndex;
+  for (unsigned i = intrinsicHash
+         (intrinsicHash(t, className), intrinsicHash(t, name),
+          intrinsicHash(t, spec)) & (IntrinsicIndexSize - 1);
+       index[i];
+       i = (i + 1) & (IntrinsicIndexSize - 1))
+  {
+    const IntrinsicDescriptor* d = intrinsics + index[i] - 1;
+    if (intrinsicMatch(t, name, d->name)
+        and intrinsicMatch(t, spec, d->spec)
+        and intrinsicMatch(t, className, d->className))
+    {
+      return d;
+    }
+  }
+  return 0;
+}
+
+// Looks target up in the registry the first time it is asked about and
+// caches the answer: a miss in the method's vmFlags, and a hit in its
+// runtime data.  Boot images keep the flags but not the runtime data,
+// so a hit may need to be looked up again once.  Note that caching a
+// hit may allocate, so callers must protect target.
+const IntrinsicDescriptor*
+findIntrinsic(MyThread* t, object target)
+{
+  uint8_t flags = methodVmFlags(t, target);
+  if (flags & IntrinsicCheckedFlag) {
+    if ((flags & IntrinsicFlag) == 0) {
+      return 0;
+    } else if (methodRuntimeDataIndex(t, target)) {
+      unsigned i = methodRuntimeDataIntrinsic
+        (t, getMethodRuntimeData(t, target));
+      if (i) {
+        return intrinsics + i - 1;
+      }
+    }
+  }
+
+  const IntrinsicDescriptor* d = lookupIntrinsic(t, target);
+  if (d) {
+    PROTECT(t, target);
+
+    methodRuntimeDataIntrinsic(t, getMethodRuntimeData(t, target))
+      = d - intrinsics + 1;
+
+    methodVmFlags(t, target) |= IntrinsicCheckedFlag | IntrinsicFlag;
+  } else {
+    methodVmFlags(t, target) |= IntrinsicCheckedFlag;
+  }
+
+  return d;
+}
+
 uintptr_t
 defaultThunk(MyThread* t)
 {
@@ -10270,6 +14687,13 @@ defaultVirtualThunk(MyThread* t)
     (processor(t)->thunks.defaultVirtual.start);
 }
 
+uintptr_t
+defaultInterfaceThunk(MyThread* t)
+{
+  return reinterpret_cast<uintptr_t>
+    (processor(t)->thunks.defaultInterface.start);
+}
+
 uintptr_t
 nativeThunk(MyThread* t)
 {
@@ -10294,6 +14718,25 @@ stackOverflowThunk(MyThread* t)
   return reinterpret_cast<uintptr_t>(processor(t)->thunks.stackOverflow.start);
 }
 
+uintptr_t
+safepointThunk(MyThread* t)
+{
+  return reinterpret_cast<uintptr_t>(processor(t)->thunks.safepoint.start);
+}
+
+uintptr_t
+allocateThunk(MyThread* t)
+{
+  return reinterpret_cast<uintptr_t>(processor(t)->thunks.allocate.start);
+}
+
+uintptr_t
+allocateArrayThunk(MyThread* t)
+{
+  return reinterpret_cast<uintptr_t>
+    (processor(t)->thunks.allocateArray.start);
+}
+
 bool
 unresolved(MyThread* t, uintptr_t methodAddress)
 {
@@ -10365,6 +14808,134 @@ virtualThunk(MyThread* t, unsigned index)
   return wordArrayBody(t, root(t, VirtualThunks), index * 2);
 }
 
+object
+codeChunkMethods(MyThread* t, CodeChunk* chunk)
+{
+  return arrayBody(t, root(t, CodeChunkMethods), chunk->number);
+}
+
+CodeChunk*
+makeCodeChunk(MyThread* t, unsigned size)
+{
+  MyProcessor* p = processor(t);
+
+  ACQUIRE(t, t->m->classLock);
+
+  unsigned capacity = size < CodeChunkSizeInBytes
+    ? CodeChunkSizeInBytes : pad(size, TargetBytesPerWord) + TargetBytesPerWord;
+
+  uint8_t* base = static_cast<uint8_t*>
+    (p->codeAllocator.allocate(capacity, TargetBytesPerWord));
+
+  unsigned number = p->codeChunkCount;
+  expect(t, number < p->codeChunkCapacity);
+
+  set(t, root(t, CodeChunkMethods), ArrayBody + (number * BytesPerWord),
+      makeArray(t, 64));
+
+  CodeChunk* chunk = new (p->allocator->allocate(sizeof(CodeChunk)))
+    CodeChunk(t->m->system, base, capacity, number);
+
+  chunk->index.init(p->allocator, base, capacity);
+
+  p->codeChunks[number] = chunk;
+  ++ p->codeChunkCount;
+
+  // the chunk and its methods array must be visible to any thread
+  // which finds it in the directory, which publish ensures:
+  p->codeChunkIndex.add(t, p->allocator, base, capacity);
+  p->codeChunkIndex.publish();
+
+  return chunk;
+}
+
+FixedAllocator*
+reserveCode(MyThread* t, Context* context, unsigned* codeSize)
+{
+  // Returns the allocator for this thread's code chunk, claiming a new
+  // chunk if the current one can't hold the code and object pool of
+  // the method in context.  The remainder of a chunk we give up on is
+  // left unused.  Since padding in the generated code is relative to
+  // its start, the code can be resolved again at a new position
+  // without changing size.
+
+  Compiler* c = context->compiler;
+
+  CodeChunk* chunk = t->codeChunk;
+  FixedAllocator* allocator = chunk ? &(chunk->allocator)
+    : codeAllocator(t);
+
+  *codeSize = c->resolve(allocator->base + allocator->offset);
+
+  unsigned size = pad(*codeSize, TargetBytesPerWord)
+    + pad(c->poolSize(), TargetBytesPerWord);
+
+  if (context->objectPool) {
+    // a conservative bound on the size of the pool, including the
+    // header and object mask the heap adds to it:
+    size += 2 * (FixedSizeOfArray
+                 + ((context->objectPoolCount + 1) * BytesPerWord))
+      + (16 * BytesPerWord);
+  }
+
+  if (chunk == 0 or chunk->allocator.offset + size >= chunk->allocator.capacity)
+  {
+    chunk = t->codeChunk = makeCodeChunk(t, size);
+    allocator = &(chunk->allocator);
+
+    *codeSize = c->resolve(allocator->base + allocator->offset);
+  }
+
+  return allocator;
+}
+
+unsigned
+indexCompiledMethod(MyThread* t, CodeChunk* chunk, object clone)
+{
+  // Adds the clone to the index of the specified chunk, or, if chunk
+  // is null, to the processor-wide index used by the boot image
+  // generator, which relies on it holding methods in allocation order.
+  // The new entry is published before we return.
+
+  PROTECT(t, clone);
+
+  MyProcessor* p = processor(t);
+
+  CodeIndex* codeIndex = chunk ? &(chunk->index) : &(p->codeIndex);
+
+  unsigned index = codeIndex->add
+    (t, p->allocator, reinterpret_cast<void*>(methodCompiled(t, clone)),
+     methodCompiledSize(t, clone));
+
+  object methods = chunk ? codeChunkMethods(t, chunk)
+    : root(t, CompiledMethods);
+
+  if (index == arrayLength(t, methods)) {
+    PROTECT(t, methods);
+
+    object newMethods = makeArray(t, index * 2);
+    for (unsigned i = 0; i < index; ++i) {
+      set(t, newMethods, ArrayBody + (i * BytesPerWord),
+          arrayBody(t, methods, i));
+    }
+
+    if (chunk) {
+      set(t, root(t, CodeChunkMethods), ArrayBody
+          + (chunk->number * BytesPerWord), newMethods);
+    } else {
+      setRoot(t, CompiledMethods, newMethods);
+    }
+
+    methods = newMethods;
+  }
+
+  set(t, methods, ArrayBody + (index * BytesPerWord), clone);
+
+  codeIndex->publish();
+
+  return index;
+}
+
 void
 compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
         object method)
@@ -10398,6 +14969,9 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
 
   PROTECT(t, clone);
 
+  MyProcessor* p = processor(t);
+  int64_t then = p->statistics ? t->m->system->now() : 0;
+
   Context context(t, bootContext, clone);
   compile(t, &context);
 
@@ -10406,8 +14980,8 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
     if (ehTable) {
       PROTECT(t, ehTable);
 
-      // resolve all exception handler catch types before we acquire
-      // the class lock:
+      // resolve all exception handler catch types before we finish,
+      // so that no classloading happens while we place the code:
       for (unsigned i = 0; i < exceptionHandlerTableLength(t, ehTable); ++i) {
         uint64_t handler = exceptionHandlerTableBody(t, ehTable, i);
         if (exceptionHandlerCatchType(handler)) {
@@ -10418,7 +14992,20 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
     }
   }
 
-  ACQUIRE(t, t->m->classLock);
+  // Generating machine code is by far the most expensive part of
+  // compilation, so we do it without holding any lock, allowing
+  // threads compiling different methods to proceed in parallel.
+  context.compiler->compile
+    (context.leaf ? 0 : stackOverflowThunk(t), TARGET_THREAD_STACKLIMIT);
+
+  // The code is placed and indexed without the class lock as well:
+  // each thread has its own chunk of the executable area to allocate
+  // from and index (see CodeChunk).  Two threads may therefore finish
+  // compiling the same method, in which case the one whose code is
+  // published first below wins.
+
+  object original = methodCode(t, method);
+  PROTECT(t, original);
 
   if (methodAddress(t, method) != defaultThunk(t)) {
     return;
@@ -10426,43 +15013,53 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
 
   finish(t, allocator, &context);
  
-  if (DebugMethodTree) {
+  if (DebugCodeIndex) {
     fprintf(stderr, "insert method at %p\n",
             reinterpret_cast<void*>(methodCompiled(t, clone)));
   }
 
   // We can't update the MethodCode field on the original method
-  // before it is placed into the method tree, since another thread
+  // before it is placed into the code index, since another thread
   // might call the method, from which stack unwinding would fail
-  // (since there is not yet an entry in the method tree).  However,
-  // we can't insert the original method into the tree before updating
-  // the MethodCode field on it since we rely on that field to
-  // determine its position in the tree.  Therefore, we insert the
-  // clone in its place.  Later, we'll replace the clone with the
-  // original to save memory.
-
-  setRoot
-    (t, MethodTree, treeInsert
-     (t, &(context.zone), root(t, MethodTree),
-      methodCompiled(t, clone), clone, root(t, MethodTreeSentinal),
-      compareIpToMethodBounds));
+  // (since there is not yet an entry in the index).  However, we
+  // can't index the original method before updating the MethodCode
+  // field on it since we rely on that field to determine its code
+  // bounds.  Therefore, we index the clone in its place.  Later,
+  // we'll replace the clone with the original to save memory.
 
-  storeStoreMemoryBarrier();
+  CodeChunk* chunk = bootContext ? 0 : t->codeChunk;
+  unsigned index = indexCompiledMethod(t, chunk, clone);
 
-  set(t, method, MethodCode, methodCode(t, clone));
+  if (not atomicCompareAndSwapObject
+      (t, method, MethodCode, original, methodCode(t, clone)))
+  {
+    // another thread published its code for this method first.  Ours
+    // is already indexed under the clone, so we leave it there, unused.
+    context.executableAllocator = 0;
+    return;
+  }
 
   if (methodVirtual(t, method)) {
     classVtable(t, methodClass(t, method), methodOffset(t, method))
       = reinterpret_cast<void*>(methodCompiled(t, clone));
   }
 
-  // we've compiled the method and inserted it into the tree without
-  // error, so we ensure that the executable area not be deallocated
-  // when we dispose of the context:
+  // we've compiled the method and indexed it without error, so we
+  // ensure that the executable area not be deallocated when we dispose
+  // of the context:
   context.executableAllocator = 0;
 
-  treeUpdate(t, root(t, MethodTree), methodCompiled(t, clone),
-             method, root(t, MethodTreeSentinal), compareIpToMethodBounds);
+  set(t, chunk ? codeChunkMethods(t, chunk) : root(t, CompiledMethods),
+      ArrayBody + (index * BytesPerWord), method);
+
+  if (p->statistics) {
+    ACQUIRE(t, p->tableLock);
+
+    ++ p->compiledMethodCount;
+    p->compiledBytecodeSize += codeLength(t, methodCode(t, method));
+    p->compiledCodeSize += methodCompiledSize(t, method);
+    p->compileTime += t->m->system->now() - then;
+  }
 }
 
 object&
@@ -10478,12 +15075,59 @@ setRoot(Thread* t, Root root, object value)
       ArrayBody + (root * BytesPerWord), value);
 }
 
+bool
+compareAndSwapRoot(Thread* t, Root root, object old, object new_)
+{
+  return atomicCompareAndSwapObject
+    (t, processor(static_cast<MyThread*>(t))->roots,
+     ArrayBody + (root * BytesPerWord), old, new_);
+}
+
 FixedAllocator*
 codeAllocator(MyThread* t)
 {
   return &(processor(t)->codeAllocator);
 }
 
+object
+methodForIp(MyThread* t, void* ip)
+{
+  if (DebugCodeIndex) {
+    fprintf(stderr, "query for method containing %p\n", ip);
+  }
+
+  // CodeIndex::find issues a load barrier after reading the entry
+  // count, so the method found has been compiled at least as recently
+  // as the index entry (see compile(MyThread*, FixedAllocator*,
+  // BootContext*, object)):
+
+  MyProcessor* p = processor(t);
+
+  int index = p->codeChunkIndex.find(ip);
+  if (index >= 0) {
+    CodeChunk* chunk = p->codeChunks[index];
+
+    index = chunk->index.find(ip);
+    if (index >= 0) {
+      return arrayBody(t, codeChunkMethods(t, chunk), index);
+    }
+
+    return 0;
+  }
+
+  index = p->codeIndex.find(ip);
+  if (index >= 0) {
+    return arrayBody(t, root(t, CompiledMethods), index);
+  }
+
+  index = p->bootCodeIndex.find(ip);
+  if (index >= 0) {
+    return arrayBody(t, root(t, BootCompiledMethods), index);
+  }
+
+  return 0;
+}
+
 } // namespace local
 
 } // namespace
@@ -5031,6 +5031,202 @@ appendBoundsCheck(Context* c, Value* object, unsigned lengthOffset,
   append(c, new(c->zone) BoundsCheckEvent(c, object, lengthOffset, index, handler));
 }
 
+class AtomicEvent: public Event {
+ public:
+  AtomicEvent(Context* c, AtomicOperation type, unsigned size,
+              Value* address, Value* expect, Value* value, Value* result,
+              const SiteMask& addressMask, const SiteMask& valueMask,
+              const SiteMask& expectMask):
+    Event(c), type(type), size(size), address(address), expect(expect),
+    value(value), result(result), targetMask(expect ? expectMask : valueMask)
+  {
+    addRead(c, this, address, addressMask);
+
+    // the operation leaves its result in the register which held
+    // expect, if any, or else value, so that operand is condensed
+    // into the result:
+    if (expect) {
+      addRead(c, this, value, valueMask);
+      addRead(c, this, expect, expectMask, result);
+    } else {
+      addRead(c, this, value, valueMask, result);
+    }
+  }
+
+  virtual const char* name() {
+    return "AtomicEvent";
+  }
+
+  virtual void compile(Context* c) {
+    Value* target = expect ? expect : value;
+
+    freezeSource(c, TargetBytesPerWord, address);
+    if (expect) {
+      freezeSource(c, size, value);
+    }
+
+    Site* s = getTarget(c, target, result, targetMask);
+
+    if (s != target->source) {
+      apply(c, Move, size, target->source, target->source, size, s, s);
+    }
+
+    Assembler::Memory location
+      (static_cast<RegisterSite*>(address->source)->number, 0);
+    Assembler::Register valueRegister
+      (static_cast<RegisterSite*>(expect ? value->source : s)->number);
+    Assembler::Register expectRegister
+      (expect ? static_cast<RegisterSite*>(s)->number : NoRegister);
+
+    c->assembler->apply(type, size, &location, &valueRegister,
+                        expect ? &expectRegister : 0);
+
+    if (expect) {
+      thawSource(c, size, value);
+    }
+    thawSource(c, TargetBytesPerWord, address);
+
+    for (Read* r = reads; r; r = r->eventNext) {
+      popRead(c, this, r->value);
+    }
+
+    s->thaw(c, target);
+
+    if (live(c, result)) {
+      addSite(c, result, s);
+    }
+  }
+
+  AtomicOperation type;
+  unsigned size;
+  Value* address;
+  Value* expect;
+  Value* value;
+  Value* result;
+  SiteMask targetMask;
+};
+
+void
+appendAtomic(Context* c, AtomicOperation type, unsigned size, Value* address,
+             Value* expect, Value* value, Value* result)
+{
+  bool thunk;
+  uint64_t addressRegisterMask;
+  uint64_t valueRegisterMask;
+  uint64_t expectRegisterMask;
+
+  c->arch->plan(type, size, &addressRegisterMask, &valueRegisterMask,
+                &expectRegisterMask, &thunk);
+
+  if (thunk) {
+    Stack* oldStack = c->stack;
+
+    bool threadParameter;
+    intptr_t handler = c->client->getThunk(type, size, &threadParameter);
+
+    unsigned footprint = ceiling(size, TargetBytesPerWord);
+    unsigned stackSize = 1 + footprint;
+
+    local::push(c, footprint, value);
+    if (expect) {
+      stackSize += footprint;
+      local::push(c, footprint, expect);
+    }
+    local::push(c, 1, address);
+
+    if (threadParameter) {
+      ++ stackSize;
+
+      local::push(c, 1, register_(c, c->arch->thread()));
+    }
+
+    Stack* argumentStack = c->stack;
+    c->stack = oldStack;
+
+    appendCall
+      (c, local::value(c, ValueGeneral, constantSite(c, handler)), 0, 0,
+       result, expect ? 4 : size, argumentStack, stackSize, 0);
+  } else {
+    append
+      (c, new(c->zone)
+       AtomicEvent
+       (c, type, size, address, expect, value, result,
+        SiteMask(1 << RegisterOperand, addressRegisterMask, NoFrameIndex),
+        SiteMask(1 << RegisterOperand, valueRegisterMask, NoFrameIndex),
+        SiteMask(1 << RegisterOperand, expectRegisterMask, NoFrameIndex)));
+  }
+}
+
+class PollEvent: public Event {
+ public:
+  PollEvent(Context* c, Value* page, TraceHandler* traceHandler):
+    Event(c), page(page), traceHandler(traceHandler), popIndex(0),
+    stackArgumentIndex(0)
+  {
+    // the safepoint handler emulates a call from the poll instruction
+    // which returns the page in returnLow, so the page must live there
+    // and every frame value must be saved as it would be for a call:
+    addRead(c, this, page, fixedRegisterMask(c->arch->returnLow()));
+
+    stackArgumentIndex = c->localFootprint;
+    if (stackBefore) {
+      stackArgumentIndex += stackBefore->index + 1;
+    }
+
+    popIndex
+      = c->alignedFrameSize
+      + c->parameterFootprint
+      - c->arch->frameFooterSize()
+      - stackArgumentIndex;
+
+    assert(c, static_cast<int>(popIndex) >= 0);
+
+    for (Stack* s = stackBefore; s; s = s->next) {
+      if (s->value) {
+        addRead(c, this, s->value, SiteMask
+                (1 << MemoryOperand, 0, local::frameIndex
+                 (c, s->index + c->localFootprint)));
+      }
+    }
+
+    saveLocals(c, this);
+  }
+
+  virtual const char* name() {
+    return "PollEvent";
+  }
+
+  virtual void compile(Context* c) {
+    assert(c, page->source->type(c) == RegisterOperand);
+
+    // the faulting instruction doubles as the return address, so the
+    // trace is recorded at its start rather than its end:
+    if (traceHandler) {
+      traceHandler->handleTrace(codePromise(c, c->assembler->offset(true)),
+                                stackArgumentIndex);
+    }
+
+    int number = static_cast<RegisterSite*>(page->source)->number;
+    Assembler::Memory src(number, 0);
+    Assembler::Register dst(number);
+    c->assembler->apply(Move, 4, MemoryOperand, &src,
+                        4, RegisterOperand, &dst);
+
+    clean(c, this, stackBefore, localsBefore, reads, popIndex);
+  }
+
+  Value* page;
+  TraceHandler* traceHandler;
+  unsigned popIndex;
+  unsigned stackArgumentIndex;
+};
+
+void
+appendPoll(Context* c, Value* page, TraceHandler* traceHandler)
+{
+  append(c, new(c->zone) PollEvent(c, page, traceHandler));
+}
+
 class FrameSiteEvent: public Event {
  public:
   FrameSiteEvent(Context* c, Value* value, int index):
@@ -6457,6 +6653,10 @@ class MyCompiler: public Compiler {
                       static_cast<Value*>(index), handler);
   }
 
+  virtual void poll(Operand* page, TraceHandler* traceHandler) {
+    appendPoll(&c, static_cast<Value*>(page), traceHandler);
+  }
+
   virtual void store(unsigned srcSize, Operand* src, unsigned dstSize,
                      Operand* dst)
   {
@@ -6854,6 +7054,34 @@ class MyCompiler: public Compiler {
     return result;
   }
   
+  virtual Operand* compareAndSwap(unsigned size, Operand* address,
+                                  Operand* expect, Operand* update)
+  {
+    Value* result = value(&c, ValueGeneral);
+    appendAtomic(&c, AtomicCompareAndSwap, size,
+                 static_cast<Value*>(address), static_cast<Value*>(expect),
+                 static_cast<Value*>(update), result);
+    return result;
+  }
+
+  virtual Operand* getAndAdd(unsigned size, Operand* address,
+                             Operand* delta)
+  {
+    Value* result = value(&c, ValueGeneral);
+    appendAtomic(&c, AtomicAdd, size, static_cast<Value*>(address), 0,
+                 static_cast<Value*>(delta), result);
+    return result;
+  }
+
+  virtual Operand* getAndSet(unsigned size, Operand* address,
+                             Operand* value)
+  {
+    Value* result = local::value(&c, ValueGeneral);
+    appendAtomic(&c, AtomicExchange, size, static_cast<Value*>(address), 0,
+                 static_cast<Value*>(value), result);
+    return result;
+  }
+
   virtual Operand* i2f(unsigned aSize, unsigned resSize, Operand* a) {
     assert(&c, static_cast<Value*>(a)->type == ValueGeneral);
     Value* result = value(&c, ValueFloat);
@@ -6862,6 +7090,53 @@ class MyCompiler: public Compiler {
     return result;
   }
 
+  virtual Operand* f2bits(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueFloat);
+    Value* result = value(&c, ValueGeneral);
+    appendTranslate
+      (&c, Float2Bits, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* bits2f(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueGeneral);
+    Value* result = value(&c, ValueFloat);
+    appendTranslate
+      (&c, Bits2Float, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* reverseBytes(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueGeneral);
+    Value* result = value(&c, ValueGeneral);
+    appendTranslate
+      (&c, ReverseBytes, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* bitCount(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueGeneral);
+    Value* result = value(&c, ValueGeneral);
+    appendTranslate(&c, BitCount, size, static_cast<Value*>(a), 4, result);
+    return result;
+  }
+
+  virtual Operand* leadingZeros(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueGeneral);
+    Value* result = value(&c, ValueGeneral);
+    appendTranslate
+      (&c, LeadingZeros, size, static_cast<Value*>(a), 4, result);
+    return result;
+  }
+
+  virtual Operand* trailingZeros(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == ValueGeneral);
+    Value* result = value(&c, ValueGeneral);
+    appendTranslate
+      (&c, TrailingZeros, size, static_cast<Value*>(a), 4, result);
+    return result;
+  }
+
   virtual void trap() {
     appendOperation(&c, Trap);
   }
@@ -31,6 +31,8 @@ class Compiler {
                               unsigned resultSize) = 0;
     virtual intptr_t getThunk(TernaryOperation op, unsigned size,
                               unsigned resultSize, bool* threadParameter) = 0;
+    virtual intptr_t getThunk(AtomicOperation op, unsigned size,
+                              bool* threadParameter) = 0;
   };
   
   static const unsigned Aligned  = 1 << 0;
@@ -115,6 +117,7 @@ class Compiler {
 
   virtual void checkBounds(Operand* object, unsigned lengthOffset,
                            Operand* index, intptr_t handler) = 0;
+  virtual void poll(Operand* page, TraceHandler* traceHandler) = 0;
 
   virtual void store(unsigned srcSize, Operand* src, unsigned dstSize,
                      Operand* dst) = 0;
@@ -183,6 +186,19 @@ class Compiler {
   virtual Operand* f2f(unsigned aSize, unsigned resSize, Operand* a) = 0;
   virtual Operand* f2i(unsigned aSize, unsigned resSize, Operand* a) = 0;
   virtual Operand* i2f(unsigned aSize, unsigned resSize, Operand* a) = 0;
+  virtual Operand* f2bits(unsigned size, Operand* a) = 0;
+  virtual Operand* bits2f(unsigned size, Operand* a) = 0;
+  virtual Operand* reverseBytes(unsigned size, Operand* a) = 0;
+  virtual Operand* bitCount(unsigned size, Operand* a) = 0;
+  virtual Operand* leadingZeros(unsigned size, Operand* a) = 0;
+  virtual Operand* trailingZeros(unsigned size, Operand* a) = 0;
+
+  virtual Operand* compareAndSwap(unsigned size, Operand* address,
+                                  Operand* expect, Operand* update) = 0;
+  virtual Operand* getAndAdd(unsigned size, Operand* address,
+                             Operand* delta) = 0;
+  virtual Operand* getAndSet(unsigned size, Operand* address,
+                             Operand* value) = 0;
 
   virtual void trap() = 0;
 
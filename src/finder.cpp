@@ -10,6 +10,7 @@
 
 #include "zlib-custom.h"
 #include "system.h"
+#include "arch.h"
 #include "tokenizer.h"
 #include "finder.h"
 #include "lzma.h"
@@ -21,6 +22,12 @@ namespace {
 const bool DebugFind = false;
 const bool DebugStat = false;
 
+// upper bound on the inflated bytes a finder keeps for jar entries
+// which are read more than once
+const unsigned InflatedCacheSizeInBytes = 4 * 1024 * 1024;
+
+class JarElement;
+
 class Element {
  public:
   class Iterator {
@@ -39,6 +46,19 @@ class Element {
   virtual const char* sourceUrl() = 0;
   virtual void dispose() = 0;
 
+  virtual JarElement* jar() {
+    return 0;
+  }
+
+  // Returns the absolute name of the file or directory this element
+  // reads from and sets *originalName to the name it was given on the
+  // class path, or returns null if the element can't be recreated from
+  // a name (e.g. a jar built into the executable).
+  virtual const char* location(const char** originalName) {
+    *originalName = 0;
+    return 0;
+  }
+
   Element* next;
 };
 
@@ -155,6 +175,11 @@ class DirectoryElement: public Element {
     return sourceUrl_;
   }
 
+  virtual const char* location(const char** originalName) {
+    *originalName = this->originalName;
+    return name;
+  }
+
   virtual void dispose() {
     allocator->free(originalName, strlen(originalName) + 1);
     allocator->free(name, strlen(name) + 1);
@@ -230,6 +255,226 @@ class DataRegion: public System::Region {
   uint8_t data[0];
 };
 
+class IndexReader {
+ public:
+  IndexReader(const uint8_t* p, const uint8_t* end): p(p), end(end) { }
+
+  bool read4(uint32_t* v) {
+    if (end - p < 4) {
+      return false;
+    }
+    memcpy(v, p, 4);
+    p += 4;
+    return true;
+  }
+
+  bool read8(int64_t* v) {
+    if (end - p < 8) {
+      return false;
+    }
+    memcpy(v, p, 8);
+    p += 8;
+    return true;
+  }
+
+  const uint8_t* readString(unsigned* length) {
+    if (not read4(length)
+        or static_cast<uintptr_t>(end - p) < pad(*length, 4))
+    {
+      return 0;
+    }
+    const uint8_t* s = p;
+    p += pad(*length, 4);
+    return s;
+  }
+
+  const uint8_t* p;
+  const uint8_t* end;
+};
+
+// Writes the specified data to a temporary file and renames it to the
+// specified name, so that a VM starting concurrently sees either the
+// old file or the complete new one.
+void
+replaceFile(Allocator* allocator, const char* file, const uint8_t* data,
+            unsigned length)
+{
+  const char* temporary = append(allocator, file, ".tmp");
+
+  FILE* out = vm::fopen(temporary, "wb");
+  if (out) {
+    bool success = fwrite(data, 1, length, out) == length;
+    success = (fclose(out) == 0) and success;
+
+    if (success and ::rename(temporary, file) != 0) {
+      // Windows won't rename over an existing file
+      ::remove(file);
+      success = ::rename(temporary, file) == 0;
+    }
+
+    if (not success) {
+      ::remove(temporary);
+    }
+  }
+
+  allocator->free(temporary, strlen(temporary) + 1);
+}
+
+// Writes to the specified buffer, or just measures what would be
+// written if it is null.
+class IndexWriter {
+ public:
+  IndexWriter(uint8_t* p): p(p), position(0) { }
+
+  void write(const void* v, unsigned length) {
+    if (p) {
+      memcpy(p + position, v, length);
+    }
+    position += length;
+  }
+
+  void write4(uint32_t v) {
+    write(&v, 4);
+  }
+
+  void write8(int64_t v) {
+    write(&v, 8);
+  }
+
+  void writeString(const void* s, unsigned length) {
+    write4(length);
+    write(s, length);
+
+    const uint8_t zeros[] = { 0, 0, 0 };
+    write(zeros, pad(length, 4) - length);
+  }
+
+  uint8_t* p;
+  unsigned position;
+};
+
+// State shared by every jar on a finder's path: a z_stream per thread,
+// so that inflating an entry never waits on or allocates for another
+// thread, the budget for inflated entries kept after a re-read, and
+// the directory, if any, in which inflated entries are kept between
+// runs.
+class InflaterCache {
+ public:
+  class Inflater {
+   public:
+    z_stream stream;
+    Inflater* next;
+  };
+
+  InflaterCache(System* s, Allocator* allocator, const char* directory):
+    s(s),
+    allocator(allocator),
+    directory(directory ? copy(allocator, directory) : 0),
+    local(0),
+    inflaters(0),
+    cachedBytes(0)
+  {
+    expect(s, s->success(s->make(&local)));
+  }
+
+  z_stream* inflater() {
+    Inflater* inflater = static_cast<Inflater*>(local->get());
+    if (inflater) {
+      int r = inflateReset(&(inflater->stream));
+      expect(s, r == Z_OK);
+    } else {
+      inflater = static_cast<Inflater*>
+        (allocator->allocate(sizeof(Inflater)));
+      memset(inflater, 0, sizeof(Inflater));
+
+      // -15 means max window size and raw deflate (no zlib wrapper)
+      int r = inflateInit2(&(inflater->stream), -15);
+      expect(s, r == Z_OK);
+
+      // remember every inflater so dispose can free it, including
+      // those belonging to threads which have since exited
+      Inflater* head;
+      do {
+        head = inflaters;
+        inflater->next = head;
+      } while (not atomicCompareAndSwap
+               (reinterpret_cast<uintptr_t*>(&inflaters),
+                reinterpret_cast<uintptr_t>(head),
+                reinterpret_cast<uintptr_t>(inflater)));
+
+      local->set(inflater);
+    }
+
+    return &(inflater->stream);
+  }
+
+  bool reserve(unsigned size) {
+    uintptr_t v;
+    do {
+      v = cachedBytes;
+      if (v + size > InflatedCacheSizeInBytes) {
+        return false;
+      }
+    } while (not atomicCompareAndSwap(&cachedBytes, v, v + size));
+
+    return true;
+  }
+
+  void release(unsigned size) {
+    uintptr_t v;
+    do {
+      v = cachedBytes;
+    } while (not atomicCompareAndSwap(&cachedBytes, v, v - size));
+  }
+
+  // Returns the name of the file in which the inflated entries of the
+  // specified jar are kept.  Jars whose names hash alike share a file,
+  // each replacing the other's entries.
+  char* inflatedFile(const char* jar) {
+    // a separator, eight hex digits, ".inflated" and a terminator
+    unsigned length = strlen(directory) + 19;
+    char* file = static_cast<char*>(allocator->allocate(length));
+    vm::snprintf(file, length, "%s%c%08x.inflated", directory,
+                 s->fileSeparator(), hash(jar));
+    return file;
+  }
+
+  void dispose() {
+    for (Inflater* inflater = inflaters; inflater;) {
+      Inflater* next = inflater->next;
+      inflateEnd(&(inflater->stream));
+      allocator->free(inflater, sizeof(Inflater));
+      inflater = next;
+    }
+    local->dispose();
+    if (directory) {
+      allocator->free(directory, strlen(directory) + 1);
+    }
+    allocator->free(this, sizeof(*this));
+  }
+
+  System* s;
+  Allocator* allocator;
+  const char* directory;
+  System::Local* local;
+  Inflater* inflaters;
+  uintptr_t cachedBytes;
+};
+
+// Layout of the file in which a jar's inflated entries are kept between
+// runs, in the same encoding as a path index file (see below):
+//
+//   magic, version, checksum (of the rest of the directory),
+//   directory end, jar name, jar length, jar modification time,
+//   entry count,
+//   entries: uncompressed length, data offset, name
+//
+// followed by each entry's data at its offset, aligned to eight bytes.
+const uint32_t InflatedFileMagic = 0x46494156;
+const uint32_t InflatedFileVersion = 1;
+const unsigned InflatedFileChecksumEnd = 12;
+const unsigned InflatedFileHeaderSize = 16;
+
 class JarIndex {
  public:
   enum CompressionMethod {
@@ -240,34 +485,45 @@ class JarIndex {
   class Node {
    public:
     Node(uint32_t hash, const uint8_t* entry, Node* next):
-      hash(hash), entry(entry), next(next)
+      hash(hash), entry(entry), next(next), data(0), requested(false),
+      mapped(false)
     { }
 
     uint32_t hash;
     const uint8_t* entry;
     Node* next;
+    uint8_t* data;
+    bool requested;
+    // true if data points into the mapped inflated file, in which case
+    // it is neither freed nor charged to the cache budget
+    bool mapped;
   };
 
-  JarIndex(System* s, Allocator* allocator, unsigned capacity):
+  JarIndex(System* s, Allocator* allocator, InflaterCache* cache,
+           unsigned capacity):
     s(s),
     allocator(allocator),
+    cache(cache),
     capacity(capacity),
     position(0),
-    nodes(static_cast<Node*>(allocator->allocate(sizeof(Node) * capacity)))
+    nodes(static_cast<Node*>(allocator->allocate(sizeof(Node) * capacity))),
+    inflated(0)
   {
     memset(table, 0, sizeof(Node*) * capacity);
   }
 
-  static JarIndex* make(System* s, Allocator* allocator, unsigned capacity) {
+  static JarIndex* make(System* s, Allocator* allocator,
+                        InflaterCache* cache, unsigned capacity)
+  {
     return new
       (allocator->allocate(sizeof(JarIndex) + (sizeof(Node*) * capacity)))
-      JarIndex(s, allocator, capacity);
+      JarIndex(s, allocator, cache, capacity);
   }
   
   static JarIndex* open(System* s, Allocator* allocator,
-                        System::Region* region)
+                        InflaterCache* cache, System::Region* region)
   {
-    JarIndex* index = make(s, allocator, 32);
+    JarIndex* index = make(s, allocator, cache, 32);
 
     const uint8_t* start = region->start();
     const uint8_t* end = start + region->length();
@@ -300,7 +556,7 @@ class JarIndex {
       table[i] = new (nodes + (position++)) Node(hash, entry, table[i]);
       return this;
     } else {
-      JarIndex* index = make(s, allocator, capacity * 2);
+      JarIndex* index = make(s, allocator, cache, capacity * 2);
       for (unsigned i = 0; i < capacity; ++i) {
         index->add(nodes[i].hash, nodes[i].entry);
       }
@@ -310,9 +566,9 @@ class JarIndex {
     }
   }
 
-  Node* findNode(const char* name) {
-    unsigned length = strlen(name);
-    unsigned i = hash(name) & (capacity - 1);
+  Node* findNode(const void* name, unsigned length) {
+    unsigned i = hash(static_cast<const uint8_t*>(name), length)
+      & (capacity - 1);
     for (Node* n = table[i]; n; n = n->next) {
       const uint8_t* p = n->entry;
       if (equal(name, length, fileName(p), fileNameLength(p))) {
@@ -322,48 +578,93 @@ class JarIndex {
     return 0;
   }
 
+  Node* findNode(const char* name) {
+    return findNode(name, strlen(name));
+  }
+
   System::Region* find(const char* name, const uint8_t* start) {
     Node* n = findNode(name);
     if (n) {
-      const uint8_t* p = n->entry;
-      switch (compressionMethod(p)) {
-      case Stored: {
-        return new (allocator->allocate(sizeof(PointerRegion)))
-          PointerRegion(s, allocator, fileData(start + localHeaderOffset(p)),
-			compressedSize(p));
-      } break;
+      return find(n, start);
+    }
 
-      case Deflated: {
-        DataRegion* region = new
-          (allocator->allocate(sizeof(DataRegion) + uncompressedSize(p)))
-          DataRegion(s, allocator, uncompressedSize(p));
-          
-        z_stream zStream; memset(&zStream, 0, sizeof(z_stream));
+    return 0;
+  }
 
-        zStream.next_in = const_cast<uint8_t*>(fileData(start +
-							localHeaderOffset(p)));
-        zStream.avail_in = compressedSize(p);
-        zStream.next_out = region->data;
-        zStream.avail_out = region->length();
+  void inflateEntry(const uint8_t* p, const uint8_t* start, uint8_t* dst) {
+    z_stream* zStream = cache->inflater();
 
-        // -15 means max window size and raw deflate (no zlib wrapper)
-        int r = inflateInit2(&zStream, -15);
-        expect(s, r == Z_OK);
+    zStream->next_in = const_cast<uint8_t*>
+      (fileData(start + localHeaderOffset(p)));
+    zStream->avail_in = compressedSize(p);
+    zStream->next_out = dst;
+    zStream->avail_out = uncompressedSize(p);
 
-        r = inflate(&zStream, Z_FINISH);
-        expect(s, r == Z_STREAM_END);
+    int r = inflate(zStream, Z_FINISH);
+    expect(s, r == Z_STREAM_END);
+  }
 
-        inflateEnd(&zStream);
+  System::Region* find(Node* n, const uint8_t* start) {
+    const uint8_t* p = n->entry;
+    switch (compressionMethod(p)) {
+    case Stored: {
+      return new (allocator->allocate(sizeof(PointerRegion)))
+        PointerRegion(s, allocator, fileData(start + localHeaderOffset(p)),
+			compressedSize(p));
+    } break;
+
+    case Deflated: {
+      // Most entries are only read once (e.g. to parse a class), so we
+      // inflate into a temporary region the first time; that read pays
+      // the full inflate cost just as before.  If an entry is requested
+      // again and the finder's cache budget allows, we keep its
+      // inflated form for the life of the index and hand out regions
+      // which point to it:
+
+      uint8_t* data = n->data;
+      if (data == 0 and n->requested and uncompressedSize(p)
+          and cache->reserve(uncompressedSize(p)))
+      {
+        data = static_cast<uint8_t*>
+          (allocator->allocate(uncompressedSize(p)));
+
+        inflateEntry(p, start, data);
+
+        // another thread may have beaten us to it, in which case we use
+        // its copy instead:
+        if (not atomicCompareAndSwap
+            (reinterpret_cast<uintptr_t*>(&(n->data)), 0,
+             reinterpret_cast<uintptr_t>(data)))
+        {
+          allocator->free(data, uncompressedSize(p));
+          cache->release(uncompressedSize(p));
+          data = n->data;
+        }
+      }
 
-        return region;
-      } break;
+      if (data) {
+        // pairs with the compare-and-swap which published data, so that
+        // we see the inflated bytes and not just the pointer to them
+        loadMemoryBarrier();
 
-      default:
-        abort(s);
+        return new (allocator->allocate(sizeof(PointerRegion)))
+          PointerRegion(s, allocator, data, uncompressedSize(p));
       }
-    }
 
-    return 0;
+      n->requested = true;
+
+      DataRegion* region = new
+        (allocator->allocate(sizeof(DataRegion) + uncompressedSize(p)))
+        DataRegion(s, allocator, uncompressedSize(p));
+
+      inflateEntry(p, start, region->data);
+
+      return region;
+    } break;
+
+    default:
+      abort(s);
+    }
   }
 
   System::FileType stat(const char* name, unsigned* length, bool tryDirectory)
@@ -394,17 +695,175 @@ class JarIndex {
     }
   }
 
+  // Points each deflated entry recorded in the specified inflated file
+  // at its recorded data, provided the file was written for this jar
+  // with its current length and modification time, and the data
+  // matches the CRC in the jar.  Takes ownership of the file and
+  // returns true if any entry was mapped; otherwise returns false and
+  // leaves disposing of the file to the caller.
+  bool map(System::Region* file, const char* jarName, unsigned jarLength,
+           int64_t jarLastModified)
+  {
+    const uint8_t* start = file->start();
+    IndexReader r(start, start + file->length());
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t checksum;
+    uint32_t directoryEnd;
+    if (not (r.read4(&magic) and magic == InflatedFileMagic
+             and r.read4(&version) and version == InflatedFileVersion
+             and r.read4(&checksum) and r.read4(&directoryEnd)
+             and directoryEnd >= InflatedFileHeaderSize
+             and directoryEnd <= file->length()
+             and checksum == hash(start + InflatedFileChecksumEnd,
+                                  directoryEnd - InflatedFileChecksumEnd)))
+    {
+      return false;
+    }
+
+    r.end = start + directoryEnd;
+
+    unsigned nameLength;
+    const uint8_t* name = r.readString(&nameLength);
+    uint32_t length;
+    int64_t lastModified;
+    uint32_t count;
+    if (name == 0
+        or not equal(name, nameLength, jarName, strlen(jarName))
+        or not (r.read4(&length) and length == jarLength)
+        or not (r.read8(&lastModified) and lastModified == jarLastModified)
+        or not r.read4(&count))
+    {
+      return false;
+    }
+
+    bool mapped = false;
+    for (unsigned i = 0; i < count; ++i) {
+      uint32_t size;
+      uint32_t offset;
+      const uint8_t* entryName;
+      if (not (r.read4(&size) and r.read4(&offset)
+               and (entryName = r.readString(&nameLength))))
+      {
+        break;
+      }
+
+      Node* n = findNode(entryName, nameLength);
+      if (n and n->data == 0
+          and compressionMethod(n->entry) == Deflated
+          and size and size == uncompressedSize(n->entry)
+          and offset >= directoryEnd and offset <= file->length()
+          and size <= file->length() - offset
+          and crc32(0, start + offset, size) == fileCRC(n->entry))
+      {
+        n->data = const_cast<uint8_t*>(start + offset);
+        n->mapped = true;
+        mapped = true;
+      }
+    }
+
+    if (mapped) {
+      inflated = file;
+    }
+
+    return mapped;
+  }
+
+  bool inflatedEntry(Node* n) {
+    return (n->data or n->requested) and uncompressedSize(n->entry);
+  }
+
+  // Writes the inflated form of each entry read during this run, or
+  // mapped from an earlier one, to the specified file so that map()
+  // can reuse it, unless every such entry was mapped already.
+  void write(const char* file, const uint8_t* start, const char* jarName,
+             unsigned jarLength, int64_t jarLastModified)
+  {
+    bool changed = false;
+    unsigned count = 0;
+    unsigned directoryEnd = InflatedFileHeaderSize
+      + 4 + pad(strlen(jarName), 4) + 4 + 8 + 4;
+    unsigned dataLength = 0;
+    for (unsigned i = 0; i < position; ++i) {
+      Node* n = nodes + i;
+      if (inflatedEntry(n)) {
+        changed = changed or n->requested;
+        ++ count;
+        directoryEnd += 4 + 4 + 4 + pad(fileNameLength(n->entry), 4);
+        dataLength += pad(uncompressedSize(n->entry), 8);
+      }
+    }
+
+    if (not changed) {
+      return;
+    }
+
+    unsigned dataStart = pad(directoryEnd, 8);
+    unsigned length = dataStart + dataLength;
+    uint8_t* buffer = static_cast<uint8_t*>(allocator->allocate(length));
+    memset(buffer, 0, length);
+
+    IndexWriter w(buffer);
+    w.write4(InflatedFileMagic);
+    w.write4(InflatedFileVersion);
+    w.write4(0);
+    w.write4(directoryEnd);
+    w.writeString(jarName, strlen(jarName));
+    w.write4(jarLength);
+    w.write8(jarLastModified);
+    w.write4(count);
+
+    unsigned offset = dataStart;
+    for (unsigned i = 0; i < position; ++i) {
+      Node* n = nodes + i;
+      if (inflatedEntry(n)) {
+        const uint8_t* p = n->entry;
+        w.write4(uncompressedSize(p));
+        w.write4(offset);
+        w.writeString(fileName(p), fileNameLength(p));
+
+        if (n->data) {
+          memcpy(buffer + offset, n->data, uncompressedSize(p));
+        } else {
+          inflateEntry(p, start, buffer + offset);
+        }
+
+        offset += pad(uncompressedSize(p), 8);
+      }
+    }
+
+    uint32_t checksum = hash(buffer + InflatedFileChecksumEnd,
+                             directoryEnd - InflatedFileChecksumEnd);
+    memcpy(buffer + InflatedFileChecksumEnd - 4, &checksum, 4);
+
+    replaceFile(allocator, file, buffer, length);
+
+    allocator->free(buffer, length);
+  }
+
   void dispose() {
+    for (unsigned i = 0; i < position; ++i) {
+      if (nodes[i].data and not nodes[i].mapped) {
+        allocator->free(nodes[i].data, uncompressedSize(nodes[i].entry));
+      }
+    }
+    if (inflated) {
+      inflated->dispose();
+    }
     allocator->free(nodes, sizeof(Node) * capacity);
     allocator->free(this, sizeof(*this) + (sizeof(Node*) * capacity));
   }
 
   System* s;
   Allocator* allocator;
+  InflaterCache* cache;
   unsigned capacity;
   unsigned position;
   
   Node* nodes;
+  // the mapped inflated file which mapped nodes' data points into, if any
+  System::Region* inflated;
   Node* table[0];
 };
 
@@ -436,10 +895,11 @@ class JarElement: public Element {
     unsigned position;
   };
 
-  JarElement(System* s, Allocator* allocator, const char* name,
-             bool canonicalizePath = true):
+  JarElement(System* s, Allocator* allocator, InflaterCache* cache,
+             const char* name, bool canonicalizePath = true):
     s(s),
     allocator(allocator),
+    cache(cache),
     originalName(name),
     name(name and canonicalizePath
          ? s->toAbsolutePath(allocator, name) : name),
@@ -447,20 +907,24 @@ class JarElement: public Element {
                ? append(allocator, "jar:file:", this->name, "!/") : 0),
     sourceUrl_(this->name
                ? append(allocator, "file:", this->name) : 0),
-    region(0), index(0)
+    region(0), index(0), inflatedFile(0), length(0), lastModified(0)
   { }
 
-  JarElement(System* s, Allocator* allocator, const uint8_t* jarData,
-             unsigned jarLength):
+  JarElement(System* s, Allocator* allocator, InflaterCache* cache,
+             const uint8_t* jarData, unsigned jarLength):
     s(s),
     allocator(allocator),
+    cache(cache),
     originalName(0),
     name(0),
     urlPrefix_(name ? append(allocator, "jar:file:", name, "!/") : 0),
     sourceUrl_(name ? append(allocator, "file:", name) : 0),
     region(new (allocator->allocate(sizeof(PointerRegion)))
            PointerRegion(s, allocator, jarData, jarLength)),
-    index(JarIndex::open(s, allocator, region))
+    index(JarIndex::open(s, allocator, cache, region)),
+    inflatedFile(0),
+    length(0),
+    lastModified(0)
   { }
 
   virtual Element::Iterator* iterator() {
@@ -472,10 +936,41 @@ class JarElement: public Element {
 
   virtual void init() {
     if (index == 0) {
+      if (cache->directory) {
+        // note these before mapping the jar, so that if it changes in
+        // between, the inflated file we write describes the old jar
+        s->stat(name, &length);
+        lastModified = s->lastModified(name);
+      }
+
       System::Region* r;
       if (s->success(s->map(&r, name))) {
         region = r;
-        index = JarIndex::open(s, allocator, r);
+        index = JarIndex::open(s, allocator, cache, r);
+
+        if (cache->directory) {
+          mapInflated();
+        }
+      }
+    }
+  }
+
+  void mapInflated() {
+    inflatedFile = cache->inflatedFile(name);
+
+    System::Region* r;
+    if (s->success(s->map(&r, inflatedFile))) {
+      if (index->map(r, name, length, lastModified)) {
+        if (DebugFind) {
+          fprintf(stderr, "map inflated entries of %s from %s\n", name,
+                  inflatedFile);
+        }
+      } else {
+        r->dispose();
+
+        if (DebugFind) {
+          fprintf(stderr, "ignore stale or damaged %s\n", inflatedFile);
+        }
       }
     }
   }
@@ -511,6 +1006,16 @@ class JarElement: public Element {
     return type;
   }
 
+  System::Region* find(JarIndex::Node* node) {
+    return index->find(node, region->start());
+  }
+
+  virtual JarElement* jar() {
+    init();
+
+    return this;
+  }
+
   virtual const char* urlPrefix() {
     return urlPrefix_;
   }
@@ -519,11 +1024,21 @@ class JarElement: public Element {
     return sourceUrl_;
   }
 
+  virtual const char* location(const char** originalName) {
+    *originalName = this->originalName;
+    return name;
+  }
+
   virtual void dispose() {
     dispose(sizeof(*this));
   }
 
   virtual void dispose(unsigned size) {
+    if (inflatedFile) {
+      index->write(inflatedFile, region->start(), name, length,
+                   lastModified);
+      allocator->free(inflatedFile, strlen(inflatedFile) + 1);
+    }
     if (name) {
       if (originalName != name) {
         allocator->free(originalName, strlen(originalName) + 1);
@@ -543,19 +1058,25 @@ class JarElement: public Element {
 
   System* s;
   Allocator* allocator;
+  InflaterCache* cache;
   const char* originalName;
   const char* name;
   const char* urlPrefix_;
   const char* sourceUrl_;
   System::Region* region;
   JarIndex* index;
+  // the file in which inflated entries are kept between runs, if any,
+  // and the jar's length and modification time when it was mapped
+  char* inflatedFile;
+  unsigned length;
+  int64_t lastModified;
 };
 
 class BuiltinElement: public JarElement {
  public:
-  BuiltinElement(System* s, Allocator* allocator, const char* name,
-                 const char* libraryName):
-    JarElement(s, allocator, name, false),
+  BuiltinElement(System* s, Allocator* allocator, InflaterCache* cache,
+                 const char* name, const char* libraryName):
+    JarElement(s, allocator, cache, name, false),
     libraryName(libraryName ? copy(allocator, libraryName) : 0)
   { }
 
@@ -588,7 +1109,7 @@ class BuiltinElement: public JarElement {
             }
             region = new (allocator->allocate(sizeof(PointerRegion)))
               PointerRegion(s, allocator, data, size, freePointer);
-            index = JarIndex::open(s, allocator, region);
+            index = JarIndex::open(s, allocator, cache, region);
           } else if (DebugFind) {
             fprintf(stderr, "%s in %s returned null\n", symbolName,
                     libraryName);
@@ -609,6 +1130,11 @@ class BuiltinElement: public JarElement {
     return 0;
   }
 
+  virtual const char* location(const char** originalName) {
+    *originalName = 0;
+    return 0;
+  }
+
   virtual void dispose() {
     library->disposeAll();
     if (libraryName) {
@@ -649,12 +1175,14 @@ baseName(const char* name, char fileSeparator)
 
 void
 add(System* s, Element** first, Element** last, Allocator* allocator,
-    const char* name, unsigned nameLength, const char* bootLibrary);
+    InflaterCache* cache, const char* name, unsigned nameLength,
+    const char* bootLibrary, bool* complete);
 
 void
 addTokens(System* s, Element** first, Element** last, Allocator* allocator,
-          const char* jarName, unsigned jarNameBase, const char* tokens,
-          unsigned tokensLength, const char* bootLibrary)
+          InflaterCache* cache, const char* jarName, unsigned jarNameBase,
+          const char* tokens, unsigned tokensLength, const char* bootLibrary,
+          bool* complete)
 {
   for (Tokenizer t(tokens, tokensLength, ' '); t.hasMore();) {
     Tokenizer::Token token(t.next());
@@ -664,8 +1192,8 @@ addTokens(System* s, Element** first, Element** last, Allocator* allocator,
     memcpy(RUNTIME_ARRAY_BODY(n) + jarNameBase, token.s, token.length);
     RUNTIME_ARRAY_BODY(n)[jarNameBase + token.length] = 0;
           
-    add(s, first, last, allocator, RUNTIME_ARRAY_BODY(n),
-        jarNameBase + token.length, bootLibrary);
+    add(s, first, last, allocator, cache, RUNTIME_ARRAY_BODY(n),
+        jarNameBase + token.length, bootLibrary, complete);
   }
 }
 
@@ -680,14 +1208,15 @@ continuationLine(const uint8_t* base, unsigned total, unsigned* start,
 
 void
 addJar(System* s, Element** first, Element** last, Allocator* allocator,
-       const char* name, const char* bootLibrary)
+       InflaterCache* cache, const char* name, const char* bootLibrary,
+       bool* complete)
 {
   if (DebugFind) {
     fprintf(stderr, "add jar %s\n", name);
   }
 
   JarElement* e = new (allocator->allocate(sizeof(JarElement)))
-    JarElement(s, allocator, name);
+    JarElement(s, allocator, cache, name);
 
   unsigned nameBase = baseName(name, s->fileSeparator());
 
@@ -743,11 +1272,11 @@ addJar(System* s, Element** first, Element** last, Allocator* allocator,
             }
           }
 
-          addTokens(s, first, last, allocator, name, nameBase,
-                    RUNTIME_ARRAY_BODY(n), offset, bootLibrary);
+          addTokens(s, first, last, allocator, cache, name, nameBase,
+                    RUNTIME_ARRAY_BODY(n), offset, bootLibrary, complete);
         } else {
-          addTokens(s, first, last, allocator, name, nameBase, line,
-                    lineLength, bootLibrary);
+          addTokens(s, first, last, allocator, cache, name, nameBase, line,
+                    lineLength, bootLibrary, complete);
         }
       }
 
@@ -760,7 +1289,8 @@ addJar(System* s, Element** first, Element** last, Allocator* allocator,
 
 void
 add(System* s, Element** first, Element** last, Allocator* allocator,
-    const char* token, unsigned tokenLength, const char* bootLibrary)
+    InflaterCache* cache, const char* token, unsigned tokenLength,
+    const char* bootLibrary, bool* complete)
 {
   if (*token == '[' and token[tokenLength - 1] == ']') {
     char* name = static_cast<char*>(allocator->allocate(tokenLength - 1));
@@ -772,7 +1302,7 @@ add(System* s, Element** first, Element** last, Allocator* allocator,
     }
   
     add(first, last, new (allocator->allocate(sizeof(BuiltinElement)))
-        BuiltinElement(s, allocator, name, bootLibrary));
+        BuiltinElement(s, allocator, cache, name, bootLibrary));
   } else {
     char* name = static_cast<char*>(allocator->allocate(tokenLength + 1));
     memcpy(name, token, tokenLength);
@@ -781,7 +1311,7 @@ add(System* s, Element** first, Element** last, Allocator* allocator,
     unsigned length;
     switch (s->stat(name, &length)) {
     case System::TypeFile: {
-      addJar(s, first, last, allocator, name, bootLibrary);
+      addJar(s, first, last, allocator, cache, name, bootLibrary, complete);
     } break;
 
     case System::TypeDirectory: {
@@ -798,22 +1328,27 @@ add(System* s, Element** first, Element** last, Allocator* allocator,
         fprintf(stderr, "ignore nonexistent %s\n", name);
       }
 
+      *complete = false;
+
       allocator->free(name, strlen(name) + 1);
     } break;
     }
   }
 }
 
+// Sets *complete to false if any entry on the path, or in the
+// Class-Path of a jar on it, was ignored because it doesn't exist.
 Element*
-parsePath(System* s, Allocator* allocator, const char* path,
-          const char* bootLibrary)
+parsePath(System* s, Allocator* allocator, InflaterCache* cache,
+          const char* path, const char* bootLibrary, bool* complete)
 {
   Element* first = 0;
   Element* last = 0;
   for (Tokenizer t(path, s->pathSeparator()); t.hasMore();) {
     Tokenizer::Token token(t.next());
 
-    add(s, &first, &last, allocator, token.s, token.length, bootLibrary);
+    add(s, &first, &last, allocator, cache, token.s, token.length,
+        bootLibrary, complete);
   }
 
   return first;
@@ -855,37 +1390,567 @@ class MyIterator: public Finder::IteratorImp {
   Element::Iterator* it;
 };
 
+// Layout of a path index file, which lets a finder skip opening every
+// jar on its path when the jars haven't changed since the file was
+// written.  All fields are native-endian 32-bit words, except that
+// modification times take two, and strings are a length followed by
+// that many bytes, padded to a word boundary:
+//
+//   magic, version, checksum (of everything which follows),
+//   path string, element count, node count,
+//   elements: kind, length, modification time, original name, name
+//   nodes: hash, element position, uncompressed length, name
+//
+// An element's kind is System::TypeFile for a jar and
+// System::TypeDirectory for a directory.
+const uint32_t PathIndexMagic = 0x49504156;
+const uint32_t PathIndexVersion = 1;
+const unsigned PathIndexChecksumEnd = 12;
+
+// Maps each resource name to the first jar on the path which contains
+// it, so that a lookup costs a single hash probe regardless of how
+// many jars are on the path.  Directory contents may change at any
+// time, so directories are not indexed; instead, we remember where
+// they fall on the path and consult any which precede the indexed
+// jar, preserving first-wins semantics.
+class PathIndex {
+ public:
+  class Node {
+   public:
+    Node(uint32_t hash, const uint8_t* name, unsigned nameLength,
+         unsigned length, JarIndex::Node* source, JarElement* element,
+         unsigned position, Node* next):
+      hash(hash), name(name), nameLength(nameLength), length(length),
+      source(source), element(element), position(position), next(next)
+    { }
+
+    uint32_t hash;
+    const uint8_t* name;
+    unsigned nameLength;
+    unsigned length;
+    // null if the node was loaded from an index file, in which case
+    // the jar is only opened once something is read from it
+    JarIndex::Node* source;
+    JarElement* element;
+    unsigned position;
+    Node* next;
+  };
+
+  class Directory {
+   public:
+    Element* element;
+    unsigned position;
+  };
+
+  PathIndex(Allocator* allocator, unsigned capacity, unsigned nodeCount,
+            unsigned directoryCount, unsigned elementCount):
+    allocator(allocator),
+    capacity(capacity),
+    nodeCount(nodeCount),
+    directoryCount(directoryCount),
+    elementCount(elementCount),
+    nodes(static_cast<Node*>
+          (allocator->allocate(sizeof(Node) * max(nodeCount, 1)))),
+    directories(static_cast<Directory*>
+                (allocator->allocate
+                 (sizeof(Directory) * max(directoryCount, 1)))),
+    position(0),
+    region(0)
+  {
+    memset(table, 0, sizeof(Node*) * capacity);
+  }
+
+  static PathIndex* make(Allocator* allocator, unsigned nodeCount,
+                         unsigned directoryCount, unsigned elementCount)
+  {
+    unsigned capacity = nextPowerOfTwo(max(nodeCount, 1));
+
+    return new
+      (allocator->allocate(sizeof(PathIndex) + (sizeof(Node*) * capacity)))
+      PathIndex(allocator, capacity, nodeCount, directoryCount,
+                elementCount);
+  }
+
+  static PathIndex* make(Allocator* allocator, Element* path) {
+    unsigned nodeCount = 0;
+    unsigned directoryCount = 0;
+    unsigned elementCount = 0;
+    for (Element* e = path; e; e = e->next) {
+      JarElement* jar = e->jar();
+      if (jar == 0) {
+        ++ directoryCount;
+      } else if (jar->index) {
+        nodeCount += jar->index->position;
+      }
+      ++ elementCount;
+    }
+
+    PathIndex* index = make
+      (allocator, nodeCount, directoryCount, elementCount);
+
+    unsigned position = 0;
+    unsigned directory = 0;
+    for (Element* e = path; e; e = e->next) {
+      JarElement* jar = e->jar();
+      if (jar == 0) {
+        index->directories[directory].element = e;
+        index->directories[directory].position = position;
+        ++ directory;
+      } else if (jar->index) {
+        for (unsigned i = 0; i < jar->index->position; ++i) {
+          index->add(jar->index->nodes + i, jar, position);
+        }
+      }
+      ++ position;
+    }
+
+    return index;
+  }
+
+  // Reads an index written by write() for the specified path,
+  // recreating the path's elements without opening any jar.  Returns
+  // null if the file is missing or damaged, was written for another
+  // path or working directory, or if any element has since changed
+  // kind, length or modification time.  Times have the resolution of
+  // System::lastModified, so a jar rewritten within a second at the
+  // same length goes unnoticed.
+  static PathIndex* load(System* s, Allocator* allocator,
+                         InflaterCache* cache, const char* path,
+                         const char* file, Element** elements)
+  {
+    System::Region* region;
+    if (not s->success(s->map(&region, file))) {
+      return 0;
+    }
+
+    Element* first = 0;
+    Element* last = 0;
+    PathIndex* index = 0;
+    if (not read(s, allocator, cache, path, region, &first, &last, &index)) {
+      if (index) {
+        index->dispose();
+      }
+      for (Element* e = first; e;) {
+        Element* t = e;
+        e = e->next;
+        t->dispose();
+      }
+      region->dispose();
+
+      if (DebugFind) {
+        fprintf(stderr, "ignore stale or damaged index %s\n", file);
+      }
+      return 0;
+    }
+
+    index->region = region;
+    *elements = first;
+    return index;
+  }
+
+  static bool read(System* s, Allocator* allocator, InflaterCache* cache,
+                   const char* path, System::Region* region, Element** first,
+                   Element** last, PathIndex** index)
+  {
+    const uint8_t* start = region->start();
+    IndexReader r(start, start + region->length());
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t checksum;
+    if (not (r.read4(&magic) and magic == PathIndexMagic
+             and r.read4(&version) and version == PathIndexVersion
+             and r.read4(&checksum)
+             and checksum == hash(start + PathIndexChecksumEnd,
+                                  region->length() - PathIndexChecksumEnd)))
+    {
+      return false;
+    }
+
+    unsigned pathLength;
+    const uint8_t* pathString = r.readString(&pathLength);
+    uint32_t elementCount;
+    uint32_t nodeCount;
+    if (pathString == 0
+        or not equal(pathString, pathLength, path, strlen(path))
+        or not r.read4(&elementCount)
+        or not r.read4(&nodeCount)
+        or elementCount > region->length()
+        or nodeCount > region->length())
+    {
+      return false;
+    }
+
+    RUNTIME_ARRAY(Element*, elements, max(elementCount, 1));
+    RUNTIME_ARRAY(uint32_t, kinds, max(elementCount, 1));
+    unsigned directoryCount = 0;
+    for (unsigned i = 0; i < elementCount; ++i) {
+      uint32_t kind;
+      uint32_t length;
+      int64_t lastModified;
+      unsigned originalNameLength;
+      const uint8_t* originalName;
+      unsigned nameLength;
+      const uint8_t* name;
+      if (not (r.read4(&kind) and r.read4(&length) and r.read8(&lastModified)
+               and (originalName = r.readString(&originalNameLength))
+               and (name = r.readString(&nameLength))))
+      {
+        return false;
+      }
+
+      char* n = static_cast<char*>
+        (allocator->allocate(originalNameLength + 1));
+      memcpy(n, originalName, originalNameLength);
+      n[originalNameLength] = 0;
+
+      Element* e;
+      if (kind == System::TypeFile) {
+        e = new (allocator->allocate(sizeof(JarElement)))
+          JarElement(s, allocator, cache, n);
+      } else if (kind == System::TypeDirectory) {
+        e = new (allocator->allocate(sizeof(DirectoryElement)))
+          DirectoryElement(s, allocator, n);
+        ++ directoryCount;
+      } else {
+        allocator->free(n, originalNameLength + 1);
+        return false;
+      }
+
+      ::add(first, last, e);
+      RUNTIME_ARRAY_BODY(elements)[i] = e;
+      RUNTIME_ARRAY_BODY(kinds)[i] = kind;
+
+      // the element resolves its name against the current working
+      // directory, so this also checks that hasn't changed:
+      const char* o;
+      const char* location = e->location(&o);
+
+      unsigned actualLength;
+      if (not equal(location, strlen(location), name, nameLength)
+          or s->stat(location, &actualLength) != kind
+          or (kind == System::TypeFile
+              and (actualLength != length
+                   or s->lastModified(location) != lastModified)))
+      {
+        return false;
+      }
+    }
+
+    *index = make(allocator, nodeCount, directoryCount, elementCount);
+
+    unsigned directory = 0;
+    for (unsigned i = 0; i < elementCount; ++i) {
+      if (RUNTIME_ARRAY_BODY(kinds)[i] == System::TypeDirectory) {
+        (*index)->directories[directory].element
+          = RUNTIME_ARRAY_BODY(elements)[i];
+        (*index)->directories[directory].position = i;
+        ++ directory;
+      }
+    }
+
+    for (unsigned i = 0; i < nodeCount; ++i) {
+      uint32_t nodeHash;
+      uint32_t element;
+      uint32_t length;
+      unsigned nameLength;
+      const uint8_t* name;
+      if (not (r.read4(&nodeHash) and r.read4(&element) and r.read4(&length)
+               and (name = r.readString(&nameLength))
+               and element < elementCount
+               and RUNTIME_ARRAY_BODY(kinds)[element] == System::TypeFile))
+      {
+        return false;
+      }
+
+      (*index)->insert
+        (nodeHash, name, nameLength, length, 0,
+         static_cast<JarElement*>(RUNTIME_ARRAY_BODY(elements)[element]),
+         element);
+    }
+
+    return true;
+  }
+
+  // Writes this index to the specified file so that load() can reuse
+  // it.  Nothing is written if any element can't be recreated from a
+  // name.
+  void write(System* s, Element* path, const char* pathString,
+             const char* file)
+  {
+    for (Element* e = path; e; e = e->next) {
+      const char* originalName;
+      if (e->location(&originalName) == 0) {
+        return;
+      }
+    }
+
+    IndexWriter size(0);
+    write(s, path, pathString, &size);
+
+    uint8_t* buffer = static_cast<uint8_t*>
+      (allocator->allocate(size.position));
+
+    IndexWriter w(buffer);
+    write(s, path, pathString, &w);
+
+    uint32_t checksum = hash(buffer + PathIndexChecksumEnd,
+                             w.position - PathIndexChecksumEnd);
+    memcpy(buffer + PathIndexChecksumEnd - 4, &checksum, 4);
+
+    replaceFile(allocator, file, buffer, w.position);
+
+    allocator->free(buffer, size.position);
+  }
+
+  void write(System* s, Element* path, const char* pathString,
+             IndexWriter* w)
+  {
+    w->write4(PathIndexMagic);
+    w->write4(PathIndexVersion);
+    w->write4(0);
+
+    w->writeString(pathString, strlen(pathString));
+    w->write4(elementCount);
+    w->write4(position);
+
+    for (Element* e = path; e; e = e->next) {
+      const char* originalName;
+      const char* name = e->location(&originalName);
+
+      unsigned length = 0;
+      int64_t lastModified = 0;
+      if (w->p) {
+        s->stat(name, &length);
+        lastModified = s->lastModified(name);
+      }
+
+      w->write4(e->jar() ? System::TypeFile : System::TypeDirectory);
+      w->write4(length);
+      w->write8(lastModified);
+      w->writeString(originalName, strlen(originalName));
+      w->writeString(name, strlen(name));
+    }
+
+    for (unsigned i = 0; i < position; ++i) {
+      Node* n = nodes + i;
+      w->write4(n->hash);
+      w->write4(n->position);
+      w->write4(n->length);
+      w->writeString(n->name, n->nameLength);
+    }
+  }
+
+  void add(JarIndex::Node* source, JarElement* element,
+           unsigned elementPosition)
+  {
+    const uint8_t* p = source->entry;
+    if (findNode(source->hash, fileName(p), fileNameLength(p)) == 0) {
+      insert(source->hash, fileName(p), fileNameLength(p),
+             uncompressedSize(p), source, element, elementPosition);
+    }
+  }
+
+  void insert(uint32_t hash, const uint8_t* name, unsigned nameLength,
+              unsigned length, JarIndex::Node* source, JarElement* element,
+              unsigned elementPosition)
+  {
+    unsigned i = hash & (capacity - 1);
+    table[i] = new (nodes + (position++))
+      Node(hash, name, nameLength, length, source, element, elementPosition,
+           table[i]);
+  }
+
+  Node* findNode(uint32_t hash, const void* name, unsigned length) {
+    for (Node* n = table[hash & (capacity - 1)]; n; n = n->next) {
+      if (n->hash == hash and equal(name, length, n->name, n->nameLength)) {
+        return n;
+      }
+    }
+    return 0;
+  }
+
+  Node* findNode(const char* name) {
+    while (*name == '/') name++;
+
+    return findNode(hash(name), name, strlen(name));
+  }
+
+  Node* find(const char* name, bool tryDirectory, System::FileType* type) {
+    Node* node = findNode(name);
+    if (node) {
+      *type = System::TypeFile;
+    }
+
+    if (tryDirectory) {
+      // look for a directory entry which precedes any file entry we
+      // found, as a per-element search would have found it first
+      unsigned length = strlen(name);
+      RUNTIME_ARRAY(char, n, length + 2);
+      memcpy(RUNTIME_ARRAY_BODY(n), name, length);
+      RUNTIME_ARRAY_BODY(n)[length] = '/';
+      RUNTIME_ARRAY_BODY(n)[length + 1] = 0;
+
+      Node* directory = findNode(RUNTIME_ARRAY_BODY(n));
+      if (directory
+          and (node == 0 or directory->position < node->position))
+      {
+        node = directory;
+        *type = System::TypeDirectory;
+      }
+    }
+
+    return node;
+  }
+
+  void dispose() {
+    if (region) {
+      region->dispose();
+    }
+    allocator->free(nodes, sizeof(Node) * max(nodeCount, 1));
+    allocator->free(directories, sizeof(Directory) * max(directoryCount, 1));
+    allocator->free(this, sizeof(*this) + (sizeof(Node*) * capacity));
+  }
+
+  Allocator* allocator;
+  unsigned capacity;
+  unsigned nodeCount;
+  unsigned directoryCount;
+  unsigned elementCount;
+  Node* nodes;
+  Directory* directories;
+  unsigned position;
+  // the mapped index file which loaded nodes' names point into, if any
+  System::Region* region;
+  Node* table[0];
+};
+
 class MyFinder: public Finder {
  public:
   MyFinder(System* system, Allocator* allocator, const char* path,
-           const char* bootLibrary):
+           const char* bootLibrary, const char* indexFile,
+           const char* inflatedCacheDirectory):
     system(system),
     allocator(allocator),
-    path_(parsePath(system, allocator, path, bootLibrary)),
-    pathString(copy(allocator, path))
-  { }
+    cache(new (allocator->allocate(sizeof(InflaterCache)))
+          InflaterCache(system, allocator, inflatedCacheDirectory)),
+    path_(0),
+    pathString(copy(allocator, path)),
+    indexFile(indexFile ? copy(allocator, indexFile) : 0),
+    index_(indexFile
+           ? PathIndex::load(system, allocator, cache, path, indexFile, &path_)
+           : 0)
+  {
+    if (index_ == 0) {
+      bool complete = true;
+      path_ = parsePath(system, allocator, cache, path, bootLibrary,
+                        &complete);
+
+      // an index written now would miss any missing entry which is
+      // created later, so don't write one
+      if (not complete and this->indexFile) {
+        allocator->free(this->indexFile, strlen(this->indexFile) + 1);
+        this->indexFile = 0;
+      }
+    }
+  }
 
   MyFinder(System* system, Allocator* allocator, const uint8_t* jarData,
            unsigned jarLength):
     system(system),
     allocator(allocator),
+    cache(new (allocator->allocate(sizeof(InflaterCache)))
+          InflaterCache(system, allocator, 0)),
     path_(new (allocator->allocate(sizeof(JarElement)))
-          JarElement(system, allocator, jarData, jarLength)),
-    pathString(0)
+          JarElement(system, allocator, cache, jarData, jarLength)),
+    pathString(0),
+    indexFile(0),
+    index_(0)
   { }
 
+  PathIndex* index() {
+    PathIndex* index = index_;
+    if (index == 0) {
+      index = PathIndex::make(allocator, path_);
+
+      // another thread may have beaten us to it, in which case we use
+      // its index instead:
+      if (atomicCompareAndSwap
+          (reinterpret_cast<uintptr_t*>(&index_), 0,
+           reinterpret_cast<uintptr_t>(index)))
+      {
+        if (indexFile) {
+          index->write(system, path_, pathString, indexFile);
+        }
+      } else {
+        index->dispose();
+        index = index_;
+      }
+    }
+
+    loadMemoryBarrier();
+
+    return index;
+  }
+
+  Element* find(const char* name, unsigned* length, bool tryDirectory,
+                System::FileType* type)
+  {
+    PathIndex* index = this->index();
+
+    System::FileType nodeType = System::TypeDoesNotExist;
+    PathIndex::Node* node = index->find(name, tryDirectory, &nodeType);
+
+    unsigned limit = node ? node->position : index->elementCount;
+    for (unsigned i = 0; i < index->directoryCount
+           and index->directories[i].position < limit; ++i)
+    {
+      Element* e = index->directories[i].element;
+      System::FileType directoryType = e->stat(name, length, tryDirectory);
+      if (directoryType != System::TypeDoesNotExist) {
+        *type = directoryType;
+        return e;
+      }
+    }
+
+    if (node) {
+      *type = nodeType;
+      *length = nodeType == System::TypeFile ? node->length : 0;
+      return node->element;
+    } else {
+      *length = 0;
+      *type = System::TypeDoesNotExist;
+      return 0;
+    }
+  }
+
   virtual IteratorImp* iterator() {
     return new (allocator->allocate(sizeof(MyIterator)))
       MyIterator(system, allocator, path_);
   }
 
   virtual System::Region* find(const char* name) {
-    for (Element* e = path_; e; e = e->next) {
-      System::Region* r = e->find(name);
+    PathIndex* index = this->index();
+
+    PathIndex::Node* node = index->findNode(name);
+
+    unsigned limit = node ? node->position : index->elementCount;
+    for (unsigned i = 0; i < index->directoryCount
+           and index->directories[i].position < limit; ++i)
+    {
+      System::Region* r = index->directories[i].element->find(name);
       if (r) {
         return r;
       }
     }
+
+    if (node) {
+      if (DebugFind) {
+        fprintf(stderr, "found %s in %s\n", name, node->element->name);
+      }
+      return node->source
+        ? node->element->find(node->source) : node->element->find(name);
+    }
     
     return 0;
   }
@@ -893,38 +1958,23 @@ class MyFinder: public Finder {
   virtual System::FileType stat(const char* name, unsigned* length,
                                 bool tryDirectory)
   {
-    for (Element* e = path_; e; e = e->next) {
-      System::FileType type = e->stat(name, length, tryDirectory);
-      if (type != System::TypeDoesNotExist) {
-        return type;
-      }
-    }
-    
-    return System::TypeDoesNotExist;
+    System::FileType type;
+    find(name, length, tryDirectory, &type);
+    return type;
   }
 
   virtual const char* urlPrefix(const char* name) {
-    for (Element* e = path_; e; e = e->next) {
-      unsigned length;
-      System::FileType type = e->stat(name, &length, true);
-      if (type != System::TypeDoesNotExist) {
-        return e->urlPrefix();
-      }
-    }
-
-    return 0;
+    unsigned length;
+    System::FileType type;
+    Element* e = find(name, &length, true, &type);
+    return e ? e->urlPrefix() : 0;
   }
 
   virtual const char* sourceUrl(const char* name) {
-    for (Element* e = path_; e; e = e->next) {
-      unsigned length;
-      System::FileType type = e->stat(name, &length, true);
-      if (type != System::TypeDoesNotExist) {
-        return e->sourceUrl();
-      }
-    }
-
-    return 0;
+    unsigned length;
+    System::FileType type;
+    Element* e = find(name, &length, true, &type);
+    return e ? e->sourceUrl() : 0;
   }
 
   virtual const char* path() {
@@ -932,6 +1982,9 @@ class MyFinder: public Finder {
   }
 
   virtual void dispose() {
+    if (index_) {
+      index_->dispose();
+    }
     for (Element* e = path_; e;) {
       Element* t = e;
       e = e->next;
@@ -940,13 +1993,20 @@ class MyFinder: public Finder {
     if (pathString) {
       allocator->free(pathString, strlen(pathString) + 1);
     }
+    if (indexFile) {
+      allocator->free(indexFile, strlen(indexFile) + 1);
+    }
+    cache->dispose();
     allocator->free(this, sizeof(*this));
   }
 
   System* system;
   Allocator* allocator;
+  InflaterCache* cache;
   Element* path_;
   const char* pathString;
+  const char* indexFile;
+  PathIndex* index_;
 };
 
 } // namespace
@@ -954,9 +2014,11 @@ class MyFinder: public Finder {
 namespace vm {
 
 JNIEXPORT Finder*
-makeFinder(System* s, Allocator* a, const char* path, const char* bootLibrary)
+makeFinder(System* s, Allocator* a, const char* path, const char* bootLibrary,
+           const char* indexFile, const char* inflatedCacheDirectory)
 {
-  return new (a->allocate(sizeof(MyFinder))) MyFinder(s, a, path, bootLibrary);
+  return new (a->allocate(sizeof(MyFinder)))
+    MyFinder(s, a, path, bootLibrary, indexFile, inflatedCacheDirectory);
 }
 
 Finder*
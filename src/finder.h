@@ -173,8 +173,16 @@ class Finder {
   virtual void dispose() = 0;
 };
 
+// If indexFile is given, the finder reuses the index of the path's
+// jars saved there by an earlier finder, as long as none of them has
+// changed since, and otherwise saves a new one there.  Likewise, if
+// inflatedCacheDirectory is given, the finder maps compressed jar
+// entries inflated by an earlier finder from files in that directory
+// rather than inflating them again, and saves those it inflates there
+// when disposed.
 JNIEXPORT Finder*
-makeFinder(System* s, Allocator* a, const char* path, const char* bootLibrary);
+makeFinder(System* s, Allocator* a, const char* path, const char* bootLibrary,
+           const char* indexFile = 0, const char* inflatedCacheDirectory = 0);
 
 Finder*
 makeFinder(System* s, Allocator* a, const uint8_t* jarData,
@@ -26,6 +26,28 @@ const unsigned InitialTenuredFixieCeilingInBytes = 4 * 1024 * 1024;
 
 const unsigned LowMemoryPaddingInBytes = 1024 * 1024;
 
+// a major collection compacts gen2 in place unless it is crowded, in
+// which case it is copied to a larger segment instead.  Gen2 counts
+// as crowded when, after compaction, less than 1/CompactionHeadroomRatio
+// of it is free beyond what the objects awaiting tenure will take:
+const unsigned CompactionHeadroomRatio = 4;
+
+// size of the chunks each collector carves out of a destination
+// segment when collecting in parallel; objects larger than
+// PlabSizeInWords / PlabWasteRatio are allocated from the segment
+// directly so that no more than that fraction of a chunk is wasted
+// when it is retired:
+const unsigned PlabSizeInWords = 4 * 1024;
+const unsigned PlabWasteRatio = 16;
+
+const unsigned MaximumCollectorCount = 64;
+
+const unsigned ClaimLockCount = 1024;
+
+// number of objects pending on the coordinating collector's stack
+// before the other collectors are woken to help:
+const unsigned ParallelThreshold = 256;
+
 const bool Verbose = false;
 const bool Verbose2 = false;
 const bool Debug = false;
@@ -54,6 +76,7 @@ class MutexLock {
 };
 
 class Context;
+class Collector;
 
 void NO_RETURN abort(Context*);
 #ifndef NDEBUG
@@ -75,6 +98,41 @@ markBitAtomic(uintptr_t* map, unsigned i)
        old = *p)
   { }
 }
+
+// returns false if the bit was already set:
+inline bool
+testAndMarkBitAtomic(uintptr_t* map, unsigned i)
+{
+  uintptr_t* p = map + wordOf(i);
+  uintptr_t v = static_cast<uintptr_t>(1) << bitOf(i);
+  for (uintptr_t old = *p; (old & v) == 0; old = *p) {
+    if (atomicCompareAndSwap(p, old, old | v)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline void
+setBitsAtomic(uintptr_t* map, unsigned bitsPerRecord, unsigned index,
+              unsigned v)
+{
+  uintptr_t* p = map + wordOf(index);
+  uintptr_t mask = 0;
+  uintptr_t bits = 0;
+  for (unsigned i = 0; i < bitsPerRecord; ++i) {
+    uintptr_t bit = static_cast<uintptr_t>(1)
+      << bitOf(index + bitsPerRecord - 1 - i);
+    mask |= bit;
+    if (v & 1) bits |= bit;
+    v >>= 1;
+  }
+
+  for (uintptr_t old = *p;
+       not atomicCompareAndSwap(p, old, (old & ~mask) | bits);
+       old = *p)
+  { }
+}
 #endif // USE_ATOMIC_OPERATIONS
 
 inline void*
@@ -103,6 +161,94 @@ set(void* o, unsigned offsetInWords, void* value)
   set(getp(o, offsetInWords), value);
 }
 
+inline unsigned
+bitCount(uintptr_t v)
+{
+  const uintptr_t m1 = ~static_cast<uintptr_t>(0) / 3;
+  const uintptr_t m2 = ~static_cast<uintptr_t>(0) / 5;
+  const uintptr_t m4 = ~static_cast<uintptr_t>(0) / 17;
+  const uintptr_t h01 = ~static_cast<uintptr_t>(0) / 255;
+
+  v -= (v >> 1) & m1;
+  v = (v & m2) + ((v >> 2) & m2);
+  v = (v + (v >> 4)) & m4;
+  return (v * h01) >> (BitsPerWord - 8);
+}
+
+// returns the index of the first set bit in map at or after i, or
+// limit if there is none before limit:
+inline unsigned
+nextBit(uintptr_t* map, unsigned i, unsigned limit)
+{
+  if (i >= limit) return limit;
+
+  unsigned word = wordOf(i);
+  unsigned wordLimit = ceiling(limit, BitsPerWord);
+  uintptr_t w = map[word] & (~static_cast<uintptr_t>(0) << bitOf(i));
+  while (w == 0) {
+    if (++ word == wordLimit) return limit;
+    w = map[word];
+  }
+
+  unsigned r = indexOf(word, bitCount((w & (~w + 1)) - 1));
+  return r < limit ? r : limit;
+}
+
+// returns the index of the last set bit in map at or before i, of
+// which there must be one:
+inline unsigned
+previousBit(uintptr_t* map, unsigned i)
+{
+  unsigned word = wordOf(i);
+  uintptr_t w = map[word]
+    & ((static_cast<uintptr_t>(2) << bitOf(i)) - 1);
+  while (w == 0) {
+    w = map[-- word];
+  }
+
+  unsigned bit = BitsPerWord - 1;
+  while ((w & (static_cast<uintptr_t>(1) << bit)) == 0) -- bit;
+  return indexOf(word, bit);
+}
+
+inline void
+markRange(uintptr_t* map, unsigned start, unsigned end)
+{
+  for (unsigned i = start; i < end;) {
+    if (bitOf(i) == 0 and end - i >= BitsPerWord) {
+      map[wordOf(i)] = ~static_cast<uintptr_t>(0);
+      i += BitsPerWord;
+    } else {
+      markBit(map, i++);
+    }
+  }
+}
+
+inline void
+clearRange(uintptr_t* map, unsigned start, unsigned end)
+{
+  for (unsigned i = nextBit(map, start, end); i < end;
+       i = nextBit(map, i + 1, end))
+  {
+    clearBit(map, i);
+  }
+}
+
+// moves the set bits in [from, from + count) to [to, to + count),
+// where to <= from:
+inline void
+moveRange(uintptr_t* map, unsigned from, unsigned to, unsigned count)
+{
+  if (from != to) {
+    for (unsigned i = nextBit(map, from, from + count); i < from + count;
+         i = nextBit(map, i + 1, from + count))
+    {
+      clearBit(map, i);
+      markBit(map, to + (i - from));
+    }
+  }
+}
+
 class Segment {
  public:
   class Map {
@@ -318,6 +464,12 @@ class Segment {
       assert(segment->context, getBit(data, indexOf(p)));
       if (child) child->markAtomic(p);
     }
+
+    void setOnlyAtomic(void* p, unsigned v) {
+      assert(segment->context, wordOf(indexOf(p))
+             == wordOf(indexOf(p) + bitsPerRecord - 1));
+      setBitsAtomic(data, bitsPerRecord, indexOf(p), v);
+    }
 #endif
 
     unsigned get(void* p) {
@@ -452,6 +604,32 @@ class Segment {
     return p;
   }
 
+#ifdef USE_ATOMIC_OPERATIONS
+  // allocates at least minimum and at most desired words, returning
+  // zero if fewer than minimum words remain:
+  void* allocateAtomic(unsigned minimum, unsigned desired,
+                       unsigned* allocated)
+  {
+    assert(context, minimum);
+    assert(context, minimum <= desired);
+
+    while (true) {
+      unsigned old = position_;
+      unsigned size = min(desired, capacity() - old);
+      if (size < minimum) {
+        return 0;
+      }
+
+      if (atomicCompareAndSwap32
+          (reinterpret_cast<uint32_t*>(&position_), old, old + size))
+      {
+        *allocated = size;
+        return data + old;
+      }
+    }
+  }
+#endif
+
   void dispose() {
     if (data) {
       free(context, data, (footprint(capacity())) * BytesPerWord);
@@ -602,19 +780,93 @@ fixie(void* body)
 void
 free(Context* c, Fixie** fixies, bool resetImmortal = false);
 
+class Plab {
+ public:
+  Plab(): position(0), limit(0) { }
+
+  uintptr_t* position;
+  uintptr_t* limit;
+};
+
+void
+runCollector(Collector* w);
+
+class Collector: public System::Runnable {
+ public:
+  Collector(Context* c, unsigned index):
+    c(c),
+    thread(0),
+    index(index),
+    phase(0),
+    stack(0),
+    stackSize(0),
+    stackCapacity(0),
+    tenureFootprint(0)
+  { }
+
+  virtual void attach(System::Thread* t) {
+    thread = t;
+  }
+
+  virtual void run() {
+    runCollector(this);
+  }
+
+  virtual bool interrupted() {
+    return false;
+  }
+
+  virtual void setInterrupted(bool) { }
+
+  Context* c;
+  System::Thread* thread;
+  unsigned index;
+  unsigned phase;
+
+  void** stack;
+  unsigned stackSize;
+  unsigned stackCapacity;
+
+  Plab nextGen1Plab;
+  Plab gen2Plab;
+  Plab nextGen2Plab;
+
+  unsigned tenureFootprint;
+};
+
+void
+disposeCollectors(Context* c);
+
 class Context {
  public:
-  Context(System* system, unsigned limit):
+  Context(System* system, unsigned limit, unsigned collectorCount):
     system(system),
     client(0),
     count(0),
     limit(limit),
     lowMemoryThreshold(limit / 2),
     lock(0),
+
+    collectorCount(collectorCount),
+    collectors(0),
+    collectorMonitor(0),
+    collectorLock(0),
+    claimLocks(0),
+    sharedWork(0),
+    sharedWorkCount(0),
+    sharedWorkCapacity(0),
+    idleCollectors(0),
+    finishedCollectors(0),
+    phase(0),
+    workDone(false),
+    stopping(false),
+    parallel(false),
     
     immortalHeapStart(0),
     immortalHeapEnd(0),
 
+    cards(0),
+
     ageMap(&gen1, max(1, log(TenureThreshold)), 1, 0, false),
     gen1(this, &ageMap, 0, 0),
 
@@ -624,13 +876,33 @@ class Context {
     pointerMap(&gen2, 1, 1, 0, true),
     pageMap(&gen2, 1, LikelyPageSizeInBytes / BytesPerWord, &pointerMap, true),
     heapMap(&gen2, 1, pageMap.scale * 1024, &pageMap, true),
-    gen2(this, &heapMap, 0, 0),
+    startMap(&gen2, 1, 1, &heapMap, true),
+    gen2(this, &startMap, 0, 0),
 
     nextPointerMap(&nextGen2, 1, 1, 0, true),
     nextPageMap(&nextGen2, 1, LikelyPageSizeInBytes / BytesPerWord,
                 &nextPointerMap, true),
     nextHeapMap(&nextGen2, 1, nextPageMap.scale * 1024, &nextPageMap, true),
-    nextGen2(this, &nextHeapMap, 0, 0),
+    nextStartMap(&nextGen2, 1, 1, &nextHeapMap, true),
+    nextGen2(this, &nextStartMap, 0, 0),
+
+    compacting(false),
+    gen2Crowded(false),
+
+    liveMap(&gen2, 1, 1, 0, false),
+    extensionMap(&gen2, 1, 1, 0, false),
+    slotMap(&gen2, 1, 1, 0, false),
+    nextSlotMap(&nextGen1, 1, 1, 0, false),
+    forwardBase(0),
+    compactionTable(0),
+    compactionTableSize(0),
+    moveFrontier(0),
+    markStack(0),
+    markStackSize(0),
+    markStackCapacity(0),
+    slots(0),
+    slotCount(0),
+    slotCapacity(0),
 
     gen2Base(0),
     incomingFootprint(0),
@@ -662,6 +934,7 @@ class Context {
   }
 
   void dispose() {
+    disposeCollectors(this);
     gen1.dispose();
     nextGen1.dispose();
     gen2.dispose();
@@ -684,9 +957,27 @@ class Context {
 
   System::Mutex* lock;
 
+  unsigned collectorCount;
+  Collector* collectors;
+  System::Monitor* collectorMonitor;
+  System::Mutex* collectorLock;
+  uintptr_t* claimLocks;
+  void** sharedWork;
+  unsigned sharedWorkCount;
+  unsigned sharedWorkCapacity;
+  unsigned volatile idleCollectors;
+  unsigned volatile finishedCollectors;
+  unsigned volatile phase;
+  bool volatile workDone;
+  bool volatile stopping;
+  bool parallel;
+
   uintptr_t* immortalHeapStart;
   uintptr_t* immortalHeapEnd;
 
+  // see CardShift in heap.h:
+  uint8_t* cards;
+
   Segment::Map ageMap;
   Segment gen1;
 
@@ -696,13 +987,53 @@ class Context {
   Segment::Map pointerMap;
   Segment::Map pageMap;
   Segment::Map heapMap;
+  // one bit at the first word of each gen2 object (see scanCards):
+  Segment::Map startMap;
   Segment gen2;
 
   Segment::Map nextPointerMap;
   Segment::Map nextPageMap;
   Segment::Map nextHeapMap;
+  Segment::Map nextStartMap;
   Segment nextGen2;
 
+  // state used while compacting gen2 in place (see compact):
+
+  bool compacting;
+  bool gen2Crowded;
+
+  // one bit per word of each live object (only the first word until
+  // marking is done):
+  Segment::Map liveMap;
+
+  // one bit at the last word of each object which grows when moved,
+  // i.e. whose identity hash must be stored in an extra word:
+  Segment::Map extensionMap;
+
+  // one bit per gen2 and nextGen1 word referring to a gen2 object:
+  Segment::Map slotMap;
+  Segment::Map nextSlotMap;
+
+  // offset in gen2 of the first word of each liveMap word once
+  // compacted:
+  unsigned* forwardBase;
+
+  uintptr_t* compactionTable;
+  unsigned compactionTableSize;
+
+  // objects below this address have already been moved:
+  uintptr_t* moveFrontier;
+
+  void** markStack;
+  unsigned markStackSize;
+  unsigned markStackCapacity;
+
+  // other words referring to gen2 objects, e.g. roots and fixie
+  // fields:
+  void*** slots;
+  unsigned slotCount;
+  unsigned slotCapacity;
+
   unsigned gen2Base;
   
   unsigned incomingFootprint;
@@ -759,18 +1090,48 @@ assert(Context* c, bool v)
 }
 #endif
 
+// extra space a destination segment needs to absorb the unused tails
+// of parallel allocation chunks:
+inline unsigned
+plabSlack(Context* c, unsigned footprint)
+{
+  if (c->collectorCount > 1) {
+    return (footprint / PlabWasteRatio)
+      + (c->collectorCount * PlabSizeInWords);
+  } else {
+    return 0;
+  }
+}
+
 inline unsigned
 minimumNextGen1Capacity(Context* c)
 {
-  return c->gen1.position() - c->tenureFootprint + c->incomingFootprint
-    + c->gen1Padding;
+  unsigned n;
+  if (c->compacting) {
+    // objects due for tenure stay in gen1 until the next minor
+    // collection (see copy2):
+    n = c->gen1.position() + c->incomingFootprint + c->gen1Padding
+      + c->tenurePadding;
+  } else {
+    n = c->gen1.position() - c->tenureFootprint + c->incomingFootprint
+      + c->gen1Padding;
+  }
+  return n + plabSlack(c, n);
 }
 
 inline unsigned
 minimumNextGen2Capacity(Context* c)
 {
-  return c->gen2.position() + c->tenureFootprint + c->tenurePadding
+  unsigned n = c->gen2.position() + c->tenureFootprint + c->tenurePadding
     + c->gen2Padding;
+  return n + plabSlack(c, n);
+}
+
+inline unsigned
+tenureFootprint(Context* c)
+{
+  return c->tenureFootprint + c->tenurePadding
+    + plabSlack(c, c->tenureFootprint);
 }
 
 inline bool
@@ -780,12 +1141,33 @@ oversizedGen2(Context* c)
     and c->gen2.position() < (c->gen2.capacity() / 4);
 }
 
+// we compact gen2 in place during a major collection unless it needs
+// to grow or shrink, in which case we copy it to a new segment:
+inline bool
+compactGen2(Context* c)
+{
+  return c->gen2.capacity() and not (c->gen2Crowded or oversizedGen2(c));
+}
+
+// size in words of the tables used to compact a gen2 of the specified
+// capacity, not counting nextSlotMap:
+inline unsigned
+compactionTableSize(unsigned capacity)
+{
+  unsigned n = ceiling(capacity, BitsPerWord);
+  return (n * 3) + ceiling(n * sizeof(unsigned), BytesPerWord);
+}
+
 inline unsigned
 memoryNeeded(Context* c)
 {
+  unsigned gen2 = compactGen2(c)
+    ? compactionTableSize(c->gen2.capacity())
+    : c->gen2.footprint(minimumNextGen2Capacity(c));
+
   return c->count
-    + ((c->gen1.footprint(minimumNextGen1Capacity(c))
-        + c->gen2.footprint(minimumNextGen2Capacity(c))) * BytesPerWord)
+    + ((c->gen1.footprint(minimumNextGen1Capacity(c)) + gen2)
+       * BytesPerWord)
     + LowMemoryPaddingInBytes;
 }
 
@@ -825,6 +1207,9 @@ initNextGen2(Context* c)
   new (&(c->nextHeapMap)) Segment::Map
     (&(c->nextGen2), 1, c->pageMap.scale * 1024, &(c->nextPageMap), true);
 
+  new (&(c->nextStartMap)) Segment::Map
+    (&(c->nextGen2), 1, 1, &(c->nextHeapMap), true);
+
   unsigned minimum = minimumNextGen2Capacity(c);
   unsigned desired = minimum;
 
@@ -836,7 +1221,7 @@ initNextGen2(Context* c)
     desired = InitialGen2CapacityInBytes / BytesPerWord;
   }
 
-  new (&(c->nextGen2)) Segment(c, &(c->nextHeapMap), desired, minimum);
+  new (&(c->nextGen2)) Segment(c, &(c->nextStartMap), desired, minimum);
 
   if (Verbose2) {
     fprintf(stderr, "init nextGen2 to %d bytes\n",
@@ -987,12 +1372,87 @@ sweepFixies(Context* c)
      InitialTenuredFixieCeilingInBytes);
 }
 
+inline Plab*
+plab(Collector* w, Segment* s)
+{
+  Context* c = w->c;
+  if (s == &(c->nextGen1)) {
+    return &(w->nextGen1Plab);
+  } else if (s == &(c->gen2)) {
+    return &(w->gen2Plab);
+  } else {
+    assert(c, s == &(c->nextGen2));
+    return &(w->nextGen2Plab);
+  }
+}
+
+#ifdef USE_ATOMIC_OPERATIONS
+void*
+plabAllocate(Collector* w, Segment* s, unsigned size)
+{
+  Plab* p = plab(w, s);
+  if (static_cast<unsigned>(p->limit - p->position) < size) {
+    unsigned allocated;
+    if (size > PlabSizeInWords / PlabWasteRatio) {
+      void* dst = s->allocateAtomic(size, size, &allocated);
+      expect(w->c->system, dst);
+      return dst;
+    }
+
+    uintptr_t* chunk = static_cast<uintptr_t*>
+      (s->allocateAtomic(size, PlabSizeInWords, &allocated));
+    expect(w->c->system, chunk);
+
+    p->position = chunk;
+    p->limit = chunk + allocated;
+  }
+
+  void* dst = p->position;
+  p->position += size;
+  return dst;
+}
+#endif // USE_ATOMIC_OPERATIONS
+
+// records the start of an object copied to gen2 or nextGen2 so that
+// scanCards can find the objects which overlap a card:
+inline void
+markStart(Context* c, Collector* w UNUSED, Segment* s, void* p)
+{
+  Segment::Map* map;
+  if (s == &(c->gen2)) {
+    map = &(c->startMap);
+  } else if (s == &(c->nextGen2)) {
+    map = &(c->nextStartMap);
+  } else {
+    return;
+  }
+
+#ifdef USE_ATOMIC_OPERATIONS
+  if (w) {
+    // objects copied by other collectors may share the bitmap word:
+    markBitAtomic(map->data, map->indexOf(p));
+    return;
+  }
+#endif
+
+  map->setOnly(p);
+}
+
 inline void*
-copyTo(Context* c, Segment* s, void* o, unsigned size)
+copyTo(Context* c, Collector* w, Segment* s, void* o, unsigned size)
 {
-  assert(c, s->remaining() >= size);
-  void* dst = s->allocate(size);
+  void* dst;
+#ifdef USE_ATOMIC_OPERATIONS
+  if (w) {
+    dst = plabAllocate(w, s, size);
+  } else
+#endif
+  {
+    assert(c, s->remaining() >= size);
+    dst = s->allocate(size);
+  }
   c->client->copy(o, dst);
+  markStart(c, w, s, dst);
   return dst;
 }
 
@@ -1003,34 +1463,54 @@ immortalHeapContains(Context* c, void* p)
 }
 
 void*
-copy2(Context* c, void* o)
+copy2(Context* c, Collector* w, void* o)
 {
   unsigned size = c->client->copiedSizeInWords(o);
 
   if (c->gen2.contains(o)) {
     assert(c, c->mode == Heap::MajorCollection);
+    assert(c, not c->compacting);
 
-    return copyTo(c, &(c->nextGen2), o, size);
+    return copyTo(c, w, &(c->nextGen2), o, size);
   } else if (c->gen1.contains(o)) {
     unsigned age = c->ageMap.get(o);
-    if (age == TenureThreshold) {
+    if (age == TenureThreshold and not c->compacting) {
       if (c->mode == Heap::MinorCollection) {
-        assert(c, c->gen2.remaining() >= size);
+        assert(c, w or c->gen2.remaining() >= size);
 
         if (c->gen2Base == Top) {
           c->gen2Base = c->gen2.position();
         }
 
-        return copyTo(c, &(c->gen2), o, size);
+        return copyTo(c, w, &(c->gen2), o, size);
       } else {
-        return copyTo(c, &(c->nextGen2), o, size);
+        return copyTo(c, w, &(c->nextGen2), o, size);
       }
     } else {
-      o = copyTo(c, &(c->nextGen1), o, size);
+      // gen2 has no room to spare until it has been compacted, so
+      // objects due for tenure wait in gen1 for the next minor
+      // collection:
+      if (age < TenureThreshold) {
+        ++ age;
+      }
+
+      o = copyTo(c, w, &(c->nextGen1), o, size);
+
+#ifdef USE_ATOMIC_OPERATIONS
+      if (w) {
+        c->nextAgeMap.setOnlyAtomic(o, age);
+      } else
+#endif
+      {
+        c->nextAgeMap.setOnly(o, age);
+      }
 
-      c->nextAgeMap.setOnly(o, age + 1);
-      if (age + 1 == TenureThreshold) {
-        c->tenureFootprint += size;
+      if (age == TenureThreshold) {
+        if (w) {
+          w->tenureFootprint += size;
+        } else {
+          c->tenureFootprint += size;
+        }
       }
 
       return o;
@@ -1040,69 +1520,204 @@ copy2(Context* c, void* o)
     assert(c, not c->nextGen2.contains(o));
     assert(c, not immortalHeapContains(c, o));
 
-    o = copyTo(c, &(c->nextGen1), o, size);
+    o = copyTo(c, w, &(c->nextGen1), o, size);
 
-    c->nextAgeMap.clear(o);
+#ifdef USE_ATOMIC_OPERATIONS
+    if (w) {
+      c->nextAgeMap.setOnlyAtomic(o, 0);
+    } else
+#endif
+    {
+      c->nextAgeMap.clear(o);
+    }
 
     return o;
   }
 }
 
 void*
-copy(Context* c, void* o)
+copy(Context* c, Collector* w, void* o)
 {
-  void* r = copy2(c, o);
+  void* r = copy2(c, w, o);
 
   if (Debug) {
     fprintf(stderr, "copy %p (%s) to %p (%s)\n",
             o, segment(c, o), r, segment(c, r));
   }
 
+  // make sure the copy is complete before other collectors can see
+  // it:
+  if (w) storeStoreMemoryBarrier();
+
   // leave a pointer to the copy in the original
   cast<void*>(o, 0) = r;
 
   return r;
 }
 
+#ifdef USE_ATOMIC_OPERATIONS
+inline uintptr_t*
+claimLock(Context* c, void* o)
+{
+  return c->claimLocks
+    + ((reinterpret_cast<uintptr_t>(o) / BytesPerWord) % ClaimLockCount);
+}
+
+void
+acquireClaim(Context* c, uintptr_t* lock)
+{
+  while (not atomicCompareAndSwap(lock, 0, 1)) {
+    c->system->yield();
+  }
+}
+
+void
+releaseClaim(uintptr_t* lock)
+{
+  storeStoreMemoryBarrier();
+  *lock = 0;
+}
+
+// copies the specified object unless another collector got to it
+// first, in which case we use that collector's copy:
+void*
+claim(Context* c, Collector* w, void* o, bool* needsVisit)
+{
+  uintptr_t* lock = claimLock(c, o);
+  acquireClaim(c, lock);
+
+  void* r;
+  if (wasCollected(c, o)) {
+    *needsVisit = false;
+    r = follow(c, o);
+  } else {
+    *needsVisit = true;
+    r = copy(c, w, o);
+  }
+
+  releaseClaim(lock);
+
+  return r;
+}
+#endif // USE_ATOMIC_OPERATIONS
+
+void
+push(Collector* w, void* o);
+
+void
+markFixie(Context* c, Collector* w, Fixie* f)
+{
+  if (DebugFixies) {
+    fprintf(stderr, "mark fixie %p\n", f);
+  }
+
+  if (w) {
+    ACQUIRE(c->collectorLock);
+
+    if (not f->marked()) {
+      // marked fixies are visited by whichever collector marks them
+      // rather than by visitMarkedFixies:
+      f->marked(true);
+      f->dead(false);
+      f->move(c, &(c->visitedFixies));
+      push(w, f->body());
+    }
+  } else {
+    f->marked(true);
+    f->dead(false);
+    f->move(c, &(c->markedFixies));
+  }
+}
+
+void
+pushMarked(Context* c, void* o)
+{
+  if (c->markStackSize == c->markStackCapacity) {
+    unsigned capacity = max(ParallelThreshold * 2, c->markStackCapacity * 2);
+    void** stack = static_cast<void**>
+      (local::allocate(c, capacity * BytesPerWord));
+
+    if (c->markStack) {
+      memcpy(stack, c->markStack, c->markStackSize * BytesPerWord);
+      free(c, c->markStack, c->markStackCapacity * BytesPerWord);
+    }
+
+    c->markStack = stack;
+    c->markStackCapacity = capacity;
+  }
+
+  c->markStack[c->markStackSize++] = o;
+}
+
+// marks a gen2 object which is to be compacted rather than copied,
+// returning true if it was not already marked.  If we are collecting
+// in parallel, the caller is responsible for visiting it; otherwise we
+// leave it on the mark stack for visitMarkedGen2:
+bool
+markGen2(Context* c, Collector* w UNUSED, void* o)
+{
+#ifdef USE_ATOMIC_OPERATIONS
+  if (w) {
+    return testAndMarkBitAtomic(c->liveMap.data, c->liveMap.indexOf(o));
+  }
+#endif
+
+  if (c->liveMap.get(o) == 0) {
+    c->liveMap.setOnly(o);
+    pushMarked(c, o);
+  }
+  return false;
+}
+
 void*
-update3(Context* c, void* o, bool* needsVisit)
+update3(Context* c, Collector* w, void* o, bool* needsVisit)
 {
   if (c->client->isFixed(o)) {
     Fixie* f = fixie(o);
     if ((not f->marked())
         and (c->mode == Heap::MajorCollection
-             or f->age < FixieTenureThreshold))
+             or f->age < FixieTenureThreshold
+             // an immortal fixie isn't on any list until we've seen
+             // it, and scanCards can only find fixies on a list:
+             or (f->immortal() and f->handle == 0)))
     {
-      if (DebugFixies) {
-        fprintf(stderr, "mark fixie %p\n", f);
-      }
-      f->marked(true);
-      f->dead(false);
-      f->move(c, &(c->markedFixies));
+      markFixie(c, w, f);
     }
     *needsVisit = false;
     return o;
   } else if (immortalHeapContains(c, o)) {
     *needsVisit = false;
     return o;    
+  } else if (c->compacting and c->gen2.contains(o)) {
+    *needsVisit = markGen2(c, w, o);
+    return o;
+  } else if (fresh(c, o)) {
+    // the client has visited a reference we've already updated (see
+    // postVisit in machine.cpp):
+    *needsVisit = false;
+    return o;
   } else if (wasCollected(c, o)) {
     *needsVisit = false;
     return follow(c, o);
+#ifdef USE_ATOMIC_OPERATIONS
+  } else if (w) {
+    return claim(c, w, o, needsVisit);
+#endif
   } else {
     *needsVisit = true;
-    return copy(c, o);
+    return copy(c, w, o);
   }
 }
 
 void*
-update2(Context* c, void* o, bool* needsVisit)
+update2(Context* c, Collector* w, void* o, bool* needsVisit)
 {
   if (c->mode == Heap::MinorCollection and c->gen2.contains(o)) {
     *needsVisit = false;
     return o;
   }
 
-  return update3(c, o, needsVisit);
+  return update3(c, w, o, needsVisit);
 }
 
 void
@@ -1125,21 +1740,18 @@ markClean(Context* c, Fixie* f)
 {
   if (f->dirty()) {
     f->dirty(false);
-    if (f->immortal()) {
-      f->remove(c);
-    } else {
-      f->move(c, &(c->tenuredFixies));
-    }
+    f->move(c, &(c->tenuredFixies));
   }
 }
 
 void
-updateHeapMap(Context* c, void* p, void* target, unsigned offset, void* result)
+updateHeapMap(Context* c, Collector* w UNUSED, void* p, void* target,
+              unsigned offset, void* result)
 {
   Segment* seg;
   Segment::Map* map;
 
-  if (c->mode == Heap::MinorCollection) {
+  if (c->mode == Heap::MinorCollection or c->compacting) {
     seg = &(c->gen2);
     map = &(c->heapMap);
   } else {
@@ -1171,23 +1783,82 @@ updateHeapMap(Context* c, void* p, void* target, unsigned offset, void* result)
                 result, segment(c, result), p, segment(c, p));
       }
 
-      map->set(p);
-    }
-  }
+#ifdef USE_ATOMIC_OPERATIONS
+      if (w) {
+        map->markAtomic(p);
+      } else
+#endif
+      {
+        map->set(p);
+      }
+    }
+  }
+}
+
+// remembers that p refers to a gen2 object so we can update it once
+// we know where that object will be moved:
+void
+recordSlot(Context* c, Collector* w UNUSED, void** p)
+{
+  Segment::Map* map;
+  if (c->gen2.contains(p)) {
+    map = &(c->slotMap);
+  } else if (c->nextGen1.contains(p)) {
+    map = &(c->nextSlotMap);
+  } else {
+#ifdef USE_ATOMIC_OPERATIONS
+    if (w) c->collectorLock->acquire();
+#endif
+
+    if (c->slotCount == c->slotCapacity) {
+      unsigned capacity = max(1024, c->slotCapacity * 2);
+      void*** slots = static_cast<void***>
+        (local::allocate(c, capacity * BytesPerWord));
+
+      if (c->slots) {
+        memcpy(slots, c->slots, c->slotCount * BytesPerWord);
+        free(c, c->slots, c->slotCapacity * BytesPerWord);
+      }
+
+      c->slots = slots;
+      c->slotCapacity = capacity;
+    }
+
+    c->slots[c->slotCount++] = p;
+
+#ifdef USE_ATOMIC_OPERATIONS
+    if (w) c->collectorLock->release();
+#endif
+    return;
+  }
+
+#ifdef USE_ATOMIC_OPERATIONS
+  if (w) {
+    map->markAtomic(p);
+  } else
+#endif
+  {
+    map->setOnly(p);
+  }
 }
 
 void*
-update(Context* c, void** p, void* target, unsigned offset, bool* needsVisit)
+update(Context* c, Collector* w, void** p, void* target, unsigned offset,
+       bool* needsVisit)
 {
   if (mask(*p) == 0) {
     *needsVisit = false;
     return 0;
   }
 
-  void* result = update2(c, mask(*p), needsVisit);
+  void* result = update2(c, w, mask(*p), needsVisit);
 
   if (result) {
-    updateHeapMap(c, p, target, offset, result);
+    updateHeapMap(c, w, p, target, offset, result);
+
+    if (c->compacting and c->gen2.contains(result)) {
+      recordSlot(c, w, p);
+    }
   }
 
   return result;
@@ -1294,9 +1965,19 @@ bitsetNext(Context* c, uintptr_t* p)
   }
 }
 
+void
+enqueue(Collector* w, void** p, void* target, unsigned offset);
+
 void
 collect(Context* c, void** p, void* target, unsigned offset)
 {
+  if (c->parallel) {
+    // the coordinating collector only updates the reference here;
+    // anything it copies is traced by drain:
+    enqueue(c->collectors, p, target, offset);
+    return;
+  }
+
   void* original = mask(*p);
   void* parent_ = 0;
   
@@ -1306,7 +1987,7 @@ collect(Context* c, void** p, void* target, unsigned offset)
   }
 
   bool needsVisit;
-  local::set(p, update(c, mask(p), target, offset, &needsVisit));
+  local::set(p, update(c, 0, mask(p), target, offset, &needsVisit));
 
   if (Debug) {
     fprintf(stderr, "  result: %p (%s) (visit? %d)\n",
@@ -1344,7 +2025,7 @@ collect(Context* c, void** p, void* target, unsigned offset)
 
         bool needsVisit;
         void* childCopy = update
-          (c, getp(copy, offset), copy, offset, &needsVisit);
+          (c, 0, getp(copy, offset), copy, offset, &needsVisit);
         
         if (Debug) {
           fprintf(stderr, "    result: %p (%s) (visit? %d)\n",
@@ -1498,6 +2179,311 @@ collect(Context* c, void* target, unsigned offset)
   collect(c, getp(target, offset), target, offset);
 }
 
+void
+push(Collector* w, void* o)
+{
+  if (w->stackSize == w->stackCapacity) {
+    unsigned capacity = max(ParallelThreshold * 2, w->stackCapacity * 2);
+    void** stack = static_cast<void**>
+      (local::allocate(w->c, capacity * BytesPerWord));
+
+    if (w->stack) {
+      memcpy(stack, w->stack, w->stackSize * BytesPerWord);
+      free(w->c, w->stack, w->stackCapacity * BytesPerWord);
+    }
+
+    w->stack = stack;
+    w->stackCapacity = capacity;
+  }
+
+  w->stack[w->stackSize++] = o;
+}
+
+void
+enqueue(Collector* w, void** p, void* target, unsigned offset)
+{
+  bool needsVisit;
+  local::set(p, update(w->c, w, mask(p), target, offset, &needsVisit));
+
+  if (needsVisit) {
+    push(w, mask(*p));
+  }
+}
+
+void
+scan(Collector* w, void* o)
+{
+  class Walker: public Heap::Walker {
+   public:
+    Walker(Collector* w, void* o): w(w), o(o) { }
+
+    virtual bool visit(unsigned offset) {
+      enqueue(w, getp(o, offset), o, offset);
+      return true;
+    }
+
+    Collector* w;
+    void* o;
+  } walker(w, o);
+
+  if (Debug) {
+    fprintf(stderr, "scan %p (%s) in collector %d\n",
+            o, segment(w->c, o), w->index);
+  }
+
+  w->c->client->walk(o, &walker);
+}
+
+#ifdef USE_ATOMIC_OPERATIONS
+
+// give the oldest half of our stack to whichever collector runs out
+// of work first:
+void
+share(Collector* w)
+{
+  Context* c = w->c;
+  ACQUIRE(c->collectorLock);
+
+  if (c->sharedWorkCount == 0 and w->stackSize > 1) {
+    unsigned n = w->stackSize / 2;
+
+    if (n > c->sharedWorkCapacity) {
+      if (c->sharedWork) {
+        free(c, c->sharedWork, c->sharedWorkCapacity * BytesPerWord);
+      }
+
+      c->sharedWorkCapacity = max(n, c->sharedWorkCapacity * 2);
+      c->sharedWork = static_cast<void**>
+        (local::allocate(c, c->sharedWorkCapacity * BytesPerWord));
+    }
+
+    memcpy(c->sharedWork, w->stack, n * BytesPerWord);
+    memmove(w->stack, w->stack + n, (w->stackSize - n) * BytesPerWord);
+    w->stackSize -= n;
+    c->sharedWorkCount = n;
+  }
+}
+
+// returns false when there is no more work for any collector in the
+// current phase:
+bool
+findWork(Collector* w)
+{
+  Context* c = w->c;
+  bool idle = false;
+
+  while (true) {
+    { ACQUIRE(c->collectorLock);
+
+      if (c->workDone) {
+        return false;
+      }
+
+      if (c->sharedWorkCount) {
+        if (idle) {
+          -- c->idleCollectors;
+        }
+
+        unsigned n = ceiling(c->sharedWorkCount, 2);
+        c->sharedWorkCount -= n;
+        for (unsigned i = 0; i < n; ++i) {
+          push(w, c->sharedWork[c->sharedWorkCount + i]);
+        }
+
+        return true;
+      }
+
+      if (not idle) {
+        idle = true;
+
+        if (++ c->idleCollectors == c->collectorCount) {
+          c->workDone = true;
+          return false;
+        }
+      }
+    }
+
+    while (not (c->workDone or c->sharedWorkCount)) {
+      c->system->yield();
+    }
+  }
+}
+
+void
+work(Collector* w)
+{
+  Context* c = w->c;
+
+  do {
+    while (w->stackSize) {
+      scan(w, w->stack[-- w->stackSize]);
+
+      if (c->idleCollectors and c->sharedWorkCount == 0
+          and w->stackSize > 1)
+      {
+        share(w);
+      }
+    }
+  } while (findWork(w));
+
+  assert(c, w->stackSize == 0);
+}
+
+void
+runCollector(Collector* w)
+{
+  Context* c = w->c;
+
+  while (true) {
+    { ACQUIRE_MONITOR(w->thread, c->collectorMonitor);
+
+      while (w->phase == c->phase and not c->stopping) {
+        c->collectorMonitor->wait(w->thread, 0);
+      }
+
+      w->phase = c->phase;
+    }
+
+    if (c->stopping) {
+      return;
+    }
+
+    work(w);
+
+    ACQUIRE(c->collectorLock);
+    ++ c->finishedCollectors;
+  }
+}
+
+void
+startCollectors(Context* c)
+{
+  if (Verbose) {
+    fprintf(stderr, "start %d collectors\n", c->collectorCount);
+  }
+
+  expect(c->system, c->system->success(c->system->make(&(c->collectorLock))));
+  expect(c->system, c->system->success
+         (c->system->make(&(c->collectorMonitor))));
+
+  c->claimLocks = static_cast<uintptr_t*>
+    (local::allocate(c, ClaimLockCount * BytesPerWord));
+  memset(c->claimLocks, 0, ClaimLockCount * BytesPerWord);
+
+  c->collectors = static_cast<Collector*>
+    (local::allocate(c, c->collectorCount * sizeof(Collector)));
+  for (unsigned i = 0; i < c->collectorCount; ++i) {
+    new (c->collectors + i) Collector(c, i);
+  }
+
+  for (unsigned i = 1; i < c->collectorCount; ++i) {
+    expect(c->system, c->system->success
+           (c->system->start(c->collectors + i)));
+  }
+}
+
+// the first collector runs on whichever thread triggered the
+// collection, which need not be the one that triggered the last, so it
+// gets a fresh context for the monitor each time:
+void
+attachCollector(Context* c)
+{
+  expect(c->system, c->system->success(c->system->attach(c->collectors)));
+}
+
+void
+detachCollector(Context* c)
+{
+  c->collectors->thread->dispose();
+  c->collectors->thread = 0;
+}
+
+// wake the other collectors and trace until every stack is empty:
+void
+collectInParallel(Context* c)
+{
+  Collector* w = c->collectors;
+
+  c->idleCollectors = 0;
+  c->finishedCollectors = 0;
+  c->workDone = false;
+
+  { ACQUIRE_MONITOR(w->thread, c->collectorMonitor);
+
+    w->phase = ++ c->phase;
+    c->collectorMonitor->notifyAll(w->thread);
+  }
+
+  work(w);
+
+  while (c->finishedCollectors < c->collectorCount - 1) {
+    c->system->yield();
+  }
+
+  assert(c, c->sharedWorkCount == 0);
+}
+
+#endif // USE_ATOMIC_OPERATIONS
+
+void
+drain(Context* c)
+{
+  if (c->parallel) {
+    Collector* w = c->collectors;
+    while (w->stackSize) {
+#ifdef USE_ATOMIC_OPERATIONS
+      if (w->stackSize > ParallelThreshold) {
+        collectInParallel(c);
+        break;
+      }
+#endif
+
+      scan(w, w->stack[-- w->stackSize]);
+    }
+  }
+}
+
+void
+disposeCollectors(Context* c)
+{
+  if (c->collectors) {
+#ifdef USE_ATOMIC_OPERATIONS
+    Collector* w = c->collectors;
+
+    attachCollector(c);
+
+    { ACQUIRE_MONITOR(w->thread, c->collectorMonitor);
+
+      c->stopping = true;
+      c->collectorMonitor->notifyAll(w->thread);
+    }
+
+    for (unsigned i = 1; i < c->collectorCount; ++i) {
+      c->collectors[i].thread->join();
+    }
+#endif
+
+    for (unsigned i = 0; i < c->collectorCount; ++i) {
+      Collector* w = c->collectors + i;
+      w->thread->dispose();
+      if (w->stack) {
+        free(c, w->stack, w->stackCapacity * BytesPerWord);
+      }
+    }
+
+    if (c->sharedWork) {
+      free(c, c->sharedWork, c->sharedWorkCapacity * BytesPerWord);
+    }
+
+    free(c, c->claimLocks, ClaimLockCount * BytesPerWord);
+    free(c, c->collectors, c->collectorCount * sizeof(Collector));
+    c->collectorMonitor->dispose();
+    c->collectorLock->dispose();
+
+    c->collectors = 0;
+  }
+}
+
 void
 visitDirtyFixies(Context* c, Fixie** p)
 {
@@ -1593,6 +2579,44 @@ visitMarkedFixies(Context* c)
   }  
 }
 
+void
+visitMarkedGen2(Context* c)
+{
+  while (c->markStackSize) {
+    void* o = c->markStack[-- c->markStackSize];
+
+    if (Debug) {
+      fprintf(stderr, "visit gen2 object %p\n", o);
+    }
+
+    class Walker: public Heap::Walker {
+     public:
+      Walker(Context* c, void* o):
+        c(c), o(o)
+      { }
+
+      virtual bool visit(unsigned offset) {
+        local::collect(c, o, offset);
+        return true;
+      }
+
+      Context* c;
+      void* o;
+    } w(c, o);
+
+    c->client->walk(o, &w);
+  }
+}
+
+void
+visitMarked(Context* c)
+{
+  do {
+    visitMarkedFixies(c);
+    visitMarkedGen2(c);
+  } while (c->markedFixies);
+}
+
 void
 collect(Context* c, Segment::Map* map, unsigned start, unsigned end,
         bool* dirty, bool expectDirty UNUSED)
@@ -1647,6 +2671,31 @@ collect2(Context* c)
     c->gen2Padding = 0;
   }
 
+#ifdef USE_ATOMIC_OPERATIONS
+  c->parallel = c->collectorCount > 1;
+  if (c->parallel) {
+    if (c->collectors == 0) {
+      startCollectors(c);
+    }
+
+    attachCollector(c);
+
+    for (unsigned i = 0; i < c->collectorCount; ++i) {
+      Collector* w = c->collectors + i;
+      w->nextGen1Plab = Plab();
+      w->gen2Plab = Plab();
+      w->nextGen2Plab = Plab();
+      w->tenureFootprint = 0;
+    }
+
+    if (c->mode == Heap::MinorCollection) {
+      // objects may be tenured by several collectors at once, so we
+      // mark the start of the tenured region up front:
+      c->gen2Base = c->gen2.position();
+    }
+  }
+#endif
+
   if (c->mode == Heap::MinorCollection and c->gen2.position()) {
     unsigned start = 0;
     unsigned end = start + c->gen2.position();
@@ -1658,19 +2707,374 @@ collect2(Context* c)
     visitDirtyFixies(c, &(c->dirtyTenuredFixies));
   }
 
+  drain(c);
+
   class Visitor : public Heap::Visitor {
    public:
     Visitor(Context* c): c(c) { }
 
     virtual void visit(void* p) {
+      // the client may inspect anything reachable from p as soon as
+      // we return, so we must finish tracing it first:
       local::collect(c, static_cast<void**>(p));
-      visitMarkedFixies(c);
+      drain(c);
+      visitMarked(c);
     }
 
     Context* c;
   } v(c);
 
   c->client->visitRoots(&v);
+
+  if (c->parallel) {
+    for (unsigned i = 0; i < c->collectorCount; ++i) {
+      c->tenureFootprint += c->collectors[i].tenureFootprint;
+    }
+
+#ifdef USE_ATOMIC_OPERATIONS
+    detachCollector(c);
+#endif
+
+    c->parallel = false;
+  }
+}
+
+void
+startCompaction(Context* c)
+{
+  unsigned size = ceiling(c->gen2.capacity(), BitsPerWord);
+  unsigned nextSize = ceiling(c->nextGen1.capacity(), BitsPerWord);
+
+  c->compactionTableSize = compactionTableSize(c->gen2.capacity())
+    + nextSize;
+  c->compactionTable = static_cast<uintptr_t*>
+    (local::allocate(c, c->compactionTableSize * BytesPerWord));
+  memset(c->compactionTable, 0, c->compactionTableSize * BytesPerWord);
+
+  uintptr_t* p = c->compactionTable;
+  new (&(c->liveMap)) Segment::Map(&(c->gen2), p, 1, 1, 0, false);
+  p += size;
+  new (&(c->extensionMap)) Segment::Map(&(c->gen2), p, 1, 1, 0, false);
+  p += size;
+  new (&(c->slotMap)) Segment::Map(&(c->gen2), p, 1, 1, 0, false);
+  p += size;
+  new (&(c->nextSlotMap)) Segment::Map(&(c->nextGen1), p, 1, 1, 0, false);
+  p += nextSize;
+  c->forwardBase = reinterpret_cast<unsigned*>(p);
+
+  // the remembered set is rebuilt as we visit each live gen2 object:
+  memset(c->heapMap.data, 0, c->heapMap.size() * BytesPerWord);
+  memset(c->pageMap.data, 0, c->pageMap.size() * BytesPerWord);
+  memset(c->pointerMap.data, 0, c->pointerMap.size() * BytesPerWord);
+
+  c->moveFrontier = 0;
+  c->slotCount = 0;
+}
+
+// returns the offset in gen2 which the word at index i, which must be
+// part of a live object, will have once gen2 is compacted:
+inline unsigned
+forward(Context* c, unsigned i)
+{
+  unsigned word = wordOf(i);
+  uintptr_t below = (static_cast<uintptr_t>(1) << bitOf(i)) - 1;
+  return c->forwardBase[word]
+    + bitCount(c->liveMap.data[word] & below)
+    + bitCount(c->extensionMap.data[word] & below);
+}
+
+inline void*
+compacted(Context* c, void* o)
+{
+  return c->gen2.data + forward(c, c->gen2.indexOf(o));
+}
+
+// returns the current location of a live gen2 object while it is being
+// compacted:
+inline void*
+current(Context* c, void* o)
+{
+  return o < c->moveFrontier ? compacted(c, o) : o;
+}
+
+inline void
+fixSlot(Context* c, void** p)
+{
+  void* o = mask(*p);
+  if (c->gen2.contains(o)) {
+    assert(c, c->liveMap.get(o));
+
+    local::set(p, compacted(c, o));
+  }
+}
+
+int
+compareSlots(const void* a, const void* b)
+{
+  uintptr_t x = reinterpret_cast<uintptr_t>(*static_cast<void** const*>(a));
+  uintptr_t y = reinterpret_cast<uintptr_t>(*static_cast<void** const*>(b));
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// slides the gen2 objects marked by collect2 down to the start of the
+// segment in address order and updates every reference to them.  We
+// never call the client once references have been updated, since it
+// would have no way to tell old addresses from new ones:
+void
+compact(Context* c)
+{
+  uintptr_t* data = c->gen2.data;
+  unsigned end = c->gen2.position();
+  uintptr_t* live = c->liveMap.data;
+
+  // find the extent of each live object and where it will go:
+  unsigned position = 0;
+  for (unsigned i = nextBit(live, 0, end); i < end;) {
+    void* o = data + i;
+    unsigned size = c->client->sizeInWords(o);
+
+    markRange(live, i + 1, i + size);
+
+    if (c->client->copiedSizeInWords(o) > size) {
+      // the object's identity hash is its address, so it needs another
+      // word to hold the hash if it moves.  If it won't move, we leave
+      // it as it is rather than push everything after it up a word:
+      if (position < i) {
+        c->extensionMap.setOnly(i + size - 1);
+        ++ position;
+      } else {
+        ++ c->gen2Padding;
+      }
+    }
+
+    position += size;
+    i = nextBit(live, i + size, end);
+  }
+
+  unsigned base = 0;
+  for (unsigned i = 0; i < ceiling(end, BitsPerWord); ++i) {
+    c->forwardBase[i] = base;
+    base += bitCount(live[i]) + bitCount(c->extensionMap.data[i]);
+  }
+
+  assert(c, base == position);
+
+  memset(c->startMap.data, 0, c->startMap.size() * BytesPerWord);
+
+  // move each object, fixing its references to gen2 objects and
+  // moving its remembered set bits with it:
+  for (unsigned i = nextBit(live, 0, end); i < end;) {
+    uintptr_t* o = data + i;
+    unsigned dst = forward(c, i);
+
+    c->startMap.setOnly(dst);
+
+    c->moveFrontier = o;
+
+    unsigned size = c->client->sizeInWords(o);
+    if (dst != i) {
+      if (Debug) {
+        fprintf(stderr, "move %p to %p\n", o, data + dst);
+      }
+
+      c->client->copy(o, data + dst);
+    }
+
+    moveRange(c->pointerMap.data, i, dst, size);
+
+    for (unsigned j = nextBit(c->slotMap.data, i, i + size); j < i + size;
+         j = nextBit(c->slotMap.data, j + 1, i + size))
+    {
+      fixSlot(c, reinterpret_cast<void**>(data + dst + (j - i)));
+    }
+
+    i = nextBit(live, i + size, end);
+  }
+
+  c->moveFrontier = data + end;
+
+  // fix references from outside gen2:
+  unsigned nextEnd = c->nextGen1.position();
+  for (unsigned i = nextBit(c->nextSlotMap.data, 0, nextEnd); i < nextEnd;
+       i = nextBit(c->nextSlotMap.data, i + 1, nextEnd))
+  {
+    fixSlot(c, static_cast<void**>(c->nextGen1.get(i)));
+  }
+
+  // a root may have been visited more than once, so we make sure to
+  // fix each one only once:
+  qsort(c->slots, c->slotCount, BytesPerWord, compareSlots);
+  for (unsigned i = 0; i < c->slotCount; ++i) {
+    if (i == 0 or c->slots[i] != c->slots[i - 1]) {
+      fixSlot(c, c->slots[i]);
+    }
+  }
+
+  c->gen2.position_ = position;
+
+  // rebuild the upper levels of the remembered set:
+  clearRange(c->pointerMap.data, position, end);
+  memset(c->heapMap.data, 0, c->heapMap.size() * BytesPerWord);
+  memset(c->pageMap.data, 0, c->pageMap.size() * BytesPerWord);
+  for (unsigned i = nextBit(c->pointerMap.data, 0, position); i < position;
+       i = nextBit(c->pointerMap.data, i + 1, position))
+  {
+    c->pageMap.setOnly(i);
+    c->heapMap.setOnly(i);
+  }
+
+  if (Verbose) {
+    fprintf(stderr, "compacted gen2 from %d to %d bytes\n",
+            end * BytesPerWord, position * BytesPerWord);
+  }
+
+  free(c, c->compactionTable, c->compactionTableSize * BytesPerWord);
+  c->compactionTable = 0;
+  c->forwardBase = 0;
+  c->moveFrontier = 0;
+
+  if (c->markStack) {
+    free(c, c->markStack, c->markStackCapacity * BytesPerWord);
+    c->markStack = 0;
+    c->markStackCapacity = 0;
+  }
+
+  if (c->slots) {
+    free(c, c->slots, c->slotCapacity * BytesPerWord);
+    c->slots = 0;
+    c->slotCount = 0;
+    c->slotCapacity = 0;
+  }
+
+  c->gen2Crowded = c->gen2.remaining()
+    < tenureFootprint(c) + (c->gen2.capacity() / CompactionHeadroomRatio);
+}
+
+bool
+targetNeedsMark(Context* c, void* target)
+{
+  return target
+    and not c->gen2.contains(target)
+    and not c->nextGen2.contains(target)
+    and not immortalHeapContains(c, target)
+    and not (c->client->isFixed(target)
+             and fixie(target)->age >= FixieTenureThreshold);
+}
+
+inline uint8_t*
+card(Context* c, void* p)
+{
+  return c->cards + ((reinterpret_cast<uintptr_t>(p) >> CardShift) & CardMask);
+}
+
+// returns the address at which the card after the one containing p
+// starts:
+inline uintptr_t*
+nextCard(void* p)
+{
+  return reinterpret_cast<uintptr_t*>
+    ((reinterpret_cast<uintptr_t>(p) | ((1 << CardShift) - 1)) + 1);
+}
+
+// adds each reference in a dirty card of the object it walks to the
+// remembered set, i.e. the heap map for gen2 objects and the fixie
+// mask otherwise:
+class CardWalker: public Heap::Walker {
+ public:
+  CardWalker(Context* c, void** p, void** start, void** end, Fixie* f):
+    c(c), p(p), start(start), end(end), f(f), dirty(false)
+  { }
+
+  virtual bool visit(unsigned offset) {
+    void** slot = p + offset;
+    // compiled code never stores to the class pointer at offset zero:
+    if (offset and slot >= start and slot < end and *card(c, slot)
+        and targetNeedsMark(c, mask(*slot)))
+    {
+      if (f) {
+        assert(c, f->hasMask());
+        markBit(f->mask(), offset);
+      } else {
+        c->heapMap.set(slot);
+      }
+      dirty = true;
+    }
+    return true;
+  }
+
+  Context* c;
+  void** p;
+  void** start;
+  void** end;
+  Fixie* f;
+  bool dirty;
+};
+
+void
+scanCards(Context* c, Fixie* f)
+{
+  void** body = f->body();
+  void** end = body + f->size;
+  for (void** p = body; p < end; p = reinterpret_cast<void**>(nextCard(p))) {
+    if (*card(c, p)) {
+      CardWalker walker(c, body, body, end, f);
+      c->client->walk(body, &walker);
+      if (walker.dirty) {
+        markDirty(c, f);
+      }
+      return;
+    }
+  }
+}
+
+// translates the cards dirtied by compiled code since the last
+// collection into the remembered set used by collect2.  A major
+// collection rebuilds the remembered set from scratch, so it need only
+// clear them:
+void
+scanCards(Context* c)
+{
+  if (c->mode == Heap::MinorCollection) {
+    // the client will call follow as it walks objects, which mustn't
+    // mistake an object tenured by the last collection for one which
+    // has already been moved:
+    c->gen2Base = Top;
+
+    uintptr_t* data = c->gen2.data;
+    unsigned limit = c->gen2.position();
+    for (unsigned i = 0; i < limit;) {
+      unsigned start = i;
+      while (i < limit and *card(c, data + i)) {
+        i = min(limit, static_cast<unsigned>(nextCard(data + i) - data));
+      }
+
+      if (i == start) {
+        i = min(limit, static_cast<unsigned>(nextCard(data + i) - data));
+      } else {
+        for (unsigned j = previousBit(c->startMap.data, start); j < i;
+             j = nextBit(c->startMap.data, j + 1, limit))
+        {
+          void** o = reinterpret_cast<void**>(data + j);
+          CardWalker walker(c, o, reinterpret_cast<void**>(data + start),
+                            reinterpret_cast<void**>(data + i), 0);
+          c->client->walk(o, &walker);
+        }
+      }
+    }
+
+    for (Fixie* f = c->dirtyTenuredFixies; f; f = f->next) {
+      scanCards(c, f);
+    }
+
+    for (Fixie* f = c->tenuredFixies; f;) {
+      // scanCards may move f to dirtyTenuredFixies:
+      Fixie* next = f->next;
+      scanCards(c, f);
+      f = next;
+    }
+  }
+
+  memset(c->cards, 0, CardTableSizeInBytes);
 }
 
 void
@@ -1678,7 +3082,7 @@ collect(Context* c)
 {
   if (lowMemory(c)
       or oversizedGen2(c)
-      or c->tenureFootprint + c->tenurePadding > c->gen2.remaining()
+      or tenureFootprint(c) > c->gen2.remaining()
       or c->fixieTenureFootprint + c->tenuredFixieFootprint
       > c->tenuredFixieCeiling)
   {
@@ -1687,8 +3091,7 @@ collect(Context* c)
         fprintf(stderr, "low memory causes ");        
       } else if (oversizedGen2(c)) {
         fprintf(stderr, "oversized gen2 causes ");
-      } else if (c->tenureFootprint + c->tenurePadding > c->gen2.remaining())
-      {
+      } else if (tenureFootprint(c) > c->gen2.remaining()) {
         fprintf(stderr, "undersized gen2 causes ");
       } else {
         fprintf(stderr, "fixie ceiling causes ");
@@ -1701,7 +3104,8 @@ collect(Context* c)
   int64_t then;
   if (Verbose) {
     if (c->mode == Heap::MajorCollection) {
-      fprintf(stderr, "major collection\n");
+      fprintf(stderr, "major collection%s\n",
+              compactGen2(c) ? " (compacting)" : "");
     } else {
       fprintf(stderr, "minor collection\n");
     }
@@ -1728,19 +3132,32 @@ collect(Context* c)
     c->lowMemoryThreshold = avg(count, c->lowMemoryThreshold);
   }
 
+  scanCards(c);
+
+  c->compacting = c->mode == Heap::MajorCollection and compactGen2(c);
+
   initNextGen1(c);
 
-  if (c->mode == Heap::MajorCollection) {
+  if (c->compacting) {
+    startCompaction(c);
+  } else if (c->mode == Heap::MajorCollection) {
     initNextGen2(c);
   }
 
   collect2(c);
 
+  if (c->compacting) {
+    compact(c);
+  }
+
   c->gen1.replaceWith(&(c->nextGen1));
-  if (c->mode == Heap::MajorCollection) {
+  if (c->mode == Heap::MajorCollection and not c->compacting) {
     c->gen2.replaceWith(&(c->nextGen2));
+    c->gen2Crowded = false;
   }
 
+  c->compacting = false;
+
   sweepFixies(c);
 
   if (Verbose) {
@@ -1778,6 +3195,10 @@ collect(Context* c)
     fprintf(stderr,
             " -   tenured fixies:          %8d bytes\n",
             c->tenuredFixieFootprint);
+
+    fprintf(stderr,
+            " -       collectors: %8d\n",
+            c->collectorCount);
   }
 }
 
@@ -1854,9 +3275,13 @@ free_(Context* c, const void* p, unsigned size)
 
 class MyHeap: public Heap {
  public:
-  MyHeap(System* system, unsigned limit):
-    c(system, limit)
-  { }
+  MyHeap(System* system, unsigned limit, unsigned collectorCount):
+    c(system, limit, collectorCount)
+  {
+    c.cards = static_cast<uint8_t*>
+      (local::allocate(&c, CardTableSizeInBytes));
+    memset(c.cards, 0, CardTableSizeInBytes);
+  }
 
   virtual void setClient(Heap::Client* client) {
     assert(&c, c.client == 0);
@@ -1923,15 +3348,22 @@ class MyHeap: public Heap {
   }
 
   bool targetNeedsMark(void* target) {
-    return target
-      and not c.gen2.contains(target)
-      and not c.nextGen2.contains(target)
-      and not immortalHeapContains(&c, target)
-      and not (c.client->isFixed(target)
-               and fixie(target)->age >= FixieTenureThreshold);
+    return local::targetNeedsMark(&c, target);
   }
 
   virtual void mark(void* p, unsigned offset, unsigned count) {
+    if (c.compacting) {
+      // the client may store references to gen2 objects while
+      // visiting roots (see postVisit in machine.cpp), and we need to
+      // fix them along with the rest:
+      for (unsigned i = 0; i < count; ++i) {
+        void** target = static_cast<void**>(p) + offset + i;
+        if (c.gen2.contains(mask(*target))) {
+          recordSlot(&c, 0, target);
+        }
+      }
+    }
+
     if (needsMark(p)) {
 #ifndef USE_ATOMIC_OPERATIONS
       ACQUIRE(c.lock);
@@ -1998,8 +3430,17 @@ class MyHeap: public Heap {
     }
   }
 
+  virtual uint8_t* cardTable() {
+    return c.cards;
+  }
+
   virtual void* follow(void* p) {
-    if (p == 0 or c.client->isFixed(p)) {
+    if (c.compacting and c.gen2.contains(p)) {
+      // p may have been moved already, in which case there's no
+      // telling what's at its old address now, so we must check this
+      // before anything else:
+      return current(&c, p);
+    } else if (p == 0 or c.client->isFixed(p)) {
       return p;
     } else if (wasCollected(&c, p)) {
       if (Debug) {
@@ -2032,6 +3473,8 @@ class MyHeap: public Heap {
            : Tenured);
     } else if (c.nextGen1.contains(p)) {
       return Reachable;
+    } else if (c.compacting and c.gen2.contains(p)) {
+      return c.liveMap.get(p) ? Tenured : Unreachable;
     } else if (c.nextGen2.contains(p)
                or immortalHeapContains(&c, p)
                or (c.gen2.contains(p)
@@ -2055,6 +3498,7 @@ class MyHeap: public Heap {
   }
 
   virtual void dispose() {
+    local::free(&c, c.cards, CardTableSizeInBytes);
     c.dispose();
     assert(&c, c.count == 0);
     c.system->free(this);
@@ -2070,10 +3514,20 @@ class MyHeap: public Heap {
 namespace vm {
 
 Heap*
-makeHeap(System* system, unsigned limit)
-{  
+makeHeap(System* system, unsigned limit, unsigned collectorCount)
+{
+#ifdef USE_ATOMIC_OPERATIONS
+  if (collectorCount == 0) {
+    collectorCount = 1;
+  } else if (collectorCount > local::MaximumCollectorCount) {
+    collectorCount = local::MaximumCollectorCount;
+  }
+#else
+  collectorCount = 1;
+#endif
+
   return new (system->tryAllocate(sizeof(local::MyHeap)))
-    local::MyHeap(system, limit);
+    local::MyHeap(system, limit, collectorCount);
 }
 
 } // namespace vm
@@ -22,6 +22,15 @@ const unsigned TenureThreshold = 3;
 
 const unsigned FixieTenureThreshold = TenureThreshold + 2;
 
+// compiled code records each reference store by setting
+// cardTable[(address >> CardShift) & CardMask] to a non-zero value
+// rather than calling Heap::mark.  Any address maps to some card, so
+// the barrier needs no test, at the cost of the collector sometimes
+// scanning a card dirtied by a store elsewhere:
+const unsigned CardShift = 9;
+const unsigned CardTableSizeInBytes = 256 * 1024;
+const uintptr_t CardMask = CardTableSizeInBytes - 1;
+
 class Heap: public Allocator {
  public:
   enum CollectionType {
@@ -70,6 +79,7 @@ class Heap: public Allocator {
   virtual void mark(void* p, unsigned offset, unsigned count) = 0;
   virtual void pad(void* p) = 0;
   virtual void* follow(void* p) = 0;
+  virtual uint8_t* cardTable() = 0;
   virtual void postVisit() = 0;
   virtual Status status(void* p) = 0;
   virtual CollectionType collectionType() = 0;
@@ -77,7 +87,10 @@ class Heap: public Allocator {
   virtual void dispose() = 0;
 };
 
-Heap* makeHeap(System* system, unsigned limit);
+// collectorCount is the number of threads used to trace and copy
+// objects during a collection (1 means the collecting thread does
+// everything itself):
+Heap* makeHeap(System* system, unsigned limit, unsigned collectorCount);
 
 } // namespace vm
 
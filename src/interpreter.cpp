@@ -0,0 +1,2301 @@
+/* Copyright (c) 2008-2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "interpreter.h"
+#include "process.h"
+
+using namespace vm;
+
+namespace {
+
+void
+backEdge(Interpreter* s)
+{
+  Thread* t = s->t;
+
+  // compiled code polls for safepoints at back edges, so we must too,
+  // or a long-running interpreted loop could hold up the collector:
+  if (UNLIKELY(t->m->exclusive and t->state == Thread::ActiveState)) {
+    ENTER(t, Thread::IdleState);
+  }
+
+  s->client->backEdge(s);
+}
+
+inline void
+jump(Interpreter* s, unsigned length, int32_t offset)
+{
+  s->ip = (s->ip - length) + offset;
+
+  if (offset <= 0) {
+    backEdge(s);
+  }
+}
+
+inline void
+resolveBootstrap(Thread* t, object class_)
+{
+  // a class from a boot image may not have been fully loaded yet, in
+  // which case its method tables are incomplete:
+  if (UNLIKELY(classVmFlags(t, class_) & BootstrapFlag)) {
+    resolveClass(t, root(t, Machine::BootLoader), className(t, class_));
+  }
+}
+
+uint64_t
+findExceptionHandler(Interpreter* s, object method, unsigned ip)
+{
+  Thread* t = s->t;
+
+  PROTECT(t, method);
+
+  object eht = codeExceptionHandlerTable(t, methodCode(t, method));
+      
+  if (eht) {
+    for (unsigned i = 0; i < exceptionHandlerTableLength(t, eht); ++i) {
+      uint64_t eh = exceptionHandlerTableBody(t, eht, i);
+
+      if (ip - 1 >= exceptionHandlerStart(eh)
+          and ip - 1 < exceptionHandlerEnd(eh))
+      {
+        object catchType = 0;
+        if (exceptionHandlerCatchType(eh)) {
+          object e = t->exception;
+          t->exception = 0;
+          PROTECT(t, e);
+
+          PROTECT(t, eht);
+          catchType = resolveClassInPool
+            (t, method, exceptionHandlerCatchType(eh) - 1);
+
+          if (catchType) {
+            eh = exceptionHandlerTableBody(t, eht, i);
+            t->exception = e;
+          } else {
+            // can't find what we're supposed to catch - move on.
+            continue;
+          }
+        }
+
+        if (exceptionMatch(t, catchType, t->exception)) {
+          return eh;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+uint64_t
+findExceptionHandler(Interpreter* s, int frame)
+{
+  return findExceptionHandler(s, frameMethod(s, frame), frameIp(s, frame));
+}
+
+void
+pushField(Interpreter* s, object target, object field)
+{
+  Thread* t = s->t;
+
+  switch (fieldCode(t, field)) {
+  case ByteField:
+  case BooleanField:
+    pushInt(s, cast<int8_t>(target, fieldOffset(t, field)));
+    break;
+
+  case CharField:
+  case ShortField:
+    pushInt(s, cast<int16_t>(target, fieldOffset(t, field)));
+    break;
+
+  case FloatField:
+  case IntField:
+    pushInt(s, cast<int32_t>(target, fieldOffset(t, field)));
+    break;
+
+  case DoubleField:
+  case LongField:
+    pushLong(s, cast<int64_t>(target, fieldOffset(t, field)));
+    break;
+
+  case ObjectField:
+    pushObject(s, cast<object>(target, fieldOffset(t, field)));
+    break;
+
+  default:
+    abort(t);
+  }
+}
+
+object
+interpret3(Interpreter* s, const int base)
+{
+  Thread* t = s->t;
+
+  unsigned instruction = nop;
+  unsigned& ip = s->ip;
+  unsigned& sp = s->sp;
+  int& frame = s->frame;
+  object& code = s->code;
+  object& exception = t->exception;
+  uintptr_t* stack = s->stack;
+
+  code = methodCode(t, frameMethod(s, frame));
+
+  if (UNLIKELY(exception)) {
+    goto throw_;
+  }
+
+  initClass(t, methodClass(t, frameMethod(s, frame)));
+
+ loop:
+  instruction = codeBody(t, code, ip++);
+
+  if (DebugRun) {
+    fprintf(stderr, "ip: %d; instruction: 0x%x in %s.%s ",
+            ip - 1,
+            instruction,
+            &byteArrayBody
+            (t, className(t, methodClass(t, frameMethod(s, frame))), 0),
+            &byteArrayBody
+            (t, methodName(t, frameMethod(s, frame)), 0));
+
+    int line = findLineNumber(t, frameMethod(s, frame), ip);
+    switch (line) {
+    case NativeLine:
+      fprintf(stderr, "(native)\n");
+      break;
+    case UnknownLine:
+      fprintf(stderr, "(unknown line)\n");
+      break;
+    default:
+      fprintf(stderr, "(line %d)\n", line);
+    }
+  }
+
+  switch (instruction) {
+  case aaload: {
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < objectArrayLength(t, array)))
+      {
+        pushObject(s, objectArrayBody(t, array, index));
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, objectArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case aastore: {
+    object value = popObject(s);
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < objectArrayLength(t, array)))
+      {
+        set(t, array, ArrayBody + (index * BytesPerWord), value);
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, objectArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case aconst_null: {
+    pushObject(s, 0);
+  } goto loop;
+
+  case aload: {
+    pushObject(s, localObject(s, codeBody(t, code, ip++)));
+  } goto loop;
+
+  case aload_0: {
+    pushObject(s, localObject(s, 0));
+  } goto loop;
+
+  case aload_1: {
+    pushObject(s, localObject(s, 1));
+  } goto loop;
+
+  case aload_2: {
+    pushObject(s, localObject(s, 2));
+  } goto loop;
+
+  case aload_3: {
+    pushObject(s, localObject(s, 3));
+  } goto loop;
+
+  case anewarray: {
+    int32_t count = popInt(s);
+
+    if (LIKELY(count >= 0)) {
+      uint16_t index = codeReadInt16(t, code, ip);
+      
+      object class_ = resolveClassInPool(t, frameMethod(s, frame), index - 1);
+            
+      pushObject(s, makeObjectArray(t, class_, count));
+    } else {
+      exception = makeThrowable
+        (t, Machine::NegativeArraySizeExceptionType, "%d", count);
+      goto throw_;
+    }
+  } goto loop;
+
+  case areturn: {
+    object result = popObject(s);
+    if (frame > base) {
+      popFrame(s);
+      pushObject(s, result);
+      goto loop;
+    } else {
+      return result;
+    }
+  } goto loop;
+
+  case arraylength: {
+    object array = popObject(s);
+    if (LIKELY(array)) {
+      pushInt(s, cast<uintptr_t>(array, BytesPerWord));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case astore: {
+    store(s, codeBody(t, code, ip++));
+  } goto loop;
+
+  case astore_0: {
+    store(s, 0);
+  } goto loop;
+
+  case astore_1: {
+    store(s, 1);
+  } goto loop;
+
+  case astore_2: {
+    store(s, 2);
+  } goto loop;
+
+  case astore_3: {
+    store(s, 3);
+  } goto loop;
+
+  case athrow: {
+    exception = popObject(s);
+    if (UNLIKELY(exception == 0)) {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+    }
+  } goto throw_;
+
+  case baload: {
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (objectClass(t, array) == type(t, Machine::BooleanArrayType)) {
+        if (LIKELY(index >= 0 and
+                   static_cast<uintptr_t>(index)
+                   < booleanArrayLength(t, array)))
+        {
+          pushInt(s, booleanArrayBody(t, array, index));
+        } else {
+          exception = makeThrowable
+            (t, Machine::ArrayIndexOutOfBoundsExceptionType,
+             "%d not in [0,%d)", index, booleanArrayLength(t, array));
+          goto throw_;
+        }
+      } else {
+        if (LIKELY(index >= 0 and
+                   static_cast<uintptr_t>(index)
+                   < byteArrayLength(t, array)))
+        {
+          pushInt(s, byteArrayBody(t, array, index));
+        } else {
+          exception = makeThrowable
+            (t, Machine::ArrayIndexOutOfBoundsExceptionType,
+             "%d not in [0,%d)", index, byteArrayLength(t, array));
+          goto throw_;
+        }
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case bastore: {
+    int8_t value = popInt(s);
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (objectClass(t, array) == type(t, Machine::BooleanArrayType)) {
+        if (LIKELY(index >= 0 and
+                   static_cast<uintptr_t>(index)
+                   < booleanArrayLength(t, array)))
+        {
+          booleanArrayBody(t, array, index) = value;
+        } else {
+          exception = makeThrowable
+            (t, Machine::ArrayIndexOutOfBoundsExceptionType,
+             "%d not in [0,%d)", index, booleanArrayLength(t, array));
+          goto throw_;
+        }
+      } else {
+        if (LIKELY(index >= 0 and
+                   static_cast<uintptr_t>(index) < byteArrayLength(t, array)))
+        {
+          byteArrayBody(t, array, index) = value;
+        } else {
+          exception = makeThrowable
+            (t, Machine::ArrayIndexOutOfBoundsExceptionType,
+             "%d not in [0,%d)", index, byteArrayLength(t, array));
+          goto throw_;
+        }
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case bipush: {
+    pushInt(s, static_cast<int8_t>(codeBody(t, code, ip++)));
+  } goto loop;
+
+  case caload: {
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < charArrayLength(t, array)))
+      {
+        pushInt(s, charArrayBody(t, array, index));
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, charArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case castore: {
+    uint16_t value = popInt(s);
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < charArrayLength(t, array)))
+      {
+        charArrayBody(t, array, index) = value;
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, charArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case checkcast: {
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    if (peekObject(s, sp - 1)) {
+      object class_ = resolveClassInPool(t, frameMethod(s, frame), index - 1);
+      if (UNLIKELY(exception)) goto throw_;
+
+      if (not instanceOf(t, class_, peekObject(s, sp - 1))) {
+        exception = makeThrowable
+          (t, Machine::ClassCastExceptionType, "%s as %s",
+           &byteArrayBody
+           (t, className(t, objectClass(t, peekObject(s, sp - 1))), 0),
+           &byteArrayBody(t, className(t, class_), 0));
+        goto throw_;
+      }
+    }
+  } goto loop;
+
+  case d2f: {
+    pushFloat(s, static_cast<float>(popDouble(s)));
+  } goto loop;
+
+  case d2i: {
+    double f = popDouble(s);
+    switch (fpclassify(f)) {
+    case FP_NAN: pushInt(s, 0); break;
+    case FP_INFINITE: pushInt(s, signbit(f) ? INT32_MIN : INT32_MAX); break;
+    default: pushInt
+        (s,  f >= INT32_MAX ? INT32_MAX
+         : (f <= INT32_MIN ? INT32_MIN : static_cast<int32_t>(f)));
+      break;
+    }
+  } goto loop;
+
+  case d2l: {
+    double f = popDouble(s);
+    switch (fpclassify(f)) {
+    case FP_NAN: pushLong(s, 0); break;
+    case FP_INFINITE: pushLong(s, signbit(f) ? INT64_MIN : INT64_MAX); break;
+    default: pushLong
+        (s,  f >= INT64_MAX ? INT64_MAX
+         : (f <= INT64_MIN ? INT64_MIN : static_cast<int64_t>(f)));
+      break;
+    }
+  } goto loop;
+
+  case dadd: {
+    double b = popDouble(s);
+    double a = popDouble(s);
+    
+    pushDouble(s, a + b);
+  } goto loop;
+
+  case daload: {
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < doubleArrayLength(t, array)))
+      {
+        pushLong(s, doubleArrayBody(t, array, index));
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, doubleArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case dastore: {
+    double value = popDouble(s);
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < doubleArrayLength(t, array)))
+      {
+        memcpy(&doubleArrayBody(t, array, index), &value, sizeof(uint64_t));
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, doubleArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case dcmpg: {
+    double b = popDouble(s);
+    double a = popDouble(s);
+    
+    if (a < b) {
+      pushInt(s, static_cast<unsigned>(-1));
+    } else if (a > b) {
+      pushInt(s, 1);
+    } else if (a == b) {
+      pushInt(s, 0);
+    } else {
+      pushInt(s, 1);
+    }
+  } goto loop;
+
+  case dcmpl: {
+    double b = popDouble(s);
+    double a = popDouble(s);
+    
+    if (a < b) {
+      pushInt(s, static_cast<unsigned>(-1));
+    } else if (a > b) {
+      pushInt(s, 1);
+    } else if (a == b) {
+      pushInt(s, 0);
+    } else {
+      pushInt(s, static_cast<unsigned>(-1));
+    }
+  } goto loop;
+
+  case dconst_0: {
+    pushDouble(s, 0);
+  } goto loop;
+
+  case dconst_1: {
+    pushDouble(s, 1);
+  } goto loop;
+
+  case ddiv: {
+    double b = popDouble(s);
+    double a = popDouble(s);
+    
+    pushDouble(s, a / b);
+  } goto loop;
+
+  case dmul: {
+    double b = popDouble(s);
+    double a = popDouble(s);
+    
+    pushDouble(s, a * b);
+  } goto loop;
+
+  case dneg: {
+    double a = popDouble(s);
+    
+    pushDouble(s, - a);
+  } goto loop;
+
+  case vm::drem: {
+    double b = popDouble(s);
+    double a = popDouble(s);
+    
+    pushDouble(s, fmod(a, b));
+  } goto loop;
+
+  case dsub: {
+    double b = popDouble(s);
+    double a = popDouble(s);
+    
+    pushDouble(s, a - b);
+  } goto loop;
+
+  case dup: {
+    if (DebugStack) {
+      fprintf(stderr, "dup\n");
+    }
+
+    memcpy(stack + ((sp    ) * 2), stack + ((sp - 1) * 2), BytesPerWord * 2);
+    ++ sp;
+  } goto loop;
+
+  case dup_x1: {
+    if (DebugStack) {
+      fprintf(stderr, "dup_x1\n");
+    }
+
+    memcpy(stack + ((sp    ) * 2), stack + ((sp - 1) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 1) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 2) * 2), stack + ((sp    ) * 2), BytesPerWord * 2);
+    ++ sp;
+  } goto loop;
+
+  case dup_x2: {
+    if (DebugStack) {
+      fprintf(stderr, "dup_x2\n");
+    }
+
+    memcpy(stack + ((sp    ) * 2), stack + ((sp - 1) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 1) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 2) * 2), stack + ((sp - 3) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 3) * 2), stack + ((sp    ) * 2), BytesPerWord * 2);
+    ++ sp;
+  } goto loop;
+
+  case dup2: {
+    if (DebugStack) {
+      fprintf(stderr, "dup2\n");
+    }
+
+    memcpy(stack + ((sp    ) * 2), stack + ((sp - 2) * 2), BytesPerWord * 4);
+    sp += 2;
+  } goto loop;
+
+  case dup2_x1: {
+    if (DebugStack) {
+      fprintf(stderr, "dup2_x1\n");
+    }
+
+    memcpy(stack + ((sp + 1) * 2), stack + ((sp - 1) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp    ) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 1) * 2), stack + ((sp - 3) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 3) * 2), stack + ((sp    ) * 2), BytesPerWord * 4);
+    sp += 2;
+  } goto loop;
+
+  case dup2_x2: {
+    if (DebugStack) {
+      fprintf(stderr, "dup2_x2\n");
+    }
+
+    memcpy(stack + ((sp + 1) * 2), stack + ((sp - 1) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp    ) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 1) * 2), stack + ((sp - 3) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 2) * 2), stack + ((sp - 4) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 4) * 2), stack + ((sp    ) * 2), BytesPerWord * 4);
+    sp += 2;
+  } goto loop;
+
+  case f2d: {
+    pushDouble(s, popFloat(s));
+  } goto loop;
+
+  case f2i: {
+    float f = popFloat(s);
+    switch (fpclassify(f)) {
+    case FP_NAN: pushInt(s, 0); break;
+    case FP_INFINITE: pushInt(s, signbit(f) ? INT32_MIN : INT32_MAX); break;
+    default: pushInt(s, f >= INT32_MAX ? INT32_MAX
+                     : (f <= INT32_MIN ? INT32_MIN : static_cast<int32_t>(f)));
+      break;
+    }
+  } goto loop;
+
+  case f2l: {
+    float f = popFloat(s);
+    switch (fpclassify(f)) {
+    case FP_NAN: pushLong(s, 0); break;
+    case FP_INFINITE: pushLong(s, signbit(f) ? INT64_MIN : INT64_MAX);
+      break;
+    default: pushLong(s, static_cast<int64_t>(f)); break;
+    }
+  } goto loop;
+
+  case fadd: {
+    float b = popFloat(s);
+    float a = popFloat(s);
+    
+    pushFloat(s, a + b);
+  } goto loop;
+
+  case faload: {
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < floatArrayLength(t, array)))
+      {
+        pushInt(s, floatArrayBody(t, array, index));
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, floatArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case fastore: {
+    float value = popFloat(s);
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < floatArrayLength(t, array)))
+      {
+        memcpy(&floatArrayBody(t, array, index), &value, sizeof(uint32_t));
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, floatArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case fcmpg: {
+    float b = popFloat(s);
+    float a = popFloat(s);
+    
+    if (a < b) {
+      pushInt(s, static_cast<unsigned>(-1));
+    } else if (a > b) {
+      pushInt(s, 1);
+    } else if (a == b) {
+      pushInt(s, 0);
+    } else {
+      pushInt(s, 1);
+    }
+  } goto loop;
+
+  case fcmpl: {
+    float b = popFloat(s);
+    float a = popFloat(s);
+    
+    if (a < b) {
+      pushInt(s, static_cast<unsigned>(-1));
+    } else if (a > b) {
+      pushInt(s, 1);
+    } else if (a == b) {
+      pushInt(s, 0);
+    } else {
+      pushInt(s, static_cast<unsigned>(-1));
+    }
+  } goto loop;
+
+  case fconst_0: {
+    pushFloat(s, 0);
+  } goto loop;
+
+  case fconst_1: {
+    pushFloat(s, 1);
+  } goto loop;
+
+  case fconst_2: {
+    pushFloat(s, 2);
+  } goto loop;
+
+  case fdiv: {
+    float b = popFloat(s);
+    float a = popFloat(s);
+    
+    pushFloat(s, a / b);
+  } goto loop;
+
+  case fmul: {
+    float b = popFloat(s);
+    float a = popFloat(s);
+    
+    pushFloat(s, a * b);
+  } goto loop;
+
+  case fneg: {
+    float a = popFloat(s);
+    
+    pushFloat(s, - a);
+  } goto loop;
+
+  case frem: {
+    float b = popFloat(s);
+    float a = popFloat(s);
+    
+    pushFloat(s, fmodf(a, b));
+  } goto loop;
+
+  case fsub: {
+    float b = popFloat(s);
+    float a = popFloat(s);
+    
+    pushFloat(s, a - b);
+  } goto loop;
+
+  case getfield: {
+    if (LIKELY(peekObject(s, sp - 1))) {
+      uint16_t index = codeReadInt16(t, code, ip);
+    
+      object field = resolveField(t, frameMethod(s, frame), index - 1);
+
+      assert(t, (fieldFlags(t, field) & ACC_STATIC) == 0);
+
+      PROTECT(t, field);
+
+      ACQUIRE_FIELD_FOR_READ(t, field);
+
+      pushField(s, popObject(s), field);
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case getstatic: {
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    object field = resolveField(t, frameMethod(s, frame), index - 1);
+
+    assert(t, fieldFlags(t, field) & ACC_STATIC);
+
+    PROTECT(t, field);
+
+    initClass(t, fieldClass(t, field));
+
+    ACQUIRE_FIELD_FOR_READ(t, field);
+
+    pushField(s, classStaticTable(t, fieldClass(t, field)), field);
+  } goto loop;
+
+  case goto_: {
+    int16_t offset = codeReadInt16(t, code, ip);
+    jump(s, 3, offset);
+  } goto loop;
+    
+  case goto_w: {
+    int32_t offset = codeReadInt32(t, code, ip);
+    jump(s, 5, offset);
+  } goto loop;
+
+  case i2b: {
+    pushInt(s, static_cast<int8_t>(popInt(s)));
+  } goto loop;
+
+  case i2c: {
+    pushInt(s, static_cast<uint16_t>(popInt(s)));
+  } goto loop;
+
+  case i2d: {
+    pushDouble(s, static_cast<double>(static_cast<int32_t>(popInt(s))));
+  } goto loop;
+
+  case i2f: {
+    pushFloat(s, static_cast<float>(static_cast<int32_t>(popInt(s))));
+  } goto loop;
+
+  case i2l: {
+    pushLong(s, static_cast<int32_t>(popInt(s)));
+  } goto loop;
+
+  case i2s: {
+    pushInt(s, static_cast<int16_t>(popInt(s)));
+  } goto loop;
+
+  case iadd: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    pushInt(s, a + b);
+  } goto loop;
+
+  case iaload: {
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < intArrayLength(t, array)))
+      {
+        pushInt(s, intArrayBody(t, array, index));
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, intArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case iand: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    pushInt(s, a & b);
+  } goto loop;
+
+  case iastore: {
+    int32_t value = popInt(s);
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < intArrayLength(t, array)))
+      {
+        intArrayBody(t, array, index) = value;
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, intArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case iconst_m1: {
+    pushInt(s, static_cast<unsigned>(-1));
+  } goto loop;
+
+  case iconst_0: {
+    pushInt(s, 0);
+  } goto loop;
+
+  case iconst_1: {
+    pushInt(s, 1);
+  } goto loop;
+
+  case iconst_2: {
+    pushInt(s, 2);
+  } goto loop;
+
+  case iconst_3: {
+    pushInt(s, 3);
+  } goto loop;
+
+  case iconst_4: {
+    pushInt(s, 4);
+  } goto loop;
+
+  case iconst_5: {
+    pushInt(s, 5);
+  } goto loop;
+
+  case idiv: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+
+    if (UNLIKELY(b == 0)) {
+      exception = makeThrowable(t, Machine::ArithmeticExceptionType);
+      goto throw_;
+    }
+    
+    pushInt(s, a / b);
+  } goto loop;
+
+  case if_acmpeq: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    object b = popObject(s);
+    object a = popObject(s);
+    
+    if (a == b) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case if_acmpne: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    object b = popObject(s);
+    object a = popObject(s);
+    
+    if (a != b) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case if_icmpeq: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    if (a == b) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case if_icmpne: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    if (a != b) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case if_icmpgt: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    if (a > b) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case if_icmpge: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    if (a >= b) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case if_icmplt: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    if (a < b) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case if_icmple: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    if (a <= b) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case ifeq: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    if (popInt(s) == 0) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case ifne: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    if (popInt(s)) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case ifgt: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    if (static_cast<int32_t>(popInt(s)) > 0) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case ifge: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    if (static_cast<int32_t>(popInt(s)) >= 0) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case iflt: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    if (static_cast<int32_t>(popInt(s)) < 0) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case ifle: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    if (static_cast<int32_t>(popInt(s)) <= 0) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case ifnonnull: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    if (popObject(s)) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case ifnull: {
+    int16_t offset = codeReadInt16(t, code, ip);
+
+    if (popObject(s) == 0) {
+      jump(s, 3, offset);
+    }
+  } goto loop;
+
+  case iinc: {
+    uint8_t index = codeBody(t, code, ip++);
+    int8_t c = codeBody(t, code, ip++);
+    
+    setLocalInt(s, index, localInt(s, index) + c);
+  } goto loop;
+
+  case iload:
+  case fload: {
+    pushInt(s, localInt(s, codeBody(t, code, ip++)));
+  } goto loop;
+
+  case iload_0:
+  case fload_0: {
+    pushInt(s, localInt(s, 0));
+  } goto loop;
+
+  case iload_1:
+  case fload_1: {
+    pushInt(s, localInt(s, 1));
+  } goto loop;
+
+  case iload_2:
+  case fload_2: {
+    pushInt(s, localInt(s, 2));
+  } goto loop;
+
+  case iload_3:
+  case fload_3: {
+    pushInt(s, localInt(s, 3));
+  } goto loop;
+
+  case imul: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    pushInt(s, a * b);
+  } goto loop;
+
+  case ineg: {
+    pushInt(s, - popInt(s));
+  } goto loop;
+
+  case instanceof: {
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    if (peekObject(s, sp - 1)) {
+      object class_ = resolveClassInPool(t, frameMethod(s, frame), index - 1);
+
+      if (instanceOf(t, class_, popObject(s))) {
+        pushInt(s, 1);
+      } else {
+        pushInt(s, 0);
+      }
+    } else {
+      popObject(s);
+      pushInt(s, 0);
+    }
+  } goto loop;
+
+  case invokeinterface: {
+    uint16_t index = codeReadInt16(t, code, ip);
+    
+    ip += 2;
+
+    object method = resolveMethod(t, frameMethod(s, frame), index - 1);
+    
+    unsigned parameterFootprint = methodParameterFootprint(t, method);
+    if (LIKELY(peekObject(s, sp - parameterFootprint))) {
+      object class_ = objectClass(t, peekObject(s, sp - parameterFootprint));
+      PROTECT(t, method);
+      PROTECT(t, class_);
+
+      resolveBootstrap(t, class_);
+
+      code = findInterfaceMethod(t, method, class_);
+      goto invoke;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case invokespecial: {
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    object method = resolveMethod(t, frameMethod(s, frame), index - 1);
+    
+    unsigned parameterFootprint = methodParameterFootprint(t, method);
+    if (LIKELY(peekObject(s, sp - parameterFootprint))) {
+      object class_ = methodClass(t, frameMethod(s, frame));
+      if (isSpecialMethod(t, method, class_)) {
+        class_ = classSuper(t, class_);
+        PROTECT(t, method);
+        PROTECT(t, class_);
+
+        initClass(t, class_);
+
+        code = findVirtualMethod(t, method, class_);
+      } else {
+        code = method;
+      }
+      
+      goto invoke;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case invokestatic: {
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    object method = resolveMethod(t, frameMethod(s, frame), index - 1);
+    PROTECT(t, method);
+    
+    initClass(t, methodClass(t, method));
+
+    code = method;
+  } goto invoke;
+
+  case invokevirtual: {
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    object method = resolveMethod(t, frameMethod(s, frame), index - 1);
+    
+    unsigned parameterFootprint = methodParameterFootprint(t, method);
+    if (LIKELY(peekObject(s, sp - parameterFootprint))) {
+      object class_ = objectClass(t, peekObject(s, sp - parameterFootprint));
+      PROTECT(t, method);
+      PROTECT(t, class_);
+
+      resolveBootstrap(t, class_);
+      initClass(t, class_);
+
+      code = findVirtualMethod(t, method, class_);
+      goto invoke;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case ior: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    pushInt(s, a | b);
+  } goto loop;
+
+  case irem: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    if (UNLIKELY(b == 0)) {
+      exception = makeThrowable(t, Machine::ArithmeticExceptionType);
+      goto throw_;
+    }
+    
+    pushInt(s, a % b);
+  } goto loop;
+
+  case ireturn:
+  case freturn: {
+    int32_t result = popInt(s);
+    if (frame > base) {
+      popFrame(s);
+      pushInt(s, result);
+      goto loop;
+    } else {
+      return makeInt(t, result);
+    }
+  } goto loop;
+
+  case ishl: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    pushInt(s, a << (b & 0x1F));
+  } goto loop;
+
+  case ishr: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    pushInt(s, a >> (b & 0x1F));
+  } goto loop;
+
+  case istore:
+  case fstore: {
+    setLocalInt(s, codeBody(t, code, ip++), popInt(s));
+  } goto loop;
+
+  case istore_0:
+  case fstore_0: {
+    setLocalInt(s, 0, popInt(s));
+  } goto loop;
+
+  case istore_1:
+  case fstore_1: {
+    setLocalInt(s, 1, popInt(s));
+  } goto loop;
+
+  case istore_2:
+  case fstore_2: {
+    setLocalInt(s, 2, popInt(s));
+  } goto loop;
+
+  case istore_3:
+  case fstore_3: {
+    setLocalInt(s, 3, popInt(s));
+  } goto loop;
+
+  case isub: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    pushInt(s, a - b);
+  } goto loop;
+
+  case iushr: {
+    int32_t b = popInt(s);
+    uint32_t a = popInt(s);
+    
+    pushInt(s, a >> (b & 0x1F));
+  } goto loop;
+
+  case ixor: {
+    int32_t b = popInt(s);
+    int32_t a = popInt(s);
+    
+    pushInt(s, a ^ b);
+  } goto loop;
+
+  case jsr: {
+    uint16_t offset = codeReadInt16(t, code, ip);
+
+    pushInt(s, ip);
+    ip = (ip - 3) + static_cast<int16_t>(offset);
+  } goto loop;
+
+  case jsr_w: {
+    uint32_t offset = codeReadInt32(t, code, ip);
+
+    pushInt(s, ip);
+    ip = (ip - 5) + static_cast<int32_t>(offset);
+  } goto loop;
+
+  case l2d: {
+    pushDouble(s, static_cast<double>(static_cast<int64_t>(popLong(s))));
+  } goto loop;
+
+  case l2f: {
+    pushFloat(s, static_cast<float>(static_cast<int64_t>(popLong(s))));
+  } goto loop;
+
+  case l2i: {
+    pushInt(s, static_cast<int32_t>(popLong(s)));
+  } goto loop;
+
+  case ladd: {
+    int64_t b = popLong(s);
+    int64_t a = popLong(s);
+    
+    pushLong(s, a + b);
+  } goto loop;
+
+  case laload: {
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < longArrayLength(t, array)))
+      {
+        pushLong(s, longArrayBody(t, array, index));
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, longArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case land: {
+    int64_t b = popLong(s);
+    int64_t a = popLong(s);
+    
+    pushLong(s, a & b);
+  } goto loop;
+
+  case lastore: {
+    int64_t value = popLong(s);
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < longArrayLength(t, array)))
+      {
+        longArrayBody(t, array, index) = value;
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, longArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case lcmp: {
+    int64_t b = popLong(s);
+    int64_t a = popLong(s);
+    
+    pushInt(s, a > b ? 1 : a == b ? 0 : -1);
+  } goto loop;
+
+  case lconst_0: {
+    pushLong(s, 0);
+  } goto loop;
+
+  case lconst_1: {
+    pushLong(s, 1);
+  } goto loop;
+
+  case ldc:
+  case ldc_w: {
+    uint16_t index;
+
+    if (instruction == ldc) {
+      index = codeBody(t, code, ip++);
+    } else {
+      index = codeReadInt16(t, code, ip);
+    }
+
+    object pool = codePool(t, code);
+
+    if (singletonIsObject(t, pool, index - 1)) {
+      object v = singletonObject(t, pool, index - 1);
+      if (objectClass(t, v) == type(t, Machine::ReferenceType)) {
+        object class_ = resolveClassInPool
+          (t, frameMethod(s, frame), index - 1); 
+
+        pushObject(s, getJClass(t, class_));
+      } else if (objectClass(t, v) == type(t, Machine::ClassType)) {
+        pushObject(s, getJClass(t, v));
+      } else {     
+        pushObject(s, v);
+      }
+    } else {
+      pushInt(s, singletonValue(t, pool, index - 1));
+    }
+  } goto loop;
+
+  case ldc2_w: {
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    object pool = codePool(t, code);
+
+    uint64_t v;
+    memcpy(&v, &singletonValue(t, pool, index - 1), 8);
+    pushLong(s, v);
+  } goto loop;
+
+  case ldiv_: {
+    int64_t b = popLong(s);
+    int64_t a = popLong(s);
+    
+    if (UNLIKELY(b == 0)) {
+      exception = makeThrowable(t, Machine::ArithmeticExceptionType);
+      goto throw_;
+    }
+    
+    pushLong(s, a / b);
+  } goto loop;
+
+  case lload:
+  case dload: {
+    pushLong(s, localLong(s, codeBody(t, code, ip++)));
+  } goto loop;
+
+  case lload_0:
+  case dload_0: {
+    pushLong(s, localLong(s, 0));
+  } goto loop;
+
+  case lload_1:
+  case dload_1: {
+    pushLong(s, localLong(s, 1));
+  } goto loop;
+
+  case lload_2:
+  case dload_2: {
+    pushLong(s, localLong(s, 2));
+  } goto loop;
+
+  case lload_3:
+  case dload_3: {
+    pushLong(s, localLong(s, 3));
+  } goto loop;
+
+  case lmul: {
+    int64_t b = popLong(s);
+    int64_t a = popLong(s);
+    
+    pushLong(s, a * b);
+  } goto loop;
+
+  case lneg: {
+    pushLong(s, - popLong(s));
+  } goto loop;
+
+  case lookupswitch: {
+    int32_t base = ip - 1;
+
+    ip += 3;
+    ip -= (ip % 4);
+    
+    int32_t default_ = codeReadInt32(t, code, ip);
+    int32_t pairCount = codeReadInt32(t, code, ip);
+    
+    int32_t key = popInt(s);
+
+    int32_t bottom = 0;
+    int32_t top = pairCount;
+    for (int32_t span = top - bottom; span; span = top - bottom) {
+      int32_t middle = bottom + (span / 2);
+      unsigned index = ip + (middle * 8);
+
+      int32_t k = codeReadInt32(t, code, index);
+
+      if (key < k) {
+        top = middle;
+      } else if (key > k) {
+        bottom = middle + 1;
+      } else {
+        ip = base + codeReadInt32(t, code, index);
+        goto loop;
+      }
+    }
+
+    ip = base + default_;
+  } goto loop;
+
+  case lor: {
+    int64_t b = popLong(s);
+    int64_t a = popLong(s);
+    
+    pushLong(s, a | b);
+  } goto loop;
+
+  case lrem: {
+    int64_t b = popLong(s);
+    int64_t a = popLong(s);
+    
+    if (UNLIKELY(b == 0)) {
+      exception = makeThrowable(t, Machine::ArithmeticExceptionType);
+      goto throw_;
+    }
+    
+    pushLong(s, a % b);
+  } goto loop;
+
+  case lreturn:
+  case dreturn: {
+    int64_t result = popLong(s);
+    if (frame > base) {
+      popFrame(s);
+      pushLong(s, result);
+      goto loop;
+    } else {
+      return makeLong(t, result);
+    }
+  } goto loop;
+
+  case lshl: {
+    int32_t b = popInt(s);
+    int64_t a = popLong(s);
+    
+    pushLong(s, a << (b & 0x3F));
+  } goto loop;
+
+  case lshr: {
+    int32_t b = popInt(s);
+    int64_t a = popLong(s);
+    
+    pushLong(s, a >> (b & 0x3F));
+  } goto loop;
+
+  case lstore:
+  case dstore: {
+    setLocalLong(s, codeBody(t, code, ip++), popLong(s));
+  } goto loop;
+
+  case lstore_0: 
+  case dstore_0:{
+    setLocalLong(s, 0, popLong(s));
+  } goto loop;
+
+  case lstore_1: 
+  case dstore_1: {
+    setLocalLong(s, 1, popLong(s));
+  } goto loop;
+
+  case lstore_2: 
+  case dstore_2: {
+    setLocalLong(s, 2, popLong(s));
+  } goto loop;
+
+  case lstore_3: 
+  case dstore_3: {
+    setLocalLong(s, 3, popLong(s));
+  } goto loop;
+
+  case lsub: {
+    int64_t b = popLong(s);
+    int64_t a = popLong(s);
+    
+    pushLong(s, a - b);
+  } goto loop;
+
+  case lushr: {
+    int64_t b = popInt(s);
+    uint64_t a = popLong(s);
+    
+    pushLong(s, a >> (b & 0x3F));
+  } goto loop;
+
+  case lxor: {
+    int64_t b = popLong(s);
+    int64_t a = popLong(s);
+    
+    pushLong(s, a ^ b);
+  } goto loop;
+
+  case monitorenter: {
+    object o = popObject(s);
+    if (LIKELY(o)) {
+      acquire(t, o);
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case monitorexit: {
+    object o = popObject(s);
+    if (LIKELY(o)) {
+      release(t, o);
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case multianewarray: {
+    uint16_t index = codeReadInt16(t, code, ip);
+    uint8_t dimensions = codeBody(t, code, ip++);
+
+    object class_ = resolveClassInPool(t, frameMethod(s, frame), index - 1);
+    PROTECT(t, class_);
+
+    int32_t counts[dimensions];
+    for (int i = dimensions - 1; i >= 0; --i) {
+      counts[i] = popInt(s);
+      if (UNLIKELY(counts[i] < 0)) {
+        exception = makeThrowable
+          (t, Machine::NegativeArraySizeExceptionType, "%d", counts[i]);
+        goto throw_;
+      }
+    }
+
+    object array = makeArray(t, counts[0]);
+    setObjectClass(t, array, class_);
+    PROTECT(t, array);
+
+    populateMultiArray(t, array, counts, 0, dimensions);
+
+    pushObject(s, array);
+  } goto loop;
+
+  case new_: {
+    uint16_t index = codeReadInt16(t, code, ip);
+    
+    object class_ = resolveClassInPool(t, frameMethod(s, frame), index - 1);
+    PROTECT(t, class_);
+
+    initClass(t, class_);
+
+    pushObject(s, make(t, class_));
+  } goto loop;
+
+  case newarray: {
+    int32_t count = popInt(s);
+
+    if (LIKELY(count >= 0)) {
+      uint8_t type = codeBody(t, code, ip++);
+
+      object array;
+
+      switch (type) {
+      case T_BOOLEAN:
+        array = makeBooleanArray(t, count);
+        break;
+
+      case T_CHAR:
+        array = makeCharArray(t, count);
+        break;
+
+      case T_FLOAT:
+        array = makeFloatArray(t, count);
+        break;
+
+      case T_DOUBLE:
+        array = makeDoubleArray(t, count);
+        break;
+
+      case T_BYTE:
+        array = makeByteArray(t, count);
+        break;
+
+      case T_SHORT:
+        array = makeShortArray(t, count);
+        break;
+
+      case T_INT:
+        array = makeIntArray(t, count);
+        break;
+
+      case T_LONG:
+        array = makeLongArray(t, count);
+        break;
+
+      default: abort(t);
+      }
+            
+      pushObject(s, array);
+    } else {
+      exception = makeThrowable
+        (t, Machine::NegativeArraySizeExceptionType, "%d", count);
+      goto throw_;
+    }
+  } goto loop;
+
+  case nop: goto loop;
+
+  case pop_: {
+    -- sp;
+  } goto loop;
+
+  case pop2: {
+    sp -= 2;
+  } goto loop;
+
+  case putfield: {
+    uint16_t index = codeReadInt16(t, code, ip);
+    
+    object field = resolveField(t, frameMethod(s, frame), index - 1);
+
+    assert(t, (fieldFlags(t, field) & ACC_STATIC) == 0);
+    PROTECT(t, field);
+
+    { ACQUIRE_FIELD_FOR_WRITE(t, field);
+
+      switch (fieldCode(t, field)) {
+      case ByteField:
+      case BooleanField:
+      case CharField:
+      case ShortField:
+      case FloatField:
+      case IntField: {
+        int32_t value = popInt(s);
+        object o = popObject(s);
+        if (LIKELY(o)) {
+          switch (fieldCode(t, field)) {
+          case ByteField:
+          case BooleanField:
+            cast<int8_t>(o, fieldOffset(t, field)) = value;
+            break;
+            
+          case CharField:
+          case ShortField:
+            cast<int16_t>(o, fieldOffset(t, field)) = value;
+            break;
+            
+          case FloatField:
+          case IntField:
+            cast<int32_t>(o, fieldOffset(t, field)) = value;
+            break;
+          }
+        } else {
+          exception = makeThrowable(t, Machine::NullPointerExceptionType);
+        }
+      } break;
+
+      case DoubleField:
+      case LongField: {
+        int64_t value = popLong(s);
+        object o = popObject(s);
+        if (LIKELY(o)) {
+          cast<int64_t>(o, fieldOffset(t, field)) = value;
+        } else {
+          exception = makeThrowable(t, Machine::NullPointerExceptionType);
+        }
+      } break;
+
+      case ObjectField: {
+        object value = popObject(s);
+        object o = popObject(s);
+        if (LIKELY(o)) {
+          set(t, o, fieldOffset(t, field), value);
+        } else {
+          exception = makeThrowable(t, Machine::NullPointerExceptionType);
+        }
+      } break;
+
+      default: abort(t);
+      }
+    }
+
+    if (UNLIKELY(exception)) {
+      goto throw_;
+    }
+  } goto loop;
+
+  case putstatic: {
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    object field = resolveField(t, frameMethod(s, frame), index - 1);
+
+    assert(t, fieldFlags(t, field) & ACC_STATIC);
+
+    PROTECT(t, field);
+
+    ACQUIRE_FIELD_FOR_WRITE(t, field);
+
+    initClass(t, fieldClass(t, field));
+      
+    object table = classStaticTable(t, fieldClass(t, field));
+
+    switch (fieldCode(t, field)) {
+    case ByteField:
+    case BooleanField:
+    case CharField:
+    case ShortField:
+    case FloatField:
+    case IntField: {
+      int32_t value = popInt(s);
+      switch (fieldCode(t, field)) {
+      case ByteField:
+      case BooleanField:
+        cast<int8_t>(table, fieldOffset(t, field)) = value;
+        break;
+            
+      case CharField:
+      case ShortField:
+        cast<int16_t>(table, fieldOffset(t, field)) = value;
+        break;
+            
+      case FloatField:
+      case IntField:
+        cast<int32_t>(table, fieldOffset(t, field)) = value;
+        break;
+      }
+    } break;
+
+    case DoubleField:
+    case LongField: {
+      cast<int64_t>(table, fieldOffset(t, field)) = popLong(s);
+    } break;
+
+    case ObjectField: {
+      set(t, table, fieldOffset(t, field), popObject(s));
+    } break;
+
+    default: abort(t);
+    }
+  } goto loop;
+
+  case ret: {
+    ip = localInt(s, codeBody(t, code, ip));
+  } goto loop;
+
+  case return_: {
+    object method = frameMethod(s, frame);
+    if ((methodFlags(t, method) & ConstructorFlag)
+        and (classVmFlags(t, methodClass(t, method)) & HasFinalMemberFlag))
+    {
+      storeStoreMemoryBarrier();
+    }
+
+    if (frame > base) {
+      popFrame(s);
+      goto loop;
+    } else {
+      return 0;
+    }
+  } goto loop;
+
+  case saload: {
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < shortArrayLength(t, array)))
+      {
+        pushInt(s, shortArrayBody(t, array, index));
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, shortArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case sastore: {
+    int16_t value = popInt(s);
+    int32_t index = popInt(s);
+    object array = popObject(s);
+
+    if (LIKELY(array)) {
+      if (LIKELY(index >= 0 and
+                 static_cast<uintptr_t>(index) < shortArrayLength(t, array)))
+      {
+        shortArrayBody(t, array, index) = value;
+      } else {
+        exception = makeThrowable
+          (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
+           index, shortArrayLength(t, array));
+        goto throw_;
+      }
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } goto loop;
+
+  case sipush: {
+    pushInt(s, static_cast<int16_t>(codeReadInt16(t, code, ip)));
+  } goto loop;
+
+  case swap: {
+    uintptr_t tmp[2];
+    memcpy(tmp                   , stack + ((sp - 1) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 1) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
+    memcpy(stack + ((sp - 2) * 2), tmp                   , BytesPerWord * 2);
+  } goto loop;
+
+  case tableswitch: {
+    int32_t base = ip - 1;
+
+    ip += 3;
+    ip -= (ip % 4);
+    
+    int32_t default_ = codeReadInt32(t, code, ip);
+    int32_t bottom = codeReadInt32(t, code, ip);
+    int32_t top = codeReadInt32(t, code, ip);
+    
+    int32_t key = popInt(s);
+    
+    if (key >= bottom and key <= top) {
+      unsigned index = ip + ((key - bottom) * 4);
+      ip = base + codeReadInt32(t, code, index);
+    } else {
+      ip = base + default_;
+    }
+  } goto loop;
+
+  case wide: goto wide;
+
+  case impdep1: {
+    // this means we're invoking a virtual method on an instance of a
+    // bootstrap class, so we need to load the real class to get the
+    // real method and call it.
+
+    assert(t, frameNext(s, frame) >= base);
+    popFrame(s);
+
+    assert(t, codeBody(t, code, ip - 3) == invokevirtual);
+    ip -= 2;
+
+    uint16_t index = codeReadInt16(t, code, ip);
+    object method = resolveMethod(t, frameMethod(s, frame), index - 1);
+
+    unsigned parameterFootprint = methodParameterFootprint(t, method);
+    object class_ = objectClass(t, peekObject(s, sp - parameterFootprint));
+    assert(t, classVmFlags(t, class_) & BootstrapFlag);
+    
+    resolveClass(t, classLoader(t, methodClass(t, frameMethod(s, frame))),
+                 className(t, class_));
+
+    ip -= 3;
+  } goto loop;
+
+  default: abort(t);
+  }
+
+ wide:
+  switch (codeBody(t, code, ip++)) {
+  case aload: {
+    pushObject(s, localObject(s, codeReadInt16(t, code, ip)));
+  } goto loop;
+
+  case astore: {
+    setLocalObject(s, codeReadInt16(t, code, ip), popObject(s));
+  } goto loop;
+
+  case iinc: {
+    uint16_t index = codeReadInt16(t, code, ip);
+    int16_t count = codeReadInt16(t, code, ip);
+    
+    setLocalInt(s, index, localInt(s, index) + count);
+  } goto loop;
+
+  case iload: {
+    pushInt(s, localInt(s, codeReadInt16(t, code, ip)));
+  } goto loop;
+
+  case istore: {
+    setLocalInt(s, codeReadInt16(t, code, ip), popInt(s));
+  } goto loop;
+
+  case lload: {
+    pushLong(s, localLong(s, codeReadInt16(t, code, ip)));
+  } goto loop;
+
+  case lstore: {
+    setLocalLong(s, codeReadInt16(t, code, ip),  popLong(s));
+  } goto loop;
+
+  case ret: {
+    ip = localInt(s, codeReadInt16(t, code, ip));
+  } goto loop;
+
+  default: abort(t);
+  }
+
+ invoke: {
+    // the method to invoke was left in the code register, where the
+    // collector could find it, so restore the register before calling
+    // out:
+    object method = code;
+    code = methodCode(t, frameMethod(s, frame));
+
+    if (not s->client->invoke(s, method)) {
+      checkStack(s, method);
+      pushFrame(s, method);
+    }
+  } goto loop;
+
+ throw_:
+  if (DebugRun) {
+    fprintf(stderr, "throw\n");
+  }
+
+  pokeInt(s, s->frame + FrameIpOffset, s->ip);
+  for (; frame >= base; popFrame(s)) {
+    uint64_t eh = findExceptionHandler(s, frame);
+    if (eh) {
+      sp = frame + FrameFootprint;
+      ip = exceptionHandlerIp(eh);
+      pushObject(s, exception);
+      exception = 0;
+      goto loop;
+    }
+  }
+
+  return 0;
+}
+
+uint64_t
+interpret2(Thread*, uintptr_t* arguments)
+{
+  Interpreter* s = reinterpret_cast<Interpreter*>(arguments[0]);
+  int base = arguments[1];
+  bool* success = reinterpret_cast<bool*>(arguments[2]);
+
+  object r = interpret3(s, base);
+  *success = true;
+  return reinterpret_cast<uint64_t>(r);
+}
+
+} // namespace
+
+namespace vm {
+
+void
+pushFrame(Interpreter* s, object method)
+{
+  Thread* t = s->t;
+
+  PROTECT(t, method);
+
+  unsigned parameterFootprint = methodParameterFootprint(t, method);
+  unsigned base = s->sp - parameterFootprint;
+  unsigned locals = parameterFootprint;
+
+  if (methodFlags(t, method) & ACC_SYNCHRONIZED) {
+    // Try to acquire the monitor before doing anything else.
+    // Otherwise, if we were to push the frame first, we risk trying
+    // to release a monitor we never successfully acquired when we try
+    // to pop the frame back off.
+    if (methodFlags(t, method) & ACC_STATIC) {
+      acquire(t, methodClass(t, method));
+    } else {
+      acquire(t, peekObject(s, base));
+    }   
+  }
+
+  if (s->frame >= 0) {
+    pokeInt(s, s->frame + FrameIpOffset, s->ip);
+  }
+  s->ip = 0;
+
+  if ((methodFlags(t, method) & ACC_NATIVE) == 0) {
+    s->code = methodCode(t, method);
+
+    locals = codeMaxLocals(t, s->code);
+
+    memset(s->stack + ((base + parameterFootprint) * 2), 0,
+           (locals - parameterFootprint) * BytesPerWord * 2);
+  }
+
+  unsigned frame = base + locals;
+  pokeInt(s, frame + FrameNextOffset, s->frame);
+  s->frame = frame;
+
+  s->sp = frame + FrameFootprint;
+
+  pokeInt(s, frame + FrameBaseOffset, base);
+  pokeObject(s, frame + FrameMethodOffset, method);
+  pokeInt(s, s->frame + FrameIpOffset, 0);
+}
+
+void
+popFrame(Interpreter* s)
+{
+  Thread* t = s->t;
+
+  object method = frameMethod(s, s->frame);
+
+  if (methodFlags(t, method) & ACC_SYNCHRONIZED) {
+    if (methodFlags(t, method) & ACC_STATIC) {
+      release(t, methodClass(t, method));
+    } else {
+      release(t, peekObject(s, frameBase(s, s->frame)));
+    }   
+  }
+
+  s->sp = frameBase(s, s->frame);
+  s->frame = frameNext(s, s->frame);
+  if (s->frame >= 0) {
+    s->code = methodCode(t, frameMethod(s, s->frame));
+    s->ip = frameIp(s, s->frame);
+  } else {
+    s->code = 0;
+    s->ip = 0;
+  }
+}
+
+void
+pushResult(Interpreter* s, unsigned returnCode, uint64_t result,
+           bool indirect)
+{
+  Thread* t = s->t;
+
+  switch (returnCode) {
+  case ByteField:
+  case BooleanField:
+    if (DebugRun) {
+      fprintf(stderr, "result: %d\n", static_cast<int8_t>(result));
+    }
+    pushInt(s, static_cast<int8_t>(result));
+    break;
+
+  case CharField:
+    if (DebugRun) {
+      fprintf(stderr, "result: %d\n", static_cast<uint16_t>(result));
+    }
+    pushInt(s, static_cast<uint16_t>(result));
+    break;
+
+  case ShortField:
+    if (DebugRun) {
+      fprintf(stderr, "result: %d\n", static_cast<int16_t>(result));
+    }
+    pushInt(s, static_cast<int16_t>(result));
+    break;
+
+  case FloatField:
+  case IntField:
+    if (DebugRun) {
+      fprintf(stderr, "result: %d\n", static_cast<int32_t>(result));
+    }
+    pushInt(s, result);
+    break;
+
+  case DoubleField:
+  case LongField:
+    if (DebugRun) {
+      fprintf(stderr, "result: %"LLD"\n", result);
+    }
+    pushLong(s, result);
+    break;
+
+  case ObjectField:
+    if (indirect) {
+      if (DebugRun) {
+        fprintf(stderr, "result: %p at %p\n",
+                static_cast<uintptr_t>(result) == 0 ? 0 :
+                *reinterpret_cast<object*>(static_cast<uintptr_t>(result)),
+                reinterpret_cast<object*>(static_cast<uintptr_t>(result)));
+      }
+      pushObject(s, static_cast<uintptr_t>(result) == 0 ? 0 :
+                 *reinterpret_cast<object*>(static_cast<uintptr_t>(result)));
+    } else {
+      if (DebugRun) {
+        fprintf(stderr, "result: %p\n", reinterpret_cast<object>(result));
+      }
+      pushObject(s, reinterpret_cast<object>(result));
+    }
+    break;
+
+  case VoidField:
+    break;
+
+  default:
+    abort(t);
+  }
+}
+
+object
+interpret(Interpreter* s)
+{
+  Thread* t = s->t;
+
+  const int base = s->frame;
+
+  while (true) {
+    bool success = false;
+    uintptr_t arguments[] = { reinterpret_cast<uintptr_t>(s),
+                              static_cast<uintptr_t>(base),
+                              reinterpret_cast<uintptr_t>(&success) };
+
+    uint64_t r = run(t, interpret2, arguments);
+    if (success) {
+      return reinterpret_cast<object>(r);
+    }
+  }
+}
+
+} // namespace vm
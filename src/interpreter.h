@@ -0,0 +1,359 @@
+/* Copyright (c) 2008-2012, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "common.h"
+#include "system.h"
+#include "constants.h"
+#include "machine.h"
+
+namespace vm {
+
+const unsigned FrameBaseOffset = 0;
+const unsigned FrameNextOffset = 1;
+const unsigned FrameMethodOffset = 2;
+const unsigned FrameIpOffset = 3;
+const unsigned FrameFootprint = 4;
+
+// The state of the bytecode interpreter on a given thread: a stack of
+// tagged slots holding each frame's locals, operands and bookkeeping,
+// plus registers describing the innermost frame.  The interpreting
+// processor runs every method this way; the JIT runs methods which
+// are not yet hot enough to compile.
+class Interpreter {
+ public:
+  class Client {
+   public:
+    // Invokes the specified method on behalf of interpreted code,
+    // replacing its arguments on top of the stack with its result, if
+    // any.  Returns false if the interpreter should push a frame for
+    // the method and run it itself instead.
+    virtual bool invoke(Interpreter* s, object method) = 0;
+
+    // Called whenever interpreted code branches backward.
+    virtual void backEdge(Interpreter* s) = 0;
+  };
+
+  Interpreter(Thread* t, Client* client, uintptr_t* stack):
+    t(t),
+    client(client),
+    ip(0),
+    sp(0),
+    frame(-1),
+    code(0),
+    stack(stack)
+  { }
+
+  Thread* t;
+  Client* client;
+  unsigned ip;
+  unsigned sp;
+  int frame;
+  object code;
+  uintptr_t* stack;
+};
+
+inline void
+pushObject(Interpreter* s, object o)
+{
+  if (DebugStack) {
+    fprintf(stderr, "push object %p at %d\n", o, s->sp);
+  }
+
+  assert(s->t, s->sp + 1 < stackSizeInWords(s->t) / 2);
+  s->stack[(s->sp * 2)    ] = ObjectTag;
+  s->stack[(s->sp * 2) + 1] = reinterpret_cast<uintptr_t>(o);
+  ++ s->sp;
+}
+
+inline void
+pushInt(Interpreter* s, uint32_t v)
+{
+  if (DebugStack) {
+    fprintf(stderr, "push int %d at %d\n", v, s->sp);
+  }
+
+  assert(s->t, s->sp + 1 < stackSizeInWords(s->t) / 2);
+  s->stack[(s->sp * 2)    ] = IntTag;
+  s->stack[(s->sp * 2) + 1] = v;
+  ++ s->sp;
+}
+
+inline void
+pushFloat(Interpreter* s, float v)
+{
+  pushInt(s, floatToBits(v));
+}
+
+inline void
+pushLong(Interpreter* s, uint64_t v)
+{
+  if (DebugStack) {
+    fprintf(stderr, "push long %"LLD" at %d\n", v, s->sp);
+  }
+
+  pushInt(s, v >> 32);
+  pushInt(s, v & 0xFFFFFFFF);
+}
+
+inline void
+pushDouble(Interpreter* s, double v)
+{
+  uint64_t w = doubleToBits(v);
+  pushLong(s, w);
+}
+
+inline object
+popObject(Interpreter* s)
+{
+  if (DebugStack) {
+    fprintf(stderr, "pop object %p at %d\n",
+            reinterpret_cast<object>(s->stack[((s->sp - 1) * 2) + 1]),
+            s->sp - 1);
+  }
+
+  assert(s->t, s->stack[(s->sp - 1) * 2] == ObjectTag);
+  return reinterpret_cast<object>(s->stack[((-- s->sp) * 2) + 1]);
+}
+
+inline uint32_t
+popInt(Interpreter* s)
+{
+  if (DebugStack) {
+    fprintf(stderr, "pop int %"ULD" at %d\n",
+            s->stack[((s->sp - 1) * 2) + 1],
+            s->sp - 1);
+  }
+
+  assert(s->t, s->stack[(s->sp - 1) * 2] == IntTag);
+  return s->stack[((-- s->sp) * 2) + 1];
+}
+
+inline float
+popFloat(Interpreter* s)
+{
+  return bitsToFloat(popInt(s));
+}
+
+inline uint64_t
+popLong(Interpreter* s)
+{
+  if (DebugStack) {
+    fprintf(stderr, "pop long %"LLD" at %d\n",
+            (static_cast<uint64_t>(s->stack[((s->sp - 2) * 2) + 1]) << 32)
+            | static_cast<uint64_t>(s->stack[((s->sp - 1) * 2) + 1]),
+            s->sp - 2);
+  }
+
+  uint64_t a = popInt(s);
+  uint64_t b = popInt(s);
+  return (b << 32) | a;
+}
+
+inline double
+popDouble(Interpreter* s)
+{
+  uint64_t v = popLong(s);
+  return bitsToDouble(v);
+}
+
+inline object
+peekObject(Interpreter* s, unsigned index)
+{
+  if (DebugStack) {
+    fprintf(stderr, "peek object %p at %d\n",
+            reinterpret_cast<object>(s->stack[(index * 2) + 1]),
+            index);
+  }
+
+  assert(s->t, index < stackSizeInWords(s->t) / 2);
+  assert(s->t, s->stack[index * 2] == ObjectTag);
+  return reinterpret_cast<object>(s->stack[(index * 2) + 1]);
+}
+
+inline uint32_t
+peekInt(Interpreter* s, unsigned index)
+{
+  if (DebugStack) {
+    fprintf(stderr, "peek int %"ULD" at %d\n",
+            s->stack[(index * 2) + 1],
+            index);
+  }
+
+  assert(s->t, index < stackSizeInWords(s->t) / 2);
+  assert(s->t, s->stack[index * 2] == IntTag);
+  return s->stack[(index * 2) + 1];
+}
+
+inline uint64_t
+peekLong(Interpreter* s, unsigned index)
+{
+  if (DebugStack) {
+    fprintf(stderr, "peek long %"LLD" at %d\n",
+            (static_cast<uint64_t>(s->stack[(index * 2) + 1]) << 32)
+            | static_cast<uint64_t>(s->stack[((index + 1) * 2) + 1]),
+            index);
+  }
+
+  return (static_cast<uint64_t>(peekInt(s, index)) << 32)
+    | static_cast<uint64_t>(peekInt(s, index + 1));
+}
+
+inline void
+pokeObject(Interpreter* s, unsigned index, object value)
+{
+  if (DebugStack) {
+    fprintf(stderr, "poke object %p at %d\n", value, index);
+  }
+
+  s->stack[index * 2] = ObjectTag;
+  s->stack[(index * 2) + 1] = reinterpret_cast<uintptr_t>(value);
+}
+
+inline void
+pokeInt(Interpreter* s, unsigned index, uint32_t value)
+{
+  if (DebugStack) {
+    fprintf(stderr, "poke int %d at %d\n", value, index);
+  }
+
+  s->stack[index * 2] = IntTag;
+  s->stack[(index * 2) + 1] = value;
+}
+
+inline void
+pokeLong(Interpreter* s, unsigned index, uint64_t value)
+{
+  if (DebugStack) {
+    fprintf(stderr, "poke long %"LLD" at %d\n", value, index);
+  }
+
+  pokeInt(s, index, value >> 32);
+  pokeInt(s, index + 1, value & 0xFFFFFFFF);
+}
+
+inline int
+frameNext(Interpreter* s, int frame)
+{
+  return peekInt(s, frame + FrameNextOffset);
+}
+
+inline object
+frameMethod(Interpreter* s, int frame)
+{
+  return peekObject(s, frame + FrameMethodOffset);
+}
+
+inline unsigned
+frameIp(Interpreter* s, int frame)
+{
+  return peekInt(s, frame + FrameIpOffset);
+}
+
+inline unsigned
+frameBase(Interpreter* s, int frame)
+{
+  return peekInt(s, frame + FrameBaseOffset);
+}
+
+inline object
+localObject(Interpreter* s, unsigned index)
+{
+  return peekObject(s, frameBase(s, s->frame) + index);
+}
+
+inline uint32_t
+localInt(Interpreter* s, unsigned index)
+{
+  return peekInt(s, frameBase(s, s->frame) + index);
+}
+
+inline uint64_t
+localLong(Interpreter* s, unsigned index)
+{
+  return peekLong(s, frameBase(s, s->frame) + index);
+}
+
+inline void
+setLocalObject(Interpreter* s, unsigned index, object value)
+{
+  pokeObject(s, frameBase(s, s->frame) + index, value);
+}
+
+inline void
+setLocalInt(Interpreter* s, unsigned index, uint32_t value)
+{
+  pokeInt(s, frameBase(s, s->frame) + index, value);
+}
+
+inline void
+setLocalLong(Interpreter* s, unsigned index, uint64_t value)
+{
+  pokeLong(s, frameBase(s, s->frame) + index, value);
+}
+
+inline void
+checkStack(Interpreter* s, object method)
+{
+  Thread* t = s->t;
+
+  if (UNLIKELY(s->sp
+               + methodParameterFootprint(t, method)
+               + codeMaxLocals(t, methodCode(t, method))
+               + FrameFootprint
+               + codeMaxStack(t, methodCode(t, method))
+               > stackSizeInWords(t) / 2))
+  {
+    throwNew(t, Machine::StackOverflowErrorType);
+  }
+}
+
+inline void
+store(Interpreter* s, unsigned index)
+{
+  memcpy(s->stack + ((frameBase(s, s->frame) + index) * 2),
+         s->stack + ((-- s->sp) * 2),
+         BytesPerWord * 2);
+}
+
+inline void
+visitObjects(Interpreter* s, Heap::Visitor* v)
+{
+  v->visit(&(s->code));
+
+  for (unsigned i = 0; i < s->sp; ++i) {
+    if (s->stack[i * 2] == ObjectTag) {
+      v->visit(reinterpret_cast<object*>(s->stack + (i * 2) + 1));
+    }
+  }
+}
+
+void
+pushFrame(Interpreter* s, object method);
+
+void
+popFrame(Interpreter* s);
+
+void
+pushResult(Interpreter* s, unsigned returnCode, uint64_t result,
+           bool indirect);
+
+// Runs the frame on top of the stack, along with any frames it
+// pushes, until it returns, yielding its result (boxed, if it is a
+// primitive).  If it throws an exception it does not catch, its
+// frame is popped and the exception is left in Thread::exception.
+object
+interpret(Interpreter* s);
+
+} // namespace vm
+
+#endif//INTERPRETER_H
@@ -3614,6 +3614,8 @@ populateJNITables(JavaVMVTable* vmTable, JNIEnvVTable* envTable)
 #define BOOTSTRAP_PROPERTY "avian.bootstrap"
 #define CRASHDIR_PROPERTY "avian.crash.dir"
 #define EMBED_PREFIX_PROPERTY "avian.embed.prefix"
+#define CLASSPATH_INDEX_PROPERTY "avian.classpath.index"
+#define INFLATED_CACHE_PROPERTY "avian.inflated.cache"
 #define CLASSPATH_PROPERTY "java.class.path"
 #define JAVA_HOME_PROPERTY "java.home"
 #define BOOTCLASSPATH_PREPEND_OPTION "bootclasspath/p"
@@ -3641,6 +3643,7 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
 
   unsigned heapLimit = 0;
   unsigned stackLimit = 0;
+  unsigned collectorCount = 0;
   const char* bootLibrary = 0;
   const char* classpath = 0;
   const char* javaHome = AVIAN_JAVA_HOME;
@@ -3649,6 +3652,8 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
   const char* bootClasspath = 0;
   const char* bootClasspathAppend = "";
   const char* crashDumpDirectory = 0;
+  const char* classpathIndex = 0;
+  const char* inflatedCache = 0;
 
   unsigned propertyCount = 0;
 
@@ -3659,6 +3664,8 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
         heapLimit = local::parseSize(p + 2);
       } else if (strncmp(p, "ss", 2) == 0) {
         stackLimit = local::parseSize(p + 2);
+      } else if (strncmp(p, "gcthreads", 9) == 0) {
+        collectorCount = atoi(p + 9);
       } else if (strncmp(p, BOOTCLASSPATH_PREPEND_OPTION ":",
                          sizeof(BOOTCLASSPATH_PREPEND_OPTION)) == 0)
       {
@@ -3694,6 +3701,14 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
                          sizeof(EMBED_PREFIX_PROPERTY)) == 0)
       {
         embedPrefix = p + sizeof(EMBED_PREFIX_PROPERTY);
+      } else if (strncmp(p, CLASSPATH_INDEX_PROPERTY "=",
+                         sizeof(CLASSPATH_INDEX_PROPERTY)) == 0)
+      {
+        classpathIndex = p + sizeof(CLASSPATH_INDEX_PROPERTY);
+      } else if (strncmp(p, INFLATED_CACHE_PROPERTY "=",
+                         sizeof(INFLATED_CACHE_PROPERTY)) == 0)
+      {
+        inflatedCache = p + sizeof(INFLATED_CACHE_PROPERTY);
       }
 
       ++ propertyCount;
@@ -3703,11 +3718,13 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
   if (heapLimit == 0) heapLimit = 128 * 1024 * 1024;
 
   if (stackLimit == 0) stackLimit = 128 * 1024;
+
+  if (collectorCount == 0) collectorCount = 1;
   
   if (classpath == 0) classpath = ".";
   
   System* s = makeSystem(crashDumpDirectory);
-  Heap* h = makeHeap(s, heapLimit);
+  Heap* h = makeHeap(s, heapLimit, collectorCount);
   Classpath* c = makeClasspath(s, h, javaHome, embedPrefix);
 
   if (bootClasspath == 0) {
@@ -3732,8 +3749,10 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
   }
 
   Finder* bf = makeFinder
-    (s, h, RUNTIME_ARRAY_BODY(bootClasspathBuffer), bootLibrary);
-  Finder* af = makeFinder(s, h, classpath, bootLibrary);
+    (s, h, RUNTIME_ARRAY_BODY(bootClasspathBuffer), bootLibrary, 0,
+     inflatedCache);
+  Finder* af = makeFinder
+    (s, h, classpath, bootLibrary, classpathIndex, inflatedCache);
   Processor* p = makeProcessor(s, h, true);
 
   const char** properties = static_cast<const char**>
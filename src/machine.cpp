@@ -17,6 +17,11 @@
 #include "arch.h"
 #include "lzma.h"
 
+#if ((defined ARCH_x86_32) || (defined ARCH_x86_64)) && (defined __GNUC__)
+#  define AVIAN_VECTOR_HASH
+#  include <smmintrin.h>
+#endif
+
 using namespace vm;
 
 namespace {
@@ -646,6 +651,13 @@ postVisit(Thread* t, Heap::Visitor* v)
       }
     }
   }
+
+  // the finalizers queued above have been visited already, but the
+  // heap has not seen the references we've since stored to them, which
+  // it must update if it moves the finalizers after we return:
+  for (object* p = &(m->finalizeQueue); *p; p = &finalizerNext(t, *p)) {
+    v->visit(p);
+  }
 }
 
 void
@@ -663,6 +675,7 @@ postCollect(Thread* t)
   } else {
     memset(t->defaultHeap, 0, ThreadHeapSizeInBytes);
     t->heap = t->defaultHeap;
+    t->heapSizeInWords = ThreadHeapSizeInWords;
   }
 
   t->heapOffset = 0;
@@ -670,7 +683,7 @@ postCollect(Thread* t)
   if (t->m->heap->limitExceeded()) {
     // if we're out of memory, pretend the thread-local heap is
     // already full so we don't make things worse:
-    t->heapIndex = ThreadHeapSizeInWords;
+    t->heapIndex = t->heapSizeInWords;
   } else {
     t->heapIndex = 0;
   }
@@ -2528,6 +2541,83 @@ removeMonitor(Thread* t, object o)
   }
 }
 
+void
+markInflated(Thread* t, object o)
+{
+  uintptr_t* word = lockWord(t, o);
+  if (word) {
+    while (true) {
+      uintptr_t w = *word;
+      if ((w & LockWordMask) != 0
+          or atomicCompareAndSwap(word, w, w | LockInflatedBit))
+      {
+        break;
+      }
+    }
+  }
+}
+
+void
+waitForLockWord(Thread* t, object o)
+{
+  PROTECT(t, o);
+
+  ACQUIRE(t, t->m->lockWordLock);
+
+  uintptr_t* word = lockWord(t, o);
+  uintptr_t w = *word;
+  if ((w & LockWordMask) != 0
+      and (w & LockInflatedBit) == 0
+      and ((w & LockContendedBit)
+           or atomicCompareAndSwap(word, w, w | LockContendedBit)))
+  {
+    ENTER(t, Thread::IdleState);
+
+    t->m->lockWordLock->wait(t->systemThread, 0);
+  }
+}
+
+unsigned
+nextLockId(Machine* m)
+{
+  if (not ThinLocks) {
+    return 0;
+  }
+
+  for (unsigned i = 0; i < LockIdWords; ++i) {
+    while (true) {
+      uintptr_t w = m->lockIds[i];
+      if (w == ~static_cast<uintptr_t>(0)) {
+        break;
+      }
+
+      unsigned bit = 0;
+      while (w & (static_cast<uintptr_t>(1) << bit)) ++ bit;
+
+      if (atomicCompareAndSwap
+          (m->lockIds + i, w, w | (static_cast<uintptr_t>(1) << bit)))
+      {
+        return (i * BitsPerWord) + bit;
+      }
+    }
+  }
+
+  // we've run out of IDs, so the new thread will inflate every lock it
+  // acquires
+  return 0;
+}
+
+void
+releaseLockId(Machine* m, unsigned id)
+{
+  if (id) {
+    uintptr_t* p = m->lockIds + (id / BitsPerWord);
+    uintptr_t bit = static_cast<uintptr_t>(1) << (id % BitsPerWord);
+    for (uintptr_t w = *p; not atomicCompareAndSwap(p, w, w & ~bit); w = *p)
+    { }
+  }
+}
+
 void
 removeString(Thread* t, object o)
 {
@@ -2799,10 +2889,15 @@ class HeapClient: public Heap::Client {
 
     object dst = static_cast<object>(dstp);
 
-    memcpy(dst, src, n * BytesPerWord);
+    // the heap may slide an object down over itself when compacting, so
+    // we must use memmove and check the hash mark beforehand:
+    bool hash = hashTaken(t, src);
 
-    if (hashTaken(t, src)) {
-      alias(dst, 0) &= PointerMask;
+    memmove(dst, src, n * BytesPerWord);
+
+    if (hash) {
+      // keep the thin lock word, if any, along with the class:
+      alias(dst, 0) &= ~MarkMask;
       alias(dst, 0) |= ExtendedMark;
       extendedWord(t, dst, base) = takeHash(t, src);
     }
@@ -2844,15 +2939,23 @@ doCollect(Thread* t, Heap::CollectionType type)
 
   killZombies(t, m->rootThread);
 
-  for (unsigned i = 0; i < m->heapPoolIndex; ++i) {
-    m->heap->free(m->heapPool[i], ThreadHeapSizeInBytes);
+  if (m->heap->collectionType() == Heap::MajorCollection) {
+    ++ m->majorCollectionCount;
+  } else {
+    ++ m->minorCollectionCount;
+  }
+
+  for (unsigned i = 0; i < m->heapPoolIndex * 2; i += 2) {
+    m->heap->free(reinterpret_cast<void*>(m->heapPool[i]),
+                  m->heapPool[i + 1]);
   }
   m->heapPoolIndex = 0;
+  m->heapPoolFootprint = 0;
 
   if (m->heap->limitExceeded()) {
     // if we're out of memory, disallow further allocations of fixed
     // objects:
-    m->fixedFootprint = FixedFootprintThresholdInBytes;
+    m->fixedFootprint = m->heapPoolLimit;
   } else {
     m->fixedFootprint = 0;
   }
@@ -2938,6 +3041,69 @@ findInTable(Thread* t, object table, object name, object spec,
   return 0;
 }
 
+#ifdef AVIAN_VECTOR_HASH
+
+extern "C" bool
+detectFeature(unsigned ecx, unsigned edx);
+
+bool
+useVectorHash()
+{
+  static int supported = -1;
+  if (supported == -1) {
+    supported = detectFeature(0x80000, 0); // SSE 4.1
+  }
+  return supported;
+}
+
+__attribute__((target("sse4.1"))) __m128i
+loadBytes(const void* s, unsigned i)
+{
+  // sign-extend to match stringCharAt; the unpack in vectorHash then
+  // zero-extends each char to 32 bits
+  return _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>
+                                           (static_cast<const int8_t*>(s)
+                                            + i)));
+}
+
+__attribute__((target("sse4.1"))) __m128i
+loadChars(const void* s, unsigned i)
+{
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>
+                         (static_cast<const uint16_t*>(s) + i));
+}
+
+// Hashes eight characters per iteration, four per 32-bit lane: each
+// lane j of the accumulator holds the sum of the characters at
+// positions congruent to j modulo four, weighted by the power of 31
+// they will have once the whole prefix is folded together below.
+// 923521 == 31^4, 0x94446f01 == 31^8 (mod 2^32).
+__attribute__((target("sse4.1"))) uint32_t
+vectorHash(const void* s, bool bytes, unsigned length, unsigned* position)
+{
+  const __m128i p4 = _mm_set1_epi32(923521);
+  const __m128i p8 = _mm_set1_epi32(static_cast<int32_t>(0x94446f01));
+
+  __m128i a = _mm_setzero_si128();
+  unsigned i = 0;
+  for (; i + 8 <= length; i += 8) {
+    __m128i v = bytes ? loadBytes(s, i) : loadChars(s, i);
+    __m128i lo = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+    __m128i hi = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+    a = _mm_add_epi32(_mm_mullo_epi32(a, p8),
+                      _mm_add_epi32(_mm_mullo_epi32(lo, p4), hi));
+  }
+
+  *position = i;
+
+  return (static_cast<uint32_t>(_mm_extract_epi32(a, 0)) * 29791)
+    + (static_cast<uint32_t>(_mm_extract_epi32(a, 1)) * 961)
+    + (static_cast<uint32_t>(_mm_extract_epi32(a, 2)) * 31)
+    + static_cast<uint32_t>(_mm_extract_epi32(a, 3));
+}
+
+#endif // AVIAN_VECTOR_HASH
+
 } // namespace
 
 namespace vm {
@@ -2976,6 +3142,7 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   classLock(0),
   referenceLock(0),
   shutdownLock(0),
+  lockWordLock(0),
   libraries(0),
   errorLog(0),
   bootimage(0),
@@ -2991,10 +3158,31 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   triedBuiltinOnLoad(false),
   dumpedHeapOnOOM(false),
   alive(true),
-  heapPoolIndex(0)
+  heapPool(0),
+  heapPoolIndex(0),
+  heapPoolCapacity(0),
+  heapPoolFootprint(0),
+  heapPoolLimit(max(heap->limit() / HeapPoolLimitDivisor,
+                    HeapPoolMinimumSizeInBytes)),
+  maxThreadHeapSize(ThreadHeapSizeInBytes),
+  minorCollectionCount(0),
+  majorCollectionCount(0),
+  safepointCount(0),
+  safepointTime(0),
+  maxSafepointTime(0)
 {
   heap->setClient(heapClient);
 
+  // lock ID zero means a thread has none:
+  memset(lockIds, 0, LockIdWords * BytesPerWord);
+  lockIds[0] = 1;
+
+  // every thread-local heap taken from the pool is at least
+  // ThreadHeapSizeInBytes, so this many slots is always enough:
+  heapPoolCapacity = heapPoolLimit / ThreadHeapSizeInBytes;
+  heapPool = static_cast<uintptr_t*>
+    (heap->allocate(heapPoolCapacity * 2 * BytesPerWord));
+
   populateJNITables(&javaVMVTable, &jniEnvVTable);
 
   if (not system->success(system->make(&localThread)) or
@@ -3003,6 +3191,7 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
       not system->success(system->make(&classLock)) or
       not system->success(system->make(&referenceLock)) or
       not system->success(system->make(&shutdownLock)) or
+      not system->success(system->make(&lockWordLock)) or
       not system->success
       (system->load(&libraries, findProperty(this, "avian.bootstrap"))))
   {
@@ -3019,6 +3208,7 @@ Machine::dispose()
   classLock->dispose();
   referenceLock->dispose();
   shutdownLock->dispose();
+  lockWordLock->dispose();
 
   if (libraries) {
     libraries->disposeAll();
@@ -3030,10 +3220,23 @@ Machine::dispose()
     heap->free(tmp, sizeof(*tmp));
   }
 
-  for (unsigned i = 0; i < heapPoolIndex; ++i) {
-    heap->free(heapPool[i], ThreadHeapSizeInBytes);
+  if (findProperty(this, "avian.gc.stats")) {
+    fprintf(stderr, "gc: %d minor and %d major collections, young "
+            "generation %d bytes, largest thread heap %d bytes\n",
+            minorCollectionCount, majorCollectionCount, heapPoolLimit,
+            maxThreadHeapSize);
+
+    fprintf(stderr, "gc: %d safepoints, %"LLD" ms total and %"LLD" ms "
+            "longest time to safepoint\n",
+            safepointCount, safepointTime, maxSafepointTime);
+  }
+
+  for (unsigned i = 0; i < heapPoolIndex * 2; i += 2) {
+    heap->free(reinterpret_cast<void*>(heapPool[i]), heapPool[i + 1]);
   }
 
+  heap->free(heapPool, heapPoolCapacity * 2 * BytesPerWord);
+
   if (bootimage) {
     heap->free(bootimage, bootimageSize);
   }
@@ -3069,7 +3272,9 @@ Thread::Thread(Machine* m, object javaThread, Thread* parent):
               (m->heap->allocate(ThreadHeapSizeInBytes))),
   heap(defaultHeap),
   backupHeapIndex(0),
-  flags(ActiveFlag)
+  flags(ActiveFlag),
+  lockId(nextLockId(m)),
+  heapSizeInWords(ThreadHeapSizeInWords)
 { }
 
 void
@@ -3188,6 +3393,8 @@ Thread::dispose()
 
   -- m->threadCount;
 
+  releaseLockId(m, lockId);
+
   m->heap->free(defaultHeap, ThreadHeapSizeInBytes);
 
   m->processor->dispose(this);
@@ -3307,8 +3514,25 @@ enter(Thread* t, Thread::State s)
     
     STORE_LOAD_MEMORY_BARRIER;
 
-    while (t->m->activeCount > 1) {
-      t->m->stateLock->wait(t->systemThread, 0);
+    if (t->m->activeCount > 1) {
+      // protect the polling page so that threads running compiled
+      // code fault into a safepoint at their next loop back-edge or
+      // method return:
+      int64_t start = t->m->system->now();
+      t->m->system->armPollPage(true);
+
+      while (t->m->activeCount > 1) {
+        t->m->stateLock->wait(t->systemThread, 0);
+      }
+
+      t->m->system->armPollPage(false);
+
+      int64_t elapsed = t->m->system->now() - start;
+      ++ t->m->safepointCount;
+      t->m->safepointTime += elapsed;
+      if (elapsed > t->m->maxSafepointTime) {
+        t->m->maxSafepointTime = elapsed;
+      }
     }
   } break;
 
@@ -3438,6 +3662,38 @@ enter(Thread* t, Thread::State s)
   }
 }
 
+unsigned
+nextThreadHeapSize(Thread* t)
+{
+  Machine* m = t->m;
+
+  if (m->heapPoolFootprint + ThreadHeapSizeInBytes > m->heapPoolLimit) {
+    return 0;
+  }
+
+  // a thread which has allocated a lot since the last collection is
+  // likely to keep doing so, so give it a heap at least as large as
+  // what it has used so far, which makes the number of refills per
+  // collection logarithmic in its allocation rate:
+  unsigned used = (t->heapOffset + t->heapIndex) * BytesPerWord;
+  unsigned size = ThreadHeapSizeInBytes;
+  while (size < used and size < MaxThreadHeapSizeInBytes) {
+    size *= 2;
+  }
+
+  // ...but don't take more than a fair share of what is left of the
+  // young generation from the other active threads:
+  unsigned available = m->heapPoolLimit - m->heapPoolFootprint;
+  unsigned share = available / max(m->activeCount, 1U);
+  while (size > ThreadHeapSizeInBytes and size > share) {
+    size /= 2;
+  }
+
+  assert(t, m->heapPoolIndex < m->heapPoolCapacity);
+
+  return size;
+}
+
 object
 allocate2(Thread* t, unsigned sizeInBytes, bool objectMask)
 {
@@ -3462,7 +3718,7 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
     return o;
   } else if (UNLIKELY(t->flags & Thread::TracingFlag)) {
     expect(t, t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-           <= ThreadHeapSizeInWords);
+           <= t->heapSizeInWords);
     return allocateSmall(t, sizeInBytes);
   }
 
@@ -3482,29 +3738,37 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
     switch (type) {
     case Machine::MovableAllocation:
       if (t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-          > ThreadHeapSizeInWords)
+          > t->heapSizeInWords)
       {
         t->heap = 0;
-        if ((not t->m->heap->limitExceeded())
-            and t->m->heapPoolIndex < ThreadHeapPoolSize)
-        {
-          t->heap = static_cast<uintptr_t*>
-            (t->m->heap->tryAllocate(ThreadHeapSizeInBytes));
+        unsigned size = nextThreadHeapSize(t);
+        if ((not t->m->heap->limitExceeded()) and size) {
+          t->heap = static_cast<uintptr_t*>(t->m->heap->tryAllocate(size));
 
           if (t->heap) {
-            memset(t->heap, 0, ThreadHeapSizeInBytes);
+            memset(t->heap, 0, size);
+
+            Machine* m = t->m;
+            m->heapPool[m->heapPoolIndex * 2]
+              = reinterpret_cast<uintptr_t>(t->heap);
+            m->heapPool[(m->heapPoolIndex * 2) + 1] = size;
+            ++ m->heapPoolIndex;
+            m->heapPoolFootprint += size;
+
+            if (size > m->maxThreadHeapSize) {
+              m->maxThreadHeapSize = size;
+            }
 
-            t->m->heapPool[t->m->heapPoolIndex++] = t->heap;
             t->heapOffset += t->heapIndex;
             t->heapIndex = 0;
+            t->heapSizeInWords = size / BytesPerWord;
           }
         }
       }
       break;
 
     case Machine::FixedAllocation:
-      if (t->m->fixedFootprint + sizeInBytes > FixedFootprintThresholdInBytes)
-      {
+      if (t->m->fixedFootprint + sizeInBytes > t->m->heapPoolLimit) {
         t->heap = 0;
       }
       break;
@@ -3524,7 +3788,7 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
     }
   } while (type == Machine::MovableAllocation
            and t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-           > ThreadHeapSizeInWords);
+           > t->heapSizeInWords);
   
   switch (type) {
   case Machine::MovableAllocation: {
@@ -4543,6 +4807,12 @@ objectMonitor(Thread* t, object o, bool createNew)
 {
   assert(t, t->state == Thread::ActiveState);
 
+  PROTECT(t, o);
+
+  // like the other weak hash maps, the monitor map is guarded by
+  // referenceLock, so making a monitor need not stop the world:
+  ACQUIRE(t, t->m->referenceLock);
+
   object m = hashMapFind
     (t, root(t, Machine::MonitorMap), o, objectHash, objectEqual);
 
@@ -4550,45 +4820,246 @@ objectMonitor(Thread* t, object o, bool createNew)
     if (DebugMonitors) {
       fprintf(stderr, "found monitor %p for object %x\n", m, objectHash(t, o));
     }
-
-    return m;
   } else if (createNew) {
-    PROTECT(t, o);
+    object head = makeMonitorNode(t, 0, 0);
+    m = makeMonitor(t, 0, 0, 0, head, head, 0);
     PROTECT(t, m);
 
-    { ENTER(t, Thread::ExclusiveState);
+    if (DebugMonitors) {
+      fprintf(stderr, "made monitor %p for object %x\n", m,
+              objectHash(t, o));
+    }
 
-      m = hashMapFind
-        (t, root(t, Machine::MonitorMap), o, objectHash, objectEqual);
+    hashMapInsert(t, root(t, Machine::MonitorMap), o, m, objectHash);
 
-      if (m) {
-        if (DebugMonitors) {
-          fprintf(stderr, "found monitor %p for object %x\n",
-                  m, objectHash(t, o));
-        }
+    addFinalizer(t, o, removeMonitor);
+  } else {
+    return 0;
+  }
 
-        return m;
-      }
+  if (createNew) {
+    markInflated(t, o);
+  }
 
-      object head = makeMonitorNode(t, 0, 0);
-      m = makeMonitor(t, 0, 0, 0, head, head, 0);
+  return m;
+}
+
+void
+acquireLockWord(Thread* t, object o)
+{
+  PROTECT(t, o);
 
-      if (DebugMonitors) {
-        fprintf(stderr, "made monitor %p for object %x\n", m,
-                objectHash(t, o));
+  bool contended = false;
+  unsigned spins = 0;
+  while (true) {
+    uintptr_t* word = lockWord(t, o);
+    uintptr_t w = *word;
+    if (w & LockInflatedBit) {
+      object m = objectMonitor(t, o, true);
+
+      monitorAcquire(t, m);
+      return;
+    } else if ((w & LockWordMask) == 0) {
+      if (contended or t->lockId == 0) {
+        // inflate the lock so that this and any other contending
+        // threads may block on its monitor instead of spinning
+        objectMonitor(t, o, true);
+      } else if (tryAcquireLockWord(t, word)) {
+        return;
+      }
+    } else if (lockWordHeld(t, w)) {
+      if (lockWordDepth(w) == LockMaxDepth) {
+        inflateLockWord(t, o);
+      } else if (tryAcquireLockWord(t, word)) {
+        return;
       }
+    } else if (spins < LockSpinCount) {
+      ++ spins;
+      contended = true;
+      t->m->system->yield();
+    } else {
+      waitForLockWord(t, o);
+    }
+  }
+}
+
+object
+inflateLockWord(Thread* t, object o)
+{
+  PROTECT(t, o);
+
+  object m = objectMonitor(t, o, true);
+  PROTECT(t, m);
+
+  uintptr_t* word = lockWord(t, o);
+
+  expect(t, lockWordHeld(t, *word));
+  expect(t, monitorOwner(t, m) == 0);
 
-      hashMapInsert(t, root(t, Machine::MonitorMap), o, m, objectHash);
+  monitorOwner(t, m) = t;
+  monitorDepth(t, m) = lockWordDepth(*word);
 
-      addFinalizer(t, o, removeMonitor);
+  storeStoreMemoryBarrier();
+
+  while (true) {
+    uintptr_t w = *word;
+    if (atomicCompareAndSwap(word, w, (w & ~LockWordMask) | LockInflatedBit)) {
+      if (w & LockContendedBit) {
+        notifyLockWordWaiters(t);
+      }
+      break;
     }
+  }
+
+  if (DebugMonitors) {
+    fprintf(stderr, "thread %p inflated lock word to %p for %x\n",
+            t, m, objectHash(t, o));
+  }
+
+  return m;
+}
+
+void
+notifyLockWordWaiters(Thread* t)
+{
+  ACQUIRE(t, t->m->lockWordLock);
+
+  t->m->lockWordLock->notifyAll(t->systemThread);
+}
+
+bool
+compatibleArrayTypes(Thread* t, object a, object b)
+{
+  return classArrayElementSize(t, a)
+    and classArrayElementSize(t, b)
+    and (a == b
+         or (not ((classVmFlags(t, a) & PrimitiveFlag)
+                  or (classVmFlags(t, b) & PrimitiveFlag))));
+}
+
+void
+arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length)
+{
+  if (LIKELY(src and dst)) {
+    if (LIKELY(compatibleArrayTypes
+               (t, objectClass(t, src), objectClass(t, dst))))
+    {
+      unsigned elementSize = classArrayElementSize(t, objectClass(t, src));
+
+      if (LIKELY(elementSize)) {
+        intptr_t sl = cast<uintptr_t>(src, BytesPerWord);
+        intptr_t dl = cast<uintptr_t>(dst, BytesPerWord);
+        if (LIKELY(length > 0)) {
+          if (LIKELY(srcOffset >= 0 and srcOffset + length <= sl and
+                     dstOffset >= 0 and dstOffset + length <= dl))
+          {
+            uint8_t* sbody = &cast<uint8_t>(src, ArrayBody);
+            uint8_t* dbody = &cast<uint8_t>(dst, ArrayBody);
+            if (src == dst) {
+              memmove(dbody + (dstOffset * elementSize),
+                      sbody + (srcOffset * elementSize),
+                      length * elementSize);
+            } else {
+              memcpy(dbody + (dstOffset * elementSize),
+                     sbody + (srcOffset * elementSize),
+                     length * elementSize);
+            }
+
+            if (classObjectMask(t, objectClass(t, dst))) {
+              mark(t, dst, ArrayBody + (dstOffset * BytesPerWord), length);
+            }
 
-    return m;
+            return;
+          } else {
+            throwNew(t, Machine::IndexOutOfBoundsExceptionType);
+          }
+        } else {
+          return;
+        }
+      }
+    }
   } else {
-    return 0;
+    throwNew(t, Machine::NullPointerExceptionType);
+    return;
+  }
+
+  throwNew(t, Machine::ArrayStoreExceptionType);
+}
+
+void
+arrayFill(Thread* t, object array, uint64_t value)
+{
+  if (UNLIKELY(array == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  // object arrays need a write barrier per element, so only primitive
+  // arrays come through here
+  assert(t, classObjectMask(t, objectClass(t, array)) == 0);
+
+  uintptr_t length = cast<uintptr_t>(array, BytesPerWord);
+  void* body = &cast<uint8_t>(array, ArrayBody);
+
+  switch (classArrayElementSize(t, objectClass(t, array))) {
+  case 1:
+    memset(body, static_cast<uint8_t>(value), length);
+    break;
+
+  case 2: {
+    uint16_t* p = static_cast<uint16_t*>(body);
+    for (uintptr_t i = 0; i < length; ++i) p[i] = value;
+  } break;
+
+  case 4: {
+    uint32_t* p = static_cast<uint32_t*>(body);
+    for (uintptr_t i = 0; i < length; ++i) p[i] = value;
+  } break;
+
+  case 8: {
+    uint64_t* p = static_cast<uint64_t*>(body);
+    for (uintptr_t i = 0; i < length; ++i) p[i] = value;
+  } break;
+
+  default:
+    abort(t);
   }
 }
 
+uint32_t
+stringBodyHash(const int8_t* s, unsigned length)
+{
+#ifdef AVIAN_VECTOR_HASH
+  if (length >= VectorHashThreshold and useVectorHash()) {
+    unsigned i;
+    uint32_t h = vectorHash(s, true, length, &i);
+    for (; i < length; ++i) {
+      h = (h * 31) + static_cast<uint16_t>(s[i]);
+    }
+    return h;
+  }
+#endif
+
+  return stringBytesHash(s, length);
+}
+
+uint32_t
+stringBodyHash(const uint16_t* s, unsigned length)
+{
+#ifdef AVIAN_VECTOR_HASH
+  if (length >= VectorHashThreshold and useVectorHash()) {
+    unsigned i;
+    uint32_t h = vectorHash(s, false, length, &i);
+    for (; i < length; ++i) {
+      h = (h * 31) + s[i];
+    }
+    return h;
+  }
+#endif
+
+  return hash(s, length);
+}
+
 object
 intern(Thread* t, object s)
 {
@@ -4740,17 +5211,16 @@ printTrace(Thread* t, object exception)
     }
 
     object trace = throwableTrace(t, e);
-    if (trace) {
-      for (unsigned i = 0; i < objectArrayLength(t, trace); ++i) {
-        object e = objectArrayBody(t, trace, i);
+    if (trace and objectClass(t, trace) == type(t, Machine::TraceType)) {
+      for (unsigned i = 0; i < traceLength(t, trace); ++i) {
+        object method = traceMethod(t, trace, i);
         const int8_t* class_ = &byteArrayBody
-          (t, className(t, methodClass(t, traceElementMethod(t, e))), 0);
-        const int8_t* method = &byteArrayBody
-          (t, methodName(t, traceElementMethod(t, e)), 0);
+          (t, className(t, methodClass(t, method)), 0);
+        const int8_t* name = &byteArrayBody(t, methodName(t, method), 0);
         int line = t->m->processor->lineNumber
-          (t, traceElementMethod(t, e), traceElementIp(t, e));
+          (t, method, traceIp(t, trace, i));
 
-        fprintf(errorLog(t), "  at %s.%s ", class_, method);
+        fprintf(errorLog(t), "  at %s.%s ", class_, name);
 
         switch (line) {
         case NativeLine:
@@ -4776,32 +5246,82 @@ printTrace(Thread* t, object exception)
 object
 makeTrace(Thread* t, Processor::StackWalker* walker)
 {
+  // Most stacks are shallow enough that we can record each frame in a
+  // fixed-size buffer on the first and only pass.  If the buffer fills
+  // up, we count the remaining frames, allocate the trace, and fill in
+  // the rest directly.  In either case we allocate just the trace and
+  // its table of IPs, deferring any method, line number, or
+  // StackTraceElement lookups until the trace is actually inspected.
+  const unsigned BufferCapacity = 32;
+
   class Visitor: public Processor::StackVisitor {
    public:
-    Visitor(Thread* t): t(t), trace(0), index(0), protector(t, &trace) { }
+    Visitor(Thread* t):
+      t(t), trace(0), count(0), protector(t, this)
+    { }
 
     virtual bool visit(Processor::StackWalker* walker) {
       if (trace == 0) {
-        trace = makeObjectArray(t, walker->count());
-        vm_assert(t, trace);
+        if (count < BufferCapacity) {
+          methods[count] = walker->method();
+          ips[count] = walker->ip();
+          ++ count;
+          return true;
+        }
+
+        make(count + walker->count());
       }
 
-      object e = makeTraceElement(t, walker->method(), walker->ip());
-      vm_assert(t, index < objectArrayLength(t, trace));
-      set(t, trace, ArrayBody + (index * BytesPerWord), e);
-      ++ index;
+      vm_assert(t, count < traceLength(t, trace));
+      set(t, trace, TraceMethod + (count * BytesPerWord), walker->method());
+      intArrayBody(t, traceIps(t, trace), count) = walker->ip();
+      ++ count;
       return true;
     }
 
+    void make(unsigned length) {
+      object table = makeIntArray(t, length);
+      memcpy(&intArrayBody(t, table, 0), ips, count * 4);
+
+      trace = vm::makeTrace(t, table, length);
+      for (unsigned i = 0; i < count; ++i) {
+        set(t, trace, TraceMethod + (i * BytesPerWord), methods[i]);
+      }
+    }
+
+    class MyProtector: public Thread::Protector {
+     public:
+      MyProtector(Thread* t, Visitor* visitor):
+        Protector(t), visitor(visitor)
+      { }
+
+      virtual void visit(Heap::Visitor* v) {
+        v->visit(&(visitor->trace));
+        if (visitor->trace == 0) {
+          for (unsigned i = 0; i < visitor->count; ++i) {
+            v->visit(visitor->methods + i);
+          }
+        }
+      }
+
+      Visitor* visitor;
+    };
+
     Thread* t;
     object trace;
-    unsigned index;
-    Thread::SingleProtector protector;
+    object methods[BufferCapacity];
+    int32_t ips[BufferCapacity];
+    unsigned count;
+    MyProtector protector;
   } v(t);
 
   walker->walk(&v);
 
-  return v.trace ? v.trace : makeObjectArray(t, 0);
+  if (v.trace == 0) {
+    v.make(v.count);
+  }
+
+  return v.trace;
 }
 
 object
@@ -4822,7 +5342,7 @@ makeTrace(Thread* t, Thread* target)
 
   t->m->processor->walkStack(target, &v);
 
-  return v.trace ? v.trace : makeObjectArray(t, 0);
+  return v.trace ? v.trace : makeEmptyTrace(t);
 }
 
 void
@@ -105,17 +105,59 @@ const uintptr_t HashTakenMark = 1;
 const uintptr_t ExtendedMark = 2;
 const uintptr_t FixedMark = 3;
 
+const uintptr_t MarkMask = BytesPerWord - 1;
+
+// On 64-bit targets, the top 16 bits of every object's header, which
+// no class pointer uses, hold a thin lock word.  A lock which is only
+// ever held by one thread at a time is recorded there and never needs
+// a monitor from the monitor map.  The layout, relative to
+// LockWordShift, is: bit 0 set if the lock has been inflated to a
+// monitor, bit 1 set if a thread is waiting for the current owner to
+// release it, bits 2-4 the recursion depth, and bits 5-15 the lock ID
+// of the owning thread.  32-bit targets have no bits to spare, so
+// their locks always use the monitor map.
+const bool ThinLocks = BytesPerWord == 8;
+
+const unsigned LockWordShift = BitsPerWord - 16;
+const uintptr_t LockWordMask = ~static_cast<uintptr_t>(0) << LockWordShift;
+const uintptr_t LockInflatedBit = static_cast<uintptr_t>(1) << LockWordShift;
+const uintptr_t LockContendedBit
+= static_cast<uintptr_t>(1) << (LockWordShift + 1);
+
+const unsigned LockDepthShift = LockWordShift + 2;
+const uintptr_t LockDepthUnit = static_cast<uintptr_t>(1) << LockDepthShift;
+const unsigned LockMaxDepth = (1 << 3) - 1;
+
+const unsigned LockOwnerShift = LockWordShift + 5;
+const unsigned LockMaxOwner = (1 << 11) - 1;
+
+// lock IDs are handed out from a bitmap and returned when their
+// threads are disposed:
+const unsigned LockIdWords = (LockMaxOwner + 1) / BitsPerWord;
+
+// number of times a thread will yield while waiting for another
+// thread to release a thin lock before blocking:
+const unsigned LockSpinCount = 8;
+
 const unsigned ThreadHeapSizeInBytes = 64 * 1024;
 const unsigned ThreadHeapSizeInWords = ThreadHeapSizeInBytes / BytesPerWord;
 
+// thread-local heaps after the first one grow with the amount the
+// thread has allocated since the last collection, up to this size:
+const unsigned MaxThreadHeapSizeInBytes = 1024 * 1024;
+const unsigned MaxThreadHeapSizeInWords
+= MaxThreadHeapSizeInBytes / BytesPerWord;
+
 const unsigned ThreadBackupHeapSizeInBytes = 2 * 1024;
 const unsigned ThreadBackupHeapSizeInWords
 = ThreadBackupHeapSizeInBytes / BytesPerWord;
 
-const unsigned ThreadHeapPoolSize = 64;
+// the young generation, i.e. the thread-local heaps and fixed objects
+// handed out between collections, may use this fraction of the heap
+// limit, but never less than HeapPoolMinimumSizeInBytes:
+const unsigned HeapPoolLimitDivisor = 8;
 
-const unsigned FixedFootprintThresholdInBytes
-= ThreadHeapPoolSize * ThreadHeapSizeInBytes;
+const unsigned HeapPoolMinimumSizeInBytes = 64 * ThreadHeapSizeInBytes;
 
 // number of zombie threads which may accumulate before we force a GC
 // to clean them up:
@@ -159,6 +201,9 @@ const unsigned ContinuationFlag = 1 << 11;
 // method vmFlags:
 const unsigned ClassInitFlag = 1 << 0;
 const unsigned ConstructorFlag = 1 << 1;
+const unsigned ReferenceStubFlag = 1 << 2;
+const unsigned IntrinsicCheckedFlag = 1 << 3;
+const unsigned IntrinsicFlag = 1 << 4;
 
 #ifndef JNI_VERSION_1_6
 #define JNI_VERSION_1_6 0x00010006
@@ -1265,12 +1310,14 @@ class Machine {
   unsigned daemonCount;
   unsigned fixedFootprint;
   unsigned stackSizeInBytes;
+  uintptr_t lockIds[LockIdWords];
   System::Local* localThread;
   System::Monitor* stateLock;
   System::Monitor* heapLock;
   System::Monitor* classLock;
   System::Monitor* referenceLock;
   System::Monitor* shutdownLock;
+  System::Monitor* lockWordLock;
   System::Library* libraries;
   FILE* errorLog;
   BootImage* bootimage;
@@ -1288,8 +1335,17 @@ class Machine {
   bool alive;
   JavaVMVTable javaVMVTable;
   JNIEnvVTable jniEnvVTable;
-  uintptr_t* heapPool[ThreadHeapPoolSize];
+  uintptr_t* heapPool;
   unsigned heapPoolIndex;
+  unsigned heapPoolCapacity;
+  unsigned heapPoolFootprint;
+  unsigned heapPoolLimit;
+  unsigned maxThreadHeapSize;
+  unsigned minorCollectionCount;
+  unsigned majorCollectionCount;
+  unsigned safepointCount;
+  int64_t safepointTime;
+  int64_t maxSafepointTime;
   unsigned bootimageSize;
 };
 
@@ -1523,6 +1579,8 @@ class Thread {
   uintptr_t backupHeap[ThreadBackupHeapSizeInWords];
   unsigned backupHeapIndex;
   unsigned flags;
+  unsigned lockId;
+  unsigned heapSizeInWords;
 };
 
 class Classpath {
@@ -1807,7 +1865,7 @@ inline bool
 ensure(Thread* t, unsigned sizeInBytes)
 {
   if (t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-      > ThreadHeapSizeInWords)
+      > t->heapSizeInWords)
   {
     if (sizeInBytes <= ThreadBackupHeapSizeInBytes) {
       expect(t, (t->flags & Thread::UseBackupHeapFlag) == 0);
@@ -1834,7 +1892,7 @@ inline object
 allocateSmall(Thread* t, unsigned sizeInBytes)
 {
   assert(t, t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-         <= ThreadHeapSizeInWords);
+         <= t->heapSizeInWords);
 
   object o = reinterpret_cast<object>(t->heap + t->heapIndex);
   t->heapIndex += ceiling(sizeInBytes, BytesPerWord);
@@ -1847,7 +1905,7 @@ allocate(Thread* t, unsigned sizeInBytes, bool objectMask)
   stress(t);
 
   if (UNLIKELY(t->heapIndex + ceiling(sizeInBytes, BytesPerWord)
-               > ThreadHeapSizeInWords
+               > t->heapSizeInWords
                or t->m->exclusive))
   {
     return allocate2(t, sizeInBytes, objectMask);
@@ -2117,19 +2175,19 @@ setType(Thread* t, Machine::Type type, object value)
 inline bool
 objectFixed(Thread*, object o)
 {
-  return (alias(o, 0) & (~PointerMask)) == FixedMark;
+  return (alias(o, 0) & MarkMask) == FixedMark;
 }
 
 inline bool
 objectExtended(Thread*, object o)
 {
-  return (alias(o, 0) & (~PointerMask)) == ExtendedMark;
+  return (alias(o, 0) & MarkMask) == ExtendedMark;
 }
 
 inline bool
 hashTaken(Thread*, object o)
 {
-  return (alias(o, 0) & (~PointerMask)) == HashTakenMark;
+  return (alias(o, 0) & MarkMask) == HashTakenMark;
 }
 
 inline unsigned
@@ -2155,6 +2213,18 @@ makeTrace(Thread* t)
   return makeTrace(t, t);
 }
 
+inline object
+makeEmptyTrace(Thread* t)
+{
+  return makeTrace(t, makeIntArray(t, 0), 0);
+}
+
+inline int
+traceIp(Thread* t, object trace, unsigned index)
+{
+  return intArrayBody(t, traceIps(t, trace), index);
+}
+
 inline object
 makeNew(Thread* t, object class_)
 {
@@ -2295,7 +2365,13 @@ markHashTaken(Thread* t, object o)
 
   ACQUIRE_RAW(t, t->m->heapLock);
 
-  alias(o, 0) |= HashTakenMark;
+  // another thread may be updating the lock word in the same header:
+  uintptr_t* header = &cast<uintptr_t>(o, 0);
+  for (uintptr_t h = *header;
+       not atomicCompareAndSwap(header, h, h | HashTakenMark);
+       h = *header)
+  { }
+
   t->m->heap->pad(o);
 }
 
@@ -2328,6 +2404,36 @@ objectEqual(Thread*, object a, object b)
   return a == b;
 }
 
+inline uintptr_t*
+lockWord(Thread*, object o)
+{
+  if (ThinLocks) {
+    return &cast<uintptr_t>(o, 0);
+  } else {
+    return 0;
+  }
+}
+
+inline unsigned
+lockWordOwner(uintptr_t word)
+{
+  return (word >> LockOwnerShift) & LockMaxOwner;
+}
+
+inline unsigned
+lockWordDepth(uintptr_t word)
+{
+  return (word >> LockDepthShift) & LockMaxDepth;
+}
+
+inline bool
+lockWordHeld(Thread* t, uintptr_t word)
+{
+  return t->lockId
+    and (word & LockInflatedBit) == 0
+    and lockWordOwner(word) == t->lockId;
+}
+
 inline uint32_t
 byteArrayHash(Thread* t, object array)
 {
@@ -2349,16 +2455,47 @@ byteArrayEqual(Thread* t, object a, object b)
             byteArrayLength(t, a)) == 0);
 }
 
+inline uint32_t
+stringBytesHash(const int8_t* s, unsigned length)
+{
+  // like hash(const uint8_t*, unsigned), but widens each byte to a
+  // char the way stringCharAt does, so a byte-backed string hashes the
+  // same as its char-backed equivalent
+  uint32_t h = 0;
+  unsigned i = 0;
+  for (; i + 4 <= length; i += 4) {
+    h = (h * 923521)
+      + (static_cast<uint32_t>(static_cast<uint16_t>(s[i])) * 29791)
+      + (static_cast<uint32_t>(static_cast<uint16_t>(s[i + 1])) * 961)
+      + (static_cast<uint32_t>(static_cast<uint16_t>(s[i + 2])) * 31)
+      + static_cast<uint16_t>(s[i + 3]);
+  }
+  for (; i < length; ++i) {
+    h = (h * 31) + static_cast<uint16_t>(s[i]);
+  }
+  return h;
+}
+
+// strings at least this long are hashed with SSE 4.1 where the CPU
+// supports it
+const unsigned VectorHashThreshold = 16;
+
+uint32_t
+stringBodyHash(const int8_t* s, unsigned length);
+
+uint32_t
+stringBodyHash(const uint16_t* s, unsigned length);
+
 inline uint32_t
 stringHash(Thread* t, object s)
 {
   if (stringHashCode(t, s) == 0 and stringLength(t, s)) {
     object data = stringData(t, s);
     if (objectClass(t, data) == type(t, Machine::ByteArrayType)) {
-      stringHashCode(t, s) = hash
+      stringHashCode(t, s) = stringBodyHash
         (&byteArrayBody(t, data, stringOffset(t, s)), stringLength(t, s));
     } else {
-      stringHashCode(t, s) = hash
+      stringHashCode(t, s) = stringBodyHash
         (&charArrayBody(t, data, stringOffset(t, s)), stringLength(t, s));
     }
   }
@@ -2382,6 +2519,22 @@ stringEqual(Thread* t, object a, object b)
   if (a == b) {
     return true;
   } else if (stringLength(t, a) == stringLength(t, b)) {
+    object ad = stringData(t, a);
+    object bd = stringData(t, b);
+    if (objectClass(t, ad) == objectClass(t, bd)) {
+      // same representation, so let memcmp compare whole words at a
+      // time
+      if (objectClass(t, ad) == type(t, Machine::ByteArrayType)) {
+        return memcmp(&byteArrayBody(t, ad, stringOffset(t, a)),
+                      &byteArrayBody(t, bd, stringOffset(t, b)),
+                      stringLength(t, a)) == 0;
+      } else {
+        return memcmp(&charArrayBody(t, ad, stringOffset(t, a)),
+                      &charArrayBody(t, bd, stringOffset(t, b)),
+                      stringLength(t, a) * 2) == 0;
+      }
+    }
+
     for (unsigned i = 0; i < stringLength(t, a); ++i) {
       if (stringCharAt(t, a, i) != stringCharAt(t, b, i)) {
         return false;
@@ -2393,6 +2546,57 @@ stringEqual(Thread* t, object a, object b)
   }
 }
 
+inline int32_t
+stringIndexOf(Thread* t, object s, int32_t c, int32_t start)
+{
+  int32_t length = stringLength(t, s);
+  if (start < 0) {
+    start = 0;
+  } else if (start >= length) {
+    return -1;
+  }
+
+  object data = stringData(t, s);
+  if (objectClass(t, data) == type(t, Machine::ByteArrayType)) {
+    // stringCharAt sign-extends bytes, so a byte string can only
+    // contain characters below 0x80 or from 0xFF80 up
+    if ((c >= 0 and c < 0x80) or (c >= 0xFF80 and c <= 0xFFFF)) {
+      const int8_t* body = &byteArrayBody(t, data, stringOffset(t, s));
+      const void* p = memchr(body + start, static_cast<int8_t>(c),
+                             length - start);
+      if (p) {
+        return static_cast<const int8_t*>(p) - body;
+      }
+    }
+  } else {
+    const uint16_t* body = &charArrayBody(t, data, stringOffset(t, s));
+    if (c >= 0 and c <= 0xFFFF) {
+      for (int32_t i = start; i < length; ++i) {
+        if (body[i] == c) {
+          return i;
+        }
+      }
+    } else if (c > 0xFFFF and c <= 0x10FFFF) {
+      // a supplementary character is stored as a surrogate pair
+      uint16_t high = 0xD800 + ((c - 0x10000) >> 10);
+      uint16_t low = 0xDC00 + ((c - 0x10000) & 0x3FF);
+      for (int32_t i = start; i < length - 1; ++i) {
+        if (body[i] == high and body[i + 1] == low) {
+          return i;
+        }
+      }
+    }
+  }
+  return -1;
+}
+
+void
+arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length);
+
+void
+arrayFill(Thread* t, object array, uint64_t value);
+
 inline uint32_t
 methodHash(Thread* t, object method)
 {
@@ -3157,6 +3361,57 @@ class ObjectMonitorResource {
 object
 objectMonitor(Thread* t, object o, bool createNew);
 
+void
+acquireLockWord(Thread* t, object o);
+
+object
+inflateLockWord(Thread* t, object o);
+
+void
+notifyLockWordWaiters(Thread* t);
+
+inline bool
+tryAcquireLockWord(Thread* t, uintptr_t* word)
+{
+  uintptr_t w = *word;
+  if ((w & LockWordMask) == 0) {
+    return t->lockId and atomicCompareAndSwap
+      (word, w, w | LockDepthUnit
+       | (static_cast<uintptr_t>(t->lockId) << LockOwnerShift));
+  } else if (lockWordHeld(t, w) and lockWordDepth(w) < LockMaxDepth) {
+    return atomicCompareAndSwap(word, w, w + LockDepthUnit);
+  } else {
+    return false;
+  }
+}
+
+inline bool
+tryReleaseLockWord(Thread* t, uintptr_t* word)
+{
+  while (true) {
+    uintptr_t w = *word;
+    if (w & LockInflatedBit) {
+      return false;
+    }
+
+    expect(t, lockWordHeld(t, w));
+
+    // the owner is the only thread which may change the lock word
+    // while it is held, except for other threads setting the
+    // contended bit, so we only loop if that happens concurrently:
+    if (lockWordDepth(w) > 1) {
+      if (atomicCompareAndSwap(word, w, w - LockDepthUnit)) {
+        return true;
+      }
+    } else if (atomicCompareAndSwap(word, w, w & ~LockWordMask)) {
+      if (w & LockContendedBit) {
+        notifyLockWordWaiters(t);
+      }
+      return true;
+    }
+  }
+}
+
 inline void
 acquire(Thread* t, object o)
 {
@@ -3165,6 +3420,19 @@ acquire(Thread* t, object o)
     hash = objectHash(t, o);
   }
 
+  uintptr_t* word = lockWord(t, o);
+  if (word) {
+    if (not tryAcquireLockWord(t, word)) {
+      acquireLockWord(t, o);
+    }
+
+    if (DebugMonitors) {
+      fprintf(stderr, "thread %p acquires lock word for %x\n", t, hash);
+    }
+
+    return;
+  }
+
   object m = objectMonitor(t, o, true);
 
   if (DebugMonitors) {
@@ -3182,6 +3450,15 @@ release(Thread* t, object o)
     hash = objectHash(t, o);
   }
 
+  uintptr_t* word = lockWord(t, o);
+  if (word and tryReleaseLockWord(t, word)) {
+    if (DebugMonitors) {
+      fprintf(stderr, "thread %p releases lock word for %x\n", t, hash);
+    }
+
+    return;
+  }
+
   object m = objectMonitor(t, o, false);
 
   if (DebugMonitors) {
@@ -3199,7 +3476,14 @@ wait(Thread* t, object o, int64_t milliseconds)
     hash = objectHash(t, o);
   }
 
-  object m = objectMonitor(t, o, false);
+  // waiting requires a monitor, so inflate the lock if it is thin:
+  object m;
+  uintptr_t* word = lockWord(t, o);
+  if (word and lockWordHeld(t, *word)) {
+    m = inflateLockWord(t, o);
+  } else {
+    m = objectMonitor(t, o, false);
+  }
 
   if (DebugMonitors) {
     fprintf(stderr, "thread %p waits %d millis on %p for %x\n",
@@ -3239,6 +3523,12 @@ notify(Thread* t, object o)
     hash = objectHash(t, o);
   }
 
+  uintptr_t* word = lockWord(t, o);
+  if (word and lockWordHeld(t, *word)) {
+    // nobody can be waiting on a lock which hasn't been inflated
+    return;
+  }
+
   object m = objectMonitor(t, o, false);
 
   if (DebugMonitors) {
@@ -3256,6 +3546,11 @@ notify(Thread* t, object o)
 inline void
 notifyAll(Thread* t, object o)
 {
+  uintptr_t* word = lockWord(t, o);
+  if (word and lockWordHeld(t, *word)) {
+    return;
+  }
+
   object m = objectMonitor(t, o, false);
 
   if (DebugMonitors) {
@@ -3270,6 +3565,18 @@ notifyAll(Thread* t, object o)
   }
 }
 
+inline bool
+holdsLock(Thread* t, object o)
+{
+  uintptr_t* word = lockWord(t, o);
+  if (word and (*word & LockInflatedBit) == 0) {
+    return lockWordHeld(t, *word);
+  } else {
+    object m = objectMonitor(t, o, false);
+    return m and monitorOwner(t, m) == t;
+  }
+}
+
 inline void
 interrupt(Thread* t, Thread* target)
 {
@@ -3291,6 +3598,40 @@ getAndClearInterrupted(Thread* t, Thread* target)
   }
 }
 
+inline void
+park(Thread* t, bool absolute, int64_t time)
+{
+  // As with sun.misc.Unsafe.park, an absolute time is a deadline in
+  // milliseconds since the epoch, while a relative one is a timeout in
+  // nanoseconds, with zero meaning no timeout at all.
+  if (absolute) {
+    time = (time - t->m->system->now()) * 1000 * 1000;
+    if (time <= 0) {
+      return;
+    }
+  } else if (time < 0) {
+    return;
+  }
+
+  ENTER(t, Thread::IdleState);
+
+  t->systemThread->park(time);
+}
+
+inline void
+unpark(Thread* t, object thread)
+{
+  // The target cannot be disposed until it has exited, which requires
+  // exclusive state and thus waits for us to leave the active state,
+  // so we may use its peer without holding any lock.  As the Java
+  // specification permits, unparking a thread which has not yet
+  // started has no effect.
+  Thread* p = reinterpret_cast<Thread*>(threadPeer(t, thread));
+  if (p) {
+    p->systemThread->unpark();
+  }
+}
+
 inline bool
 exceptionMatch(Thread* t, object type, object exception)
 {
@@ -3710,7 +4051,7 @@ getMethodRuntimeData(Thread* t, object method)
     ACQUIRE(t, t->m->classLock);
 
     if (methodRuntimeDataIndex(t, method) == 0) {
-      object runtimeData = makeMethodRuntimeData(t, 0);
+      object runtimeData = makeMethodRuntimeData(t, 0, 0, 0, 0);
 
       setRoot(t, Machine::MethodRuntimeDataTable, vectorAppend
               (t, root(t, Machine::MethodRuntimeDataTable), runtimeData));
@@ -128,6 +128,7 @@ pathOfExecutable(System* s, const char** retBuf, unsigned* size)
 const bool Verbose = false;
 
 const unsigned Notified = 1 << 0;
+const unsigned Unparked = 1 << 1;
 
 class MySystem: public System {
  public:
@@ -167,6 +168,44 @@ class MySystem: public System {
       return interrupted;
     }
 
+    virtual void park(int64_t time) {
+      ACQUIRE(mutex);
+
+      if ((flags & Unparked) == 0 and not r->interrupted()) {
+        // pretend anything greater than one hundred years (in
+        // nanoseconds) is infinity so as to avoid overflow:
+        if (time and time < INT64_C(3153600000000000000)) {
+          timeval tv = { 0, 0 };
+          gettimeofday(&tv, 0);
+
+          const int64_t Billion = 1000 * 1000 * 1000;
+
+          int64_t then = (static_cast<int64_t>(tv.tv_sec) * Billion)
+            + (static_cast<int64_t>(tv.tv_usec) * 1000) + time;
+
+          timespec ts = { static_cast<time_t>(then / Billion),
+                          static_cast<long>(then % Billion) };
+
+          int rv UNUSED = pthread_cond_timedwait(&condition, &mutex, &ts);
+          expect(s, rv == 0 or rv == ETIMEDOUT or rv == EINTR);
+        } else {
+          int rv UNUSED = pthread_cond_wait(&condition, &mutex);
+          expect(s, rv == 0 or rv == EINTR);
+        }
+      }
+
+      flags &= ~Unparked;
+    }
+
+    virtual void unpark() {
+      ACQUIRE(mutex);
+
+      flags |= Unparked;
+
+      int rv UNUSED = pthread_cond_signal(&condition);
+      expect(s, rv == 0);
+    }
+
     virtual void join() {
       int rv UNUSED = pthread_join(thread, 0);
       expect(s, rv == 0);
@@ -367,7 +406,7 @@ class MySystem: public System {
         pthread_mutex_lock(&mutex);
 
         { ACQUIRE(t->mutex);
-          t->flags = 0;
+          t->flags &= ~Notified;
         }
 
         if (not notified) {
@@ -585,7 +624,10 @@ class MySystem: public System {
 
   MySystem():
     threadVisitor(0),
-    visitTarget(0)
+    visitTarget(0),
+    pollHandler(0),
+    pollPageStart(0),
+    pollPageSize(sysconf(_SC_PAGESIZE))
   {
     expect(this, system == 0);
     system = this;
@@ -697,6 +739,36 @@ class MySystem: public System {
     return registerHandler(handler, DivideByZeroSignalIndex);
   }
 
+  virtual Status handlePollFault(SignalHandler* handler) {
+    if (handler and pollPageStart == 0) {
+      void* p = mmap(0, pollPageSize, PROT_READ, MAP_PRIVATE | MAP_ANON,
+                     -1, 0);
+
+      if (p == MAP_FAILED) {
+        return 1;
+      }
+
+      pollPageStart = p;
+    }
+
+    // faults on the polling page arrive as segmentation faults, so
+    // they are only seen while a segfault handler is registered:
+    pollHandler = handler;
+    return 0;
+  }
+
+  virtual void* pollPage() {
+    return pollPageStart;
+  }
+
+  virtual void armPollPage(bool armed) {
+    if (pollPageStart) {
+      int r UNUSED = mprotect
+        (pollPageStart, pollPageSize, armed ? PROT_NONE : PROT_READ);
+      assert(this, r == 0);
+    }
+  }
+
   virtual Status visit(System::Thread* st UNUSED, System::Thread* sTarget,
                        ThreadVisitor* visitor)
   {
@@ -800,6 +872,18 @@ class MySystem: public System {
   }
 
   virtual FileType stat(const char* name, unsigned* length) {
+    int64_t time;
+    return stat(name, length, &time);
+  }
+
+  virtual int64_t lastModified(const char* name) {
+    unsigned length;
+    int64_t time;
+    stat(name, &length, &time);
+    return time;
+  }
+
+  FileType stat(const char* name, unsigned* length, int64_t* lastModified) {
 #ifdef __FreeBSD__
     // Now the hack below causes the error "Dereferencing type-punned
     // pointer will break strict aliasing rules", so another workaround
@@ -820,6 +904,8 @@ class MySystem: public System {
 
     int r = ::stat(name, s);
     if (r == 0) {
+      *lastModified = static_cast<int64_t>(s->st_mtime) * 1000;
+
       if (S_ISREG(s->st_mode)) {
         *length = s->st_size;
         return TypeFile;
@@ -832,6 +918,7 @@ class MySystem: public System {
       }
     } else {
       *length = 0;
+      *lastModified = 0;
       return TypeDoesNotExist;
     }
   }
@@ -926,6 +1013,10 @@ class MySystem: public System {
     registerHandler(0, PipeSignalIndex);
     system = 0;
 
+    if (pollPageStart) {
+      munmap(pollPageStart, pollPageSize);
+    }
+
     ::free(this);
   }
 
@@ -939,10 +1030,13 @@ class MySystem: public System {
   ThreadVisitor* threadVisitor;
   Thread* visitTarget;
   System::Monitor* visitLock;
+  SignalHandler* pollHandler;
+  void* pollPageStart;
+  unsigned pollPageSize;
 };
 
 void
-handleSignal(int signal, siginfo_t*, void* context)
+handleSignal(int signal, siginfo_t* info, void* context)
 {
   ucontext_t* c = static_cast<ucontext_t*>(context);
 
@@ -991,8 +1085,16 @@ handleSignal(int signal, siginfo_t*, void* context)
       abort();
     }
 
-    bool jump = system->handlers[index]->handleSignal
-      (&ip, &frame, &stack, &thread);
+    System::SignalHandler* handler = system->handlers[index];
+    if (system->pollHandler and signal != DivideByZeroSignal
+        and info->si_addr >= system->pollPageStart
+        and info->si_addr < static_cast<uint8_t*>(system->pollPageStart)
+        + system->pollPageSize)
+    {
+      handler = system->pollHandler;
+    }
+
+    bool jump = handler->handleSignal(&ip, &frame, &stack, &thread);
 
     if (jump) {
       // I'd like to use setcontext here (and get rid of the
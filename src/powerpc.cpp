@@ -2322,6 +2322,12 @@ class MyArchitecture: public Assembler::Architecture {
     case Float2Float:
     case Float2Int:
     case Int2Float:
+    case Float2Bits:
+    case Bits2Float:
+    case ReverseBytes:
+    case BitCount:
+    case LeadingZeros:
+    case TrailingZeros:
       *thunk = true;
       break;
 
@@ -2446,6 +2452,14 @@ class MyArchitecture: public Assembler::Architecture {
     }
   }
 
+  virtual void plan
+  (AtomicOperation, unsigned, uint64_t* addressRegisterMask,
+   uint64_t* valueRegisterMask, uint64_t* expectRegisterMask, bool* thunk)
+  {
+    *addressRegisterMask = *valueRegisterMask = *expectRegisterMask = 0;
+    *thunk = true;
+  }
+
   virtual void acquire() {
     ++ referenceCount;
   }
@@ -2720,6 +2734,12 @@ class MyAssembler: public Assembler {
     }
   }
 
+  virtual void apply(AtomicOperation, unsigned, Memory*, Register*,
+                     Register*)
+  {
+    abort(&c);
+  }
+
   virtual void setDestination(uint8_t* dst) {
     c.result = dst;
   }
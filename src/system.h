@@ -31,6 +31,8 @@ class System {
    public:
     virtual void interrupt() = 0;
     virtual bool getAndClearInterrupted() = 0;
+    virtual void park(int64_t time) = 0;
+    virtual void unpark() = 0;
     virtual void join() = 0;
     virtual void dispose() = 0;
   };
@@ -130,6 +132,9 @@ class System {
   virtual Status make(Local**) = 0;
   virtual Status handleSegFault(SignalHandler* handler) = 0;
   virtual Status handleDivideByZero(SignalHandler* handler) = 0;
+  virtual Status handlePollFault(SignalHandler* handler) = 0;
+  virtual void* pollPage() = 0;
+  virtual void armPollPage(bool armed) = 0;
   virtual Status visit(Thread* thread, Thread* target,
                        ThreadVisitor* visitor) = 0;
   virtual uint64_t call(void* function, uintptr_t* arguments, uint8_t* types,
@@ -137,6 +142,8 @@ class System {
                         unsigned returnType) = 0;
   virtual Status map(Region**, const char* name) = 0;
   virtual FileType stat(const char* name, unsigned* length) = 0;
+  // milliseconds since the epoch, or zero if the file does not exist
+  virtual int64_t lastModified(const char* name) = 0;
   virtual Status open(Directory**, const char* name) = 0;
   virtual const char* libraryPrefix() = 0;
   virtual const char* librarySuffix() = 0;
@@ -16,42 +16,52 @@
 #  if (TARGET_BYTES_PER_WORD == 8)
 
 #define TARGET_THREAD_EXCEPTION 80
-#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2256
-#define TARGET_THREAD_EXCEPTIONOFFSET 2264
-#define TARGET_THREAD_EXCEPTIONHANDLER 2272
+#define TARGET_THREAD_HEAPINDEX 88
+#define TARGET_THREAD_HEAP 152
+#define TARGET_THREAD_HEAPSIZE 2220
+#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2264
+#define TARGET_THREAD_EXCEPTIONOFFSET 2272
+#define TARGET_THREAD_EXCEPTIONHANDLER 2280
 
-#define TARGET_THREAD_IP 2216
-#define TARGET_THREAD_STACK 2224
-#define TARGET_THREAD_NEWSTACK 2232
-#define TARGET_THREAD_SCRATCH 2240
-#define TARGET_THREAD_CONTINUATION 2248
-#define TARGET_THREAD_TAILADDRESS 2280
-#define TARGET_THREAD_VIRTUALCALLTARGET 2288
-#define TARGET_THREAD_VIRTUALCALLINDEX 2296
-#define TARGET_THREAD_HEAPIMAGE 2304
-#define TARGET_THREAD_CODEIMAGE 2312
-#define TARGET_THREAD_THUNKTABLE 2320
-#define TARGET_THREAD_STACKLIMIT 2368
+#define TARGET_THREAD_IP 2224
+#define TARGET_THREAD_STACK 2232
+#define TARGET_THREAD_NEWSTACK 2240
+#define TARGET_THREAD_SCRATCH 2248
+#define TARGET_THREAD_CONTINUATION 2256
+#define TARGET_THREAD_TAILADDRESS 2288
+#define TARGET_THREAD_VIRTUALCALLTARGET 2296
+#define TARGET_THREAD_VIRTUALCALLINDEX 2304
+#define TARGET_THREAD_HEAPIMAGE 2312
+#define TARGET_THREAD_CODEIMAGE 2320
+#define TARGET_THREAD_THUNKTABLE 2328
+#define TARGET_THREAD_STACKLIMIT 2376
+#define TARGET_THREAD_CARDTABLE 2384
+#define TARGET_THREAD_POLLPAGE 2392
 
 #  elif (TARGET_BYTES_PER_WORD == 4)
 
 #define TARGET_THREAD_EXCEPTION 44
-#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2164
-#define TARGET_THREAD_EXCEPTIONOFFSET 2168
-#define TARGET_THREAD_EXCEPTIONHANDLER 2172
+#define TARGET_THREAD_HEAPINDEX 48
+#define TARGET_THREAD_HEAP 84
+#define TARGET_THREAD_HEAPSIZE 2148
+#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2172
+#define TARGET_THREAD_EXCEPTIONOFFSET 2176
+#define TARGET_THREAD_EXCEPTIONHANDLER 2180
 
-#define TARGET_THREAD_IP 2144
-#define TARGET_THREAD_STACK 2148
-#define TARGET_THREAD_NEWSTACK 2152
-#define TARGET_THREAD_SCRATCH 2156
-#define TARGET_THREAD_CONTINUATION 2160
-#define TARGET_THREAD_TAILADDRESS 2176
-#define TARGET_THREAD_VIRTUALCALLTARGET 2180
-#define TARGET_THREAD_VIRTUALCALLINDEX 2184
-#define TARGET_THREAD_HEAPIMAGE 2188
-#define TARGET_THREAD_CODEIMAGE 2192
-#define TARGET_THREAD_THUNKTABLE 2196
-#define TARGET_THREAD_STACKLIMIT 2220
+#define TARGET_THREAD_IP 2152
+#define TARGET_THREAD_STACK 2156
+#define TARGET_THREAD_NEWSTACK 2160
+#define TARGET_THREAD_SCRATCH 2164
+#define TARGET_THREAD_CONTINUATION 2168
+#define TARGET_THREAD_TAILADDRESS 2184
+#define TARGET_THREAD_VIRTUALCALLTARGET 2188
+#define TARGET_THREAD_VIRTUALCALLINDEX 2192
+#define TARGET_THREAD_HEAPIMAGE 2196
+#define TARGET_THREAD_CODEIMAGE 2200
+#define TARGET_THREAD_THUNKTABLE 2204
+#define TARGET_THREAD_STACKLIMIT 2228
+#define TARGET_THREAD_CARDTABLE 2232
+#define TARGET_THREAD_POLLPAGE 2236
 
 #  else
 #    error
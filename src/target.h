@@ -127,8 +127,10 @@ const unsigned TargetBytesPerWord = TARGET_BYTES_PER_WORD;
 
 const unsigned TargetBitsPerWord = TargetBytesPerWord * 8;
 
+// see PointerMask in common.h:
 const target_uintptr_t TargetPointerMask
-= ((~static_cast<target_uintptr_t>(0)) / TargetBytesPerWord)
+= (((~static_cast<target_uintptr_t>(0))
+    >> (TargetBytesPerWord == 8 ? 16 : 0)) / TargetBytesPerWord)
   * TargetBytesPerWord;
 
 const unsigned TargetArrayLength = TargetBytesPerWord;
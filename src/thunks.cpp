@@ -40,11 +40,9 @@ THUNK(intToDouble)
 THUNK(intToFloat)
 THUNK(longToDouble)
 THUNK(longToFloat)
-THUNK(makeBlankObjectArray)
 THUNK(makeBlankObjectArrayFromReference)
-THUNK(makeBlankArray)
+THUNK(makeBlankArrayOfClass)
 THUNK(lookUpAddress)
-THUNK(setMaybeNull)
 THUNK(acquireMonitorForObject)
 THUNK(acquireMonitorForObjectOnEntrance)
 THUNK(releaseMonitorForObject)
@@ -66,7 +64,33 @@ THUNK(instanceOfFromReference)
 THUNK(makeNewGeneral64)
 THUNK(makeNew64)
 THUNK(makeNewFromReference)
-THUNK(set)
 THUNK(getJClass64)
 THUNK(getJClassFromReference)
+THUNK(arrayCopy)
+THUNK(arrayFill32)
+THUNK(arrayFill64)
+THUNK(stringEqual64)
+THUNK(stringHash64)
+THUNK(stringIndexOf64)
+THUNK(stringCharAt64)
+THUNK(getClass64)
+THUNK(currentThread64)
+THUNK(minimumLong)
+THUNK(maximumLong)
+THUNK(moveIntBits)
+THUNK(moveLongBits)
+THUNK(bitCountInt)
+THUNK(bitCountLong)
+THUNK(leadingZerosInt)
+THUNK(leadingZerosLong)
+THUNK(trailingZerosInt)
+THUNK(trailingZerosLong)
+THUNK(reverseBytesInt)
+THUNK(reverseBytesLong)
+THUNK(compareAndSwapInt)
+THUNK(compareAndSwapLong)
+THUNK(getAndAddInt)
+THUNK(getAndAddLong)
+THUNK(getAndSetInt)
+THUNK(getAndSetLong)
 THUNK(gcIfNecessary)
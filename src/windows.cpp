@@ -71,6 +71,7 @@ const bool Verbose = false;
 
 const unsigned Waiting = 1 << 0;
 const unsigned Notified = 1 << 1;
+const unsigned Unparked = 1 << 2;
 
 class MySystem: public System {
  public:
@@ -110,6 +111,50 @@ class MySystem: public System {
       return interrupted;
     }
 
+    virtual void park(int64_t time) {
+      ACQUIRE(s, mutex);
+
+      if ((flags & Unparked) == 0 and not r->interrupted()) {
+        flags |= Waiting;
+
+        bool success UNUSED = ResetEvent(event);
+        assert(s, success);
+
+        success = ReleaseMutex(mutex);
+        assert(s, success);
+
+        // WaitForSingleObject only has millisecond resolution, so round
+        // up rather than waking early and spinning
+        int64_t milliseconds = time / (1000 * 1000);
+        if (time % (1000 * 1000)) {
+          ++ milliseconds;
+        }
+
+        int r UNUSED = WaitForSingleObject
+          (event, (time and milliseconds < INFINITE)
+           ? static_cast<DWORD>(milliseconds) : INFINITE);
+        assert(s, r == WAIT_OBJECT_0 or r == WAIT_TIMEOUT);
+
+        r = WaitForSingleObject(mutex, INFINITE);
+        assert(s, r == WAIT_OBJECT_0);
+
+        flags &= ~Waiting;
+      }
+
+      flags &= ~Unparked;
+    }
+
+    virtual void unpark() {
+      ACQUIRE(s, mutex);
+
+      flags |= Unparked;
+
+      if (flags & Waiting) {
+        int r UNUSED = SetEvent(event);
+        assert(s, r != 0);
+      }
+    }
+
     virtual void join() {
       int r UNUSED = WaitForSingleObject(thread, INFINITE);
       assert(s, r == WAIT_OBJECT_0);
@@ -326,7 +371,7 @@ class MySystem: public System {
         assert(s, r == WAIT_OBJECT_0);
 
         { ACQUIRE(s, t->mutex);
-          t->flags = 0;
+          t->flags &= ~(Waiting | Notified);
         }
 
         if (not notified) {
@@ -674,6 +719,16 @@ class MySystem: public System {
     return registerHandler(handler, DivideByZeroIndex);
   }
 
+  virtual Status handlePollFault(SignalHandler*) {
+    return 1;
+  }
+
+  virtual void* pollPage() {
+    return 0;
+  }
+
+  virtual void armPollPage(bool) { }
+
   virtual Status visit(System::Thread* st UNUSED, System::Thread* sTarget,
                        ThreadVisitor* visitor)
   {
@@ -769,9 +824,23 @@ class MySystem: public System {
   }
 
   virtual FileType stat(const char* name, unsigned* length) {
+    int64_t time;
+    return stat(name, length, &time);
+  }
+
+  virtual int64_t lastModified(const char* name) {
+    unsigned length;
+    int64_t time;
+    stat(name, &length, &time);
+    return time;
+  }
+
+  FileType stat(const char* name, unsigned* length, int64_t* lastModified) {
     struct _stat s;
     int r = _stat(name, &s);
     if (r == 0) {
+      *lastModified = static_cast<int64_t>(s.st_mtime) * 1000;
+
       if (S_ISREG(s.st_mode)) {
         *length = s.st_size;
         return TypeFile;
@@ -784,6 +853,7 @@ class MySystem: public System {
       }
     } else {
       *length = 0;
+      *lastModified = 0;
       return TypeDoesNotExist;
     }
   }
@@ -463,6 +463,20 @@ useSSE(ArchitectureContext* c)
   }
 }
 
+bool
+usePopulationCount(ArchitectureContext* c)
+{
+  if (c->useNativeFeatures) {
+    static int supported = -1;
+    if (supported == -1) {
+      supported = detectFeature(0x800000, 0); // POPCNT
+    }
+    return supported;
+  } else {
+    return false;
+  }
+}
+
 #define REX_W 0x48
 #define REX_R 0x44
 #define REX_X 0x42
@@ -1336,10 +1350,10 @@ moveZMR(Context* c, unsigned aSize UNUSED, Assembler::Memory* a,
         unsigned bSize UNUSED, Assembler::Register* b)
 {
   assert(c, bSize == TargetBytesPerWord);
-  assert(c, aSize == 2);
+  assert(c, aSize == 1 or aSize == 2);
   
   maybeRex(c, bSize, b, a);
-  opcode(c, 0x0f, 0xb7);
+  opcode(c, 0x0f, aSize == 1 ? 0xb6 : 0xb7);
   modrmSibImm(c, b->low, a->scale, a->index, a->base, a->offset);
 }
 
@@ -2528,6 +2542,83 @@ absoluteRR(Context* c, unsigned aSize, Assembler::Register* a,
   c->client->releaseTemporary(rdx);
 }
 
+void
+reverseBytesRR(Context* c, unsigned aSize, Assembler::Register* a,
+               unsigned bSize, Assembler::Register* b)
+{
+  assert(c, aSize == bSize and aSize <= TargetBytesPerWord);
+
+  if (a->low != b->low) {
+    moveRR(c, aSize, a, bSize, b);
+  }
+
+  maybeRex(c, bSize, b);
+  opcode(c, 0x0f, 0xc8 + regCode(b)); // bswap
+}
+
+void
+bitCountRR(Context* c, unsigned aSize, Assembler::Register* a,
+           unsigned bSize UNUSED, Assembler::Register* b)
+{
+  assert(c, aSize <= TargetBytesPerWord and bSize == 4);
+
+  opcode(c, 0xf3);
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, 0xb8); // popcnt
+  modrm(c, 0xc0, a, b);
+}
+
+// Emits a bit scan of a into b which leaves the zero flag set if a is
+// zero, followed by a move of the given constant into b for that
+// case, since the scan leaves b undefined then.
+void
+bitScanRR(Context* c, uint8_t op, unsigned aSize, Assembler::Register* a,
+          Assembler::Register* b, int64_t ifZero)
+{
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, op);
+  modrm(c, 0xc0, a, b);
+
+  opcode(c, 0x75); // jnz
+  unsigned next = c->code.length();
+  c->code.append(0);
+
+  ResolvedPromise valuePromise(ifZero);
+  Assembler::Constant value(&valuePromise);
+  moveCR(c, 4, &value, 4, b);
+
+  int8_t nextOffset = c->code.length() - next - 1;
+  c->code.set(next, &nextOffset, 1);
+}
+
+void
+leadingZerosRR(Context* c, unsigned aSize, Assembler::Register* a,
+               unsigned bSize UNUSED, Assembler::Register* b)
+{
+  assert(c, aSize <= TargetBytesPerWord and bSize == 4);
+
+  // bsr yields the index of the highest set bit, so the count is
+  // (bits - 1) - index, which also gives bits when a is zero if we
+  // substitute -1 for the index
+  bitScanRR(c, 0xbd, aSize, a, b, -1);
+
+  negateR(c, 4, b);
+
+  ResolvedPromise highestPromise(aSize * 8 - 1);
+  Assembler::Constant highest(&highestPromise);
+  addCR(c, 4, &highest, 4, b);
+}
+
+void
+trailingZerosRR(Context* c, unsigned aSize, Assembler::Register* a,
+                unsigned bSize UNUSED, Assembler::Register* b)
+{
+  assert(c, aSize <= TargetBytesPerWord and bSize == 4);
+
+  // bsf yields the index of the lowest set bit, which is the count
+  bitScanRR(c, 0xbc, aSize, a, b, aSize * 8);
+}
+
 unsigned
 argumentFootprint(unsigned footprint)
 {
@@ -2730,6 +2821,17 @@ populateTables(ArchitectureContext* c)
   bo[index(c, Absolute, R, R)] = CAST2(absoluteRR);
   bo[index(c, FloatAbsolute, R, R)] = CAST2(floatAbsoluteRR);
 
+  bo[index(c, Float2Bits, R, R)] = CAST2(moveRR);
+  bo[index(c, Float2Bits, M, R)] = CAST2(moveMR);
+
+  bo[index(c, Bits2Float, R, R)] = CAST2(moveRR);
+  bo[index(c, Bits2Float, M, R)] = CAST2(moveMR);
+
+  bo[index(c, ReverseBytes, R, R)] = CAST2(reverseBytesRR);
+  bo[index(c, BitCount, R, R)] = CAST2(bitCountRR);
+  bo[index(c, LeadingZeros, R, R)] = CAST2(leadingZerosRR);
+  bo[index(c, TrailingZeros, R, R)] = CAST2(trailingZerosRR);
+
   bro[branchIndex(c, R, R)] = CAST_BRANCH(branchRR);
   bro[branchIndex(c, C, R)] = CAST_BRANCH(branchCR);
   bro[branchIndex(c, C, M)] = CAST_BRANCH(branchCM);
@@ -2992,10 +3094,16 @@ class MyArchitecture: public Assembler::Architecture {
     case FloatAbsolute:
     case FloatNegate:
     case FloatSquareRoot:
+    case Float2Bits:
+    case Bits2Float:
+    case BitCount:
+    case LeadingZeros:
+    case TrailingZeros:
       return false;
 
     case Negate:
     case Absolute:
+    case ReverseBytes:
       return true;
 
     default:
@@ -3117,6 +3225,36 @@ class MyArchitecture: public Assembler::Architecture {
       }
       break;
 
+    case Float2Bits:
+    case Bits2Float:
+      // a plain move, from whichever register class the value is in to
+      // the other one
+      if (useSSE(&c) and aSize <= TargetBytesPerWord) {
+        *aTypeMask = (1 << RegisterOperand) | (1 << MemoryOperand);
+        *aRegisterMask = ~static_cast<uint64_t>(0);
+      } else {
+        *thunk = true;
+      }
+      break;
+
+    case ReverseBytes:
+    case LeadingZeros:
+    case TrailingZeros:
+      if (aSize <= TargetBytesPerWord) {
+        *aTypeMask = (1 << RegisterOperand);
+      } else {
+        *thunk = true;
+      }
+      break;
+
+    case BitCount:
+      if (usePopulationCount(&c) and aSize <= TargetBytesPerWord) {
+        *aTypeMask = (1 << RegisterOperand);
+      } else {
+        *thunk = true;
+      }
+      break;
+
     case Move:
       *aTypeMask = ~0;
       *aRegisterMask = ~static_cast<uint64_t>(0);
@@ -3176,7 +3314,22 @@ class MyArchitecture: public Assembler::Architecture {
       break;
 
     case Float2Int:
+    case Float2Bits:
+    case BitCount:
+    case LeadingZeros:
+    case TrailingZeros:
+      *bTypeMask = (1 << RegisterOperand);
+      break;
+
+    case Bits2Float:
       *bTypeMask = (1 << RegisterOperand);
+      *bRegisterMask = (static_cast<uint64_t>(FloatRegisterMask) << 32)
+        | FloatRegisterMask;
+      break;
+
+    case ReverseBytes:
+      *bTypeMask = (1 << RegisterOperand);
+      *bRegisterMask = aRegisterMask;
       break;
 
     case Move:
@@ -3384,6 +3537,27 @@ class MyArchitecture: public Assembler::Architecture {
     }
   }
 
+  virtual void plan
+  (AtomicOperation op, unsigned size, uint64_t* addressRegisterMask,
+   uint64_t* valueRegisterMask, uint64_t* expectRegisterMask, bool* thunk)
+  {
+    // cmpxchg8b would be needed for 64-bit operands on x86_32, and it
+    // wants four fixed registers, so we leave those to a thunk:
+    *thunk = size > TargetBytesPerWord;
+
+    uint64_t mask = GeneralRegisterMask;
+    if (op == AtomicCompareAndSwap) {
+      // cmpxchg compares with and loads into rax:
+      mask &= ~(static_cast<uint64_t>(1) << rax);
+      *expectRegisterMask = static_cast<uint64_t>(1) << rax;
+    } else {
+      *expectRegisterMask = 0;
+    }
+
+    *addressRegisterMask = mask;
+    *valueRegisterMask = mask;
+  }
+
   virtual void acquire() {
     ++ referenceCount;
   }
@@ -3658,6 +3832,47 @@ class MyAssembler: public Assembler {
     }
   }
 
+  virtual void apply(AtomicOperation op, unsigned size, Memory* location,
+                     Register* value, Register* expect UNUSED)
+  {
+    assert(&c, size == 4 or size == TargetBytesPerWord);
+
+    switch (op) {
+    case AtomicAdd:
+      // lock xadd
+      opcode(&c, 0xf0);
+      maybeRex(&c, size, value, location);
+      opcode(&c, 0x0f, 0xc1);
+      modrmSibImm(&c, value, location);
+      break;
+
+    case AtomicExchange:
+      // xchg, which locks implicitly when given a memory operand
+      maybeRex(&c, size, value, location);
+      opcode(&c, 0x87);
+      modrmSibImm(&c, value, location);
+      break;
+
+    case AtomicCompareAndSwap:
+      assert(&c, expect->low == rax);
+
+      // lock cmpxchg
+      opcode(&c, 0xf0);
+      maybeRex(&c, size, value, location);
+      opcode(&c, 0x0f, 0xb1);
+      modrmSibImm(&c, value, location);
+
+      // setz %al; movzbl %al, %eax
+      opcode(&c, 0x0f, 0x94);
+      modrm(&c, 0xc0, rax, 0);
+      opcode(&c, 0x0f, 0xb6);
+      modrm(&c, 0xc0, rax, rax);
+      break;
+
+    default: abort(&c);
+    }
+  }
+
   virtual void setDestination(uint8_t* dst) {
     c.result = dst;
   }
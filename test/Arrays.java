@@ -94,5 +94,152 @@ public class Arrays {
       java.util.Arrays.hashCode(a);
       java.util.Arrays.hashCode((Object[])null);
     }
+
+    { int size = -1;
+      Exception exception = null;
+      try {
+        int[] array = new int[size];
+      } catch (NegativeArraySizeException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+
+      exception = null;
+      try {
+        String[] array = new String[size];
+      } catch (NegativeArraySizeException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+    }
+
+    // allocate enough to cross several thread-local heap blocks and
+    // make sure every array comes back zeroed and correctly typed
+    for (int i = 0; i < 64 * 1024; ++i) {
+      int length = i % 37;
+      long[] longs = new long[length];
+      byte[] bytes = new byte[length];
+      String[] strings = new String[length];
+
+      expect(longs.length == length);
+      expect(bytes.length == length);
+      expect(strings.length == length);
+
+      for (int j = 0; j < length; ++j) {
+        expect(longs[j] == 0);
+        expect(bytes[j] == 0);
+        expect(strings[j] == null);
+        longs[j] = -1;
+        bytes[j] = -1;
+        strings[j] = "x";
+      }
+
+      expect(longs.getClass() == long[].class);
+      expect(strings.getClass() == String[].class);
+    }
+
+    { byte[] array = new byte[128 * 1024];
+      expect(array.length == 128 * 1024);
+      expect(array[128 * 1024 - 1] == 0);
+    }
+
+    // counted loops, where the compiler may omit bounds checks
+    { int[] array = new int[100];
+      for (int i = 0; i < array.length; ++i) {
+        array[i] = i;
+      }
+
+      for (int i = 0; i < array.length; ++i) {
+        array[i] += array[i];
+      }
+
+      expect(sum(array) == 99 * 100);
+      expect(sum(new int[0]) == 0);
+    }
+
+    // ...but not where the index may leave the bounds
+    { int[] array = new int[4];
+      Exception exception = null;
+      try {
+        for (int i = 0; i < array.length; ++i) {
+          array[i + 1] = i;
+        }
+      } catch (ArrayIndexOutOfBoundsException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+      expect(array[3] == 2);
+    }
+
+    { int[] array = new int[4];
+      Exception exception = null;
+      try {
+        for (int i = 0; i < array.length; ++i) {
+          if (i == 2) {
+            i = -1;
+            array[i] = 1;
+          }
+        }
+      } catch (ArrayIndexOutOfBoundsException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+    }
+
+    { byte[] bytes = new byte[9];
+      java.util.Arrays.fill(bytes, (byte) -3);
+      expect(bytes[0] == -3 && bytes[8] == -3);
+
+      boolean[] booleans = new boolean[3];
+      java.util.Arrays.fill(booleans, true);
+      expect(booleans[0] && booleans[2]);
+
+      short[] shorts = new short[5];
+      java.util.Arrays.fill(shorts, (short) -300);
+      expect(shorts[0] == -300 && shorts[4] == -300);
+
+      char[] chars = new char[17];
+      java.util.Arrays.fill(chars, '\uffff');
+      expect(chars[0] == '\uffff' && chars[16] == '\uffff');
+
+      int[] ints = new int[33];
+      java.util.Arrays.fill(ints, 0x12345678);
+      expect(ints[0] == 0x12345678 && ints[32] == 0x12345678);
+
+      long[] longs = new long[7];
+      java.util.Arrays.fill(longs, Long.MIN_VALUE + 1);
+      expect(longs[0] == Long.MIN_VALUE + 1 && longs[6] == Long.MIN_VALUE + 1);
+
+      float[] floats = new float[6];
+      java.util.Arrays.fill(floats, -1.5f);
+      expect(floats[0] == -1.5f && floats[5] == -1.5f);
+
+      double[] doubles = new double[4];
+      java.util.Arrays.fill(doubles, 0.25);
+      expect(doubles[0] == 0.25 && doubles[3] == 0.25);
+
+      java.util.Arrays.fill(new int[0], 1);
+
+      Exception exception = null;
+      try {
+        java.util.Arrays.fill((long[]) null, 1L);
+      } catch (NullPointerException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+    }
+  }
+
+  private static int sum(int[] array) {
+    int sum = 0;
+    for (int i = 0; i < array.length; ++i) {
+      sum += array[i];
+    }
+    return sum;
   }
 }
@@ -0,0 +1,204 @@
+public class ConcurrentCompile {
+  private static final int ThreadCount = 16;
+
+  private static final Object lock = new Object();
+  private static int ready;
+  private static boolean go;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private interface Cold {
+    public int call(int method, int x);
+  }
+
+  // The two implementations below are identical, but each is loaded
+  // fresh by the run which uses it, so every first call is to code
+  // which has not been compiled yet.  The serial run compiles the
+  // methods of one class on a single thread, giving a baseline for the
+  // concurrent run, in which all the workers compile at the same time.
+
+  private static class SerialCold implements Cold {
+    static int m0(int x) { return x + 1; }
+    static int m1(int x) { return (x * 3) + 1; }
+    static int m2(int x) { return x ^ 0x55; }
+    static int m3(int x) { return x < 0 ? -x : x; }
+    static int m4(int x) { int s = 0; for (int i = 0; i < x; ++i) s += i; return s; }
+    static int m5(int x) { return Integer.toString(x).length(); }
+    static int m6(int x) { return new int[x + 1].length; }
+    static int m7(int x) { return (int) ((long) x * 1000003L % 65521L); }
+    static int m8(int x) { return x << 2; }
+    static int m9(int x) { return x >>> 1; }
+    static int m10(int x) { return Math.max(x, 7); }
+    static int m11(int x) { return Math.min(x, 7); }
+    static int m12(int x) { return (int) (x * 0.5); }
+    static int m13(int x) { return String.valueOf(x).hashCode(); }
+    static int m14(int x) { return x % 5; }
+    static int m15(int x) { return x / 3; }
+
+    public int call(int method, int x) {
+      switch (method) {
+      case 0: return m0(x);
+      case 1: return m1(x);
+      case 2: return m2(x);
+      case 3: return m3(x);
+      case 4: return m4(x);
+      case 5: return m5(x);
+      case 6: return m6(x);
+      case 7: return m7(x);
+      case 8: return m8(x);
+      case 9: return m9(x);
+      case 10: return m10(x);
+      case 11: return m11(x);
+      case 12: return m12(x);
+      case 13: return m13(x);
+      case 14: return m14(x);
+      case 15: return m15(x);
+      default: throw new IllegalArgumentException();
+      }
+    }
+  }
+
+  private static class ConcurrentCold implements Cold {
+    static int m0(int x) { return x + 1; }
+    static int m1(int x) { return (x * 3) + 1; }
+    static int m2(int x) { return x ^ 0x55; }
+    static int m3(int x) { return x < 0 ? -x : x; }
+    static int m4(int x) { int s = 0; for (int i = 0; i < x; ++i) s += i; return s; }
+    static int m5(int x) { return Integer.toString(x).length(); }
+    static int m6(int x) { return new int[x + 1].length; }
+    static int m7(int x) { return (int) ((long) x * 1000003L % 65521L); }
+    static int m8(int x) { return x << 2; }
+    static int m9(int x) { return x >>> 1; }
+    static int m10(int x) { return Math.max(x, 7); }
+    static int m11(int x) { return Math.min(x, 7); }
+    static int m12(int x) { return (int) (x * 0.5); }
+    static int m13(int x) { return String.valueOf(x).hashCode(); }
+    static int m14(int x) { return x % 5; }
+    static int m15(int x) { return x / 3; }
+
+    public int call(int method, int x) {
+      switch (method) {
+      case 0: return m0(x);
+      case 1: return m1(x);
+      case 2: return m2(x);
+      case 3: return m3(x);
+      case 4: return m4(x);
+      case 5: return m5(x);
+      case 6: return m6(x);
+      case 7: return m7(x);
+      case 8: return m8(x);
+      case 9: return m9(x);
+      case 10: return m10(x);
+      case 11: return m11(x);
+      case 12: return m12(x);
+      case 13: return m13(x);
+      case 14: return m14(x);
+      case 15: return m15(x);
+      default: throw new IllegalArgumentException();
+      }
+    }
+  }
+
+  private static int expected(int method, int x) {
+    switch (method) {
+    case 0: return x + 1;
+    case 1: return (x * 3) + 1;
+    case 2: return x ^ 0x55;
+    case 3: return x < 0 ? -x : x;
+    case 4: return (x * (x - 1)) / 2;
+    case 5: return Integer.toString(x).length();
+    case 6: return x + 1;
+    case 7: return (int) ((long) x * 1000003L % 65521L);
+    case 8: return x << 2;
+    case 9: return x >>> 1;
+    case 10: return x > 7 ? x : 7;
+    case 11: return x < 7 ? x : 7;
+    case 12: return (int) (x * 0.5);
+    case 13: return String.valueOf(x).hashCode();
+    case 14: return x % 5;
+    case 15: return x / 3;
+    default: throw new IllegalArgumentException();
+    }
+  }
+
+  private static class Worker implements Runnable {
+    private final Cold cold;
+    private final int offset;
+    private boolean failed = true;
+
+    Worker(Cold cold, int offset) {
+      this.cold = cold;
+      this.offset = offset;
+    }
+
+    public void run() {
+      synchronized (lock) {
+        ++ ready;
+        lock.notifyAll();
+
+        try {
+          while (! go) {
+            lock.wait();
+          }
+        } catch (InterruptedException e) {
+          return;
+        }
+      }
+
+      // visit the methods in a different order in each thread so that
+      // they race to compile different methods as well as the same ones
+      for (int i = 0; i < 16; ++i) {
+        int method = (i + offset) % 16;
+        int x = offset + i;
+        if (cold.call(method, x) != expected(method, x)) {
+          return;
+        }
+      }
+
+      failed = false;
+    }
+  }
+
+  private static long run(Cold cold, int threadCount) throws Exception {
+    ready = 0;
+    go = false;
+
+    Worker[] workers = new Worker[threadCount];
+    Thread[] threads = new Thread[threadCount];
+    for (int i = 0; i < threadCount; ++i) {
+      workers[i] = new Worker(cold, i);
+      threads[i] = new Thread(workers[i]);
+      threads[i].start();
+    }
+
+    long start;
+    synchronized (lock) {
+      // release the workers all at once
+      while (ready < threadCount) {
+        lock.wait();
+      }
+
+      start = System.currentTimeMillis();
+      go = true;
+      lock.notifyAll();
+    }
+
+    for (int i = 0; i < threadCount; ++i) {
+      threads[i].join();
+      expect(! workers[i].failed);
+    }
+
+    return System.currentTimeMillis() - start;
+  }
+
+  public static void main(String[] args) throws Exception {
+    long serial = run(new SerialCold(), 1);
+    long concurrent = run(new ConcurrentCold(), ThreadCount);
+
+    System.out.println
+      ("compiled and ran 16 cold methods: 1 thread in " + serial
+       + " ms, " + ThreadCount + " threads in " + concurrent + " ms");
+  }
+}
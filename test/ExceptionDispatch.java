@@ -0,0 +1,102 @@
+public class ExceptionDispatch {
+  private static final int Iterations = 100000;
+
+  private static final RuntimeException preallocated = new RuntimeException();
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class A extends RuntimeException { }
+
+  private static class B extends A { }
+
+  private static class C extends RuntimeException { }
+
+  private static void throwIt(RuntimeException e) {
+    throw e;
+  }
+
+  private static int classify(RuntimeException e) {
+    // one throw site, several exception classes, and handlers in this
+    // frame and the next one up
+    try {
+      try {
+        throwIt(e);
+      } catch (B b) {
+        return 2;
+      } catch (A a) {
+        return 1;
+      }
+    } catch (C c) {
+      return 3;
+    }
+    return 0;
+  }
+
+  private static int dispatch(RuntimeException e) {
+    try {
+      return classify(e);
+    } catch (RuntimeException r) {
+      return 4;
+    }
+  }
+
+  private static int sameFrame(int i) {
+    try {
+      throw preallocated;
+    } catch (RuntimeException e) {
+      return i + 1;
+    }
+  }
+
+  private static int nearbyFrame(int i) {
+    try {
+      throwIt(preallocated);
+    } catch (RuntimeException e) {
+      return i + 1;
+    }
+    return i;
+  }
+
+  private static void testDispatch() {
+    RuntimeException[] exceptions = new RuntimeException[] {
+      new A(), new B(), new C(), new RuntimeException()
+    };
+
+    for (int i = 0; i < 1000; ++i) {
+      expect(dispatch(exceptions[0]) == 1);
+      expect(dispatch(exceptions[1]) == 2);
+      expect(dispatch(exceptions[2]) == 3);
+      expect(dispatch(exceptions[3]) == 4);
+
+      // collections move the classes and methods any cached dispatch
+      // decisions refer to
+      if (i % 100 == 0) {
+        System.gc();
+      }
+    }
+  }
+
+  private static void benchmark(String name, int kind) {
+    long start = System.currentTimeMillis();
+
+    int sum = 0;
+    for (int i = 0; i < Iterations; ++i) {
+      sum = kind == 0 ? sameFrame(sum) : nearbyFrame(sum);
+    }
+
+    expect(sum == Iterations);
+
+    System.out.println
+      (name + ": " + Iterations + " throws in "
+       + (System.currentTimeMillis() - start) + " ms");
+  }
+
+  public static void main(String[] args) {
+    testDispatch();
+
+    benchmark("same frame", 0);
+    benchmark("nearby frame", 1);
+  }
+}
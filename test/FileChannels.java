@@ -0,0 +1,105 @@
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+
+public class FileChannels {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static void write(String path, byte[] data) throws IOException {
+    FileOutputStream out = new FileOutputStream(path);
+    FileChannel c = out.getChannel();
+    ByteBuffer b = ByteBuffer.wrap(data);
+    while (b.hasRemaining()) {
+      c.write(b);
+    }
+    expect(c.position() == data.length);
+    expect(c.size() == data.length);
+    c.close();
+    expect(! c.isOpen());
+  }
+
+  private static byte[] read(String path) throws IOException {
+    FileInputStream in = new FileInputStream(path);
+    FileChannel c = in.getChannel();
+    ByteBuffer b = ByteBuffer.allocate((int) c.size());
+    while (b.hasRemaining() && c.read(b) > 0) { }
+    expect(c.read(ByteBuffer.allocate(1)) == -1);
+    c.close();
+    return b.array();
+  }
+
+  public static void main(String[] args) throws IOException {
+    byte[] data = new byte[100 * 1024];
+    for (int i = 0; i < data.length; ++i) {
+      data[i] = (byte) (i * 31);
+    }
+
+    try {
+      write("channel1.bin", data);
+
+      // positional reads leave the channel position alone
+      FileInputStream in = new FileInputStream("channel1.bin");
+      FileChannel c = in.getChannel();
+      ByteBuffer b = ByteBuffer.allocate(4);
+      expect(c.read(b, 1000) == 4);
+      expect(c.position() == 0);
+      for (int i = 0; i < 4; ++i) {
+        expect(b.get(i) == data[1000 + i]);
+      }
+
+      c.position(data.length - 2);
+      b.clear();
+      expect(c.read(b) == 2);
+      expect(c.position() == data.length);
+
+      // mapped reads, including a position which is not page aligned
+      MappedByteBuffer m = c.map
+        (FileChannel.MapMode.READ_ONLY, 12345, data.length - 12345);
+      expect(m.capacity() == data.length - 12345);
+      for (int i = 0; i < m.capacity(); ++i) {
+        expect(m.get(i) == data[12345 + i]);
+      }
+
+      m.position(10);
+      ByteBuffer slice = m.slice();
+      expect(slice.get(0) == data[12355]);
+
+      expect(c.map(FileChannel.MapMode.READ_ONLY, 0, 0).capacity() == 0);
+
+      // file to file transfer, in the kernel where supported
+      FileOutputStream out = new FileOutputStream("channel2.bin");
+      expect(c.transferTo(100, data.length, out.getChannel())
+             == data.length - 100);
+      out.close();
+      c.close();
+
+      byte[] copy = read("channel2.bin");
+      expect(copy.length == data.length - 100);
+      for (int i = 0; i < copy.length; ++i) {
+        expect(copy[i] == data[100 + i]);
+      }
+
+      in = new FileInputStream("channel1.bin");
+      out = new FileOutputStream("channel2.bin");
+      expect(out.getChannel().transferFrom(in.getChannel(), 0, 10) == 10);
+      expect(in.getChannel().position() == 10);
+      in.close();
+      out.close();
+
+      copy = read("channel2.bin");
+      expect(copy.length == 10);
+      for (int i = 0; i < copy.length; ++i) {
+        expect(copy[i] == data[i]);
+      }
+    } finally {
+      new File("channel1.bin").delete();
+      new File("channel2.bin").delete();
+    }
+  }
+}
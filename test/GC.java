@@ -10,12 +10,133 @@ public class GC {
     }
   }
 
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Node {
+    Node next;
+    final int value;
+
+    Node(Node next, int value) {
+      this.next = next;
+      this.value = value;
+    }
+  }
+
+  private static void compaction() {
+    // leave holes between survivors in the old generation so that
+    // major collections slide them down, some with identity hashes
+    // taken before they move
+    Node[] nodes = new Node[16 * 1024];
+    int[] hashes = new int[nodes.length];
+    for (int i = 0; i < nodes.length; ++i) {
+      nodes[i] = new Node(i == 0 ? null : nodes[i - 1], i);
+    }
+
+    System.gc();
+
+    for (int i = 0; i < nodes.length; i += 3) {
+      hashes[i] = System.identityHashCode(nodes[i]);
+    }
+
+    for (int i = 0; i < nodes.length; ++i) {
+      if (i % 2 == 1) {
+        nodes[i] = null;
+      } else if (i > 1) {
+        nodes[i].next = nodes[i - 2];
+      }
+    }
+
+    for (int round = 0; round < 3; ++round) {
+      System.gc();
+      medium();
+    }
+
+    for (int i = 0; i < nodes.length; i += 2) {
+      expect(nodes[i].value == i);
+      expect(i == 0 ? nodes[i].next == null : nodes[i].next == nodes[i - 2]);
+      if (i % 3 == 0) {
+        expect(hashes[i] == System.identityHashCode(nodes[i]));
+      }
+    }
+  }
+
+  private static void barriers() {
+    // references to young objects stored by compiled code in tenured
+    // objects and arrays must survive minor collections
+    Node[] nodes = new Node[64];
+    Object[] array = new Object[nodes.length * 1024];
+    for (int i = 0; i < nodes.length; ++i) {
+      nodes[i] = new Node(null, i);
+    }
+
+    for (int i = 0; i < 5; ++i) {
+      System.gc();
+    }
+
+    for (int round = 0; round < 4; ++round) {
+      for (int i = 0; i < nodes.length; ++i) {
+        nodes[i].next = new Node(null, (round * nodes.length) + i);
+        array[i * 1024] = new Node(null, i);
+      }
+
+      small();
+
+      for (int i = 0; i < nodes.length; ++i) {
+        expect(nodes[i].next.value == (round * nodes.length) + i);
+        expect(((Node) array[i * 1024]).value == i);
+      }
+    }
+  }
+
+  private static int youngGeneration() {
+    String size = System.getProperty("avian.heap.young");
+    return size == null ? 4 * 1024 * 1024 : Integer.parseInt(size);
+  }
+
   private static void small() {
-    for (int i = 0; i < 1024; ++i) {
+    // allocate twice the young generation to be sure we get at least
+    // one minor collection
+    for (int i = 0; i < youngGeneration() / 2048; ++i) {
       byte[] a = new byte[4 * 1024];
     }
   }
 
+  private static void threadHeaps() throws Exception {
+    // several threads allocating at different rates get differently
+    // sized thread-local heaps, none of which may lose objects
+    Thread[] threads = new Thread[4];
+    final boolean[] success = new boolean[threads.length];
+    for (int i = 0; i < threads.length; ++i) {
+      final int index = i;
+      threads[i] = new Thread() {
+          public void run() {
+            Node list = null;
+            for (int j = 0; j < 32 * 1024; ++j) {
+              list = new Node(list, j);
+              for (int k = 0; k < index; ++k) {
+                byte[] garbage = new byte[64 * (k + 1)];
+              }
+            }
+
+            for (int j = 32 * 1024 - 1; j >= 0; --j) {
+              if (list.value != j) return;
+              list = list.next;
+            }
+
+            success[index] = list == null;
+          }
+        };
+      threads[i].start();
+    }
+
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i].join();
+      expect(success[i]);
+    }
+  }
+
   private static void medium() {
     for (int i = 0; i < 8; ++i) {
       Object[] array = new Object[32];
@@ -154,7 +275,7 @@ public class GC {
     }
   }
 
-  public static void main(String[] args) {
+  public static void main(String[] args) throws Exception {
     valueOf(1000);
 
     Object[] array = new Object[1024 * 1024];
@@ -197,6 +318,12 @@ public class GC {
 
     stackMap8(true);
     stackMap8(false);
+
+    compaction();
+
+    barriers();
+
+    threadHeaps();
   }
 
   private static class DummyException extends RuntimeException { }
@@ -0,0 +1,124 @@
+public class Inlining {
+  private static int counter;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Point {
+    private int x;
+    private long y;
+    private Object tag;
+    private final double z;
+
+    Point(int x, long y, double z) {
+      this.x = x;
+      this.y = y;
+      this.z = z;
+    }
+
+    int x() { return x; }
+    long y() { return y; }
+    double z() { return z; }
+    Object tag() { return tag; }
+
+    void setX(int x) { this.x = x; }
+    void setTag(Object tag) { this.tag = tag; }
+
+    final int sum() { return x() + (int) y; }
+    final Point self() { return this; }
+
+    private int shifted(int amount) { return x << amount; }
+
+    private static int constant() { return 42; }
+    private static long bigConstant() { return 1234567890123L; }
+    private static int count() { return counter; }
+    private static void bump(int v) { counter = v; }
+  }
+
+  private static final class Box {
+    private int value;
+
+    Box(int value) {
+      this.value = value;
+    }
+
+    int get() { return value; }
+  }
+
+  private static class Base {
+    int value() { return 1; }
+  }
+
+  private static class Derived extends Base {
+    int value() { return 2; }
+  }
+
+  private static int value(Base b) {
+    return b.value();
+  }
+
+  public static void main(String[] args) {
+    Point p = new Point(3, 4, 5.5);
+    expect(p.x() == 3);
+    expect(p.y() == 4);
+    expect(p.z() == 5.5);
+    expect(p.tag() == null);
+    expect(p.sum() == 7);
+    expect(p.self() == p);
+    expect(p.shifted(2) == 12);
+
+    p.setX(10);
+    expect(p.x() == 10);
+
+    // reference stores made by an inlined setter must be seen by the
+    // collector like any other
+    p.setTag(new Object[] { "tag" });
+    System.gc();
+    expect(((Object[]) p.tag())[0].equals("tag"));
+
+    expect(Point.constant() == 42);
+    expect(Point.bigConstant() == 1234567890123L);
+
+    Point.bump(17);
+    expect(Point.count() == 17);
+
+    expect(new Box(9).get() == 9);
+
+    // calls which may be overridden are still dispatched
+    expect(value(new Base()) == 1);
+    expect(value(new Derived()) == 2);
+
+    // a null receiver must throw at the call site, whether or not
+    // the call is inlined and whether or not we are in a try block
+    Point q = null;
+    try {
+      q.x();
+      expect(false);
+    } catch (NullPointerException e) { }
+
+    try {
+      q.sum();
+      expect(false);
+    } catch (NullPointerException e) { }
+
+    Box b = null;
+    try {
+      b.get();
+      expect(false);
+    } catch (NullPointerException e) { }
+
+    boolean threw = false;
+    try {
+      nullGetter();
+    } catch (NullPointerException e) {
+      threw = true;
+    }
+    expect(threw);
+  }
+
+  private static int nullGetter() {
+    Box b = null;
+    return b.get();
+  }
+}
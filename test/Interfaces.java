@@ -0,0 +1,81 @@
+public class Interfaces {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private interface Shape {
+    int sides();
+  }
+
+  private interface Named {
+    String name();
+  }
+
+  private static class Triangle implements Shape {
+    public int sides() { return 3; }
+  }
+
+  private static class Square implements Named, Shape {
+    public String name() { return "square"; }
+    public int sides() { return 4; }
+  }
+
+  private static class Pentagon implements Shape, Named {
+    public int sides() { return 5; }
+    public String name() { return "pentagon"; }
+  }
+
+  private static class Hexagon implements Shape {
+    public int sides() { return 6; }
+  }
+
+  private static class Heptagon extends Hexagon {
+    public int sides() { return 7; }
+  }
+
+  private static class Octagon extends Heptagon { }
+
+  private static int sides(Shape s) {
+    return s.sides();
+  }
+
+  private static int sum(Shape[] shapes) {
+    int sum = 0;
+    for (int i = 0; i < shapes.length; ++i) {
+      sum += sides(shapes[i]);
+    }
+    return sum;
+  }
+
+  public static void main(String[] args) {
+    // monomorphic
+    for (int i = 0; i < 100; ++i) {
+      expect(sides(new Triangle()) == 3);
+    }
+
+    // polymorphic, then megamorphic, with collections in between to
+    // move the cached classes around
+    Shape[] shapes = new Shape[] {
+      new Triangle(), new Square(), new Pentagon(), new Hexagon(),
+      new Heptagon(), new Octagon()
+    };
+
+    for (int i = 0; i < 100; ++i) {
+      expect(sum(shapes) == 3 + 4 + 5 + 6 + 7 + 7);
+      if (i % 10 == 0) {
+        System.gc();
+      }
+    }
+
+    Named[] names = new Named[] { new Square(), new Pentagon() };
+    for (int i = 0; i < 10; ++i) {
+      expect(names[i % 2].name().equals(i % 2 == 0 ? "square" : "pentagon"));
+    }
+
+    // a null receiver must still throw after the call site is cached
+    try {
+      sides(null);
+      expect(false);
+    } catch (NullPointerException e) { }
+  }
+}
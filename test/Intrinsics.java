@@ -0,0 +1,82 @@
+public class Intrinsics {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  public static void main(String[] args) {
+    expect(Math.min(3, 4) == 3);
+    expect(Math.max(3, 4) == 4);
+    expect(Math.min(-5, 5) == -5);
+    expect(Math.max(Integer.MIN_VALUE, Integer.MAX_VALUE)
+           == Integer.MAX_VALUE);
+    expect(Math.min(Integer.MIN_VALUE, Integer.MAX_VALUE)
+           == Integer.MIN_VALUE);
+    expect(Math.min(Integer.MAX_VALUE, Integer.MIN_VALUE)
+           == Integer.MIN_VALUE);
+    expect(Math.max(7, 7) == 7);
+    expect(Math.min(Long.MIN_VALUE, 0L) == Long.MIN_VALUE);
+    expect(Math.max(Long.MIN_VALUE, Long.MAX_VALUE) == Long.MAX_VALUE);
+    expect(Math.min(Long.MAX_VALUE, -1L) == -1L);
+    expect(Math.max(-1L, Long.MIN_VALUE) == -1L);
+    expect(Math.max(5L, 5L) == 5L);
+
+    { float f = 3.5f;
+      for (int i = 0; i < 4; ++i) {
+        // round trip through the integer registers and back again
+        f = Float.intBitsToFloat(Float.floatToRawIntBits(f)) + 1.0f;
+      }
+      expect(f == 7.5f);
+
+      double d = -0.25;
+      long bits = Double.doubleToRawLongBits(d * 2);
+      expect(bits == 0xbfe0000000000000L);
+      expect(Double.longBitsToDouble(bits + 1) - d * 2 > 0);
+    }
+
+    expect(Float.floatToRawIntBits(1.0f) == 0x3f800000);
+    expect(Float.intBitsToFloat(0x3f800000) == 1.0f);
+    expect(Double.doubleToRawLongBits(-2.0) == 0xc000000000000000L);
+    expect(Double.longBitsToDouble(0x4000000000000000L) == 2.0);
+
+    expect(Integer.bitCount(0) == 0);
+    expect(Integer.bitCount(-1) == 32);
+    expect(Integer.bitCount(0x10203040) == 5);
+    expect(Long.bitCount(-1L) == 64);
+    expect(Long.bitCount(0x8000000000000001L) == 2);
+
+    expect(Integer.numberOfLeadingZeros(0) == 32);
+    expect(Integer.numberOfLeadingZeros(1) == 31);
+    expect(Integer.numberOfLeadingZeros(-1) == 0);
+    expect(Long.numberOfLeadingZeros(0L) == 64);
+    expect(Long.numberOfLeadingZeros(1L << 40) == 23);
+
+    expect(Integer.numberOfTrailingZeros(0) == 32);
+    expect(Integer.numberOfTrailingZeros(8) == 3);
+    expect(Integer.numberOfTrailingZeros(Integer.MIN_VALUE) == 31);
+    expect(Long.numberOfTrailingZeros(0L) == 64);
+    expect(Long.numberOfTrailingZeros(1L << 40) == 40);
+
+    expect(Integer.reverseBytes(0x01020304) == 0x04030201);
+    expect(Integer.reverseBytes(0x80) == 0x80000000);
+    expect(Long.reverseBytes(0x0102030405060708L) == 0x0807060504030201L);
+
+    String s = "hello";
+    expect(s.length() == 5);
+    expect(s.charAt(1) == 'e');
+    expect(s.substring(2).charAt(0) == 'l');
+    try {
+      s.charAt(5);
+      expect(false);
+    } catch (IndexOutOfBoundsException e) { }
+
+    expect(s.getClass() == String.class);
+    expect(new Intrinsics().getClass() == Intrinsics.class);
+    try {
+      ((Object) null).getClass();
+      expect(false);
+    } catch (NullPointerException e) { }
+
+    expect(Thread.currentThread() != null);
+    expect(Thread.currentThread() == Thread.currentThread());
+  }
+}
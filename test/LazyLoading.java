@@ -86,7 +86,11 @@ public class LazyLoading {
     public static void test() {
       doTest();
       loadLazy = true;
-      doTest();
+      // the first pass resolves each reference and later passes reuse
+      // that resolution
+      for (int i = 0; i < 3; ++i) {
+        doTest();
+      }
     }
 
     private static void doTest() {
@@ -110,6 +114,11 @@ public class LazyLoading {
         // invokestatic
         expect(Lazy.staticMethod() == 43);
 
+        // invokestatic with arguments which must be visited by the
+        // collector while the call is resolved
+        Object z = new Object();
+        expect(Lazy.staticMethod(z, 51, "51") == z);
+
         // invokevirtual
         expect(array[0].virtualMethod() == 44);
 
@@ -152,6 +161,8 @@ public class LazyLoading {
         Object y = new Object();
         array[0].objectStaticField = y;
         expect(array[0].objectStaticField == y);
+
+        Lazy.intStaticField = 46;
       }
     }
   }
@@ -177,6 +188,11 @@ public class LazyLoading {
       return 43;
     }
 
+    public static Object staticMethod(Object o, long n, String s) {
+      System.gc();
+      return Long.parseLong(s) == n ? o : null;
+    }
+
     public int virtualMethod() {
       return 44;
     }
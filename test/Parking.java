@@ -0,0 +1,75 @@
+import java.util.concurrent.locks.LockSupport;
+
+public class Parking {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Parker implements Runnable {
+    volatile boolean started;
+    volatile boolean done;
+
+    public void run() {
+      started = true;
+      while (! done) {
+        LockSupport.park();
+      }
+    }
+  }
+
+  private static void join(Thread thread) throws Exception {
+    thread.join();
+  }
+
+  public static void main(String[] args) throws Exception {
+    // a permit made available beforehand is consumed by the next park
+    LockSupport.unpark(Thread.currentThread());
+    LockSupport.park();
+
+    // a timed park returns on its own
+    long start = System.currentTimeMillis();
+    LockSupport.parkNanos(20L * 1000 * 1000);
+    expect(System.currentTimeMillis() - start < 10 * 1000);
+
+    LockSupport.parkUntil(System.currentTimeMillis() + 20);
+    LockSupport.parkUntil(System.currentTimeMillis() - 20);
+    LockSupport.parkNanos(-1);
+
+    // unpark wakes a parked thread
+    { Parker parker = new Parker();
+      Thread thread = new Thread(parker);
+      thread.start();
+
+      while (! parker.started) {
+        Thread.sleep(1);
+      }
+
+      parker.done = true;
+      LockSupport.unpark(thread);
+      join(thread);
+    }
+
+    // and so does interrupt
+    { Parker parker = new Parker();
+      Thread thread = new Thread(parker);
+      thread.start();
+
+      while (! parker.started) {
+        Thread.sleep(1);
+      }
+
+      parker.done = true;
+      thread.interrupt();
+      join(thread);
+    }
+
+    // unparking a thread which has not started or has finished is
+    // harmless
+    LockSupport.unpark(new Thread());
+    { Thread thread = new Thread();
+      thread.start();
+      join(thread);
+      LockSupport.unpark(thread);
+    }
+  }
+}
@@ -0,0 +1,88 @@
+public class Safepoints {
+  private static volatile boolean done;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Node {
+    final Node next;
+    final int value;
+
+    Node(Node next, int value) {
+      this.next = next;
+      this.value = value;
+    }
+  }
+
+  private static int depth(Node node) {
+    return node == null ? 0 : 1 + depth(node.next);
+  }
+
+  private static class Spinner implements Runnable {
+    // bounded so that the test fails, rather than hangs, on a runtime
+    // which can only stop compiled code when it allocates or blocks
+    private static final long Limit = 1L << 30;
+
+    volatile boolean started;
+    long iterations;
+    long sum;
+
+    public void run() {
+      // allocated by this thread so that it starts out in the young
+      // generation and is moved by the collections below while only
+      // the loop's frame refers to it
+      Node node = new Node(new Node(null, 2), 3);
+      started = true;
+
+      long i = 0;
+      long sum = 0;
+      while (! done && i < Limit) {
+        sum += node.value + node.next.value;
+        ++ i;
+      }
+
+      this.iterations = i;
+      this.sum = sum;
+      expect(depth(node) == 2);
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    Spinner[] spinners = new Spinner[2];
+    Thread[] threads = new Thread[spinners.length];
+    for (int i = 0; i < spinners.length; ++i) {
+      spinners[i] = new Spinner();
+      threads[i] = new Thread(spinners[i]);
+      threads[i].start();
+    }
+
+    for (int i = 0; i < spinners.length; ++i) {
+      while (! spinners[i].started) {
+        Thread.sleep(1);
+      }
+    }
+
+    // each of these must wait for the spinners to reach a safepoint
+    // in the middle of their loops
+    for (int i = 0; i < 8; ++i) {
+      Object[] garbage = new Object[1024];
+      for (int j = 0; j < garbage.length; ++j) {
+        garbage[j] = new int[16];
+      }
+      System.gc();
+    }
+
+    done = true;
+
+    for (int i = 0; i < spinners.length; ++i) {
+      threads[i].join();
+      expect(spinners[i].sum == spinners[i].iterations * 5);
+
+      // if the collections above could not stop the spinners, they
+      // will only have finished once the spinners ran out of
+      // iterations, and set done too late to end their loops
+      expect(spinners[i].iterations < Spinner.Limit);
+    }
+  }
+}
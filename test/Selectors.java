@@ -0,0 +1,144 @@
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.net.InetSocketAddress;
+import java.nio.ByteBuffer;
+import java.nio.channels.DatagramChannel;
+import java.nio.channels.Selector;
+import java.nio.channels.SelectionKey;
+import java.util.ArrayList;
+import java.util.List;
+
+public class Selectors {
+  // the usual FD_SETSIZE, beyond which select(2) cannot see descriptors
+  private static final int FdSetSize = 1024;
+
+  private static final int ChannelCount = 16;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  public static void main(String[] args) throws Exception {
+    // only the epoll selector can handle descriptors above FD_SETSIZE
+    boolean pad = System.getProperty("os.name").equals("Linux");
+
+    // push the descriptor numbers of the channels we select on past
+    // FD_SETSIZE, as far as the process's descriptor limit allows
+    List<FileInputStream> padding = new ArrayList<FileInputStream>();
+    if (pad) {
+      try {
+        while (padding.size() < FdSetSize + 64) {
+          padding.add(new FileInputStream("/dev/null"));
+        }
+      } catch (IOException e) {
+        // descriptor limit reached; leave room for the channels below
+        for (int i = 0; i < 64 && ! padding.isEmpty(); ++i) {
+          padding.remove(padding.size() - 1).close();
+        }
+      }
+    }
+
+    try {
+      final int Port = 22143;
+      final byte[] Message = "hello, world!".getBytes();
+
+      DatagramChannel[] in = new DatagramChannel[ChannelCount];
+      SelectionKey[] keys = new SelectionKey[ChannelCount];
+      Selector selector = Selector.open();
+      try {
+        for (int i = 0; i < ChannelCount; ++i) {
+          in[i] = DatagramChannel.open();
+          in[i].configureBlocking(false);
+          in[i].socket().bind(new InetSocketAddress("localhost", Port + i));
+          keys[i] = in[i].register(selector, SelectionKey.OP_READ, null);
+        }
+
+        // nothing has been sent yet, so nothing should be ready
+        expect(selector.selectNow() == 0);
+
+        // send to every other channel and expect exactly those to be
+        // selected
+        DatagramChannel[] out = new DatagramChannel[ChannelCount];
+        try {
+          for (int i = 0; i < ChannelCount; i += 2) {
+            out[i] = DatagramChannel.open();
+            out[i].connect(new InetSocketAddress("localhost", Port + i));
+            out[i].write(ByteBuffer.wrap(Message));
+          }
+
+          int ready = 0;
+          while (ready < ChannelCount / 2) {
+            selector.select(1000);
+            ready = 0;
+            for (int i = 0; i < ChannelCount; ++i) {
+              if (keys[i].isReadable()) {
+                expect(i % 2 == 0);
+                ++ ready;
+              }
+            }
+          }
+
+          for (int i = 0; i < ChannelCount; i += 2) {
+            ByteBuffer buffer = ByteBuffer.allocate(Message.length);
+            in[i].receive(buffer);
+            expect(! buffer.hasRemaining());
+          }
+
+          // everything has been consumed, so nothing should be ready
+          // again until another message arrives
+          expect(selector.selectNow() == 0);
+
+          // wakeup must interrupt a blocking select
+          selector.wakeup();
+          expect(selector.select() == 0);
+
+          // close every channel and open replacements before selecting
+          // again, so the replacements reuse the closed channels'
+          // descriptors while the old keys are still registered
+          for (int i = 0; i < ChannelCount; ++i) {
+            in[i].close();
+          }
+
+          for (int i = 0; i < ChannelCount; ++i) {
+            in[i] = DatagramChannel.open();
+            in[i].configureBlocking(false);
+            in[i].socket().bind(new InetSocketAddress("localhost", Port + i));
+            keys[i] = in[i].register(selector, SelectionKey.OP_READ, null);
+          }
+
+          for (int i = 0; i < ChannelCount; ++i) {
+            if (out[i] == null) {
+              out[i] = DatagramChannel.open();
+              out[i].connect(new InetSocketAddress("localhost", Port + i));
+            }
+            out[i].write(ByteBuffer.wrap(Message));
+          }
+
+          // the messages were queued before we select, so a single
+          // select should see every replacement, however the old and
+          // new keys happen to be ordered
+          expect(selector.select(1000) == ChannelCount);
+          for (int i = 0; i < ChannelCount; ++i) {
+            expect(keys[i].isReadable());
+          }
+        } finally {
+          for (int i = 0; i < ChannelCount; ++i) {
+            if (out[i] != null) out[i].close();
+          }
+        }
+      } finally {
+        selector.close();
+        for (int i = 0; i < ChannelCount; ++i) {
+          if (in[i] != null) in[i].close();
+        }
+      }
+    } finally {
+      for (FileInputStream s: padding) {
+        s.close();
+      }
+    }
+
+    System.out.println
+      ("selected on descriptors above " + padding.size());
+  }
+}
@@ -80,6 +80,14 @@ public class Strings {
            (prematureEOS ? "\u00ae\ufffd" : "\u00ae\uaeaf"));
   }
 
+  private static int charHash(String s) {
+    int h = 0;
+    for (int i = 0; i < s.length(); ++i) {
+      h = (h * 31) + s.charAt(i);
+    }
+    return h;
+  }
+
   public static void main(String[] args) throws Exception {
     expect(new String(new byte[] { 99, 111, 109, 46, 101, 99, 111, 118, 97,
                                    116, 101, 46, 110, 97, 116, 46, 98, 117,
@@ -146,5 +154,38 @@ public class Strings {
         "I", "grape", "nuts", "foobar",
         new Object() { public String toString() { return "you"; } })
        .equals("I enjoy grape nuts.  do you?  you do?"));
+
+    // string literals are backed by byte arrays, while these are
+    // backed by char arrays
+    String bytes = "the quick brown fox";
+    String chars = new String(bytes.toCharArray());
+    expect(bytes.equals(chars));
+    expect(chars.equals(bytes));
+    expect(! bytes.equals(chars.substring(1)));
+    expect(! bytes.equals(null));
+    expect(! bytes.equals(new Object()));
+    expect(bytes.substring(4, 9).equals(chars.substring(4, 9)));
+    expect(bytes.hashCode() == chars.hashCode());
+    expect(bytes.hashCode() == charHash(bytes));
+    expect(chars.hashCode() == charHash(chars));
+    // the VM may make these straight from the raw bytes of C strings,
+    // which can include non-ASCII bytes
+    for (String name: new String[] { "user.home", "java.class.path" }) {
+      String value = System.getProperty(name);
+      expect(value == null || value.hashCode() == charHash(value));
+    }
+    expect("".hashCode() == 0);
+    expect("abcde".hashCode() == 92599395);
+    expect(chars.indexOf('q') == 4);
+    expect(bytes.indexOf('o', 13) == 17);
+    expect(bytes.indexOf('t', -5) == 0);
+    expect(bytes.indexOf('x', 100) == -1);
+    expect(chars.substring(4).indexOf('q') == 0);
+    expect(chars.indexOf('z') == -1);
+    expect("a\ud801\udc00b".indexOf(0x10400) == 1);
+
+    char[] array = "0123456789".toCharArray();
+    System.arraycopy(array, 0, array, 2, 5);
+    expect(new String(array).equals("0101234789"));
   }
 }
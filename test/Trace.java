@@ -80,7 +80,42 @@ public class Trace implements Runnable {
     }
   }
 
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static Exception deep(int depth) {
+    if (depth == 0) {
+      return new Exception();
+    }
+
+    // not a tail call, so that every frame appears in the trace
+    Exception e = deep(depth - 1);
+    expect(e != null);
+    return e;
+  }
+
+  private static void testDeepTrace() {
+    // deeper than the VM records in a single pass, and resolved only
+    // after a collection has had a chance to move the methods
+    Exception e = deep(100);
+    System.gc();
+
+    StackTraceElement[] elements = e.getStackTrace();
+    expect(elements.length > 101);
+    for (int i = 0; i < 101; ++i) {
+      expect(elements[i].getMethodName().equals("deep"));
+      expect(elements[i].getClassName().equals("Trace"));
+    }
+    expect(elements[101].getMethodName().equals("testDeepTrace"));
+
+    // resolving twice must give the same answer
+    expect(e.getStackTrace() == elements);
+  }
+
   public static void main(String[] args) throws Exception {
+    testDeepTrace();
+
     Trace trace = new Trace();
     Thread thread = new Thread(trace);
 
@@ -0,0 +1,46 @@
+package extra;
+
+import java.io.InputStream;
+import java.net.URL;
+
+// Run with a class path listing a directory (the test classes) ahead
+// of a jar which holds test/resources, so that lookups of resources
+// only the jar has must check the directory first and then fall
+// through to the jar.
+public class ClassPath {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static String read(InputStream in) throws Exception {
+    try {
+      StringBuilder sb = new StringBuilder();
+      int c;
+      while ((c = in.read()) != -1) {
+        sb.append((char) c);
+      }
+      return sb.toString();
+    } finally {
+      in.close();
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    // this class comes from the directory...
+    URL self = ClassPath.class.getResource("ClassPath.class");
+    expect(self != null);
+    expect(! self.toString().startsWith("jar:"));
+
+    // ...and this resource from the jar behind it
+    URL url = ClassPath.class.getResource("/resources/jar-only.txt");
+    expect(url != null);
+    expect(url.toString().startsWith("jar:"));
+    expect(url.openConnection().getContentLength()
+           == "found in the jar\n".length());
+    expect(read(url.openStream()).equals("found in the jar\n"));
+
+    expect(ClassPath.class.getResource("/resources/missing.txt") == null);
+
+    System.out.println("found a jar resource behind a directory");
+  }
+}
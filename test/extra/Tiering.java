@@ -0,0 +1,235 @@
+package extra;
+
+// Run with a low avian.jit.invocation.threshold so that each method
+// here is interpreted for its first few calls and compiled after that,
+// and calls cross between interpreted and compiled code in both
+// directions.
+public class Tiering {
+  private static final int Iterations = 200;
+
+  private static final Object lock = new Object();
+  private static int counter;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private interface Shape {
+    long area(int scale);
+  }
+
+  private static class Square implements Shape {
+    private final int side;
+
+    Square(int side) {
+      this.side = side;
+    }
+
+    public long area(int scale) {
+      return (long) side * side * scale;
+    }
+  }
+
+  private static class Rectangle implements Shape {
+    protected final int width;
+    protected final int height;
+
+    Rectangle(int width, int height) {
+      this.width = width;
+      this.height = height;
+    }
+
+    public long area(int scale) {
+      return (long) width * height * scale;
+    }
+  }
+
+  private static class Triangle extends Rectangle {
+    Triangle(int width, int height) {
+      super(width, height);
+    }
+
+    public long area(int scale) {
+      return super.area(scale) / 2;
+    }
+  }
+
+  private static class Failure extends RuntimeException {
+    final int value;
+
+    Failure(int value) {
+      this.value = value;
+    }
+  }
+
+  private static double mix(long a, double b, int c, float d) {
+    return a + b + c + d;
+  }
+
+  private static int fail(int n) {
+    if (n % 3 == 0) {
+      throw new Failure(n);
+    }
+    return n;
+  }
+
+  private static int catchFailure(int n) {
+    try {
+      return fail(n);
+    } catch (Failure e) {
+      return -e.value;
+    } finally {
+      ++ counter;
+    }
+  }
+
+  private static int divide(int a, int b) {
+    try {
+      return a / b;
+    } catch (ArithmeticException e) {
+      return Integer.MIN_VALUE;
+    }
+  }
+
+  private static synchronized int synchronizedStatic(int n) {
+    expect(Thread.holdsLock(Tiering.class));
+    return n + 1;
+  }
+
+  private static int synchronizedBlock(int n) {
+    synchronized (lock) {
+      expect(Thread.holdsLock(lock));
+      if (n % 7 == 0) {
+        throw new Failure(n);
+      }
+      return n;
+    }
+  }
+
+  private static String classify(int n) {
+    switch (n % 4) {
+    case 0: return "zero";
+    case 1: return "one";
+    case 2: return "two";
+    default: return "three";
+    }
+  }
+
+  private static int sparse(int n) {
+    switch (n) {
+    case -1000: return 1;
+    case 7: return 2;
+    case 1000000: return 3;
+    default: return 0;
+    }
+  }
+
+  private static long loop(int n) {
+    long sum = 0;
+    for (int i = 0; i < n; ++i) {
+      sum += i;
+    }
+    return sum;
+  }
+
+  private static int arrays(int n) {
+    byte[] bytes = new byte[] { (byte) -1, (byte) n };
+    char[] chars = new char[] { (char) 0xFFFF };
+    short[] shorts = new short[] { (short) -2 };
+    boolean[] booleans = new boolean[] { true };
+    long[] longs = new long[] { Long.MIN_VALUE };
+    double[] doubles = new double[] { 0.5 };
+    int[][] grid = new int[3][4];
+    grid[2][3] = n;
+
+    expect(bytes[0] == -1);
+    expect(chars[0] == 0xFFFF);
+    expect(shorts[0] == -2);
+    expect(booleans[0]);
+    expect(longs[0] == Long.MIN_VALUE);
+    expect(doubles[0] == 0.5);
+    expect(grid.length == 3 && grid[2].length == 4);
+
+    try {
+      expect(grid[3] == null);
+    } catch (ArrayIndexOutOfBoundsException e) {
+      return grid[2][3] + bytes[1];
+    }
+    return 0;
+  }
+
+  private static void check(int i, Shape[] shapes) {
+    expect(shapes[0].area(i) == 9L * i);
+    expect(shapes[1].area(i) == 6L * i);
+    expect(shapes[2].area(i) == 3L * i);
+
+    expect(mix(Long.MAX_VALUE / 2, 0.25, i, 0.25f)
+           == (Long.MAX_VALUE / 2) + 0.25 + i + 0.25f);
+
+    expect(catchFailure(i) == (i % 3 == 0 ? -i : i));
+
+    expect(divide(i, i % 5) == (i % 5 == 0 ? Integer.MIN_VALUE : i / (i % 5)));
+    expect(divide(Integer.MIN_VALUE, -1) == Integer.MIN_VALUE);
+
+    expect(synchronizedStatic(i) == i + 1);
+
+    try {
+      expect(synchronizedBlock(i) == i);
+      expect(i % 7 != 0);
+    } catch (Failure e) {
+      expect(e.value == i && ! Thread.holdsLock(lock));
+    }
+
+    expect(classify(i).length() == new String[] {
+        "zero", "one", "two", "three" } [i % 4].length());
+
+    expect(sparse(7) == 2);
+    expect(sparse(1000000) == 3);
+    expect(sparse(i + 8) == 0);
+
+    expect(loop(i) == ((long) i * (i - 1)) / 2);
+
+    expect(arrays(i) == (byte) i + i);
+
+    Object o = shapes[2];
+    expect(o instanceof Rectangle);
+    try {
+      Square s = (Square) o;
+      expect(s == null);
+    } catch (ClassCastException e) {
+      // expected
+    }
+  }
+
+  public static void main(String[] args) {
+    Shape[] shapes = new Shape[] {
+      new Square(3), new Rectangle(2, 3), new Triangle(2, 3)
+    };
+
+    for (int i = 1; i <= Iterations; ++i) {
+      check(i, shapes);
+
+      // collections move the objects which interpreted frames refer to
+      if (i % 50 == 0) {
+        System.gc();
+      }
+    }
+
+    expect(counter == Iterations);
+
+    // the outermost frames of this recursion are interpreted and the
+    // rest compiled, and the overflow must unwind through both
+    try {
+      recurse(0);
+      expect(false);
+    } catch (StackOverflowError e) {
+      // expected
+    }
+
+    System.out.println("ran " + Iterations + " iterations across tiers");
+  }
+
+  private static int recurse(int n) {
+    return recurse(n + 1) + 1;
+  }
+}
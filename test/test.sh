@@ -1,6 +1,6 @@
 #!/bin/sh
 
-log=build/log.txt
+log=${log:-build/log.txt}
 vg="nice valgrind --leak-check=full --num-callers=32 \
 --freelist-vol=100000000 --error-exitcode=1"
 